@@ -144,6 +144,10 @@ namespace Candela
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 		glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, 1);
 
+		if (m_Headless) {
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		}
+
 		// Use the latest ogl version
 		m_Window = glfwCreateWindow(m_Width, m_Height, "Candela  | Loading Models, Shaders, Data Files, Textures etc..", NULL, NULL); 
 
@@ -236,7 +240,9 @@ namespace Candela
 			std::cout << "\t\nTHE OPENGL BINDLESS TEXTURE EXTENSION IS *NOT* AVAILABLE\n";
 		}
 
-		glfwMaximizeWindow(m_Window);
+		if (!m_Headless && !m_FixedSize) {
+			glfwMaximizeWindow(m_Window);
+		}
 
 #ifdef _WIN32
 		system("@del log.txt"); // Delete the already existing log file
@@ -245,6 +251,18 @@ namespace Candela
 		return;
 	}
 
+	void Application::SetHeadless(bool headless)
+	{
+		m_Headless = headless;
+	}
+
+	void Application::SetFixedWindowSize(unsigned int width, unsigned int height)
+	{
+		m_Width = width;
+		m_Height = height;
+		m_FixedSize = true;
+	}
+
 	/*
 	This function should be called every frame.
 	It updates the window, polls events 
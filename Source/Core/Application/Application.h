@@ -57,6 +57,11 @@ namespace Candela
 		void SetCursorLocked(bool locked);
 		inline bool GetCursorLocked() noexcept { return m_CursorLocked; }
 
+		// Both must be called before Initialize()
+		// A headless window is never shown, a fixed size window is not maximized
+		void SetHeadless(bool headless);
+		void SetFixedWindowSize(unsigned int width, unsigned int height);
+
 		inline float GetCursorX()
 		{
 			double x, y;
@@ -94,5 +99,7 @@ namespace Candela
 		int m_CurrentWidth = 0;
 		int m_CurrentHeight = 0;
 		bool m_CursorLocked = false;
+		bool m_Headless = false;
+		bool m_FixedSize = false;
 	};
 }
\ No newline at end of file
@@ -30,8 +30,11 @@
 #include <iostream>
 #include <queue>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
 
-#include <random>
 
 namespace Candela {
 	namespace BVH {
@@ -44,12 +47,16 @@ namespace Candela {
 		// Number of bins used to determine the optimal split position
 		const int BIN_COUNT = 64; 
 
-		// Max primitives each leaf can hold 
+		// Nodes with this many primitives or less always become leaves, larger leaves are formed by the SAH termination (see ConfigureLeafTermination)
 		// Recommended : 2 - 3
 		const int MAX_TRIANGLES_PER_LEAF = 2;
 
+		// Picks the child order of the stackless layout by tracing sample rays against every candidate ordering
 		const bool OPTIMIZE_FOR_AVERAGE_CASE = true;
 
+		// Rays traced per candidate ordering
+		const int CHILD_ORDERING_SAMPLE_RAYS = 4096;
+
 
 		
 		// Internal
@@ -58,13 +65,23 @@ namespace Candela {
 		static uint64_t TotalIterations = 0;
 		static uint64_t LeafNodeCount = 0;
 		static uint64_t LastNodeIndex = 0;
+
 		static uint64_t SplitFails = 0;
 		static uint MaxBVHDepth = 0;
 
+		static float TraversalCostRatio = 1.2f;
+		static uint MaxLeafSize = 8;
+
 		static int TriangleOffset_ = 0;
 
 		static bool UsesStackless = false;
 
+		static std::string CurrentModel_;
+
+		// The build state above is global, objects are rebuilt on background threads (see RayIntersector::RefitObject)
+		static std::mutex BuildMutex;
+		static std::vector<ChildOrderingStats> OrderingStats;
+
 		// Processing bin
 		class Bin {
 
@@ -86,6 +103,34 @@ namespace Candela {
 			return Length <= MAX_TRIANGLES_PER_LEAF;
 		}
 
+		void ConfigureLeafTermination(float TraversalCostRatio_, int MaxLeafSize_) {
+
+			if (TraversalCostRatio_ <= 0.0f) {
+				throw "ConfigureLeafTermination : TraversalCostRatio has to be > 0";
+			}
+
+			if (MaxLeafSize_ < MAX_TRIANGLES_PER_LEAF || MaxLeafSize_ > BVH_LEAF_LENGTH_MASK) {
+				throw "ConfigureLeafTermination : MaxLeafSize has to fit the packed leaf encoding";
+			}
+
+			TraversalCostRatio = TraversalCostRatio_;
+			MaxLeafSize = MaxLeafSize_;
+		}
+
+		// SplitCost is the children's area weighted triangle count (as returned by the SAH searches), not normalized
+		inline bool IsLeafCheaper(uint Length, float Area, float SplitCost) {
+			return Length <= MaxLeafSize && float(Length) * Area <= TraversalCostRatio * Area + SplitCost;
+		}
+
+		static int PackLeaf(uint StartIndex, uint Length) {
+
+			if (StartIndex >= (1u << (31 - BVH_LEAF_LENGTH_BITS)) || Length > BVH_LEAF_LENGTH_MASK) {
+				throw "PackLeaf : Leaf doesn't fit the packed leaf encoding";
+			}
+
+			return int((StartIndex << BVH_LEAF_LENGTH_BITS) | Length);
+		}
+
 		int FindLongestAxis(const Bounds& bounds) {
 			glm::vec3 Diff = bounds.Max - bounds.Min;
 
@@ -362,34 +407,243 @@ namespace Candela {
 
 		}
 
-		void GetSplit(Node* node, const std::vector<int>& TriangleReferences, const std::vector<Bounds>& BoundsCache, const std::vector<glm::vec3>& CentroidCache, int& oAxis, float& oBorder) {
+		// Returns the SAH cost of the split, INF_COST for median splits
+		float GetSplit(Node* node, const std::vector<int>& TriangleReferences, const std::vector<Bounds>& BoundsCache, const std::vector<glm::vec3>& CentroidCache, int& oAxis, float& oBorder) {
 
 			if (USE_SAH) {
 
 				if (!BINNED_SAH) {
-					SearchBestPlaneSAHLinear(node, TriangleReferences, BoundsCache, CentroidCache, oAxis, oBorder);
+					return SearchBestPlaneSAHLinear(node, TriangleReferences, BoundsCache, CentroidCache, oAxis, oBorder);
 				}
 
 				else {
-					SearchSAHPlaneBinned(node, TriangleReferences, BoundsCache, CentroidCache, oAxis, oBorder);
+					return SearchSAHPlaneBinned(node, TriangleReferences, BoundsCache, CentroidCache, oAxis, oBorder);
 				}
 			}
 
 			else {
 
 				GetMedianSplit(node, oAxis, oBorder);
+				return INF_COST;
+
+			}
+		}
+
+		float HashFloat(uint32_t x) {
+			x ^= x >> 16;
+			x *= 0x7feb352dU;
+			x ^= x >> 15;
+			x *= 0x846ca68bU;
+			x ^= x >> 16;
+			return float(x >> 8) / 16777216.0f;
+		}
+
+		// Child the stackless traversal visits first
+		static Node* GetFirstChild(Node* node, ChildOrdering Ordering) {
+
+			switch (Ordering) {
+
+				case ChildOrdering::LargerAreaFirst:
+					return node->LeftChildPtr->NodeBounds.GetArea() >= node->RightChildPtr->NodeBounds.GetArea() ? node->LeftChildPtr : node->RightChildPtr;
+
+				// The left child always holds the centroids below the split plane
+				case ChildOrdering::NegativeSideFirst:
+					return node->LeftChildPtr;
+
+				case ChildOrdering::PositiveSideFirst:
+					return node->RightChildPtr;
+			}
+
+			return node->LeftChildPtr;
+		}
+
+		bool IntersectBounds(const glm::vec3& Min, const glm::vec3& Max, const glm::vec3& Origin, const glm::vec3& InverseDirection, float TMax) {
+			glm::vec3 T0 = (Min - Origin) * InverseDirection;
+			glm::vec3 T1 = (Max - Origin) * InverseDirection;
+			glm::vec3 Near = glm::min(T0, T1);
+			glm::vec3 Far = glm::max(T0, T1);
+			float TNear = glm::max(glm::max(Near.x, Near.y), glm::max(Near.z, 0.0f));
+			float TFar = glm::min(glm::min(Far.x, Far.y), glm::min(Far.z, TMax));
+			return TNear <= TFar;
+		}
+
+		float IntersectTriangle(const glm::vec3& Origin, const glm::vec3& Direction, const glm::vec3& V0, const glm::vec3& V1, const glm::vec3& V2) {
+			glm::vec3 E1 = V1 - V0;
+			glm::vec3 E2 = V2 - V0;
+			glm::vec3 P = glm::cross(Direction, E2);
+			float Determinant = glm::dot(E1, P);
+
+			if (glm::abs(Determinant) < 1e-8f) {
+				return -1.0f;
+			}
+
+			float InverseDeterminant = 1.0f / Determinant;
+			glm::vec3 T = Origin - V0;
+			float U = glm::dot(T, P) * InverseDeterminant;
+
+			if (U < 0.0f || U > 1.0f) {
+				return -1.0f;
+			}
+
+			glm::vec3 Q = glm::cross(T, E1);
+			float V = glm::dot(Direction, Q) * InverseDeterminant;
+
+			if (V < 0.0f || U + V > 1.0f) {
+				return -1.0f;
+			}
+
+			return glm::dot(E2, Q) * InverseDeterminant;
+		}
+
+		struct OrderingContext {
+			const std::vector<Vertex>* Vertices;
+			const std::vector<GLuint>* OriginalIndices;
+			const std::vector<int>* SortedTriangleReferences;
+			ChildOrdering Ordering;
+		};
+
+		// Same visiting order as the stackless traversal : a node's box is tested, on a hit its first child is visited before its second
+		// Iterative, degenerate trees can be deeper than the call stack allows
+		static void TraceSampleRay(const OrderingContext& Context, Node* RootNode, const glm::vec3& Origin, const glm::vec3& Direction, const glm::vec3& InverseDirection, float& TMax, uint64_t& NodesVisited, std::vector<Node*>& Stack) {
+
+			Stack.clear();
+			Stack.push_back(RootNode);
+
+			while (!Stack.empty()) {
+
+				Node* node = Stack.back();
+				Stack.pop_back();
+
+				NodesVisited++;
+
+				if (!IntersectBounds(node->NodeBounds.Min, node->NodeBounds.Max, Origin, InverseDirection, TMax)) {
+					continue;
+				}
+
+				if (node->IsLeafNode) {
+
+					for (uint i = 0; i < node->Length; i++) {
+
+						int Reference = (*Context.SortedTriangleReferences)[node->StartIndex - TriangleOffset_ + i] * 3;
+
+						glm::vec3 V0 = glm::vec3((*Context.Vertices)[(*Context.OriginalIndices)[Reference + 0]].position);
+						glm::vec3 V1 = glm::vec3((*Context.Vertices)[(*Context.OriginalIndices)[Reference + 1]].position);
+						glm::vec3 V2 = glm::vec3((*Context.Vertices)[(*Context.OriginalIndices)[Reference + 2]].position);
+
+						float T = IntersectTriangle(Origin, Direction, V0, V1, V2);
+
+						if (T > 0.0f && T < TMax) {
+							TMax = T;
+						}
+					}
+
+					continue;
+				}
+
+				Node* First = GetFirstChild(node, Context.Ordering);
+				Node* Second = First == node->LeftChildPtr ? node->RightChildPtr : node->LeftChildPtr;
+
+				// Popped in reverse
+				Stack.push_back(Second);
+				Stack.push_back(First);
+			}
+		}
+
+		static void ApplyChildOrdering(Node* RootNode, ChildOrdering Ordering) {
+
+			std::vector<Node*> Stack = { RootNode };
+
+			while (!Stack.empty()) {
+
+				Node* node = Stack.back();
+				Stack.pop_back();
+
+				if (node->IsLeafNode) {
+					continue;
+				}
+
+				if (GetFirstChild(node, Ordering) != node->LeftChildPtr) {
+					std::swap(node->LeftChildPtr, node->RightChildPtr);
+				}
+
+				Stack.push_back(node->LeftChildPtr);
+				Stack.push_back(node->RightChildPtr);
+			}
+		}
+
+		// Traces the same sample rays (origins inside the scene bounds, uniform directions) against every candidate ordering
+		// and stores the children of every node in the order that visits the fewest nodes per ray
+		static void OrderChildren(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& OriginalIndices, Node* RootNode, const std::vector<int>& SortedTriangleReferences) {
+
+			ChildOrderingStats Stats;
+			Stats.Model = CurrentModel_;
+			Stats.SampleRays = CHILD_ORDERING_SAMPLE_RAYS;
+
+			if (RootNode->IsLeafNode) {
+				OrderingStats.push_back(Stats);
+				return;
+			}
+
+			OrderingContext Context = { &Vertices, &OriginalIndices, &SortedTriangleReferences, ChildOrdering::LargerAreaFirst };
+
+			const Bounds& SceneBounds = RootNode->NodeBounds;
+			uint64_t BestNodesVisited = UINT64_MAX;
+			std::vector<Node*> Stack;
+
+			for (int o = 0; o < CHILD_ORDERING_COUNT; o++) {
+
+				Context.Ordering = static_cast<ChildOrdering>(o);
+				uint64_t NodesVisited = 0;
+
+				for (int r = 0; r < CHILD_ORDERING_SAMPLE_RAYS; r++) {
+
+					uint32_t Seed = uint32_t(r) * 5u;
+
+					glm::vec3 Origin = glm::mix(SceneBounds.Min, SceneBounds.Max, glm::vec3(HashFloat(Seed), HashFloat(Seed + 1u), HashFloat(Seed + 2u)));
+
+					float CosTheta = HashFloat(Seed + 3u) * 2.0f - 1.0f;
+					float SinTheta = glm::sqrt(glm::max(1.0f - CosTheta * CosTheta, 0.0f));
+					float Phi = HashFloat(Seed + 4u) * 6.28318530718f;
+
+					glm::vec3 Direction = glm::vec3(SinTheta * glm::cos(Phi), SinTheta * glm::sin(Phi), CosTheta);
+					glm::vec3 InverseDirection = 1.0f / Direction;
+
+					float TMax = 1e30f;
+					TraceSampleRay(Context, RootNode, Origin, Direction, InverseDirection, TMax, NodesVisited, Stack);
+				}
+
+				Stats.AverageNodesVisited[o] = float(double(NodesVisited) / double(CHILD_ORDERING_SAMPLE_RAYS));
+
+				// Ties keep the earlier candidate so the choice only depends on the input
+				if (NodesVisited < BestNodesVisited) {
+					BestNodesVisited = NodesVisited;
+					Stats.Chosen = Context.Ordering;
+				}
+			}
+
+			ApplyChildOrdering(RootNode, Stats.Chosen);
+			OrderingStats.push_back(Stats);
+		}
+
+		const char* GetChildOrderingName(ChildOrdering Ordering) {
 
+			switch (Ordering) {
+				case ChildOrdering::LargerAreaFirst: return "LargerAreaFirst";
+				case ChildOrdering::NegativeSideFirst: return "NegativeSideFirst";
+				case ChildOrdering::PositiveSideFirst: return "PositiveSideFirst";
 			}
+
+			return "Unknown";
+		}
+
+		const std::vector<ChildOrderingStats>& GetChildOrderingStats() {
+			return OrderingStats;
 		}
 
 		void ConstructTree(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& OriginalIndices, std::vector<Triangle>& oTriangles, Node* RootNode, std::vector<int>& TriangleReferences, std::vector<int>& SortedTriangleReferences) {
 
 			int StatusFrequency = (OriginalIndices.size()) / 300;
 
-			std::random_device dev;
-			std::mt19937 rng(dev());
-			std::uniform_int_distribution<std::mt19937::result_type> Distribution(1, 4);
-
 			uint TriangleCountTotal = OriginalIndices.size() / 3;
 
 
@@ -453,7 +707,21 @@ namespace Candela {
 				Node* BuildNode = NodeStack.top();
 				NodeStack.pop();
 
-				if (ShouldBeLeaf(BuildNode->Length) || BuildNode->Length <= 1) {
+				int SplitAxis = -1;
+				float Border = 0.0f;
+				bool MakeLeaf = ShouldBeLeaf(BuildNode->Length) || BuildNode->Length <= 1;
+
+				if (!MakeLeaf) {
+
+					//SplitAxis = FindLongestAxis(BuildNode->NodeBounds);
+					//Border = Centroid[SplitAxis];
+					float SplitCost = GetSplit(BuildNode, TriangleReferences, BoundsCache, CentroidCache, SplitAxis, Border);
+
+					// Stop once splitting doesn't pay for the extra traversal step
+					MakeLeaf = USE_SAH && IsLeafCheaper(BuildNode->Length, BuildNode->NodeBounds.GetArea(), SplitCost);
+				}
+
+				if (MakeLeaf) {
 					BuildNode->IsLeafNode = true;
 					LeafNodeCount++;
 
@@ -471,14 +739,10 @@ namespace Candela {
 					continue;
 				}
 
-				glm::vec3 CentroidNodeBounds = BuildNode->NodeBounds.GetCenter();
-
-				int SplitAxis;
-				float Border;
-
-				//SplitAxis = FindLongestAxis(BuildNode->NodeBounds);
-				//Border = Centroid[SplitAxis];
-				GetSplit(BuildNode, TriangleReferences, BoundsCache, CentroidCache, SplitAxis, Border);
+				// No SAH plane on degenerate bounds, the midpoint fallback below takes over
+				if (SplitAxis < 0) {
+					GetMedianSplit(BuildNode, SplitAxis, Border);
+				}
 
 				// Set axis
 				BuildNode->Axis = SplitAxis;
@@ -596,18 +860,6 @@ namespace Candela {
 				LeftNode.NodeBounds = Bounds(LeftMin, LeftMax);
 				RightNode.NodeBounds = Bounds(RightMin, RightMax);
 
-				if (OPTIMIZE_FOR_AVERAGE_CASE && UsesStackless) {
-
-					uint32_t Hash = static_cast<uint32_t>(Distribution(rng));
-
-					// Swap left and right children randomly
-					if (Hash <= 2) {
-						Node* TempPtr = LeftNodePtr;
-						LeftNodePtr = RightNodePtr;
-						RightNodePtr = TempPtr;
-					}
-				}
-
 				// Since node is not a leaf node, make length 0
 				BuildNode->Length = 0;
 				BuildNode->LeftChildPtr = LeftNodePtr;
@@ -627,188 +879,1038 @@ namespace Candela {
 		}
 
 
-		void GenerateTriangles(const std::vector<int>& TriangleIndices, const std::vector<GLuint>& OriginalIndices, std::vector<Triangle>& oTriangles, const std::vector<int>& MeshIDs) {
-			
-
-
-			oTriangles.resize((TriangleIndices.size()));
-
-			for (int i = 0; i < TriangleIndices.size(); i++) {
-
-				auto& CurrentTriangle = oTriangles[i];
+		// LBVH 
+		// Triangles are sorted along a morton curve through their centroids and the hierarchy is emitted Karras-style (see "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees")
+		// Much faster to build than the binned SAH tree, traces slower
 
-				int TriangleIndex = TriangleIndices[i];
+		static bool LBVH63BitCodes = true;
+		static int LBVHClusterBits = 0;
 
-				// 3 indices correspond to a single triangle
-				int CurrentIndexRef = TriangleIndex * 3;
+		void ConfigureLBVH(bool Use63BitCodes, int ClusterBits) {
 
-				CurrentTriangle.PackedData[0] = OriginalIndices[CurrentIndexRef + 0];
-				CurrentTriangle.PackedData[1] = OriginalIndices[CurrentIndexRef + 1];
-				CurrentTriangle.PackedData[2] = OriginalIndices[CurrentIndexRef + 2];
-				CurrentTriangle.PackedData[3] = MeshIDs[TriangleIndex];
+			if (ClusterBits < 0) {
+				throw "ConfigureLBVH : ClusterBits has to be >= 0";
 			}
-		}
 
+			LBVH63BitCodes = Use63BitCodes;
+			LBVHClusterBits = ClusterBits;
+		}
 
+		// Chunks of at least 4096 elements, at most one per pool thread
+		static int GetParallelChunkCount(int Count) {
+			int ThreadCount = glm::clamp(GetParallelThreadCount(), 1, 64);
+			return glm::min(ThreadCount, glm::max(Count / 4096, 1));
+		}
 
-		void ConstructHierarchyLinear(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& OriginalIndices, std::vector<FlattenedNode>& FlattenedNodes, std::vector<Triangle>& oTriangles, const std::vector<int>& MeshIDs, Node* RootNode) {
+		// Spreads the low 10 bits out so that there are two zero bits between each of them
+		static uint64_t ExpandBits30(uint32_t x) {
+			x = (x * 0x00010001u) & 0xFF0000FFu;
+			x = (x * 0x00000101u) & 0x0F00F00Fu;
+			x = (x * 0x00000011u) & 0xC30C30C3u;
+			x = (x * 0x00000005u) & 0x49249249u;
+			return x;
+		}
 
-			bool DEBUG_BVH = false;
+		// Same for the low 21 bits
+		static uint64_t ExpandBits63(uint64_t x) {
+			x &= 0x1FFFFFull;
+			x = (x | x << 32) & 0x1F00000000FFFFull;
+			x = (x | x << 16) & 0x1F0000FF0000FFull;
+			x = (x | x << 8) & 0x100F00F00F00F00Full;
+			x = (x | x << 4) & 0x10C30C30C30C30C3ull;
+			x = (x | x << 2) & 0x1249249249249249ull;
+			return x;
+		}
 
-			std::vector<int> TriangleReferences;
-			std::vector<int> SortedReferences;
+		static uint64_t GetMortonCode(const glm::vec3& Normalized, bool Use63Bits) {
 
-			// Build tree 
-			ConstructTree(Vertices, OriginalIndices, oTriangles, RootNode, TriangleReferences, SortedReferences);
+			if (Use63Bits) {
+				glm::uvec3 Quantized = glm::uvec3(glm::clamp(Normalized * 2097152.0f, glm::vec3(0.0f), glm::vec3(2097151.0f)));
+				return (ExpandBits63(Quantized.x) << 2) | (ExpandBits63(Quantized.y) << 1) | ExpandBits63(Quantized.z);
+			}
 
-			// Flatten
-			std::vector<glm::ivec2> FlattenCache; 
-			int ProcessedNodes_ = 0;
+			glm::uvec3 Quantized = glm::uvec3(glm::clamp(Normalized * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f)));
+			return (ExpandBits30(Quantized.x) << 2) | (ExpandBits30(Quantized.y) << 1) | ExpandBits30(Quantized.z);
+		}
 
-			FlattenCache.resize(LastNodeIndex + 1);
-			FlattenedNodes.resize(LastNodeIndex + 1);
+		// LSD radix sort, 8 bits per pass, every pass histograms and scatters in parallel
+		static void RadixSortMortonCodes(std::vector<uint64_t>& Codes, std::vector<int>& References, int KeyBits) {
 
-			FlattenBVH(RootNode, FlattenedNodes, FlattenCache, ProcessedNodes_);
+			const int Count = (int)Codes.size();
+			const int ChunkCount = GetParallelChunkCount(Count);
 
-			if (DEBUG_BVH) {
+			std::vector<uint64_t> TempCodes(Count);
+			std::vector<int> TempReferences(Count);
+			std::vector<uint32_t> Histograms(ChunkCount * 256);
 
-				for (int i = 0; i < SortedReferences.size(); i++) {
+			for (int Shift = 0; Shift < KeyBits; Shift += 8) {
 
-					bool found = false;
+				std::fill(Histograms.begin(), Histograms.end(), 0u);
 
-					for (int j = 0; j < SortedReferences.size(); j++) {
+				ParallelFor(Count, ChunkCount, [&](int Chunk, int Start, int End) {
+					uint32_t* Histogram = &Histograms[Chunk * 256];
 
-						int CurrentElement = SortedReferences[j];
+					for (int i = Start; i < End; i++) {
+						Histogram[(Codes[i] >> Shift) & 0xFF]++;
+					}
+				});
 
-						if (CurrentElement == i) {
-							found = true;
-							break;
-						}
+				// Exclusive prefix sum, digit major so that each chunk scatters behind the previous chunks
+				uint32_t Sum = 0;
 
+				for (int Digit = 0; Digit < 256; Digit++) {
+					for (int Chunk = 0; Chunk < ChunkCount; Chunk++) {
+						uint32_t Value = Histograms[Chunk * 256 + Digit];
+						Histograms[Chunk * 256 + Digit] = Sum;
+						Sum += Value;
 					}
+				}
 
-					if (!found) {
-						std::cout << "\nBVH DEBUG -> DIDNT FIND ELEMENT : " << i;
+				ParallelFor(Count, ChunkCount, [&](int Chunk, int Start, int End) {
+					uint32_t* Offsets = &Histograms[Chunk * 256];
+
+					for (int i = Start; i < End; i++) {
+						uint32_t Destination = Offsets[(Codes[i] >> Shift) & 0xFF]++;
+						TempCodes[Destination] = Codes[i];
+						TempReferences[Destination] = References[i];
 					}
+				});
 
-				}
+				Codes.swap(TempCodes);
+				References.swap(TempReferences);
 			}
+		}
 
+		struct KarrasNode {
+			int Left;
+			int Right;
+			bool LeftIsLeaf;
+			bool RightIsLeaf;
+			int First; // Range of sorted primitives covered
+			int Last;
+		};
 
-			GenerateTriangles(SortedReferences, OriginalIndices, oTriangles, MeshIDs);
-		}
+		static int CountLeadingZeros64(uint64_t x) {
 
+			if (x == 0) {
+				return 64;
+			}
 
-		void ConstructHierarchy(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& OriginalIndices, std::vector<FlattenedNode>& FlattenedNodes, std::vector<Triangle>& oTriangles, const std::vector<int>& MeshIDs, Node* RootNode) {
+			int Count = 0;
 
-			bool DEBUG_BVH = false;
+			while (!(x & 0x8000000000000000ull)) {
+				x <<= 1;
+				Count++;
+			}
 
-			std::vector<int> TriangleReferences;
-			std::vector<int> SortedReferences;
+			return Count;
+		}
 
-			ConstructTree(Vertices, OriginalIndices, oTriangles, RootNode, TriangleReferences, SortedReferences);
+		// Length of the common prefix of the keys at i and j, duplicate codes are made unique by appending the index
+		static int GetCommonPrefix(const uint64_t* Codes, int Count, int i, int j) {
 
-			// Flatten!
+			if (j < 0 || j >= Count) {
+				return -1;
+			}
 
-			std::vector<glm::ivec2> FlattenCache;
-			int ProcessedNodes_ = 0;
+			if (Codes[i] == Codes[j]) {
+				return 64 + CountLeadingZeros64(uint64_t(uint32_t(i ^ j)) << 32);
+			}
 
-			FlattenCache.resize(LastNodeIndex + 1);
-			FlattenedNodes.resize(LastNodeIndex + 1);
+			return CountLeadingZeros64(Codes[i] ^ Codes[j]);
+		}
 
-			FlattenBVH(RootNode, FlattenedNodes, FlattenCache, ProcessedNodes_);
+		// Internal node i of the radix tree over Codes[0, Count), every node is independent of the others
+		static KarrasNode GetKarrasNode(const uint64_t* Codes, int Count, int i) {
 
-			if (DEBUG_BVH) {
+			// Direction of the range
+			int Direction = GetCommonPrefix(Codes, Count, i, i + 1) - GetCommonPrefix(Codes, Count, i, i - 1) >= 0 ? 1 : -1;
+			int MinPrefix = GetCommonPrefix(Codes, Count, i, i - Direction);
 
-				for (int i = 0; i < SortedReferences.size(); i++) {
+			// Upper bound of the range length, then binary search for the other end
+			int MaxLength = 2;
 
-					bool found = false;
+			while (GetCommonPrefix(Codes, Count, i, i + MaxLength * Direction) > MinPrefix) {
+				MaxLength *= 2;
+			}
 
-					for (int j = 0; j < SortedReferences.size(); j++) {
+			int Length = 0;
 
-						int CurrentElement = SortedReferences[j];
+			for (int t = MaxLength / 2; t >= 1; t /= 2) {
+				if (GetCommonPrefix(Codes, Count, i, i + (Length + t) * Direction) > MinPrefix) {
+					Length += t;
+				}
+			}
 
-						if (CurrentElement == i) {
-							found = true;
-							break;
-						}
+			int j = i + Length * Direction;
 
-					}
+			// Binary search for the split position
+			int NodePrefix = GetCommonPrefix(Codes, Count, i, j);
+			int Split = 0;
+			int Step = Length;
 
-					if (!found) {
-						std::cout << "\nBVH DEBUG -> DIDNT FIND ELEMENT : " << i;
-					}
+			do {
+				Step = (Step + 1) / 2;
 
+				if (GetCommonPrefix(Codes, Count, i, i + (Split + Step) * Direction) > NodePrefix) {
+					Split += Step;
 				}
-			}
 
-			GenerateTriangles(SortedReferences, OriginalIndices, oTriangles, MeshIDs);
-		}
+			} while (Step > 1);
 
-		void ConstructHierarchy_StackBVH(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& OriginalIndices, std::vector<FlattenedStackNode>& FlattenedNodes, std::vector<Triangle>& oTriangles, const std::vector<int>& MeshIDs, Node* RootNode) {
+			int Gamma = i + Split * Direction + glm::min(Direction, 0);
 
-			bool DEBUG_BVH = false;
+			KarrasNode Result;
+			Result.First = glm::min(i, j);
+			Result.Last = glm::max(i, j);
+			Result.Left = Gamma;
+			Result.Right = Gamma + 1;
+			Result.LeftIsLeaf = Result.First == Gamma;
+			Result.RightIsLeaf = Result.Last == Gamma + 1;
+			return Result;
+		}
 
+		struct LBVHContext {
+			std::vector<uint64_t> Codes;
 			std::vector<int> TriangleReferences;
-			std::vector<int> SortedReferences;
-
-			ConstructTree(Vertices, OriginalIndices, oTriangles, RootNode, TriangleReferences, SortedReferences);
+			std::vector<Bounds> BoundsCache;
+			std::vector<glm::vec3> CentroidCache;
+		};
 
-			// Flatten!
+		static Bounds GetRangeBounds(const LBVHContext& Context, int First, int Count) {
 
-			std::vector<glm::ivec2> FlattenCache;
-			int ProcessedNodes_ = 0;
+			Bounds RangeBounds;
 
-			FlattenCache.resize(LastNodeIndex + 1);
-			FlattenedNodes.resize(LastNodeIndex + 1);
+			for (int i = First; i < First + Count; i++) {
+				const Bounds& TriangleBounds = Context.BoundsCache[Context.TriangleReferences[i]];
+				RangeBounds.Min = glm::min(RangeBounds.Min, TriangleBounds.Min);
+				RangeBounds.Max = glm::max(RangeBounds.Max, TriangleBounds.Max);
+			}
 
-			FlattenStackBVH(FlattenedNodes, RootNode);
-			GenerateTriangles(SortedReferences, OriginalIndices, oTriangles, MeshIDs);
+			return RangeBounds;
 		}
 
+		static Node* CreateLBVHLeaf(const LBVHContext& Context, int First, int Count) {
 
-		uint FlattenBVHNaive(Node* RootNode, uint* offset) {
-
-			std::stack<FlattenedNode> WorkStack;
+			Node* Leaf = new Node;
+			Leaf->IsLeafNode = true;
+			Leaf->StartIndex = First + TriangleOffset_;
+			Leaf->Length = Count;
+			Leaf->NodeBounds = GetRangeBounds(Context, First, Count);
+			Leaf->SAHCost = Leaf->NodeBounds.GetArea() * float(Count);
 
-			for (int i = 0; i < LastNodeIndex; i++) {
+			return Leaf;
+		}
 
+		static Node* CreateLBVHInner(Node* Left, Node* Right) {
 
+			Node* Inner = new Node;
+			Inner->IsLeafNode = false;
+			Inner->Length = 0;
+			Inner->LeftChildPtr = Left;
+			Inner->RightChildPtr = Right;
+			Inner->NodeBounds = Bounds(glm::min(Left->NodeBounds.Min, Right->NodeBounds.Min), glm::max(Left->NodeBounds.Max, Right->NodeBounds.Max));
+			Inner->Axis = FindLongestAxis(Inner->NodeBounds);
+			Inner->SAHCost = TraversalCostRatio * Inner->NodeBounds.GetArea() + Left->SAHCost + Right->SAHCost;
 
+			return Inner;
+		}
 
+		// Subtrees small enough to fit in a leaf are collapsed into one, bottom up, if the leaf is cheaper than the subtree
+		// Karras nodes cover contiguous ranges of the sorted triangles, so every subtree can become a leaf
+		static Node* ConvertKarrasNode(const LBVHContext& Context, const std::vector<KarrasNode>& Nodes, int Offset, int Index, bool IsLeaf) {
 
+			if (IsLeaf) {
+				return CreateLBVHLeaf(Context, Offset + Index, 1);
 			}
-		}
 
-		int FlattenBVHRecursive(const Node* RootNode, std::vector<FlattenedNode>& FlattenedNodes, std::vector<glm::ivec2>& Cache, int& ProcessedNodes) {
+			const KarrasNode& Current = Nodes[Index];
+			int Count = Current.Last - Current.First + 1;
 
-			int idx = ProcessedNodes;
-			FlattenedNode& node = FlattenedNodes[ProcessedNodes];
-			node.Min = glm::vec4(RootNode->NodeBounds.Min, 0.0f);
-			node.Max = glm::vec4(RootNode->NodeBounds.Max, 0.0f);
+			if (ShouldBeLeaf(Count)) {
+				return CreateLBVHLeaf(Context, Offset + Current.First, Count);
+			}
 
-			glm::ivec2& CacheRef = Cache[ProcessedNodes++];
+			Node* Left = ConvertKarrasNode(Context, Nodes, Offset, Current.Left, Current.LeftIsLeaf);
+			Node* Right = ConvertKarrasNode(Context, Nodes, Offset, Current.Right, Current.RightIsLeaf);
+			Node* Inner = CreateLBVHInner(Left, Right);
 
-			if (RootNode->IsLeafNode)
-			{
-				int Packed = (RootNode->StartIndex << 4) | (RootNode->Length & 0xF); // <- Pack data 
-				CacheRef.y = Packed;
-				CacheRef.x = -1; // <- flag
-			}
-			else
-			{
-				FlattenBVHRecursive(RootNode->LeftChildPtr, FlattenedNodes, Cache, ProcessedNodes);
-				
-				// Store links to right nodes
-				CacheRef.x = FlattenBVHRecursive(RootNode->RightChildPtr, FlattenedNodes, Cache, ProcessedNodes);
+			if (IsLeafCheaper(Count, Inner->NodeBounds.GetArea(), Inner->SAHCost - TraversalCostRatio * Inner->NodeBounds.GetArea())) {
+				DeleteBVH(Inner);
+				return CreateLBVHLeaf(Context, Offset + Current.First, Count);
 			}
 
-			return idx;
+			return Inner;
 		}
 
-		void FlattenBVH(const Node* RootNode, std::vector<FlattenedNode>& FlattenedNodes, std::vector <glm::ivec2> & Cache, int& ProcessedNodes) {
+		static Node* EmitKarrasTree(const LBVHContext& Context, int First, int Count) {
 
-			FlattenBVHRecursive(RootNode, FlattenedNodes, Cache, ProcessedNodes);
+			if (ShouldBeLeaf(Count)) {
+				return CreateLBVHLeaf(Context, First, Count);
+			}
+
+			const uint64_t* Codes = &Context.Codes[First];
+
+			std::vector<KarrasNode> Nodes(Count - 1);
+
+			ParallelFor(Count - 1, GetParallelChunkCount(Count - 1), [&](int, int Start, int End) {
+				for (int i = Start; i < End; i++) {
+					Nodes[i] = GetKarrasNode(Codes, Count, i);
+				}
+			});
+
+			return ConvertKarrasNode(Context, Nodes, First, 0, false);
+		}
+
+		// Run of sorted triangles that share the top LBVHClusterBits bits of their morton code
+		struct LBVHCluster {
+			int First;
+			int Count;
+			Bounds ClusterBounds;
+			glm::vec3 Centroid;
+		};
+
+		// Binned SAH over the cluster centroids, every cluster weighs as much as the triangles it holds
+		static bool SearchClusterSplit(const std::vector<LBVHCluster>& Clusters, int Begin, int End, int& oAxis, float& oBorder) {
+
+			Bounds CentroidBounds;
+
+			for (int i = Begin; i < End; i++) {
+				CentroidBounds.Min = glm::min(CentroidBounds.Min, Clusters[i].Centroid);
+				CentroidBounds.Max = glm::max(CentroidBounds.Max, Clusters[i].Centroid);
+			}
+
+			float BestCost = INF_COST;
+
+			for (int Axis = 0; Axis < 3; Axis++) {
+
+				float MinAxis = CentroidBounds.Min[Axis];
+				float Extent = CentroidBounds.Max[Axis] - MinAxis;
+
+				if (Extent <= 0.0f) {
+					continue;
+				}
+
+				Bin Bins[BIN_COUNT];
+				float Scale = BIN_COUNT / Extent;
+
+				for (int i = Begin; i < End; i++) {
+					int BinIndex = glm::min(BIN_COUNT - 1, (int)((Clusters[i].Centroid[Axis] - MinAxis) * Scale));
+					Bins[BinIndex].Primitives += Clusters[i].Count;
+					Bins[BinIndex].bounds.Min = glm::min(Bins[BinIndex].bounds.Min, Clusters[i].ClusterBounds.Min);
+					Bins[BinIndex].bounds.Max = glm::max(Bins[BinIndex].bounds.Max, Clusters[i].ClusterBounds.Max);
+				}
+
+				float RightAreas[BIN_COUNT - 1];
+				int RightCount[BIN_COUNT - 1];
+				Bounds RightBox;
+				int RightSum = 0;
+
+				for (int i = BIN_COUNT - 1; i > 0; i--) {
+					RightSum += Bins[i].Primitives;
+					RightBox.Min = glm::min(RightBox.Min, Bins[i].bounds.Min);
+					RightBox.Max = glm::max(RightBox.Max, Bins[i].bounds.Max);
+					RightCount[i - 1] = RightSum;
+					RightAreas[i - 1] = RightBox.GetArea();
+				}
+
+				Bounds LeftBox;
+				int LeftSum = 0;
+
+				for (int i = 0; i < BIN_COUNT - 1; i++) {
+
+					LeftSum += Bins[i].Primitives;
+					LeftBox.Min = glm::min(LeftBox.Min, Bins[i].bounds.Min);
+					LeftBox.Max = glm::max(LeftBox.Max, Bins[i].bounds.Max);
+
+					if (LeftSum == 0 || RightCount[i] == 0) {
+						continue;
+					}
+
+					float CostAt = LeftSum * LeftBox.GetArea() + RightCount[i] * RightAreas[i];
+
+					if (CostAt < BestCost) {
+						BestCost = CostAt;
+						oAxis = Axis;
+						oBorder = MinAxis + (Extent / BIN_COUNT) * (i + 1);
+					}
+				}
+			}
+
+			return BestCost < INF_COST;
+		}
+
+		// The hierarchy above the clusters is built with binned SAH, every cluster is emitted as its own Karras tree (see "HLBVH: Hierarchical LBVH Construction for Real-Time Ray Tracing")
+		// Clusters stay contiguous ranges of the sorted triangles, so only the clusters are reordered
+		static Node* BuildClusterTree(const LBVHContext& Context, std::vector<LBVHCluster>& Clusters, int Begin, int End) {
+
+			if (End - Begin == 1) {
+				return EmitKarrasTree(Context, Clusters[Begin].First, Clusters[Begin].Count);
+			}
+
+			// Falls back to halving the list, which is still in morton order if the partition didn't move anything
+			int Middle = Begin + (End - Begin) / 2;
+
+			int Axis = -1;
+			float Border = 0.0f;
+
+			if (SearchClusterSplit(Clusters, Begin, End, Axis, Border)) {
+
+				auto Split = std::stable_partition(Clusters.begin() + Begin, Clusters.begin() + End, [&](const LBVHCluster& Cluster) {
+					return Cluster.Centroid[Axis] < Border;
+				});
+
+				int SplitIndex = (int)(Split - Clusters.begin());
+
+				if (SplitIndex > Begin && SplitIndex < End) {
+					Middle = SplitIndex;
+				}
+
+				else {
+					SplitFails++;
+				}
+			}
+
+			else {
+				SplitFails++;
+			}
+
+			Node* Left = BuildClusterTree(Context, Clusters, Begin, Middle);
+			Node* Right = BuildClusterTree(Context, Clusters, Middle, End);
+			return CreateLBVHInner(Left, Right);
+		}
+
+		static Node* BuildLBVHClustered(const LBVHContext& Context, int TriangleCount) {
+
+			int KeyBits = LBVH63BitCodes ? 63 : 30;
+			int Shift = KeyBits - glm::min(LBVHClusterBits, KeyBits);
+
+			std::vector<LBVHCluster> Clusters;
+
+			for (int i = 0; i < TriangleCount; i++) {
+
+				if (i == 0 || (Context.Codes[i] >> Shift) != (Context.Codes[i - 1] >> Shift)) {
+					Clusters.push_back({ i, 0, Bounds(), glm::vec3(0.0f) });
+				}
+
+				Clusters.back().Count++;
+			}
+
+			ParallelFor((int)Clusters.size(), GetParallelChunkCount((int)Clusters.size()), [&](int, int Start, int End) {
+				for (int i = Start; i < End; i++) {
+					Clusters[i].ClusterBounds = GetRangeBounds(Context, Clusters[i].First, Clusters[i].Count);
+					Clusters[i].Centroid = Clusters[i].ClusterBounds.GetCenter();
+				}
+			});
+
+			return BuildClusterTree(Context, Clusters, 0, (int)Clusters.size());
+		}
+
+		// Leaves are collapsed after they're created, so the stats are gathered from the finished tree
+		static uint64_t CountNodes(const Node* node, uint Depth) {
+
+			if (node->IsLeafNode) {
+				LeafNodeCount++;
+				MaxBVHDepth = glm::max(MaxBVHDepth, Depth);
+				return 1;
+			}
+
+			return 1 + CountNodes(node->LeftChildPtr, Depth + 1) + CountNodes(node->RightChildPtr, Depth + 1);
+		}
+
+		// Fills the same node tree and sorted triangle references as ConstructTree()
+		void ConstructTreeLBVH(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& OriginalIndices, Node* RootNode, std::vector<int>& SortedTriangleReferences) {
+
+			int TriangleCount = (int)OriginalIndices.size() / 3;
+
+			LBVHContext Context;
+			Context.Codes.resize(TriangleCount);
+			Context.TriangleReferences.resize(TriangleCount);
+			Context.BoundsCache.resize(TriangleCount);
+			Context.CentroidCache.resize(TriangleCount);
+
+			ParallelFor(TriangleCount, GetParallelChunkCount(TriangleCount), [&](int, int Start, int End) {
+				for (int i = Start; i < End; i++) {
+
+					Bounds CurrentBounds;
+
+					for (int t = 0; t < 3; t++) {
+						CurrentBounds.Min = glm::min(CurrentBounds.Min, glm::vec3(Vertices[OriginalIndices[i * 3 + t]].position));
+						CurrentBounds.Max = glm::max(CurrentBounds.Max, glm::vec3(Vertices[OriginalIndices[i * 3 + t]].position));
+					}
+
+					Context.BoundsCache[i] = CurrentBounds;
+					Context.CentroidCache[i] = CurrentBounds.GetCenter();
+					Context.TriangleReferences[i] = i;
+				}
+			});
+
+			// Codes are quantized within the centroid bounds
+			Bounds CentroidBounds;
+
+			for (int i = 0; i < TriangleCount; i++) {
+				CentroidBounds.Min = glm::min(CentroidBounds.Min, Context.CentroidCache[i]);
+				CentroidBounds.Max = glm::max(CentroidBounds.Max, Context.CentroidCache[i]);
+			}
+
+			glm::vec3 InverseExtent = 1.0f / glm::max(CentroidBounds.GetExtent(), glm::vec3(1e-6f));
+
+			ParallelFor(TriangleCount, GetParallelChunkCount(TriangleCount), [&](int, int Start, int End) {
+				for (int i = Start; i < End; i++) {
+					Context.Codes[i] = GetMortonCode((Context.CentroidCache[i] - CentroidBounds.Min) * InverseExtent, LBVH63BitCodes);
+				}
+			});
+
+			RadixSortMortonCodes(Context.Codes, Context.TriangleReferences, LBVH63BitCodes ? 64 : 32);
+
+			Node* Root = LBVHClusterBits > 0 ? BuildLBVHClustered(Context, TriangleCount) : EmitKarrasTree(Context, 0, TriangleCount);
+			*RootNode = *Root;
+			delete Root;
+
+			LastNodeIndex = CountNodes(RootNode, 1) - 1;
+			TotalIterations = LastNodeIndex + 1;
+			SortedTriangleReferences.swap(Context.TriangleReferences);
+		}
+
+		void GenerateTriangles(const std::vector<int>& TriangleIndices, const std::vector<GLuint>& OriginalIndices, std::vector<Triangle>& oTriangles, const std::vector<int>& MeshIDs) {
+			
+
+
+			oTriangles.resize((TriangleIndices.size()));
+
+			for (int i = 0; i < TriangleIndices.size(); i++) {
+
+				auto& CurrentTriangle = oTriangles[i];
+
+				int TriangleIndex = TriangleIndices[i];
+
+				// 3 indices correspond to a single triangle
+				int CurrentIndexRef = TriangleIndex * 3;
+
+				CurrentTriangle.PackedData[0] = OriginalIndices[CurrentIndexRef + 0];
+				CurrentTriangle.PackedData[1] = OriginalIndices[CurrentIndexRef + 1];
+				CurrentTriangle.PackedData[2] = OriginalIndices[CurrentIndexRef + 2];
+				CurrentTriangle.PackedData[3] = MeshIDs[TriangleIndex];
+			}
+		}
+
+		void GenerateTriangleIntersectionData(const Triangle* Triangles, int Count, const Vertex* Vertices, int VerticesOffset, TriangleIntersectionData* oData) {
+
+			for (int i = 0; i < Count; i++) {
+
+				glm::vec3 V0 = glm::vec3(Vertices[Triangles[i].PackedData[0] - VerticesOffset].position);
+				glm::vec3 V1 = glm::vec3(Vertices[Triangles[i].PackedData[1] - VerticesOffset].position);
+				glm::vec3 V2 = glm::vec3(Vertices[Triangles[i].PackedData[2] - VerticesOffset].position);
+
+				oData[i].Vertex0 = glm::vec4(V0, glm::intBitsToFloat(Triangles[i].PackedData[3]));
+				oData[i].Edge1 = glm::vec4(V1 - V0, 0.0f);
+				oData[i].Edge2 = glm::vec4(V2 - V0, 0.0f);
+			}
+		}
+
+
+
+		// Treelet restructuring 
+		// Post-build pass over the node tree (see "Fast Parallel Construction of High-Quality Bounding Volume Hierarchies", Karras and Aila)
+		// Every internal node is the root of a treelet grown to TREELET_SIZE leaves (largest area first), the treelet's topology is replaced
+		// by the one with the lowest SAH cost (exhaustive over the leaf subsets). Leaves aren't touched, so the triangle order stays valid
+
+		const int TREELET_SIZE = 7;
+		const int TREELET_PASSES = 3;
+
+		static bool OptimizeTreelets = false;
+		static float TreeletTimeBudget = 0.0f;
+
+		void ConfigureTreeletOptimization(bool Enabled, float TimeBudgetMs) {
+
+			if (TimeBudgetMs <= 0.0f) {
+				throw "ConfigureTreeletOptimization : Time budget has to be > 0";
+			}
+
+			OptimizeTreelets = Enabled;
+			TreeletTimeBudget = TimeBudgetMs;
+		}
+
+		// Traversal cost TraversalCostRatio, intersection cost 1 per triangle, not normalized by the root's area
+		static float ComputeSubtreeCost(Node* node) {
+
+			if (node->IsLeafNode) {
+				node->SAHCost = node->NodeBounds.GetArea() * float(node->Length);
+			}
+
+			else {
+				node->SAHCost = TraversalCostRatio * node->NodeBounds.GetArea() + ComputeSubtreeCost(node->LeftChildPtr) + ComputeSubtreeCost(node->RightChildPtr);
+			}
+
+			return node->SAHCost;
+		}
+
+		static Bounds MergeBounds(const Bounds& a, const Bounds& b) {
+			return Bounds(glm::min(a.Min, b.Min), glm::max(a.Max, b.Max));
+		}
+
+		struct Treelet {
+			Node* Leaves[TREELET_SIZE];
+			Node* Internals[TREELET_SIZE - 1];
+			int LeafCount = 0;
+			int InternalCount = 0;
+
+			float Area[1 << TREELET_SIZE];
+			float Cost[1 << TREELET_SIZE];
+			int Partition[1 << TREELET_SIZE];
+		};
+
+		static void FormTreelet(Node* Root, Treelet& treelet) {
+
+			treelet.Internals[0] = Root;
+			treelet.InternalCount = 1;
+			treelet.Leaves[0] = Root->LeftChildPtr;
+			treelet.Leaves[1] = Root->RightChildPtr;
+			treelet.LeafCount = 2;
+
+			while (treelet.LeafCount < TREELET_SIZE) {
+
+				int Largest = -1;
+				float LargestArea = -1.0f;
+
+				for (int i = 0; i < treelet.LeafCount; i++) {
+
+					float Area = treelet.Leaves[i]->NodeBounds.GetArea();
+
+					if (!treelet.Leaves[i]->IsLeafNode && Area > LargestArea) {
+						Largest = i;
+						LargestArea = Area;
+					}
+				}
+
+				if (Largest < 0) {
+					break;
+				}
+
+				Node* Expanded = treelet.Leaves[Largest];
+				treelet.Internals[treelet.InternalCount++] = Expanded;
+				treelet.Leaves[Largest] = Expanded->LeftChildPtr;
+				treelet.Leaves[treelet.LeafCount++] = Expanded->RightChildPtr;
+			}
+		}
+
+		static void RebuildTreelet(Treelet& treelet, int Subset, Node* Target, int& NextInternal) {
+
+			int Left = treelet.Partition[Subset];
+			int Right = Subset ^ Left;
+
+			Node* Children[2];
+			int Subsets[2] = { Left, Right };
+
+			for (int c = 0; c < 2; c++) {
+
+				// Single leaf
+				if ((Subsets[c] & (Subsets[c] - 1)) == 0) {
+					int Index = 0;
+					while (!(Subsets[c] & (1 << Index))) { Index++; }
+					Children[c] = treelet.Leaves[Index];
+				}
+
+				else {
+					Children[c] = treelet.Internals[NextInternal++];
+					RebuildTreelet(treelet, Subsets[c], Children[c], NextInternal);
+				}
+			}
+
+			Target->IsLeafNode = false;
+			Target->Length = 0;
+			Target->LeftChildPtr = Children[0];
+			Target->RightChildPtr = Children[1];
+			Target->NodeBounds = MergeBounds(Children[0]->NodeBounds, Children[1]->NodeBounds);
+			Target->Axis = FindLongestAxis(Target->NodeBounds);
+			Target->SAHCost = treelet.Cost[Subset];
+		}
+
+		// Returns true if the treelet was restructured
+		static bool OptimizeTreelet(Node* Root) {
+
+			Treelet treelet;
+			FormTreelet(Root, treelet);
+
+			if (treelet.LeafCount < 3) {
+				return false;
+			}
+
+			const int Full = (1 << treelet.LeafCount) - 1;
+
+			for (int s = 1; s <= Full; s++) {
+
+				Bounds SubsetBounds;
+
+				for (int i = 0; i < treelet.LeafCount; i++) {
+					if (s & (1 << i)) {
+						SubsetBounds = MergeBounds(SubsetBounds, treelet.Leaves[i]->NodeBounds);
+					}
+				}
+
+				treelet.Area[s] = SubsetBounds.GetArea();
+			}
+
+			for (int i = 0; i < treelet.LeafCount; i++) {
+				treelet.Cost[1 << i] = treelet.Leaves[i]->SAHCost;
+			}
+
+			// Subsets in increasing numeric order have every proper subset solved before them
+			for (int s = 1; s <= Full; s++) {
+
+				if ((s & (s - 1)) == 0) {
+					continue;
+				}
+
+				float Best = INF_COST;
+				int BestPartition = 0;
+				int Lowest = s & (-s);
+
+				// Partitions containing the lowest leaf, so that every split is only evaluated once
+				for (int p = (s - 1) & s; p > 0; p = (p - 1) & s) {
+
+					if (!(p & Lowest)) {
+						continue;
+					}
+
+					float Cost = treelet.Cost[p] + treelet.Cost[s ^ p];
+
+					if (Cost < Best) {
+						Best = Cost;
+						BestPartition = p;
+					}
+				}
+
+				treelet.Cost[s] = TraversalCostRatio * treelet.Area[s] + Best;
+				treelet.Partition[s] = BestPartition;
+			}
+
+			if (treelet.Cost[Full] >= Root->SAHCost * 0.9999f) {
+				return false;
+			}
+
+			int NextInternal = 1;
+			RebuildTreelet(treelet, Full, Root, NextInternal);
+			return true;
+		}
+
+		// Children before parents
+		static void GetPostOrder(Node* Root, std::vector<Node*>& oNodes) {
+
+			std::vector<Node*> Stack = { Root };
+
+			while (!Stack.empty()) {
+
+				Node* Current = Stack.back();
+				Stack.pop_back();
+
+				if (Current->IsLeafNode) {
+					continue;
+				}
+
+				oNodes.push_back(Current);
+				Stack.push_back(Current->LeftChildPtr);
+				Stack.push_back(Current->RightChildPtr);
+			}
+
+			std::reverse(oNodes.begin(), oNodes.end());
+		}
+
+		static void OptimizeTree(Node* RootNode) {
+
+			if (!OptimizeTreelets || RootNode->IsLeafNode) {
+				return;
+			}
+
+			auto Start = std::chrono::steady_clock::now();
+			auto Deadline = Start + std::chrono::microseconds((int64_t)(TreeletTimeBudget * 1000.0f));
+
+			float InitialCost = ComputeSubtreeCost(RootNode);
+
+			std::atomic<uint64_t> Restructured(0);
+			int Passes = 0;
+
+			for (int Pass = 0; Pass < TREELET_PASSES && std::chrono::steady_clock::now() < Deadline; Pass++) {
+
+				Passes++;
+
+				// Split the tree breadth first into a few subtrees per thread, they're optimized in parallel and the nodes above them afterwards
+				int TargetSubtrees = GetParallelThreadCount() * 4;
+
+				std::vector<Node*> Frontier = { RootNode };
+				std::vector<Node*> Top;
+
+				while ((int)Frontier.size() < TargetSubtrees) {
+
+					std::vector<Node*> NextFrontier;
+
+					for (Node* Current : Frontier) {
+
+						if (Current->IsLeafNode) {
+							continue;
+						}
+
+						Top.push_back(Current);
+						NextFrontier.push_back(Current->LeftChildPtr);
+						NextFrontier.push_back(Current->RightChildPtr);
+					}
+
+					if (NextFrontier.empty()) {
+						break;
+					}
+
+					Frontier = NextFrontier;
+				}
+
+				uint64_t PassStart = Restructured;
+
+				auto OptimizeNodes = [&](const std::vector<Node*>& Nodes) {
+					for (Node* Current : Nodes) {
+
+						if (std::chrono::steady_clock::now() >= Deadline) {
+							return;
+						}
+
+						Current->SAHCost = TraversalCostRatio * Current->NodeBounds.GetArea() + Current->LeftChildPtr->SAHCost + Current->RightChildPtr->SAHCost;
+
+						if (OptimizeTreelet(Current)) {
+							Restructured++;
+						}
+					}
+				};
+
+				// One chunk per subtree so the pool balances uneven subtrees
+				ParallelFor((int)Frontier.size(), (int)Frontier.size(), [&](int, int Start, int End) {
+					for (int s = Start; s < End; s++) {
+
+						if (Frontier[s]->IsLeafNode) {
+							continue;
+						}
+
+						std::vector<Node*> Nodes;
+						GetPostOrder(Frontier[s], Nodes);
+						OptimizeNodes(Nodes);
+					}
+				});
+
+				OptimizeNodes(std::vector<Node*>(Top.rbegin(), Top.rend()));
+
+				if (Restructured == PassStart) {
+					break;
+				}
+			}
+
+			// Nodes skipped once the budget ran out still hold stale costs
+			float FinalCost = ComputeSubtreeCost(RootNode);
+
+			auto End = std::chrono::steady_clock::now();
+
+			std::cout << "\nTreelet Optimization : SAH cost " << InitialCost / RootNode->NodeBounds.GetArea() << " -> " << FinalCost / RootNode->NodeBounds.GetArea();
+			std::cout << " (" << Restructured << " treelets restructured in " << Passes << " passes, " << std::chrono::duration_cast<std::chrono::milliseconds>(End - Start).count() << " ms)";
+		}
+
+		// Runs after either builder, before flattening
+		static void FinalizeTree(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& OriginalIndices, Node* RootNode, const std::vector<int>& SortedReferences, BuildMode Mode) {
+
+			OptimizeTree(RootNode);
+
+			// Children are ordered once every leaf references its triangles (skipped for LBVH to keep rebuilds cheap)
+			if (OPTIMIZE_FOR_AVERAGE_CASE && UsesStackless && Mode == BuildMode::SAH) {
+				OrderChildren(Vertices, OriginalIndices, RootNode, SortedReferences);
+			}
+		}
+
+		void ConstructHierarchyLinear(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& OriginalIndices, std::vector<FlattenedNode>& FlattenedNodes, std::vector<Triangle>& oTriangles, const std::vector<int>& MeshIDs, Node* RootNode) {
+
+			bool DEBUG_BVH = false;
+
+			std::vector<int> TriangleReferences;
+			std::vector<int> SortedReferences;
+
+			// Build tree 
+			ConstructTree(Vertices, OriginalIndices, oTriangles, RootNode, TriangleReferences, SortedReferences);
+			FinalizeTree(Vertices, OriginalIndices, RootNode, SortedReferences, BuildMode::SAH);
+
+			// Flatten
+			std::vector<glm::ivec2> FlattenCache; 
+			int ProcessedNodes_ = 0;
+
+			FlattenCache.resize(LastNodeIndex + 1);
+			FlattenedNodes.resize(LastNodeIndex + 1);
+
+			FlattenBVH(RootNode, FlattenedNodes, FlattenCache, ProcessedNodes_);
+
+			if (DEBUG_BVH) {
+
+				for (int i = 0; i < SortedReferences.size(); i++) {
+
+					bool found = false;
+
+					for (int j = 0; j < SortedReferences.size(); j++) {
+
+						int CurrentElement = SortedReferences[j];
+
+						if (CurrentElement == i) {
+							found = true;
+							break;
+						}
+
+					}
+
+					if (!found) {
+						std::cout << "\nBVH DEBUG -> DIDNT FIND ELEMENT : " << i;
+					}
+
+				}
+			}
+
+
+			GenerateTriangles(SortedReferences, OriginalIndices, oTriangles, MeshIDs);
+		}
+
+
+		void ConstructHierarchy(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& OriginalIndices, std::vector<FlattenedNode>& FlattenedNodes, std::vector<Triangle>& oTriangles, const std::vector<int>& MeshIDs, Node* RootNode, BuildMode Mode) {
+
+			bool DEBUG_BVH = false;
+
+			std::vector<int> TriangleReferences;
+			std::vector<int> SortedReferences;
+
+			if (Mode == BuildMode::LBVH) {
+				ConstructTreeLBVH(Vertices, OriginalIndices, RootNode, SortedReferences);
+			}
+
+			else {
+				ConstructTree(Vertices, OriginalIndices, oTriangles, RootNode, TriangleReferences, SortedReferences);
+			}
+
+			FinalizeTree(Vertices, OriginalIndices, RootNode, SortedReferences, Mode);
+
+			// Flatten!
+
+			std::vector<glm::ivec2> FlattenCache;
+			int ProcessedNodes_ = 0;
+
+			FlattenCache.resize(LastNodeIndex + 1);
+			FlattenedNodes.resize(LastNodeIndex + 1);
+
+			FlattenBVH(RootNode, FlattenedNodes, FlattenCache, ProcessedNodes_);
+
+			if (DEBUG_BVH) {
+
+				for (int i = 0; i < SortedReferences.size(); i++) {
+
+					bool found = false;
+
+					for (int j = 0; j < SortedReferences.size(); j++) {
+
+						int CurrentElement = SortedReferences[j];
+
+						if (CurrentElement == i) {
+							found = true;
+							break;
+						}
+
+					}
+
+					if (!found) {
+						std::cout << "\nBVH DEBUG -> DIDNT FIND ELEMENT : " << i;
+					}
+
+				}
+			}
+
+			GenerateTriangles(SortedReferences, OriginalIndices, oTriangles, MeshIDs);
+		}
+
+		static int NodeLayoutLineBytes = 128;
+
+		void ConfigureNodeLayout(int CacheLineBytes) {
+
+			if (CacheLineBytes < 0) {
+				throw "ConfigureNodeLayout : Cache line size can't be negative";
+			}
+
+			NodeLayoutLineBytes = CacheLineBytes;
+		}
+
+		void ConstructHierarchy_StackBVH(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& OriginalIndices, std::vector<FlattenedStackNode>& FlattenedNodes, std::vector<Triangle>& oTriangles, const std::vector<int>& MeshIDs, Node* RootNode, BuildMode Mode) {
+
+			bool DEBUG_BVH = false;
+
+			std::vector<int> TriangleReferences;
+			std::vector<int> SortedReferences;
+
+			if (Mode == BuildMode::LBVH) {
+				ConstructTreeLBVH(Vertices, OriginalIndices, RootNode, SortedReferences);
+			}
+
+			else {
+				ConstructTree(Vertices, OriginalIndices, oTriangles, RootNode, TriangleReferences, SortedReferences);
+			}
+
+			FinalizeTree(Vertices, OriginalIndices, RootNode, SortedReferences, Mode);
+
+			// Flatten!
+
+			std::vector<glm::ivec2> FlattenCache;
+			int ProcessedNodes_ = 0;
+
+			FlattenCache.resize(LastNodeIndex + 1);
+			FlattenedNodes.resize(LastNodeIndex + 1);
+
+			FlattenStackBVH(FlattenedNodes, RootNode);
+
+			if (NodeLayoutLineBytes > 0) {
+				LayoutTreelets(FlattenedNodes, NodeLayoutLineBytes);
+			}
+
+			GenerateTriangles(SortedReferences, OriginalIndices, oTriangles, MeshIDs);
+		}
+
+
+		uint FlattenBVHNaive(Node* RootNode, uint* offset) {
+
+			std::stack<FlattenedNode> WorkStack;
+
+			for (int i = 0; i < LastNodeIndex; i++) {
+
+
+
+
+
+			}
+		}
+
+		int FlattenBVHRecursive(const Node* RootNode, std::vector<FlattenedNode>& FlattenedNodes, std::vector<glm::ivec2>& Cache, int& ProcessedNodes) {
+
+			int idx = ProcessedNodes;
+			FlattenedNode& node = FlattenedNodes[ProcessedNodes];
+			node.Min = glm::vec4(RootNode->NodeBounds.Min, 0.0f);
+			node.Max = glm::vec4(RootNode->NodeBounds.Max, 0.0f);
+
+			glm::ivec2& CacheRef = Cache[ProcessedNodes++];
+
+			if (RootNode->IsLeafNode)
+			{
+				int Packed = PackLeaf(RootNode->StartIndex, RootNode->Length); // <- Pack data 
+				CacheRef.y = Packed;
+				CacheRef.x = -1; // <- flag
+			}
+			else
+			{
+				FlattenBVHRecursive(RootNode->LeftChildPtr, FlattenedNodes, Cache, ProcessedNodes);
+				
+				// Store links to right nodes
+				CacheRef.x = FlattenBVHRecursive(RootNode->RightChildPtr, FlattenedNodes, Cache, ProcessedNodes);
+			}
+
+			return idx;
+		}
+
+		void FlattenBVH(const Node* RootNode, std::vector<FlattenedNode>& FlattenedNodes, std::vector <glm::ivec2> & Cache, int& ProcessedNodes) {
+
+			FlattenBVHRecursive(RootNode, FlattenedNodes, Cache, ProcessedNodes);
 
 			const float NegativeOneIntBits = glm::intBitsToFloat(-1);
 
@@ -884,7 +1986,7 @@ namespace Candela {
 				{
 					LeavesProcessed++;
 					// Pack data ->
-					int Packed = ((current.first->LeftChildPtr->StartIndex) << 4) | (((current.first->LeftChildPtr->Length)) & 0xF);
+					int Packed = PackLeaf(current.first->LeftChildPtr->StartIndex, current.first->LeftChildPtr->Length);
 					node.LBounds.Min.w = glm::intBitsToFloat(Packed);
 				}
 
@@ -902,7 +2004,7 @@ namespace Candela {
 				{
 					LeavesProcessed++;
 					// Pack data ->
-					int Packed = ((current.first->RightChildPtr->StartIndex) << 4) | (((current.first->RightChildPtr->Length)) & 0xF);
+					int Packed = PackLeaf(current.first->RightChildPtr->StartIndex, current.first->RightChildPtr->Length);
 					node.RBounds.Min.w = glm::intBitsToFloat(Packed);
 				}
 
@@ -945,11 +2047,26 @@ namespace Candela {
 			std::cout << "\nNode Array Length : " << FlattenedArraySize;
 			std::cout << "\nVertices Array Length : " << MeshVertices.size();
 
+			if (OPTIMIZE_FOR_AVERAGE_CASE && UsesStackless && !OrderingStats.empty()) {
+
+				const ChildOrderingStats& Stats = OrderingStats.back();
+
+				std::cout << "\nChild Ordering (average nodes visited per ray over " << Stats.SampleRays << " rays) :";
+
+				for (int o = 0; o < CHILD_ORDERING_COUNT; o++) {
+					std::cout << "\n    " << GetChildOrderingName(static_cast<ChildOrdering>(o)) << " : " << Stats.AverageNodesVisited[o];
+				}
+
+				std::cout << "\nChosen Child Ordering : " << GetChildOrderingName(Stats.Chosen);
+			}
+
 		}
 
 
-		Node* BuildBVH(const Object& object, std::vector<FlattenedNode>& FlattenedNodes, std::vector<Vertex>& MeshVertices, std::vector<Triangle>& FlattenedTris, int t_offset)
+		Node* BuildBVH(const Object& object, std::vector<FlattenedNode>& FlattenedNodes, std::vector<Vertex>& MeshVertices, std::vector<Triangle>& FlattenedTris, int t_offset, BuildMode Mode)
 		{
+			std::lock_guard<std::mutex> Lock(BuildMutex);
+
 			auto start = std::chrono::system_clock::now();
 
 			TotalIterations = 0;
@@ -971,6 +2088,8 @@ namespace Candela {
 			std::cout << "\n--------";
 			std::cout << "\n\nGenerating BVH for Object : " << object.m_ObjectID << "    Model filename : " << filename << "\n";
 
+			CurrentModel_ = filename;
+
 
 			// Combined vertices and indices  
 			std::vector<GLuint> MeshIndices; 
@@ -1013,7 +2132,7 @@ namespace Candela {
 			RootNode.StartIndex = 0;
 			RootNode.Length = Triangles;
 
-			ConstructHierarchy(MeshVertices, MeshIndices, FlattenedNodes, FlattenedTris, MeshReferences, &RootNode);
+			ConstructHierarchy(MeshVertices, MeshIndices, FlattenedNodes, FlattenedTris, MeshReferences, &RootNode, Mode);
 			PrintShit(object, FlattenedNodes.size(), MeshVertices, FlattenedTris);
 
 			auto end = std::chrono::system_clock::now();
@@ -1029,8 +2148,10 @@ namespace Candela {
 
 
 		
-		Node* BuildBVH(const Object& object, std::vector<FlattenedStackNode>& FlattenedNodes, std::vector<Vertex>& MeshVertices, std::vector<Triangle>& FlattenedTris, int t_offset)
+		Node* BuildBVH(const Object& object, std::vector<FlattenedStackNode>& FlattenedNodes, std::vector<Vertex>& MeshVertices, std::vector<Triangle>& FlattenedTris, int t_offset, BuildMode Mode)
 		{
+			std::lock_guard<std::mutex> Lock(BuildMutex);
+
 			auto start = std::chrono::system_clock::now();
 
 			TotalIterations = 0;
@@ -1093,7 +2214,7 @@ namespace Candela {
 			RootNode.StartIndex = 0;
 			RootNode.Length = Triangles;
 
-			ConstructHierarchy_StackBVH(MeshVertices, MeshIndices, FlattenedNodes, FlattenedTris, MeshReferences, &RootNode);
+			ConstructHierarchy_StackBVH(MeshVertices, MeshIndices, FlattenedNodes, FlattenedTris, MeshReferences, &RootNode, Mode);
 			PrintShit(object, FlattenedNodes.size(), MeshVertices, FlattenedTris);
 
 			auto end = std::chrono::system_clock::now();
@@ -1107,6 +2228,267 @@ namespace Candela {
 			return RootNodePtr;
 		}
 
+		static void ResetBuildState(int t_offset, bool Stackless) {
+			TotalIterations = 0;
+			LastNodeIndex = 0;
+			LeafNodeCount = 0;
+			SplitFails = 0;
+			MaxBVHDepth = 0;
+			TriangleOffset_ = t_offset;
+			UsesStackless = Stackless;
+			CurrentModel_ = "(rebuild)";
+		}
+
+		Node* BuildBVH(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& Indices, const std::vector<int>& MeshIDs, std::vector<FlattenedNode>& FlattenedNodes, std::vector<Triangle>& FlattenedTris, int t_offset, BuildMode Mode)
+		{
+			std::lock_guard<std::mutex> Lock(BuildMutex);
+
+			ResetBuildState(t_offset, true);
+
+			Node* RootNodePtr = new Node;
+			RootNodePtr->StartIndex = 0;
+			RootNodePtr->Length = Indices.size() / 3;
+
+			ConstructHierarchy(Vertices, Indices, FlattenedNodes, FlattenedTris, MeshIDs, RootNodePtr, Mode);
+			return RootNodePtr;
+		}
+
+		Node* BuildBVH(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& Indices, const std::vector<int>& MeshIDs, std::vector<FlattenedStackNode>& FlattenedNodes, std::vector<Triangle>& FlattenedTris, int t_offset, BuildMode Mode)
+		{
+			std::lock_guard<std::mutex> Lock(BuildMutex);
+
+			ResetBuildState(t_offset, false);
+
+			Node* RootNodePtr = new Node;
+			RootNodePtr->StartIndex = 0;
+			RootNodePtr->Length = Indices.size() / 3;
+
+			ConstructHierarchy_StackBVH(Vertices, Indices, FlattenedNodes, FlattenedTris, MeshIDs, RootNodePtr, Mode);
+			return RootNodePtr;
+		}
+
+		void DeleteBVH(Node* RootNode) {
+
+			if (!RootNode) {
+				return;
+			}
+
+			if (!RootNode->IsLeafNode) {
+				DeleteBVH(RootNode->LeftChildPtr);
+				DeleteBVH(RootNode->RightChildPtr);
+			}
+
+			delete RootNode;
+		}
+
+		// Refitting 
+
+		static const int FLATTENED_INNER_FLAG = -1;
+
+		static bool IsFlattenedLeaf(float Packed) {
+			return glm::floatBitsToInt(Packed) != FLATTENED_INNER_FLAG;
+		}
+
+		static Bounds GetLeafBounds(float Packed, const Triangle* Triangles, const Vertex* Vertices) {
+
+			int Data = glm::floatBitsToInt(Packed);
+			int Start = Data >> BVH_LEAF_LENGTH_BITS;
+			int Length = Data & BVH_LEAF_LENGTH_MASK;
+
+			Bounds LeafBounds;
+
+			for (int i = Start; i < Start + Length; i++) {
+				for (int v = 0; v < 3; v++) {
+					glm::vec3 Position = glm::vec3(Vertices[Triangles[i].PackedData[v]].position);
+					LeafBounds.Min = glm::min(LeafBounds.Min, Position);
+					LeafBounds.Max = glm::max(LeafBounds.Max, Position);
+				}
+			}
+
+			return LeafBounds;
+		}
+
+		static float GetRelativeArea(const glm::vec4& Min, const glm::vec4& Max, float RootArea) {
+			return Bounds(glm::vec3(Min), glm::vec3(Max)).GetArea() / RootArea;
+		}
+
+		void GetFlattenedChildren(const FlattenedNode* Nodes, int Index, int oChildren[2]) {
+
+			if (IsFlattenedLeaf(Nodes[Index].Min.w)) {
+				oChildren[0] = oChildren[1] = -1;
+				return;
+			}
+
+			// The left child directly follows its parent, its miss link is its sibling
+			oChildren[0] = Index + 1;
+			oChildren[1] = glm::floatBitsToInt(Nodes[Index + 1].Max.w);
+		}
+
+		void GetFlattenedChildren(const FlattenedStackNode* Nodes, int Index, int oChildren[2]) {
+			oChildren[0] = IsFlattenedLeaf(Nodes[Index].LBounds.Min.w) ? -1 : glm::floatBitsToInt(Nodes[Index].LBounds.Max.w);
+			oChildren[1] = IsFlattenedLeaf(Nodes[Index].RBounds.Min.w) ? -1 : glm::floatBitsToInt(Nodes[Index].RBounds.Max.w);
+		}
+
+		void RefitFlattenedNode(FlattenedNode* Nodes, int Index, const Triangle* Triangles, const Vertex* Vertices) {
+
+			FlattenedNode& Current = Nodes[Index];
+
+			if (IsFlattenedLeaf(Current.Min.w)) {
+				Bounds LeafBounds = GetLeafBounds(Current.Min.w, Triangles, Vertices);
+				Current.Min = glm::vec4(LeafBounds.Min, Current.Min.w);
+				Current.Max = glm::vec4(LeafBounds.Max, Current.Max.w);
+				return;
+			}
+
+			int Children[2];
+			GetFlattenedChildren(Nodes, Index, Children);
+
+			Current.Min = glm::vec4(glm::min(glm::vec3(Nodes[Children[0]].Min), glm::vec3(Nodes[Children[1]].Min)), Current.Min.w);
+			Current.Max = glm::vec4(glm::max(glm::vec3(Nodes[Children[0]].Max), glm::vec3(Nodes[Children[1]].Max)), Current.Max.w);
+		}
+
+		static void RefitFlattenedChild(FlattenedStackNode* Nodes, FBounds& Child, const Triangle* Triangles, const Vertex* Vertices) {
+
+			Bounds ChildBounds;
+
+			if (IsFlattenedLeaf(Child.Min.w)) {
+				ChildBounds = GetLeafBounds(Child.Min.w, Triangles, Vertices);
+			}
+
+			else {
+				const FlattenedStackNode& Inner = Nodes[glm::floatBitsToInt(Child.Max.w)];
+				ChildBounds.Min = glm::min(glm::vec3(Inner.LBounds.Min), glm::vec3(Inner.RBounds.Min));
+				ChildBounds.Max = glm::max(glm::vec3(Inner.LBounds.Max), glm::vec3(Inner.RBounds.Max));
+			}
+
+			Child.Min = glm::vec4(ChildBounds.Min, Child.Min.w);
+			Child.Max = glm::vec4(ChildBounds.Max, Child.Max.w);
+		}
+
+		void RefitFlattenedNode(FlattenedStackNode* Nodes, int Index, const Triangle* Triangles, const Vertex* Vertices) {
+			RefitFlattenedChild(Nodes, Nodes[Index].LBounds, Triangles, Vertices);
+			RefitFlattenedChild(Nodes, Nodes[Index].RBounds, Triangles, Vertices);
+		}
+
+		// Traversal cost TraversalCostRatio, intersection cost 1 per triangle
+		float GetFlattenedSAHCost(const FlattenedNode* Nodes, int Count) {
+
+			float RootArea = glm::max(GetRelativeArea(Nodes[0].Min, Nodes[0].Max, 1.0f), 1e-12f);
+			float Cost = 0.0f;
+
+			for (int i = 0; i < Count; i++) {
+
+				float Area = GetRelativeArea(Nodes[i].Min, Nodes[i].Max, RootArea);
+				Cost += IsFlattenedLeaf(Nodes[i].Min.w) ? Area * float(glm::floatBitsToInt(Nodes[i].Min.w) & BVH_LEAF_LENGTH_MASK) : TraversalCostRatio * Area;
+			}
+
+			return Cost;
+		}
+
+		float GetFlattenedSAHCost(const FlattenedStackNode* Nodes, int Count) {
+
+			glm::vec4 RootMin = glm::min(Nodes[0].LBounds.Min, Nodes[0].RBounds.Min);
+			glm::vec4 RootMax = glm::max(Nodes[0].LBounds.Max, Nodes[0].RBounds.Max);
+
+			float RootArea = glm::max(GetRelativeArea(RootMin, RootMax, 1.0f), 1e-12f);
+			float Cost = TraversalCostRatio;
+
+			for (int i = 0; i < Count; i++) {
+				for (const FBounds* Child : { &Nodes[i].LBounds, &Nodes[i].RBounds }) {
+
+					float Area = GetRelativeArea(Child->Min, Child->Max, RootArea);
+					Cost += IsFlattenedLeaf(Child->Min.w) ? Area * float(glm::floatBitsToInt(Child->Min.w) & BVH_LEAF_LENGTH_MASK) : TraversalCostRatio * Area;
+				}
+			}
+
+			return Cost;
+		}
+
+		// Node layout 
+
+		void LayoutTreelets(std::vector<FlattenedStackNode>& Nodes, int CacheLineBytes) {
+
+			if (Nodes.empty()) {
+				return;
+			}
+
+			const int TreeletSize = glm::max(CacheLineBytes / (int)sizeof(FlattenedStackNode), 1);
+
+			// Old index of every new slot, -1 for padding
+			std::vector<int> Order;
+			std::vector<int> NewIndices(Nodes.size(), -1);
+			Order.reserve(Nodes.size());
+
+			// Treelet roots, laid out depth first so every subtree's treelets end up next to each other
+			std::vector<int> Roots = { 0 };
+
+			while (!Roots.empty()) {
+
+				int Root = Roots.back();
+				Roots.pop_back();
+
+				// A ray that enters a node visits a child with a probability proportional to the child's area, so the largest children are pulled into the treelet first
+				std::priority_queue<std::pair<float, int>> Frontier;
+				Frontier.push(std::make_pair(0.0f, Root));
+
+				for (int Added = 0; Added < TreeletSize && !Frontier.empty(); Added++) {
+
+					int Index = Frontier.top().second;
+					Frontier.pop();
+
+					NewIndices[Index] = Order.size();
+					Order.push_back(Index);
+
+					const FBounds* Children[2] = { &Nodes[Index].LBounds, &Nodes[Index].RBounds };
+
+					for (int c = 0; c < 2; c++) {
+						if (!IsFlattenedLeaf(Children[c]->Min.w)) {
+							float Area = Bounds(glm::vec3(Children[c]->Min), glm::vec3(Children[c]->Max)).GetArea();
+							Frontier.push(std::make_pair(Area, glm::floatBitsToInt(Children[c]->Max.w)));
+						}
+					}
+				}
+
+				// The rest of the frontier roots the next treelets, largest first
+				int FirstRoot = Roots.size();
+
+				while (!Frontier.empty()) {
+					Roots.push_back(Frontier.top().second);
+					Frontier.pop();
+				}
+
+				std::reverse(Roots.begin() + FirstRoot, Roots.end());
+
+				// Every treelet starts on a line, padding nodes are empty leaves that nothing links to
+				while (Order.size() % TreeletSize != 0) {
+					Order.push_back(-1);
+				}
+			}
+
+			// Slots the breadth first flattening left unused aren't reachable from the root and are dropped
+			std::vector<FlattenedStackNode> Reordered(Order.size(), FlattenedStackNode{});
+
+			for (int i = 0; i < (int)Order.size(); i++) {
+
+				if (Order[i] < 0) {
+					continue;
+				}
+
+				FlattenedStackNode& Node = Reordered[i];
+				Node = Nodes[Order[i]];
+
+				if (!IsFlattenedLeaf(Node.LBounds.Min.w)) {
+					Node.LBounds.Max.w = glm::intBitsToFloat(NewIndices[glm::floatBitsToInt(Node.LBounds.Max.w)]);
+				}
+
+				if (!IsFlattenedLeaf(Node.RBounds.Min.w)) {
+					Node.RBounds.Max.w = glm::intBitsToFloat(NewIndices[glm::floatBitsToInt(Node.RBounds.Max.w)]);
+				}
+			}
+
+			Nodes.swap(Reordered);
+		}
+
 		 
 		/*
 
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <vector>
+#include <string>
 
 #include <cmath>
 
@@ -9,6 +10,8 @@
 
 #include "../Utils/Vertex.h"
 
+#include "../Shaders/Include/BVHLeafFormat.h"
+
 #include "../Object.h"
 
 #include "../Threadpool.h"
@@ -56,6 +59,8 @@ namespace Candela {
 			bool IsLeafNode = false;
 
 			uint Axis = 1000;
+
+			float SAHCost = 0.0f; // Subtree cost, only valid during LBVH builds and treelet optimization
 		};
 
 		struct FBounds {
@@ -83,7 +88,96 @@ namespace Candela {
 			int PackedData[4];
 		};
 
-		Node* BuildBVH(const Object& object, std::vector<FlattenedNode>& FlattenedNodes, std::vector<Vertex>& MeshVertices, std::vector<Triangle>& FlattenedTris, int);
-		Node* BuildBVH(const Object& object, std::vector<FlattenedStackNode>& FlattenedNodes, std::vector<Vertex>& MeshVertices, std::vector<Triangle>& FlattenedTris, int);
+		// Ray test data of a triangle, stored at the triangle's index (see PRECOMPUTED_TRIANGLES in Shaders/Include/BVHLeafFormat.h)
+		struct TriangleIntersectionData {
+			glm::vec4 Vertex0; // W : mesh id (int bits)
+			glm::vec4 Edge1; // Vertex1 - Vertex0
+			glm::vec4 Edge2; // Vertex2 - Vertex0
+		};
+
+		// Order in which the stackless layout stores (and the traversal visits) the children of a node
+		enum class ChildOrdering {
+			LargerAreaFirst,
+			NegativeSideFirst, // Child below the split plane first
+			PositiveSideFirst
+		};
+
+		const int CHILD_ORDERING_COUNT = 3;
+
+		// Ordering chosen for a stackless build, and the average nodes every candidate visited per sample ray
+		struct ChildOrderingStats {
+			std::string Model;
+			int SampleRays = 0;
+			float AverageNodesVisited[CHILD_ORDERING_COUNT] = { 0.0f, 0.0f, 0.0f };
+			ChildOrdering Chosen = ChildOrdering::LargerAreaFirst;
+		};
+
+		const char* GetChildOrderingName(ChildOrdering Ordering);
+
+		// One entry per stackless build, in build order
+		const std::vector<ChildOrderingStats>& GetChildOrderingStats();
+
+		// Cpu ray helpers, used by the child ordering sample rays and by candela-bvhstats
+
+		// Deterministic [0, 1) sequence
+		float HashFloat(uint32_t x);
+
+		// Slab test, true if the ray enters the box before TMax
+		bool IntersectBounds(const glm::vec3& Min, const glm::vec3& Max, const glm::vec3& Origin, const glm::vec3& InverseDirection, float TMax);
+
+		// Moller-Trumbore, returns the hit distance or -1
+		float IntersectTriangle(const glm::vec3& Origin, const glm::vec3& Direction, const glm::vec3& V0, const glm::vec3& V1, const glm::vec3& V2);
+
+		enum class BuildMode {
+			SAH, // Binned SAH, slow to build, fastest to trace
+			LBVH // Morton code sorted linear BVH, fast enough to rebuild moving/deforming geometry
+		};
+
+		// Morton codes are 63 bit by default (30 bit codes sort in half the passes but merge nearby triangles in large meshes)
+		// Triangles that share the top ClusterBits bits of their code form a cluster, the hierarchy above the clusters is split with binned SAH (0 disables it)
+		void ConfigureLBVH(bool Use63BitCodes, int ClusterBits);
+
+		// Nodes stop being split once intersecting all of their triangles is cheaper than splitting them, a node traversal costs TraversalCostRatio triangle intersections
+		// Leaves hold at most MaxLeafSize triangles (up to BVH_LEAF_LENGTH_MASK, see Shaders/Include/BVHLeafFormat.h), the same costs drive the LBVH leaf collapsing and treelet optimization
+		void ConfigureLeafTermination(float TraversalCostRatio, int MaxLeafSize);
+
+		// Optional treelet restructuring pass over the built tree (off by default), spends at most TimeBudgetMs per object
+		// Mostly pays off on LBVH trees, SAH trees barely change (compare the layouts with candela-bvhstats before enabling it)
+		void ConfigureTreeletOptimization(bool Enabled, float TimeBudgetMs);
+
+		// The stack layout's nodes are stored in treelets of CacheLineBytes (a node and its likeliest children share a cache line) instead of breadth first, 0 keeps the breadth first order
+		// The stackless layout is always depth first, its traversal only ever moves forward through the array
+		void ConfigureNodeLayout(int CacheLineBytes);
+
+		// Reorders an already flattened tree into treelets and rewrites its child links, the root stays the first node
+		// Treelets are padded to whole lines, so the node count is a multiple of the treelet size and objects allocated back to back stay line aligned
+		void LayoutTreelets(std::vector<FlattenedStackNode>& Nodes, int CacheLineBytes);
+
+		// Both modes emit the same node layouts, so objects built with either can be mixed in one RayIntersector
+		Node* BuildBVH(const Object& object, std::vector<FlattenedNode>& FlattenedNodes, std::vector<Vertex>& MeshVertices, std::vector<Triangle>& FlattenedTris, int, BuildMode Mode = BuildMode::SAH);
+		Node* BuildBVH(const Object& object, std::vector<FlattenedStackNode>& FlattenedNodes, std::vector<Vertex>& MeshVertices, std::vector<Triangle>& FlattenedTris, int, BuildMode Mode = BuildMode::SAH);
+
+		// Builds from an indexed triangle list (one mesh id per triangle), thread safe
+		Node* BuildBVH(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& Indices, const std::vector<int>& MeshIDs, std::vector<FlattenedNode>& FlattenedNodes, std::vector<Triangle>& FlattenedTris, int, BuildMode Mode = BuildMode::SAH);
+		Node* BuildBVH(const std::vector<Vertex>& Vertices, const std::vector<GLuint>& Indices, const std::vector<int>& MeshIDs, std::vector<FlattenedStackNode>& FlattenedNodes, std::vector<Triangle>& FlattenedTris, int, BuildMode Mode = BuildMode::SAH);
+
+		void DeleteBVH(Node* RootNode);
+
+		// Vertices are indexed with the triangles' vertex indices minus VerticesOffset
+		void GenerateTriangleIntersectionData(const Triangle* Triangles, int Count, const Vertex* Vertices, int VerticesOffset, TriangleIntersectionData* oData);
+
+		// Flattened layout helpers used to refit objects in place (see RayIntersector::RefitObject)
+		// Node indices are relative to the object's first node, leaves index the global triangle array and triangles the global vertex array
+		// Children are -1 where the layout has none (leaves of the stackless layout, leaf children of the stack layout)
+		void GetFlattenedChildren(const FlattenedNode* Nodes, int Index, int oChildren[2]);
+		void GetFlattenedChildren(const FlattenedStackNode* Nodes, int Index, int oChildren[2]);
+
+		// Children have to be refitted first
+		void RefitFlattenedNode(FlattenedNode* Nodes, int Index, const Triangle* Triangles, const Vertex* Vertices);
+		void RefitFlattenedNode(FlattenedStackNode* Nodes, int Index, const Triangle* Triangles, const Vertex* Vertices);
+
+		// Relative to the root's area
+		float GetFlattenedSAHCost(const FlattenedNode* Nodes, int Count);
+		float GetFlattenedSAHCost(const FlattenedStackNode* Nodes, int Count);
 	}
 };
\ No newline at end of file
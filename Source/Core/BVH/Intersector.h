@@ -20,10 +20,16 @@
 
 #include "../GLClasses/Shader.h"
 
+#include "../GLClasses/BufferHeap.h"
+
 #include <map>
 
 #include <type_traits>
 
+#include <future>
+
+#include <thread>
+
 namespace Candela {
 
 	namespace BVH {
@@ -48,11 +54,19 @@ namespace Candela {
 		int Data[14]; 
 	};
 
+	// Offsets index the intersector's node/triangle/vertex heaps
 	struct _ObjectData {
 		int TriangleOffset;
 		int VerticesOffset;
 		int NodeOffset;
 		int NodeCount;
+		int NodeCapacity; // Nodes allocated for the object, a rebuilt tree can use fewer
+		int VertexCount;
+		int TriangleCount;
+
+		// Vertex quantization bounds of the object, used when COMPACT_VERTICES is defined
+		glm::vec3 DequantizeMin;
+		glm::vec3 DequantizeScale;
 	};
 
 
@@ -65,19 +79,31 @@ namespace Candela {
 		RayIntersector();
 
 		void Initialize();
-		void AddObject(const Object& object);
+
+		// Objects can be added and removed at any time, each one only uploads/frees its own node, triangle and vertex ranges
+		// Objects added before the first BufferData() are uploaded by it
+		void AddObject(const Object& object, BVH::BuildMode Mode = BVH::BuildMode::SAH);
+		void RemoveObject(int ObjectID);
 		void PushEntity(const Entity& entity);
 		void PushEntities(const std::vector<Entity*>& Entities);
 		void BufferEntities();
 		void IntersectPrimary(GLuint OutputBuffer, int Width, int Height, FPSCamera& Camera);
-		void BindEverything(GLClasses::ComputeShader& Shader, bool ShouldBindTextures);
+		void BindEverything(GLClasses::ComputeShader& Shader);
 		void BindEverything(GLClasses::Shader& shader);
 		bool Collide(const glm::vec3& Point);
 
 		// if ClearCPUData is true, it deletes the CPU side BVH, else it keeps it
 		// Useful for physics sim on the CPU.
+		// The cpu side arrays mirror the heaps (same offsets)
 		void BufferData(bool ClearCPUData);
 
+		// Moves the vertices of an object (same count and order as its meshes' vertices) and refits its BVH bottom up over the existing topology
+		// Needs the CPU side data (BufferData(false)), only the object's node and vertex ranges are uploaded
+		// Once the SAH cost grows past the rebuild threshold (relative to the cost after the last build) the object is rebuilt on a
+		// background thread, a later refit swaps the new tree in
+		void RefitObject(int ObjectID, const std::vector<Vertex>& NewVertices);
+		void SetRebuildThreshold(float CostRatio);
+
 		void Recompile();
 
 		void GenerateMeshTextureReferences();
@@ -88,8 +114,8 @@ namespace Candela {
 		GLuint m_BVHVerticesSSBO = 0;
 		GLuint m_BVHEntitiesSSBO = 0;
 		GLuint m_BVHTextureReferencesSSBO = 0;
-
-		void _BindTextures(GLClasses::ComputeShader& Shader);
+		GLuint m_BVHTriangleDataSSBO = 0; // Only used with PRECOMPUTED_TRIANGLES
+		GLuint m_BVHTextureHandlesSSBO = 0; // Bindless handles, indexed by TextureReferences::Albedo/Normal
 
 		GLuint m_TextureReferences = 0;
 
@@ -102,7 +128,13 @@ namespace Candela {
 
 		std::vector<BVHEntity> m_Entities;
 
-		uint32_t m_IndexOffset;
+		GLClasses::BufferHeap m_NodeHeap;
+		GLClasses::BufferHeap m_TriangleHeap;
+		GLClasses::BufferHeap m_VertexHeap;
+		GLClasses::BufferHeap m_TriangleDataHeap; // Allocated in lockstep with the triangle heap, so both share offsets
+
+		bool m_Buffered = false; // Objects are uploaded as they're added once BufferData() was called
+		bool m_KeepCPUData = true;
 
 		std::unordered_map<int, _ObjectData> m_ObjectData;
 		GLClasses::ComputeShader TraceShader;
@@ -116,11 +148,30 @@ namespace Candela {
 		std::vector<BVH::TextureReferences> m_MeshTextureReferences;
 		std::map<GLuint64, int> m_TextureHandleReferenceMap;
 
-		std::unordered_map<uint64_t, bool> m_TextureBoundFlagMap;
+		struct _RebuildResult {
+			std::vector<T> Nodes;
+			std::vector<BVH::Triangle> Triangles;
+			float Cost;
+		};
+
+		struct _RefitData {
+			std::vector<std::vector<int>> Subtrees; // Each subtree's nodes, children first, refitted in parallel
+			std::vector<int> Top; // Nodes above the subtrees, children first
+			float BuildCost = 0.0f;
+			std::future<_RebuildResult> Rebuild;
+		};
+
+		std::unordered_map<int, _RefitData> m_RefitData;
+		float m_RebuildThreshold = 1.5f;
 
-		GLClasses::Texture m_MiscTex;
+		void _CreateRefitPlan(const _ObjectData& Data, _RefitData& Refit);
+		bool _ApplyRebuild(_ObjectData& Data, _RefitData& Refit);
 
-		void _BindTextures();
+		void _UploadNodes(const _ObjectData& Data, const T* Nodes);
+		void _UploadTriangles(const _ObjectData& Data, const BVH::Triangle* Triangles);
+		void _UploadVertices(_ObjectData& Data, const Vertex* Vertices);
+		void _UploadTriangleData(const _ObjectData& Data, const BVH::Triangle* Triangles, const Vertex* Vertices);
+		void _UpdateBufferIDs();
 	};
 
 }
@@ -129,7 +180,6 @@ namespace Candela {
 template<typename T>
 Candela::RayIntersector<T>::RayIntersector()
 {
-	m_IndexOffset = 0;
 	m_BVHTriSSBO = 0;
 	m_BVHNodeSSBO = 0;
 	m_BVHVerticesSSBO = 0;
@@ -153,7 +203,17 @@ Candela::RayIntersector<T>::RayIntersector()
 template<typename T>
 void Candela::RayIntersector<T>::Initialize()
 {
-	m_MiscTex.CreateTexture("Res/misc.png");
+	m_NodeHeap.Create(sizeof(T), 1 << 16);
+	m_TriangleHeap.Create(sizeof(BVH::Triangle), 1 << 16);
+#ifdef COMPACT_VERTICES
+	m_VertexHeap.Create(sizeof(CompactVertex), 1 << 16);
+#else
+	m_VertexHeap.Create(sizeof(Vertex), 1 << 16);
+#endif
+#ifdef PRECOMPUTED_TRIANGLES
+	m_TriangleDataHeap.Create(sizeof(BVH::TriangleIntersectionData), 1 << 16);
+#endif
+	_UpdateBufferIDs();
 
 	if (m_Stackless) {
 		TraceShader.CreateComputeShader("Core/Shaders/Intersectors/TraverseBVHStackless.glsl");
@@ -166,35 +226,167 @@ void Candela::RayIntersector<T>::Initialize()
 	TraceShader.Compile();
 }
 
+// Writes a range of a cpu side mirror array
+template<typename E>
+inline void _WriteMirrorRange(std::vector<E>& Mirror, int Offset, const E* Data, int Count)
+{
+	if ((int)Mirror.size() < Offset + Count) {
+		Mirror.resize(Offset + Count);
+	}
+
+	std::copy(Data, Data + Count, Mirror.begin() + Offset);
+}
+
 template<typename T>
-void Candela::RayIntersector<T>::AddObject(const Object& object)
+void Candela::RayIntersector<T>::AddObject(const Object& object, BVH::BuildMode Mode)
 {
 	using namespace Candela::BVH;
 
+	if (!m_NodeHeap.IsCreated()) {
+		throw "AddObject : Intersector wasn't initialized";
+	}
+
+	if (m_ObjectData.find(object.GetID()) != m_ObjectData.end()) {
+		throw "AddObject : Object was already added";
+	}
+
 	std::vector<T> Nodes;
 	std::vector<Vertex> Vertices;
 	std::vector<BVH::Triangle> Triangles;
 
-	// Write object data 
-	m_ObjectData[object.GetID()].NodeOffset = m_BVHNodes.size();
-	m_ObjectData[object.GetID()].TriangleOffset = m_BVHTriangles.size();
-	m_ObjectData[object.GetID()].VerticesOffset = m_BVHVertices.size();
+	int TriangleCount = 0;
+	int VertexCount = 0;
+
+	for (auto& Mesh : object.m_Meshes) {
+		TriangleCount += Mesh.m_Indices.size() / 3;
+		VertexCount += Mesh.m_Vertices.size();
+	}
+
+	// Leaves store global triangle indices, so the triangle range is allocated before the build
+	_ObjectData Data;
+	Data.TriangleOffset = m_TriangleHeap.Allocate(TriangleCount);
+	Data.VerticesOffset = m_VertexHeap.Allocate(VertexCount);
+
+#ifdef PRECOMPUTED_TRIANGLES
+	if (m_TriangleDataHeap.Allocate(TriangleCount) != Data.TriangleOffset) {
+		throw "AddObject : Triangle data heap is out of sync with the triangle heap";
+	}
+#endif
+
+	Node* RootNode = BuildBVH(object, Nodes, Vertices, Triangles, Data.TriangleOffset, Mode);
+	DeleteBVH(RootNode);
+
+	Data.NodeOffset = m_NodeHeap.Allocate(Nodes.size());
+	Data.NodeCount = Nodes.size();
+	Data.NodeCapacity = Nodes.size();
+	Data.VertexCount = Vertices.size();
+	Data.TriangleCount = Triangles.size();
 
-	Node* RootNode = BuildBVH(object, Nodes, Vertices, Triangles, m_BVHTriangles.size());
+	glm::vec3 VertexMin = glm::vec3(0.0f);
+	glm::vec3 VertexMax = glm::vec3(0.0f);
 
-	m_BVHVertices.insert(m_BVHVertices.end(), Vertices.begin(), Vertices.end());
-	m_BVHNodes.insert(m_BVHNodes.end(), Nodes.begin(), Nodes.end());
+	for (int i = 0; i < Vertices.size(); i++) {
+		VertexMin = i == 0 ? glm::vec3(Vertices[i].position) : glm::min(VertexMin, glm::vec3(Vertices[i].position));
+		VertexMax = i == 0 ? glm::vec3(Vertices[i].position) : glm::max(VertexMax, glm::vec3(Vertices[i].position));
+	}
 
-	m_ObjectData[object.GetID()].NodeCount = Nodes.size();
+	Data.DequantizeMin = VertexMin;
+	Data.DequantizeScale = GetDequantizeScale(VertexMin, VertexMax);
 
 	for (int i = 0; i < Triangles.size(); i++) {
-		Triangles[i].PackedData[0] += m_IndexOffset;
-		Triangles[i].PackedData[1] += m_IndexOffset;
-		Triangles[i].PackedData[2] += m_IndexOffset;
-		m_BVHTriangles.push_back(Triangles[i]);
+		Triangles[i].PackedData[0] += Data.VerticesOffset;
+		Triangles[i].PackedData[1] += Data.VerticesOffset;
+		Triangles[i].PackedData[2] += Data.VerticesOffset;
 	}
 
-	m_IndexOffset += Vertices.size();
+	if (m_KeepCPUData) {
+		_WriteMirrorRange(m_BVHNodes, Data.NodeOffset, Nodes.data(), Data.NodeCount);
+		_WriteMirrorRange(m_BVHTriangles, Data.TriangleOffset, Triangles.data(), Data.TriangleCount);
+		_WriteMirrorRange(m_BVHVertices, Data.VerticesOffset, Vertices.data(), Data.VertexCount);
+	}
+
+	if (m_Buffered) {
+		_UploadNodes(Data, Nodes.data());
+		_UploadTriangles(Data, Triangles.data());
+		_UploadVertices(Data, Vertices.data());
+		_UploadTriangleData(Data, Triangles.data(), Vertices.data());
+	}
+
+	m_ObjectData[object.GetID()] = Data;
+	_UpdateBufferIDs();
+}
+
+template<typename T>
+void Candela::RayIntersector<T>::RemoveObject(int ObjectID)
+{
+	if (m_ObjectData.find(ObjectID) == m_ObjectData.end()) {
+		throw "RemoveObject : Object hasn't been added to the BVH";
+	}
+
+	const _ObjectData& Data = m_ObjectData[ObjectID];
+
+	m_NodeHeap.Free(Data.NodeOffset, Data.NodeCapacity);
+	m_TriangleHeap.Free(Data.TriangleOffset, Data.TriangleCount);
+	m_VertexHeap.Free(Data.VerticesOffset, Data.VertexCount);
+
+#ifdef PRECOMPUTED_TRIANGLES
+	m_TriangleDataHeap.Free(Data.TriangleOffset, Data.TriangleCount);
+#endif
+
+	// Waits for a pending rebuild
+	m_RefitData.erase(ObjectID);
+	m_ObjectData.erase(ObjectID);
+}
+
+template<typename T>
+void Candela::RayIntersector<T>::_UploadNodes(const _ObjectData& Data, const T* Nodes)
+{
+	m_NodeHeap.Upload(Data.NodeOffset, Data.NodeCount, Nodes);
+}
+
+template<typename T>
+void Candela::RayIntersector<T>::_UploadTriangles(const _ObjectData& Data, const BVH::Triangle* Triangles)
+{
+	m_TriangleHeap.Upload(Data.TriangleOffset, Data.TriangleCount, Triangles);
+}
+
+template<typename T>
+void Candela::RayIntersector<T>::_UploadVertices(_ObjectData& Data, const Vertex* Vertices)
+{
+#ifdef COMPACT_VERTICES
+	// Each object's vertices are quantized against its own bounds, the cpu side copy keeps full precision
+	std::vector<CompactVertex> CompactVertices(Data.VertexCount);
+
+	for (int i = 0; i < Data.VertexCount; i++) {
+		CompactVertices[i] = PackCompactVertex(Vertices[i], Data.DequantizeMin, Data.DequantizeScale);
+	}
+
+	m_VertexHeap.Upload(Data.VerticesOffset, Data.VertexCount, CompactVertices.data());
+#else
+	m_VertexHeap.Upload(Data.VerticesOffset, Data.VertexCount, Vertices);
+#endif
+}
+
+// Vertices are the object's own, triangles index the global vertex array
+template<typename T>
+void Candela::RayIntersector<T>::_UploadTriangleData(const _ObjectData& Data, const BVH::Triangle* Triangles, const Vertex* Vertices)
+{
+#ifdef PRECOMPUTED_TRIANGLES
+	std::vector<BVH::TriangleIntersectionData> TriangleData(Data.TriangleCount);
+	BVH::GenerateTriangleIntersectionData(Triangles, Data.TriangleCount, Vertices, Data.VerticesOffset, TriangleData.data());
+	m_TriangleDataHeap.Upload(Data.TriangleOffset, Data.TriangleCount, TriangleData.data());
+#endif
+}
+
+// Growing a heap replaces its buffer
+template<typename T>
+void Candela::RayIntersector<T>::_UpdateBufferIDs()
+{
+	m_BVHNodeSSBO = m_NodeHeap.GetBuffer();
+	m_BVHTriSSBO = m_TriangleHeap.GetBuffer();
+	m_BVHVerticesSSBO = m_VertexHeap.GetBuffer();
+	m_BVHTriangleDataSSBO = m_TriangleDataHeap.GetBuffer();
+	m_NodeCountBuffered = m_NodeHeap.GetCapacity();
 }
 
 template<typename T>
@@ -212,6 +404,14 @@ void Candela::RayIntersector<T>::PushEntity(const Entity& entity)
 	push.Data[0] = glm::floatBitsToInt(entity.m_EmissiveAmount);
 	push.Data[1] = glm::floatBitsToInt(1.0f - entity.m_TranslucencyAmount);
 
+	// Read by SetBVHDequantization() in Intersectors/Include/BVHVertex.glsl
+	const _ObjectData& Data = m_ObjectData[(int)entity.m_Object->m_ObjectID];
+
+	for (int i = 0; i < 3; i++) {
+		push.Data[2 + i] = glm::floatBitsToInt(Data.DequantizeMin[i]);
+		push.Data[5 + i] = glm::floatBitsToInt(Data.DequantizeScale[i]);
+	}
+
 	m_Entities.push_back(push);
 }
 
@@ -249,6 +449,8 @@ void Candela::RayIntersector<T>::IntersectPrimary(GLuint OutputBuffer, int Width
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_BVHNodeSSBO);
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_BVHEntitiesSSBO);
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_BVHTextureReferencesSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_BVHTriangleDataSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, m_BVHTextureHandlesSSBO);
 	
 	glBindImageTexture(0, OutputBuffer, 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA16F);
 	
@@ -266,10 +468,8 @@ void Candela::RayIntersector<T>::IntersectPrimary(GLuint OutputBuffer, int Width
 }
 
 template<typename T>
-void Candela::RayIntersector<T>::BindEverything(GLClasses::ComputeShader& Shader, bool ShouldBindTextures)
+void Candela::RayIntersector<T>::BindEverything(GLClasses::ComputeShader& Shader)
 {
-	const std::vector<FileLoader::_MeshMaterialData>& Paths = FileLoader::GetMeshTexturePaths();
-
 	Shader.Use();
 
 	int StartIdx = 16;
@@ -279,16 +479,12 @@ void Candela::RayIntersector<T>::BindEverything(GLClasses::ComputeShader& Shader
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StartIdx + 2, m_BVHNodeSSBO);
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StartIdx + 3, m_BVHEntitiesSSBO);
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StartIdx + 4, m_BVHTextureReferencesSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StartIdx + 5, m_BVHTriangleDataSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StartIdx + 6, m_BVHTextureHandlesSSBO);
 
 	// verify
 	Shader.SetInteger("u_EntityCount", m_EntityPushed);
 	Shader.SetInteger("u_TotalNodes", m_NodeCountBuffered);
-
-	if (ShouldBindTextures && !Shader._BVHTextureFlag) {
-		_BindTextures(Shader);
-		Shader._BVHTextureFlag = true;
-		std::cout << "BOUND";
-	}
 }
 
 template<typename T>
@@ -303,53 +499,252 @@ void Candela::RayIntersector<T>::BindEverything(GLClasses::Shader& shader)
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StartIdx + 2, m_BVHNodeSSBO);
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StartIdx + 3, m_BVHEntitiesSSBO);
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StartIdx + 4, m_BVHTextureReferencesSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StartIdx + 5, m_BVHTriangleDataSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StartIdx + 6, m_BVHTextureHandlesSSBO);
 
 	// verify
 	shader.SetInteger("u_EntityCount", m_EntityPushed);
 	shader.SetInteger("u_TotalNodes", m_NodeCountBuffered);
+}
 
-	shader.Use();
+template<typename T>
+void Candela::RayIntersector<T>::BufferData(bool ClearCPUData)
+{
+	// Objects added before this were only written to the cpu side arrays
+	if (!m_Buffered && m_KeepCPUData) {
+		for (auto& e : m_ObjectData) {
+			_UploadNodes(e.second, &m_BVHNodes[e.second.NodeOffset]);
+			_UploadTriangles(e.second, &m_BVHTriangles[e.second.TriangleOffset]);
+			_UploadVertices(e.second, &m_BVHVertices[e.second.VerticesOffset]);
+			_UploadTriangleData(e.second, &m_BVHTriangles[e.second.TriangleOffset], &m_BVHVertices[e.second.VerticesOffset]);
+		}
+	}
+
+	m_Buffered = true;
+	_UpdateBufferIDs();
+
+	if (ClearCPUData) {
+		m_KeepCPUData = false;
+		m_BVHNodes.clear();
+		m_BVHVertices.clear();
+		m_BVHTriangles.clear();
+	}
+}
+
+template<typename T>
+void Candela::RayIntersector<T>::_CreateRefitPlan(const _ObjectData& Data, _RefitData& Refit)
+{
+	const T* Nodes = &m_BVHNodes[Data.NodeOffset];
+
+	Refit.Subtrees.clear();
+	Refit.Top.clear();
+
+	// Split the tree breadth first until there are a few subtrees per thread
+	const int TargetSubtrees = GetParallelThreadCount() * 4;
 
-	for (int i = 0; i < 512; i++) {
+	std::vector<int> Frontier = { 0 };
+	std::vector<int> TopBreadthFirst;
+	bool Expanded = true;
 
-		std::string Name = "Textures[" + std::to_string(i) + "]";
-		glProgramUniformHandleui64ARB(shader.GetProgram(), shader.FetchUniformLocation(Name), m_MiscTex.GetTextureID());
+	while (Expanded && (int)Frontier.size() < TargetSubtrees) {
 
+		Expanded = false;
+		std::vector<int> NextFrontier;
+
+		for (int Index : Frontier) {
+
+			int Children[2];
+			BVH::GetFlattenedChildren(Nodes, Index, Children);
+
+			if (Children[0] < 0 && Children[1] < 0) {
+				NextFrontier.push_back(Index);
+				continue;
+			}
+
+			TopBreadthFirst.push_back(Index);
+			Expanded = true;
+
+			for (int c = 0; c < 2; c++) {
+				if (Children[c] >= 0) {
+					NextFrontier.push_back(Children[c]);
+				}
+			}
+		}
+
+		Frontier = NextFrontier;
+	}
+
+	// Reverse breadth first order visits children before their parents
+	Refit.Top.assign(TopBreadthFirst.rbegin(), TopBreadthFirst.rend());
+
+	for (int Root : Frontier) {
+
+		std::vector<int> Subtree;
+		std::vector<int> Stack = { Root };
+
+		while (!Stack.empty()) {
+
+			int Index = Stack.back();
+			Stack.pop_back();
+			Subtree.push_back(Index);
+
+			int Children[2];
+			BVH::GetFlattenedChildren(Nodes, Index, Children);
+
+			for (int c = 0; c < 2; c++) {
+				if (Children[c] >= 0) {
+					Stack.push_back(Children[c]);
+				}
+			}
+		}
+
+		Refit.Subtrees.push_back(std::vector<int>(Subtree.rbegin(), Subtree.rend()));
 	}
 }
 
 template<typename T>
-void Candela::RayIntersector<T>::BufferData(bool ClearCPUData)
+bool Candela::RayIntersector<T>::_ApplyRebuild(_ObjectData& Data, _RefitData& Refit)
 {
-	glDeleteBuffers(1, &m_BVHTriSSBO);
-	glDeleteBuffers(1, &m_BVHNodeSSBO);
-	glDeleteBuffers(1, &m_BVHVerticesSSBO);
+	if (!Refit.Rebuild.valid() || Refit.Rebuild.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+		return false;
+	}
 
-	glGenBuffers(1, &m_BVHTriSSBO);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_BVHTriSSBO);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(BVH::Triangle) * m_BVHTriangles.size(), m_BVHTriangles.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	_RebuildResult Result = Refit.Rebuild.get();
 
-	glGenBuffers(1, &m_BVHNodeSSBO);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_BVHNodeSSBO);
-	//glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(FlattenedNode) * BVHNodes.size(), BVHNodes.data(), GL_STATIC_DRAW);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(T) * m_BVHNodes.size(), m_BVHNodes.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	// A larger tree doesn't fit the object's node range anymore
+	if ((int)Result.Nodes.size() > Data.NodeCapacity) {
+		m_NodeHeap.Free(Data.NodeOffset, Data.NodeCapacity);
+		Data.NodeOffset = m_NodeHeap.Allocate(Result.Nodes.size());
+		Data.NodeCapacity = Result.Nodes.size();
+		_UpdateBufferIDs();
+	}
 
-	glGenBuffers(1, &m_BVHVerticesSSBO);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_BVHVerticesSSBO);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Vertex) * m_BVHVertices.size(), m_BVHVertices.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	Data.NodeCount = Result.Nodes.size();
+	_WriteMirrorRange(m_BVHNodes, Data.NodeOffset, Result.Nodes.data(), Data.NodeCount);
 
-	m_NodeCountBuffered = m_BVHNodes.size();
+	for (auto& Triangle : Result.Triangles) {
+		Triangle.PackedData[0] += Data.VerticesOffset;
+		Triangle.PackedData[1] += Data.VerticesOffset;
+		Triangle.PackedData[2] += Data.VerticesOffset;
+	}
 
-	if (ClearCPUData) {
-		m_BVHNodes.clear();
-		m_BVHVertices.clear();
-		m_BVHTriangles.clear();
+	std::copy(Result.Triangles.begin(), Result.Triangles.end(), m_BVHTriangles.begin() + Data.TriangleOffset);
+
+	if (m_Buffered) {
+		_UploadTriangles(Data, Result.Triangles.data());
+	}
+
+	Refit.BuildCost = Result.Cost;
+	_CreateRefitPlan(Data, Refit);
+
+	return true;
+}
+
+template<typename T>
+void Candela::RayIntersector<T>::RefitObject(int ObjectID, const std::vector<Vertex>& NewVertices)
+{
+	if (m_ObjectData.find(ObjectID) == m_ObjectData.end()) {
+		throw "RefitObject : Object hasn't been added to the BVH";
+	}
+
+	_ObjectData& Data = m_ObjectData[ObjectID];
+
+	if (!m_KeepCPUData) {
+		throw "RefitObject : CPU side BVH data was cleared, call BufferData(false)";
+	}
+
+	if ((int)NewVertices.size() != Data.VertexCount) {
+		throw "RefitObject : Vertex count doesn't match the object's";
+	}
+
+	_RefitData& Refit = m_RefitData[ObjectID];
+
+	if (Refit.Subtrees.empty()) {
+		Refit.BuildCost = BVH::GetFlattenedSAHCost(&m_BVHNodes[Data.NodeOffset], Data.NodeCount);
+		_CreateRefitPlan(Data, Refit);
+	}
+
+	_ApplyRebuild(Data, Refit);
+
+	std::copy(NewVertices.begin(), NewVertices.end(), m_BVHVertices.begin() + Data.VerticesOffset);
+
+	// Refit
+	T* Nodes = &m_BVHNodes[Data.NodeOffset];
+	const BVH::Triangle* Triangles = m_BVHTriangles.data();
+	const Vertex* Vertices = m_BVHVertices.data();
+
+	// One chunk per subtree so the pool balances uneven subtrees
+	ParallelFor((int)Refit.Subtrees.size(), (int)Refit.Subtrees.size(), [&](int, int Start, int End) {
+		for (int s = Start; s < End; s++) {
+			for (int Index : Refit.Subtrees[s]) {
+				BVH::RefitFlattenedNode(Nodes, Index, Triangles, Vertices);
+			}
+		}
+	});
+
+	for (int Index : Refit.Top) {
+		BVH::RefitFlattenedNode(Nodes, Index, Triangles, Vertices);
+	}
+
+	// Quality monitor
+	float Cost = BVH::GetFlattenedSAHCost(Nodes, Data.NodeCount);
+
+	if (Cost > Refit.BuildCost * m_RebuildThreshold && !Refit.Rebuild.valid()) {
+
+		std::vector<Vertex> RebuildVertices(NewVertices);
+		std::vector<GLuint> RebuildIndices;
+		std::vector<int> RebuildMeshIDs;
+
+		for (int i = Data.TriangleOffset; i < Data.TriangleOffset + Data.TriangleCount; i++) {
+			for (int v = 0; v < 3; v++) {
+				RebuildIndices.push_back(m_BVHTriangles[i].PackedData[v] - Data.VerticesOffset);
+			}
+
+			RebuildMeshIDs.push_back(m_BVHTriangles[i].PackedData[3]);
+		}
+
+		int TriangleOffset = Data.TriangleOffset;
+
+		Refit.Rebuild = std::async(std::launch::async, [RebuildVertices, RebuildIndices, RebuildMeshIDs, TriangleOffset]() {
+			_RebuildResult Result;
+			BVH::Node* RootNode = BVH::BuildBVH(RebuildVertices, RebuildIndices, RebuildMeshIDs, Result.Nodes, Result.Triangles, TriangleOffset);
+			BVH::DeleteBVH(RootNode);
+			Result.Cost = BVH::GetFlattenedSAHCost(Result.Nodes.data(), Result.Nodes.size());
+			return Result;
+		});
+	}
+
+#ifdef COMPACT_VERTICES
+	// The object moved, so it's quantized against its new bounds (the next PushEntity() picks them up)
+	glm::vec3 VertexMin = glm::vec3(NewVertices[0].position);
+	glm::vec3 VertexMax = VertexMin;
+
+	for (const auto& v : NewVertices) {
+		VertexMin = glm::min(VertexMin, glm::vec3(v.position));
+		VertexMax = glm::max(VertexMax, glm::vec3(v.position));
+	}
+
+	Data.DequantizeMin = VertexMin;
+	Data.DequantizeScale = GetDequantizeScale(VertexMin, VertexMax);
+#endif
+
+	if (m_Buffered) {
+		_UploadNodes(Data, Nodes);
+		_UploadVertices(Data, NewVertices.data());
+		_UploadTriangleData(Data, &m_BVHTriangles[Data.TriangleOffset], NewVertices.data());
 	}
 }
 
+template<typename T>
+void Candela::RayIntersector<T>::SetRebuildThreshold(float CostRatio)
+{
+	if (CostRatio < 1.0f) {
+		throw "SetRebuildThreshold : CostRatio has to be >= 1";
+	}
+
+	m_RebuildThreshold = CostRatio;
+}
+
 template<typename T>
 inline bool Candela::RayIntersector<T>::Collide(const glm::vec3& Point)
 {
@@ -408,43 +803,17 @@ void Candela::RayIntersector<T>::GenerateMeshTextureReferences()
 	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(BVH::TextureReferences) * m_MeshTextureReferences.size(), m_MeshTextureReferences.data(), GL_STATIC_DRAW);
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-	//_BindTextures();
-
-}
+	// Uploaded once, the shaders turn them back into samplers, so there's no limit on the texture count and nothing to bind per shader
+	std::vector<GLuint64> Handles(glm::max(LastIndex, 1), 0);
 
-// TODO : Remove limit for textures 
-
-template<typename T>
-inline void Candela::RayIntersector<T>::_BindTextures()
-{
-	TraceShader.Use();
-	
-	// Bind, bindless textures (ironic, I know.)
-	for (auto& e : m_TextureHandleReferenceMap)
-	{
-		std::string Name = "Textures[" + std::to_string(e.second) + "]";
-		glProgramUniformHandleui64ARB(TraceShader.GetProgram(), TraceShader.FetchUniformLocation(Name), e.first);
+	for (auto& e : DataMap) {
+		Handles[e.second] = e.first;
 	}
-	
-	glUseProgram(0);
-}
-
-template<typename T>
-inline void Candela::RayIntersector<T>::_BindTextures(GLClasses::ComputeShader& Shader)
-{
-	Shader.Use();
 
-	for (int i = 0; i < 512; i++) {
+	glDeleteBuffers(1, &m_BVHTextureHandlesSSBO);
 
-		std::string Name = "Textures[" + std::to_string(i) + "]";
-		glProgramUniformHandleui64ARB(Shader.GetProgram(), Shader.FetchUniformLocation(Name), m_MiscTex.GetTextureID());
-
-	}
-
-	// Bind, bindless textures (ironic, I know.)
-	for (auto& e : m_TextureHandleReferenceMap)
-	{
-		std::string Name = "Textures[" + std::to_string(e.second) + "]";
-		glProgramUniformHandleui64ARB(Shader.GetProgram(), Shader.FetchUniformLocation(Name), e.first);
-	}
+	glGenBuffers(1, &m_BVHTextureHandlesSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_BVHTextureHandlesSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint64) * Handles.size(), Handles.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
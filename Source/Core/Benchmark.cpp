@@ -0,0 +1,529 @@
+#include "Benchmark.h"
+
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <cstdlib>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "Profiler.h"
+#include "Application/Logger.h"
+#include "BVH/BVHConstructor.h"
+
+namespace Candela {
+
+	namespace Benchmark {
+
+		struct FrameSample {
+			uint64_t ProfilerFrame;
+			float CPU;
+			float GPU = -1.0f;
+			std::vector<float> ZoneCPU;
+			std::vector<float> ZoneGPU;
+		};
+
+		struct Stats {
+			float Average = 0.0f;
+			float Min = 0.0f;
+			float Max = 0.0f;
+			float P50 = 0.0f;
+			float P90 = 0.0f;
+			float P95 = 0.0f;
+			float P99 = 0.0f;
+			int Count = 0;
+		};
+
+		static Settings CurrentSettings;
+
+		static std::vector<CameraKeyframe> Path;
+		static std::vector<CameraKeyframe> Recorded;
+		static int FrameCounter = 0;
+		static bool Finished = false;
+
+		static std::vector<FrameSample> Samples;
+		static std::unordered_map<uint64_t, int> SampleLookup;
+		static std::vector<std::string> ZoneNames;
+		static std::unordered_map<std::string, int> ZoneLookup;
+
+		static std::chrono::steady_clock::time_point LastFrameEnd;
+
+		static int GetZoneIndex(const std::string& name)
+		{
+			auto Found = ZoneLookup.find(name);
+
+			if (Found != ZoneLookup.end()) {
+				return Found->second;
+			}
+
+			int Index = (int)ZoneNames.size();
+			ZoneNames.push_back(name);
+			ZoneLookup[name] = Index;
+			return Index;
+		}
+
+		static void OnFrameResolved(uint64_t frame, const std::vector<Profiler::ZoneTiming>& zones)
+		{
+			auto Found = SampleLookup.find(frame);
+
+			if (Found == SampleLookup.end()) {
+				return;
+			}
+
+			FrameSample& Sample = Samples[Found->second];
+			Sample.GPU = 0.0f;
+
+			for (auto& e : zones) {
+				int Index = GetZoneIndex(e.Name);
+
+				if ((int)Sample.ZoneGPU.size() <= Index) {
+					Sample.ZoneCPU.resize(Index + 1, -1.0f);
+					Sample.ZoneGPU.resize(Index + 1, -1.0f);
+				}
+
+				// Zones that show up more than once in a frame are summed
+				Sample.ZoneCPU[Index] = std::max(Sample.ZoneCPU[Index], 0.0f) + (e.CPUEnd - e.CPUStart);
+				Sample.ZoneGPU[Index] = std::max(Sample.ZoneGPU[Index], 0.0f) + (e.GPUEnd - e.GPUStart);
+				Sample.GPU = std::max(Sample.GPU, e.GPUEnd);
+			}
+		}
+
+		// Nearest rank percentiles, negative values mark missing samples and are skipped
+		static Stats ComputeStats(const std::vector<float>& values)
+		{
+			std::vector<float> Sorted;
+			Sorted.reserve(values.size());
+
+			for (float v : values) {
+				if (v >= 0.0f) {
+					Sorted.push_back(v);
+				}
+			}
+
+			Stats Result;
+
+			if (Sorted.empty()) {
+				return Result;
+			}
+
+			std::sort(Sorted.begin(), Sorted.end());
+
+			double Total = 0.0;
+
+			for (float v : Sorted) {
+				Total += v;
+			}
+
+			auto Percentile = [&](float p) {
+				int Rank = (int)std::ceil(p * float(Sorted.size())) - 1;
+				return Sorted[std::min(std::max(Rank, 0), (int)Sorted.size() - 1)];
+			};
+
+			Result.Count = (int)Sorted.size();
+			Result.Average = float(Total / double(Sorted.size()));
+			Result.Min = Sorted.front();
+			Result.Max = Sorted.back();
+			Result.P50 = Percentile(0.50f);
+			Result.P90 = Percentile(0.90f);
+			Result.P95 = Percentile(0.95f);
+			Result.P99 = Percentile(0.99f);
+			return Result;
+		}
+
+		// Model and camera paths can hold backslashes and quotes
+		static std::string EscapeJSON(const std::string& str)
+		{
+			std::string Escaped;
+			Escaped.reserve(str.size());
+
+			for (char c : str) {
+				if (c == '"' || c == '\\') {
+					Escaped += '\\';
+				}
+
+				Escaped += c;
+			}
+
+			return Escaped;
+		}
+
+		static void WriteStats(std::ofstream& file, const Stats& stats)
+		{
+			file << "{ \"avg\": " << stats.Average << ", \"min\": " << stats.Min << ", \"max\": " << stats.Max
+				<< ", \"p50\": " << stats.P50 << ", \"p90\": " << stats.P90 << ", \"p95\": " << stats.P95
+				<< ", \"p99\": " << stats.P99 << ", \"samples\": " << stats.Count << " }";
+		}
+
+		static void WriteResults()
+		{
+			std::string CSVPath = CurrentSettings.OutputPath + ".csv";
+			std::string JSONPath = CurrentSettings.OutputPath + ".json";
+
+			std::ofstream CSV(CSVPath);
+
+			if (!CSV.good()) {
+				std::cout << "\nBenchmark : Couldn't write " << CSVPath << "\n";
+				Logger::LogToFile("Benchmark : Couldn't write results");
+				return;
+			}
+
+			CSV << "frame,cpu_ms,gpu_ms";
+
+			for (auto& e : ZoneNames) {
+				CSV << "," << e << " cpu_ms," << e << " gpu_ms";
+			}
+
+			CSV << "\n";
+
+			for (int i = 0; i < (int)Samples.size(); i++) {
+				const FrameSample& Sample = Samples[i];
+				CSV << i << "," << Sample.CPU << "," << Sample.GPU;
+
+				for (int z = 0; z < (int)ZoneNames.size(); z++) {
+					bool Resolved = z < (int)Sample.ZoneGPU.size();
+					CSV << "," << (Resolved ? Sample.ZoneCPU[z] : -1.0f) << "," << (Resolved ? Sample.ZoneGPU[z] : -1.0f);
+				}
+
+				CSV << "\n";
+			}
+
+			std::vector<float> CPUTimes, GPUTimes;
+
+			for (auto& e : Samples) {
+				CPUTimes.push_back(e.CPU);
+				GPUTimes.push_back(e.GPU);
+			}
+
+			std::ofstream JSON(JSONPath);
+
+			if (!JSON.good()) {
+				std::cout << "\nBenchmark : Couldn't write " << JSONPath << "\n";
+				Logger::LogToFile("Benchmark : Couldn't write results");
+				return;
+			}
+
+			JSON << "{\n";
+			JSON << "\t\"scene\": \"" << EscapeJSON(CurrentSettings.Scene) << "\",\n";
+			JSON << "\t\"camera_path\": \"" << EscapeJSON(CurrentSettings.CameraPath) << "\",\n";
+			JSON << "\t\"frames\": " << Samples.size() << ",\n";
+			JSON << "\t\"warmup_frames\": " << CurrentSettings.WarmupFrames << ",\n";
+			JSON << "\t\"seed\": " << CurrentSettings.Seed << ",\n";
+			JSON << "\t\"resolution\": [" << CurrentSettings.Width << ", " << CurrentSettings.Height << "],\n";
+			JSON << "\t\"cpu_ms\": "; WriteStats(JSON, ComputeStats(CPUTimes)); JSON << ",\n";
+			JSON << "\t\"gpu_ms\": "; WriteStats(JSON, ComputeStats(GPUTimes)); JSON << ",\n";
+			JSON << "\t\"zones\": {\n";
+
+			for (int z = 0; z < (int)ZoneNames.size(); z++) {
+				std::vector<float> ZoneCPU, ZoneGPU;
+
+				for (auto& e : Samples) {
+					ZoneCPU.push_back(z < (int)e.ZoneCPU.size() ? e.ZoneCPU[z] : -1.0f);
+					ZoneGPU.push_back(z < (int)e.ZoneGPU.size() ? e.ZoneGPU[z] : -1.0f);
+				}
+
+				JSON << "\t\t\"" << EscapeJSON(ZoneNames[z]) << "\": {\n";
+				JSON << "\t\t\t\"cpu_ms\": "; WriteStats(JSON, ComputeStats(ZoneCPU)); JSON << ",\n";
+				JSON << "\t\t\t\"gpu_ms\": "; WriteStats(JSON, ComputeStats(ZoneGPU)); JSON << "\n";
+				JSON << "\t\t}" << (z + 1 < (int)ZoneNames.size() ? "," : "") << "\n";
+			}
+
+			JSON << "\t},\n";
+
+			// Child ordering of every BVH built for the scene (see BVHConstructor.cpp)
+			const auto& Orderings = BVH::GetChildOrderingStats();
+
+			JSON << "\t\"bvh_child_ordering\": [\n";
+
+			for (int b = 0; b < (int)Orderings.size(); b++) {
+
+				const auto& Stats = Orderings[b];
+
+				JSON << "\t\t{\n";
+				JSON << "\t\t\t\"model\": \"" << EscapeJSON(Stats.Model) << "\",\n";
+				JSON << "\t\t\t\"sample_rays\": " << Stats.SampleRays << ",\n";
+				JSON << "\t\t\t\"chosen\": \"" << BVH::GetChildOrderingName(Stats.Chosen) << "\",\n";
+				JSON << "\t\t\t\"average_nodes_visited\": {";
+
+				for (int o = 0; o < BVH::CHILD_ORDERING_COUNT; o++) {
+					JSON << " \"" << BVH::GetChildOrderingName(static_cast<BVH::ChildOrdering>(o)) << "\": " << Stats.AverageNodesVisited[o] << (o + 1 < BVH::CHILD_ORDERING_COUNT ? "," : " ");
+				}
+
+				JSON << "}\n";
+				JSON << "\t\t}" << (b + 1 < (int)Orderings.size() ? "," : "") << "\n";
+			}
+
+			JSON << "\t]\n";
+			JSON << "}\n";
+
+			Stats Summary = ComputeStats(CPUTimes);
+			std::cout << "\nBenchmark : " << Samples.size() << " frames, cpu avg " << Summary.Average << " ms, p99 " << Summary.P99 << " ms";
+
+			// Reported on its own so the cpu cost of the probe scheduling can be compared between runs
+			auto ProbeZone = ZoneLookup.find("Probe Update");
+
+			if (ProbeZone != ZoneLookup.end()) {
+				std::vector<float> ProbeCPU;
+
+				for (auto& e : Samples) {
+					ProbeCPU.push_back(ProbeZone->second < (int)e.ZoneCPU.size() ? e.ZoneCPU[ProbeZone->second] : -1.0f);
+				}
+
+				Stats ProbeSummary = ComputeStats(ProbeCPU);
+				std::cout << "\nBenchmark : Probe update cpu avg " << ProbeSummary.Average << " ms, p99 " << ProbeSummary.P99 << " ms";
+			}
+			std::cout << "\nBenchmark : Wrote " << CSVPath << " and " << JSONPath << "\n";
+		}
+	}
+}
+
+void Candela::Benchmark::ParseArguments(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string Arg = argv[i];
+		bool HasValue = i + 1 < argc;
+
+		if (Arg == "--benchmark" && HasValue) {
+			CurrentSettings.CameraPath = argv[++i];
+		}
+
+		else if (Arg == "--record" && HasValue) {
+			CurrentSettings.RecordPath = argv[++i];
+		}
+
+		else if (Arg == "--scene" && HasValue) {
+			CurrentSettings.Scene = argv[++i];
+		}
+
+		else if (Arg == "--out" && HasValue) {
+			CurrentSettings.OutputPath = argv[++i];
+		}
+
+		else if (Arg == "--warmup" && HasValue) {
+			CurrentSettings.WarmupFrames = std::atoi(argv[++i]);
+		}
+
+		else if (Arg == "--seed" && HasValue) {
+			CurrentSettings.Seed = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+		}
+
+		else if (Arg == "--size" && i + 2 < argc) {
+			CurrentSettings.Width = (unsigned int)std::atoi(argv[++i]);
+			CurrentSettings.Height = (unsigned int)std::atoi(argv[++i]);
+		}
+
+		else if (Arg == "--headless") {
+			CurrentSettings.Headless = true;
+		}
+
+		else {
+			std::cout << "\nUnknown or incomplete argument : " << Arg << "\n";
+		}
+	}
+
+	// The first frame includes loading time, never record it
+	CurrentSettings.WarmupFrames = std::max(CurrentSettings.WarmupFrames, 1);
+}
+
+const Candela::Benchmark::Settings& Candela::Benchmark::GetSettings()
+{
+	return CurrentSettings;
+}
+
+bool Candela::Benchmark::IsActive()
+{
+	return !CurrentSettings.CameraPath.empty();
+}
+
+bool Candela::Benchmark::IsRecording()
+{
+	return !CurrentSettings.RecordPath.empty() && !IsActive();
+}
+
+std::string Candela::Benchmark::GetScenePath(const std::string& name)
+{
+	static const std::unordered_map<std::string, std::string> Scenes = {
+		{ "sponza", "Models/sponza-2/sponza.obj" },
+		{ "sponza-pbr", "Models/sponza-pbr/sponza.gltf" },
+		{ "architecture", "Models/architecture/scene.gltf" },
+		{ "living_room", "Models/living_room/living_room.obj" },
+		{ "fireplace_room", "Models/fireplace_room/fireplace_room.obj" },
+		{ "gitest", "Models/gitest/multibounce_gi_test_scene.gltf" },
+		{ "csgo", "Models/csgo/scene.gltf" },
+		{ "mc", "Models/mc/scene.gltf" },
+		{ "peachcastle", "Models/peachcastle/Castle.obj" }
+	};
+
+	if (name.find('.') != std::string::npos) {
+		return name;
+	}
+
+	auto Found = Scenes.find(name);
+
+	if (Found == Scenes.end()) {
+		std::cout << "\nUnknown scene : " << name << ", using sponza\n";
+		return Scenes.at("sponza");
+	}
+
+	return Found->second;
+}
+
+bool Candela::Benchmark::LoadCameraPath(const std::string& path, std::vector<CameraKeyframe>& keyframes)
+{
+	std::ifstream File(path);
+
+	if (!File.good()) {
+		return false;
+	}
+
+	keyframes.clear();
+
+	std::string Line;
+
+	while (std::getline(File, Line)) {
+		if (Line.empty() || Line[0] == '#') {
+			continue;
+		}
+
+		std::istringstream Stream(Line);
+		CameraKeyframe Keyframe;
+
+		if (Stream >> Keyframe.Position.x >> Keyframe.Position.y >> Keyframe.Position.z >> Keyframe.Yaw >> Keyframe.Pitch) {
+			keyframes.push_back(Keyframe);
+		}
+	}
+
+	return !keyframes.empty();
+}
+
+bool Candela::Benchmark::SaveCameraPath(const std::string& path, const std::vector<CameraKeyframe>& keyframes)
+{
+	std::ofstream File(path);
+
+	if (!File.good()) {
+		return false;
+	}
+
+	File << "# x y z yaw pitch\n";
+
+	for (auto& e : keyframes) {
+		File << e.Position.x << " " << e.Position.y << " " << e.Position.z << " " << e.Yaw << " " << e.Pitch << "\n";
+	}
+
+	return true;
+}
+
+void Candela::Benchmark::Begin()
+{
+	if (!IsActive()) {
+		return;
+	}
+
+	// Every texture and trace shader is bindless, software drivers (llvmpipe) don't expose the extension so they can't run the benchmark
+	if (!glfwExtensionSupported("GL_ARB_bindless_texture")) {
+		std::cout << "\nBenchmark : GL_ARB_bindless_texture isn't supported by this driver, a hardware OpenGL 4.5 driver is required\n";
+		Logger::LogToFile("Benchmark : GL_ARB_bindless_texture isn't supported");
+		throw "Benchmark : GL_ARB_bindless_texture isn't supported";
+	}
+
+	if (!LoadCameraPath(CurrentSettings.CameraPath, Path)) {
+		std::cout << "\nBenchmark : Couldn't load camera path " << CurrentSettings.CameraPath << "\n";
+		Logger::LogToFile("Benchmark : Couldn't load camera path");
+		throw "Benchmark : Couldn't load camera path";
+	}
+
+	std::srand(CurrentSettings.Seed);
+
+	Samples.clear();
+	SampleLookup.clear();
+	ZoneNames.clear();
+	ZoneLookup.clear();
+	FrameCounter = 0;
+	Finished = false;
+
+	Profiler::SetEnabled(true);
+	Profiler::SetResolveCallback(OnFrameResolved);
+
+	LastFrameEnd = std::chrono::steady_clock::now();
+
+	std::cout << "\nBenchmark : Replaying " << Path.size() << " frames of " << CurrentSettings.CameraPath << " in " << CurrentSettings.Scene << "\n";
+}
+
+float Candela::Benchmark::GetDeltaTime()
+{
+	return CurrentSettings.TimeStep;
+}
+
+float Candela::Benchmark::GetTime()
+{
+	return float(FrameCounter) * CurrentSettings.TimeStep;
+}
+
+void Candela::Benchmark::ApplyCamera(FPSCamera& camera)
+{
+	if (Path.empty()) {
+		return;
+	}
+
+	int Index = std::min(std::max(FrameCounter - CurrentSettings.WarmupFrames, 0), (int)Path.size() - 1);
+	const CameraKeyframe& Keyframe = Path[Index];
+
+	camera.SetPosition(Keyframe.Position);
+	camera.SetRotationAngles(Keyframe.Yaw, Keyframe.Pitch);
+}
+
+void Candela::Benchmark::RecordCamera(const FPSCamera& camera)
+{
+	CameraKeyframe Keyframe;
+	Keyframe.Position = camera.GetPosition();
+	Keyframe.Yaw = camera.GetYaw();
+	Keyframe.Pitch = camera.GetPitch();
+	Recorded.push_back(Keyframe);
+}
+
+bool Candela::Benchmark::EndFrame()
+{
+	auto Now = std::chrono::steady_clock::now();
+	float CPUTime = std::chrono::duration<float, std::milli>(Now - LastFrameEnd).count();
+	LastFrameEnd = Now;
+
+	if (!IsActive() || Finished) {
+		return Finished;
+	}
+
+	if (FrameCounter >= CurrentSettings.WarmupFrames) {
+		FrameSample Sample;
+		Sample.ProfilerFrame = Profiler::GetFrameIndex();
+		Sample.CPU = CPUTime;
+
+		SampleLookup[Sample.ProfilerFrame] = (int)Samples.size();
+		Samples.push_back(Sample);
+	}
+
+	FrameCounter++;
+
+	if (FrameCounter - CurrentSettings.WarmupFrames >= (int)Path.size()) {
+		Profiler::Flush();
+		Profiler::SetResolveCallback(nullptr);
+		WriteResults();
+		Finished = true;
+	}
+
+	return Finished;
+}
+
+void Candela::Benchmark::Shutdown()
+{
+	if (IsRecording() && !Recorded.empty()) {
+		if (SaveCameraPath(CurrentSettings.RecordPath, Recorded)) {
+			std::cout << "\nRecorded " << Recorded.size() << " frames to " << CurrentSettings.RecordPath << "\n";
+		}
+
+		else {
+			std::cout << "\nCouldn't write camera path " << CurrentSettings.RecordPath << "\n";
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FpsCamera.h"
+
+namespace Candela {
+
+	// Deterministic benchmark mode
+	// Replays a recorded camera path with fixed seeds and a fixed timestep, then writes per frame cpu/gpu timings to CSV and a percentile summary to JSON
+	namespace Benchmark {
+
+		struct CameraKeyframe {
+			glm::vec3 Position;
+			float Yaw;
+			float Pitch;
+		};
+
+		struct Settings {
+			std::string Scene = "sponza";
+			std::string CameraPath; // Path to replay, benchmark mode is active if this is set
+			std::string RecordPath; // Records the player's camera path to this file
+			std::string OutputPath = "benchmark"; // .csv and .json are appended
+			int WarmupFrames = 32; // Frames rendered on the first keyframe before timings are recorded
+			unsigned int Seed = 1337;
+			float TimeStep = 1.0f / 60.0f;
+			unsigned int Width = 1280;
+			unsigned int Height = 720;
+			bool Headless = false;
+		};
+
+		// --benchmark <path> --record <path> --scene <name> --out <path> --warmup <n> --seed <n> --size <w> <h> --headless
+		// --headless only hides the window, the run still needs a hardware driver with ARB_bindless_texture (software GL doesn't expose it)
+		void ParseArguments(int argc, char** argv);
+		const Settings& GetSettings();
+
+		bool IsActive();
+		bool IsRecording();
+
+		// Maps a scene name to its model file, names containing a '.' are treated as paths
+		std::string GetScenePath(const std::string& name);
+
+		bool LoadCameraPath(const std::string& path, std::vector<CameraKeyframe>& keyframes);
+		bool SaveCameraPath(const std::string& path, const std::vector<CameraKeyframe>& keyframes);
+
+		// Loads the camera path, seeds rngs and hooks into the profiler
+		void Begin();
+
+		// Fixed timestep and time used instead of the wall clock while active
+		float GetDeltaTime();
+		float GetTime();
+
+		// Moves the camera to the current keyframe
+		void ApplyCamera(FPSCamera& camera);
+		void RecordCamera(const FPSCamera& camera);
+
+		// Call after Profiler::EndFrame(), returns true once the path has finished and the results have been written
+		bool EndFrame();
+
+		// Writes out the recorded path if recording
+		void Shutdown();
+	}
+}
@@ -0,0 +1,248 @@
+#include "DrawList.h"
+#include "Threadpool.h"
+
+#include <cstring>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+// Scenes with more commands than this are culled across multiple threads
+#define DRAWLIST_PARALLEL_THRESHOLD 16384
+
+namespace Candela {
+
+	static inline int PadToBatch(int count) {
+		return (count + 7) & ~7;
+	}
+
+	// Packs the 6 frustum planes as 6 normal x, 6 normal y, 6 normal z and 6 distances
+	static void PackPlanes(const Frustum& frustum, float* planes) {
+
+		const Plane* Planes[6] = { &frustum.Left, &frustum.Right, &frustum.Top, &frustum.Bottom, &frustum.Near, &frustum.Far };
+
+		for (int i = 0; i < 6; i++) {
+			planes[i] = Planes[i]->Normal.x;
+			planes[6 + i] = Planes[i]->Normal.y;
+			planes[12 + i] = Planes[i]->Normal.z;
+			planes[18 + i] = Planes[i]->Distance;
+		}
+	}
+}
+
+void Candela::DrawList::Update(const std::vector<Entity*>& entities)
+{
+	bool Rebuild = entities.size() != m_Entities.size();
+
+	for (int i = 0; i < (int)entities.size() && !Rebuild; i++) {
+		Rebuild = entities[i] != m_Entities[i];
+	}
+
+	if (Rebuild) {
+
+		m_Version++;
+		m_Entities = entities;
+		m_EntityMatrices.resize(entities.size());
+		m_EntityFirstCommand.resize(entities.size() + 1);
+		m_Commands.clear();
+
+		for (int i = 0; i < (int)entities.size(); i++) {
+
+			m_EntityFirstCommand[i] = (int)m_Commands.size();
+
+			for (auto& e : entities[i]->m_Object->m_Meshes) {
+				DrawCommand Command;
+				Command.EntityPtr = entities[i];
+				Command.MeshPtr = &e;
+				Command.EntityIndex = i;
+				m_Commands.push_back(Command);
+			}
+		}
+
+		m_EntityFirstCommand[entities.size()] = (int)m_Commands.size();
+
+		int Padded = PadToBatch((int)m_Commands.size());
+
+		for (auto* e : { &m_CenterX, &m_CenterY, &m_CenterZ, &m_ExtentX, &m_ExtentY, &m_ExtentZ }) {
+			e->assign(Padded, 0.0f);
+		}
+
+		for (int i = 0; i < (int)entities.size(); i++) {
+			UpdateEntityBounds(i);
+		}
+
+		return;
+	}
+
+	for (int i = 0; i < (int)entities.size(); i++) {
+		if (std::memcmp(&m_EntityMatrices[i], &entities[i]->m_Model, sizeof(glm::mat4)) != 0) {
+			UpdateEntityBounds(i);
+		}
+	}
+}
+
+void Candela::DrawList::UpdateEntityBounds(int entity)
+{
+	const glm::mat4& Model = m_Entities[entity]->m_Model;
+	m_EntityMatrices[entity] = Model;
+	m_Version++;
+
+	// |M| transforms the extent of a box into the extent of its world space bounding box
+	glm::mat3 AbsoluteBasis = glm::mat3(glm::abs(glm::vec3(Model[0])), glm::abs(glm::vec3(Model[1])), glm::abs(glm::vec3(Model[2])));
+
+	for (int i = m_EntityFirstCommand[entity]; i < m_EntityFirstCommand[entity + 1]; i++) {
+
+		const FrustumBox& Box = m_Commands[i].MeshPtr->Box;
+
+		glm::vec3 Center = glm::vec3(Model * glm::vec4(Box.Origin, 1.0f));
+		glm::vec3 Extent = AbsoluteBasis * Box.Extent;
+
+		m_CenterX[i] = Center.x;
+		m_CenterY[i] = Center.y;
+		m_CenterZ[i] = Center.z;
+		m_ExtentX[i] = Extent.x;
+		m_ExtentY[i] = Extent.y;
+		m_ExtentZ[i] = Extent.z;
+	}
+}
+
+void Candela::DrawList::CullRange(const float* planes, int start, int end, std::vector<uint32_t>& visible) const
+{
+	// start is always a multiple of 8, the arrays are padded so whole batches can be loaded
+	for (int i = start; i < end; i += 8) {
+
+		int Mask = 0;
+
+#if defined(__AVX__)
+		__m256 CX = _mm256_loadu_ps(&m_CenterX[i]);
+		__m256 CY = _mm256_loadu_ps(&m_CenterY[i]);
+		__m256 CZ = _mm256_loadu_ps(&m_CenterZ[i]);
+		__m256 EX = _mm256_loadu_ps(&m_ExtentX[i]);
+		__m256 EY = _mm256_loadu_ps(&m_ExtentY[i]);
+		__m256 EZ = _mm256_loadu_ps(&m_ExtentZ[i]);
+
+		__m256 Inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		__m256 SignMask = _mm256_set1_ps(-0.0f);
+
+		for (int p = 0; p < 6; p++) {
+			__m256 NX = _mm256_set1_ps(planes[p]);
+			__m256 NY = _mm256_set1_ps(planes[6 + p]);
+			__m256 NZ = _mm256_set1_ps(planes[12 + p]);
+			__m256 D = _mm256_set1_ps(planes[18 + p]);
+
+			// Signed distance of the center and the projected radius of the box onto the plane normal
+			__m256 Distance = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(NX, CX), _mm256_mul_ps(NY, CY)), _mm256_mul_ps(NZ, CZ)), D);
+			__m256 Radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(SignMask, NX), EX), _mm256_mul_ps(_mm256_andnot_ps(SignMask, NY), EY)), _mm256_mul_ps(_mm256_andnot_ps(SignMask, NZ), EZ));
+
+			Inside = _mm256_and_ps(Inside, _mm256_cmp_ps(_mm256_add_ps(Distance, Radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+
+		Mask = _mm256_movemask_ps(Inside);
+#else
+		for (int l = 0; l < 8; l++) {
+
+			bool Inside = true;
+
+			for (int p = 0; p < 6; p++) {
+				float Distance = planes[p] * m_CenterX[i + l] + planes[6 + p] * m_CenterY[i + l] + planes[12 + p] * m_CenterZ[i + l] - planes[18 + p];
+				float Radius = std::abs(planes[p]) * m_ExtentX[i + l] + std::abs(planes[6 + p]) * m_ExtentY[i + l] + std::abs(planes[12 + p]) * m_ExtentZ[i + l];
+				Inside = Inside && (Distance + Radius >= 0.0f);
+			}
+
+			Mask |= int(Inside) << l;
+		}
+#endif
+
+		// Drop the padding
+		int Lanes = std::min(8, end - i);
+
+		for (int l = 0; l < Lanes; l++) {
+			if (Mask & (1 << l)) {
+				visible.push_back(uint32_t(i + l));
+			}
+		}
+	}
+}
+
+void Candela::DrawList::Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+	float Planes[24];
+	PackPlanes(frustum, Planes);
+
+	visible.clear();
+
+	int Count = (int)m_Commands.size();
+	int ThreadCount = GetParallelThreadCount();
+
+	if (Count < DRAWLIST_PARALLEL_THRESHOLD || ThreadCount <= 1) {
+		visible.reserve(Count);
+		CullRange(Planes, 0, Count, visible);
+		return;
+	}
+
+	// Each chunk culls a contiguous, batch aligned range on the shared pool, results are concatenated in order
+	std::vector<std::vector<uint32_t>> ThreadVisible(ThreadCount);
+
+	ParallelFor(PadToBatch(Count) / 8, ThreadCount, [&](int Chunk, int Start, int End) {
+		Start = std::min(Count, Start * 8);
+		End = std::min(Count, End * 8);
+		ThreadVisible[Chunk].reserve(End - Start);
+		CullRange(Planes, Start, End, ThreadVisible[Chunk]);
+	});
+
+	for (auto& e : ThreadVisible) {
+		visible.insert(visible.end(), e.begin(), e.end());
+	}
+}
+
+void Candela::DrawList::CullSwept(const Frustum& frustum, const glm::vec3& sweep, std::vector<uint32_t>& visible) const
+{
+	float Planes[24];
+	PackPlanes(frustum, Planes);
+
+	glm::vec3 HalfSweep = sweep * 0.5f;
+	glm::vec3 HalfSweepExtent = glm::abs(HalfSweep);
+
+	int Kept = 0;
+
+	for (uint32_t i : visible) {
+
+		// Bounds of the box swept along the vector
+		glm::vec3 Center = glm::vec3(m_CenterX[i], m_CenterY[i], m_CenterZ[i]) + HalfSweep;
+		glm::vec3 Extent = glm::vec3(m_ExtentX[i], m_ExtentY[i], m_ExtentZ[i]) + HalfSweepExtent;
+
+		bool Inside = true;
+
+		for (int p = 0; p < 6 && Inside; p++) {
+			float Distance = Planes[p] * Center.x + Planes[6 + p] * Center.y + Planes[12 + p] * Center.z - Planes[18 + p];
+			float Radius = std::abs(Planes[p]) * Extent.x + std::abs(Planes[6 + p]) * Extent.y + std::abs(Planes[12 + p]) * Extent.z;
+			Inside = Distance + Radius >= 0.0f;
+		}
+
+		if (Inside) {
+			visible[Kept++] = i;
+		}
+	}
+
+	visible.resize(Kept);
+}
+
+void Candela::DrawList::PackBounds(std::vector<glm::vec4>& bounds) const
+{
+	bounds.resize(m_Commands.size() * 2);
+
+	for (int i = 0; i < (int)m_Commands.size(); i++) {
+		bounds[i * 2 + 0] = glm::vec4(m_CenterX[i], m_CenterY[i], m_CenterZ[i], 0.0f);
+		bounds[i * 2 + 1] = glm::vec4(m_ExtentX[i], m_ExtentY[i], m_ExtentZ[i], 0.0f);
+	}
+}
+
+void Candela::DrawList::GetAll(std::vector<uint32_t>& visible) const
+{
+	visible.resize(m_Commands.size());
+
+	for (int i = 0; i < (int)m_Commands.size(); i++) {
+		visible[i] = uint32_t(i);
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Entity.h"
+#include "Mesh.h"
+#include "Frustum.h"
+
+namespace Candela {
+
+	// One mesh of an entity, submitted as a single draw
+	struct DrawCommand {
+		Entity* EntityPtr;
+		const Mesh* MeshPtr;
+		int EntityIndex;
+	};
+
+	// Flat list of every mesh in the scene
+	// World space bounds are kept in a SoA array (padded to a multiple of 8) so the culling stage can test 8 boxes at a time
+	class DrawList {
+
+	public :
+
+		// Rebuilds the commands if the entity list changed, refreshes the bounds of entities that moved
+		void Update(const std::vector<Entity*>& entities);
+
+		// Tests every box against the frustum's planes and writes the indices of the visible commands (in submission order)
+		void Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+		// Removes the commands whose bounds, swept along the sweep vector, lie outside the frustum
+		// Used for caster-receiver culling : a caster is only kept if its shadow volume can reach a visible receiver
+		void CullSwept(const Frustum& frustum, const glm::vec3& sweep, std::vector<uint32_t>& visible) const;
+
+		// Writes the world space bounds as (center, extent) pairs, used to upload them for gpu culling
+		void PackBounds(std::vector<glm::vec4>& bounds) const;
+
+		// Writes every command index
+		void GetAll(std::vector<uint32_t>& visible) const;
+
+		inline const std::vector<DrawCommand>& GetCommands() const { return m_Commands; }
+		inline int GetCommandCount() const { return (int)m_Commands.size(); }
+
+		// Incremented whenever the commands or any bounds change, used to invalidate cached results
+		inline uint32_t GetVersion() const { return m_Version; }
+
+	private :
+
+		void UpdateEntityBounds(int entity);
+		void CullRange(const float* planes, int start, int end, std::vector<uint32_t>& visible) const;
+
+		std::vector<DrawCommand> m_Commands;
+		uint32_t m_Version = 0;
+
+		// Per entity
+		std::vector<Entity*> m_Entities;
+		std::vector<glm::mat4> m_EntityMatrices;
+		std::vector<int> m_EntityFirstCommand;
+
+		// Per command, SoA
+		std::vector<float> m_CenterX, m_CenterY, m_CenterZ;
+		std::vector<float> m_ExtentX, m_ExtentY, m_ExtentZ;
+	};
+}
@@ -42,6 +42,9 @@ namespace Candela
 		Physics::PhysicsObject m_PhysicsObject;
 
 		bool m_IsPhysicsObject = false;
+
+		// Dynamic entities are drawn into the per frame shadow layer instead of the cached static one
+		bool m_IsDynamic = false;
 		bool m_UseAlbedoMap = true;
 		bool m_UsePBRMap = true;
 	};
@@ -72,6 +72,20 @@ namespace Candela
 		this->SetFront(front);
 	}
 
+	void FPSCamera::SetRotationAngles(float yaw, float pitch)
+	{
+		_Yaw = yaw;
+		_Pitch = glm::clamp(pitch, -89.0f, 89.0f);
+
+		glm::vec3 front;
+
+		front.x = cos(glm::radians(_Pitch)) * cos(glm::radians(_Yaw));
+		front.y = sin(glm::radians(_Pitch));
+		front.z = cos(glm::radians(_Pitch)) * sin(glm::radians(_Yaw));
+
+		this->SetFront(front);
+	}
+
 	void FPSCamera::SetPosition(const glm::vec3& position)
 	{
 		m_Position = position;
@@ -22,6 +22,9 @@ namespace Candela
 		
 		void SetFront(const glm::vec3& front);
 
+		// Sets yaw and pitch (in degrees) directly, used for camera path playback
+		void SetRotationAngles(float yaw, float pitch);
+
 		void SetRotation(float angle);
 		void SetFov(float fov);
 		void SetAspect(float aspect);
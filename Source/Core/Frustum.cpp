@@ -14,6 +14,31 @@ void Candela::Frustum::Update(FPSCamera& Camera, int Frame)
     this->Bottom = { Camera.GetPosition(), glm::cross(FarPlaneMultiplier + Camera.GetUp() * HalfVSide, Camera.GetRight()) };
 }
 
+void Candela::Frustum::FromMatrix(const glm::mat4& ViewProjection)
+{
+    // Gribb-Hartmann, each plane is a sum/difference of the 4th row and one of the other rows
+    glm::vec4 Rows[4];
+
+    for (int i = 0; i < 4; i++) {
+        Rows[i] = glm::vec4(ViewProjection[0][i], ViewProjection[1][i], ViewProjection[2][i], ViewProjection[3][i]);
+    }
+
+    auto MakePlane = [](const glm::vec4& Coefficients) {
+        Plane Result;
+        float Length = glm::length(glm::vec3(Coefficients));
+        Result.Normal = glm::vec3(Coefficients) / Length;
+        Result.Distance = -Coefficients.w / Length;
+        return Result;
+    };
+
+    this->Left = MakePlane(Rows[3] + Rows[0]);
+    this->Right = MakePlane(Rows[3] - Rows[0]);
+    this->Bottom = MakePlane(Rows[3] + Rows[1]);
+    this->Top = MakePlane(Rows[3] - Rows[1]);
+    this->Near = MakePlane(Rows[3] + Rows[2]);
+    this->Far = MakePlane(Rows[3] - Rows[2]);
+}
+
 bool Candela::Frustum::TestBox(const FrustumBox& aabb, const glm::mat4& ModelMatrix)
 {
     glm::vec3 Center = glm::vec3(ModelMatrix * glm::vec4(aabb.Origin, 1.0f));
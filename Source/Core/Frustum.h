@@ -14,6 +14,9 @@ namespace Candela {
 
         void Update(FPSCamera& Camera, int Frame);
 
+        // Extracts the planes from a (perspective or orthographic) view projection matrix
+        void FromMatrix(const glm::mat4& ViewProjection);
+
         bool TestBox(const FrustumBox& aabb, const glm::mat4& ModelMatrix);
 
         Plane Top;
@@ -0,0 +1,144 @@
+#include "BufferHeap.h"
+
+#include <iterator>
+
+namespace GLClasses
+{
+	BufferHeap::~BufferHeap()
+	{
+		if (m_Buffer) {
+			glDeleteBuffers(1, &m_Buffer);
+		}
+	}
+
+	void BufferHeap::Create(GLsizeiptr ElementSize, int InitialCapacity)
+	{
+		if (m_Buffer) {
+			throw "BufferHeap : Heap was already created";
+		}
+
+		if (ElementSize <= 0 || InitialCapacity <= 0) {
+			throw "BufferHeap : Invalid element size or capacity";
+		}
+
+		m_ElementSize = ElementSize;
+		m_Capacity = InitialCapacity;
+		m_Allocated = 0;
+
+		glGenBuffers(1, &m_Buffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_Buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_ElementSize * m_Capacity, nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		m_FreeRanges.clear();
+		m_FreeRanges[0] = m_Capacity;
+	}
+
+	int BufferHeap::Allocate(int Count)
+	{
+		if (Count <= 0) {
+			throw "BufferHeap : Can't allocate an empty range";
+		}
+
+		for (auto Range = m_FreeRanges.begin(); Range != m_FreeRanges.end(); Range++) {
+
+			if (Range->second < Count) {
+				continue;
+			}
+
+			int Offset = Range->first;
+			int Remaining = Range->second - Count;
+
+			m_FreeRanges.erase(Range);
+
+			if (Remaining > 0) {
+				m_FreeRanges[Offset + Count] = Remaining;
+			}
+
+			m_Allocated += Count;
+			return Offset;
+		}
+
+		Grow(m_Capacity + Count);
+		return Allocate(Count);
+	}
+
+	void BufferHeap::Free(int Offset, int Count)
+	{
+		if (Count <= 0) {
+			return;
+		}
+
+		if (Offset < 0 || Offset + Count > m_Capacity) {
+			throw "BufferHeap : Freed range is outside of the heap";
+		}
+
+		m_Allocated -= Count;
+
+		auto Next = m_FreeRanges.lower_bound(Offset);
+
+		// Merge with the following range
+		if (Next != m_FreeRanges.end() && Next->first == Offset + Count) {
+			Count += Next->second;
+			Next = m_FreeRanges.erase(Next);
+		}
+
+		// And the preceding one
+		if (Next != m_FreeRanges.begin()) {
+
+			auto Previous = std::prev(Next);
+
+			if (Previous->first + Previous->second == Offset) {
+				Previous->second += Count;
+				return;
+			}
+		}
+
+		m_FreeRanges[Offset] = Count;
+	}
+
+	void BufferHeap::Upload(int Offset, int Count, const void* Data)
+	{
+		if (Count <= 0) {
+			return;
+		}
+
+		if (Offset < 0 || Offset + Count > m_Capacity) {
+			throw "BufferHeap : Uploaded range is outside of the heap";
+		}
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_Buffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, m_ElementSize * Offset, m_ElementSize * Count, Data);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	void BufferHeap::Grow(int MinimumCapacity)
+	{
+		int NewCapacity = m_Capacity;
+
+		while (NewCapacity < MinimumCapacity) {
+			NewCapacity *= 2;
+		}
+
+		GLuint NewBuffer = 0;
+		glGenBuffers(1, &NewBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, NewBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, m_ElementSize * NewCapacity, nullptr, GL_DYNAMIC_DRAW);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, m_Buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_ElementSize * m_Capacity);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &m_Buffer);
+
+		m_Buffer = NewBuffer;
+
+		int OldCapacity = m_Capacity;
+		m_Capacity = NewCapacity;
+
+		// The new space is a free range, merged with a free range at the old end
+		m_Allocated += NewCapacity - OldCapacity;
+		Free(OldCapacity, NewCapacity - OldCapacity);
+	}
+}
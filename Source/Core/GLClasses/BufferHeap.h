@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <string>
+#include <map>
+
+namespace GLClasses
+{
+	// Shader storage buffer suballocated in fixed size elements, free ranges are kept sorted by offset (first fit) and coalesced when freed
+	// Growing copies the old contents on the gpu (glCopyBufferSubData), the buffer id changes when that happens
+	class BufferHeap
+	{
+	public:
+
+		BufferHeap() = default;
+		~BufferHeap();
+
+		BufferHeap(const BufferHeap&) = delete;
+		BufferHeap operator=(BufferHeap const&) = delete;
+
+		void Create(GLsizeiptr ElementSize, int InitialCapacity);
+
+		// Offsets and counts are in elements
+		int Allocate(int Count);
+		void Free(int Offset, int Count);
+		void Upload(int Offset, int Count, const void* Data);
+
+		inline GLuint GetBuffer() const { return m_Buffer; }
+		inline int GetCapacity() const { return m_Capacity; }
+		inline int GetAllocated() const { return m_Allocated; }
+		inline bool IsCreated() const { return m_Buffer != 0; }
+
+	private:
+
+		void Grow(int MinimumCapacity);
+
+		GLuint m_Buffer = 0;
+		GLsizeiptr m_ElementSize = 0;
+		int m_Capacity = 0;
+		int m_Allocated = 0;
+
+		std::map<int, int> m_FreeRanges; // Offset -> count
+	};
+}
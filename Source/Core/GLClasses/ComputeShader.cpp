@@ -20,28 +20,14 @@ namespace GLClasses
 
 	void ComputeShader::CreateComputeShader(const std::string& path)
 	{
+		// Sources and includes come from the in memory include cache, files are only read again when their write time changes
 		if (path.size() > 0)
 		{
-			std::ifstream file;
-			std::stringstream cont;
+			m_ComputePath = path;
 
-			file.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-			file.open(path, std::ios::in);
-
-			if (file.good() && file.is_open())
-			{
-				cont << file.rdbuf();
-				m_ComputePath = path;
-				m_ShaderContents = cont.str();
+			if (!ShaderIncludes::ExpandFile(path, m_ShaderContents, m_Dependencies)) {
+				m_Dependencies.clear();
 			}
-
-			file.close();
-
-			char error[256];
-			char* ccode = stb_include_file((char*)path.c_str(), (char*)"", (char*)"Core/Shaders/", error);
-			m_ShaderContents = ccode;
-			free(ccode);
-
 		}
 
 		m_ComputeSize = m_ShaderContents.size();
@@ -50,41 +36,81 @@ namespace GLClasses
 
 	void ComputeShader::Compile()
 	{
-		_BVHTextureFlag = false;
-        m_ID = glCreateProgram();
-        GLuint m_ComputeID = glCreateShader(GL_COMPUTE_SHADER);
+		BeginCompile();
+		FinishCompile();
+	}
+
+	// Issues the compile and link without querying any status so that the driver can compile several programs in parallel
+	void ComputeShader::BeginCompile(bool use_cache)
+	{
+		m_ID = glCreateProgram();
+		m_CompilePending = true;
+
+		m_CacheKey = ProgramCache::ComputeKey({ &m_ShaderContents });
+		m_LoadedFromCache = use_cache && ProgramCache::Load(m_ID, m_CacheKey);
+
+		if (m_LoadedFromCache) {
+			return;
+		}
+
+		glProgramParameteri(m_ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+		m_ComputeID = glCreateShader(GL_COMPUTE_SHADER);
+
+		const char* contcstr = m_ShaderContents.c_str();
+		glShaderSource(m_ComputeID, 1, &contcstr, 0);
+		glCompileShader(m_ComputeID);
+
+		glAttachShader(m_ID, m_ComputeID);
+		glLinkProgram(m_ID);
+	}
+
+	// Blocks until the program issued in BeginCompile() is linked, logs errors and writes the binary to the cache
+	void ComputeShader::FinishCompile()
+	{
+		if (!m_CompilePending) {
+			return;
+		}
 
-        const char* contcstr = m_ShaderContents.c_str();
-        glShaderSource(m_ComputeID, 1, &contcstr, 0);
-        glCompileShader(m_ComputeID);
+		m_CompilePending = false;
 
-        int rvalue;
+		if (m_LoadedFromCache) {
+			m_LoadedFromCache = false;
+			glUseProgram(m_ID);
+			return;
+		}
 
-        glGetShaderiv(m_ComputeID, GL_COMPILE_STATUS, &rvalue);
+		int rvalue;
 
-        if (!rvalue)
-        {
-            GLchar log[1024];
-            GLsizei length;
-            glGetShaderInfoLog(m_ComputeID, 1023, &length, log);
+		glGetShaderiv(m_ComputeID, GL_COMPILE_STATUS, &rvalue);
+
+		if (!rvalue)
+		{
+			GLchar log[1024];
+			GLsizei length;
+			glGetShaderInfoLog(m_ComputeID, 1023, &length, log);
+
+			std::cout << "\nCOMPILATION ERROR IN COMPUTE SHADER (" << m_ComputePath << ")" << "\n" << log << "\n\n";
+		}
 
-            std::cout << "\nCOMPILATION ERROR IN COMPUTE SHADER (" << m_ComputePath << ")" << "\n" << log << "\n\n";
-        }
+		glGetProgramiv(m_ID, GL_LINK_STATUS, &rvalue);
 
-        glAttachShader(m_ID, m_ComputeID);
+		if (!rvalue) 
+		{
+			GLchar log[1024];
+			GLsizei length;
+			glGetProgramInfoLog(m_ID, 1023, &length, log);
+			std::cout << "\nLINKING ERROR IN COMPUTE SHADER (" << m_ComputePath << ")" << "\n" << log << "\n\n";
+		}
 
-        glLinkProgram(m_ID);
-        glGetProgramiv(m_ID, GL_LINK_STATUS, &rvalue);
+		else {
+			ProgramCache::Store(m_ID, m_CacheKey);
+		}
 
-        if (!rvalue) 
-        {
-            GLchar log[1024];
-            GLsizei length;
-            glGetProgramInfoLog(m_ID, 1023, &length, log);
-            std::cout << "\nLINKING ERROR IN COMPUTE SHADER (" << m_ComputePath << ")" << "\n" << log << "\n\n";
-        }
+		glDeleteShader(m_ComputeID);
+		m_ComputeID = 0;
 
-        glUseProgram(m_ID);
+		glUseProgram(m_ID);
 	}
 
 	void ComputeShader::SetFloat(const std::string& name, GLfloat value, GLboolean useShader)
@@ -178,6 +204,11 @@ namespace GLClasses
 
 	bool ComputeShader::Recompile()
 	{
+		// Nothing this program includes has changed since it was last expanded (see ShaderIncludes::Refresh())
+		if (!ShaderIncludes::IsOutOfDate(m_Dependencies)) {
+			return false;
+		}
+
 		uint32_t PrevHash = m_ComputeHash;
 		uint32_t PrevSize = m_ComputeSize;
 
@@ -185,8 +216,6 @@ namespace GLClasses
 
 		if (m_ComputeHash != PrevHash || m_ComputeSize != PrevSize) {
 
-			_BVHTextureFlag = false;
-
 			Location_map.clear();
 			glDeleteProgram(m_ID);
 			glDeleteShader(m_ComputeID);
@@ -202,8 +231,6 @@ namespace GLClasses
 
 	void ComputeShader::ForceRecompile()
 	{
-		_BVHTextureFlag = false;
-
 		this->CreateComputeShader(m_ComputePath);
 
 		Location_map.clear();
@@ -211,8 +238,8 @@ namespace GLClasses
 		glDeleteShader(m_ComputeID);
 		glUseProgram(0);
 
-		this->Compile();
-
+		this->BeginCompile(false);
+		this->FinishCompile();
 	}
 
 	void ComputeShader::SetVector2f(const std::string& name, GLfloat x, GLfloat y, GLboolean useShader)
@@ -16,6 +16,8 @@
 #include <filesystem>
 
 #include "../Application/Logger.h"
+#include "ProgramCache.h"
+#include "ShaderIncludes.h"
 #define STB_INCLUDE_LINE_NONE
 #include "stb_include.h"
 
@@ -37,13 +39,25 @@ namespace GLClasses
 			m_ComputeID = v.m_ComputeID;
 			m_ComputePath = v.m_ComputePath;
 			m_ShaderContents = v.m_ShaderContents;
+			m_CacheKey = v.m_CacheKey;
+			m_Dependencies = v.m_Dependencies;
+			m_LoadedFromCache = v.m_LoadedFromCache;
+			m_CompilePending = v.m_CompilePending;
 
+			// A program moved between BeginCompile() and FinishCompile() is finished by its new owner
 			v.m_ID = 0;
 			v.m_ComputeID = 0;
+			v.m_LoadedFromCache = false;
+			v.m_CompilePending = false;
 		}
 
 		void CreateComputeShader(const std::string& path);
 		void Compile();
+
+		// Split compile, used by the shader manager to compile every program before querying any status
+		void BeginCompile(bool use_cache = true);
+		void FinishCompile();
+
 		void Use() const noexcept { glUseProgram(m_ID); return; }
 
 		void SetFloat(const std::string& name, GLfloat value, GLboolean useShader = GL_FALSE);
@@ -70,8 +84,6 @@ namespace GLClasses
 
 		GLuint GetProgram() { return m_ID; }
 
-		bool _BVHTextureFlag = false; // Internal.
-
 	private :
 
 		std::unordered_map<std::string, GLint> Location_map; // To avoid unnecessary calls to glGetUniformLocation()
@@ -85,5 +97,11 @@ namespace GLClasses
 		uint32_t m_ComputeSize = 0;
 		uint32_t m_ComputeHash = 0;
 
+		std::vector<ShaderIncludes::Dependency> m_Dependencies;
+
+		uint32_t m_CacheKey = 0;
+		bool m_LoadedFromCache = false;
+		bool m_CompilePending = false; // Between BeginCompile() and FinishCompile()
+
 	};
 }
\ No newline at end of file
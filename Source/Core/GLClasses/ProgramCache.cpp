@@ -0,0 +1,207 @@
+#include "ProgramCache.h"
+
+#include "../Application/Logger.h"
+
+#include <sstream>
+#include <iomanip>
+
+namespace GLClasses
+{
+	namespace ProgramCache
+	{
+		struct CacheHeader {
+			uint32_t Magic;
+			uint32_t DriverCRC;
+			uint32_t Key;
+			uint32_t Format;
+			uint32_t Size;
+		};
+
+		static const uint32_t CacheMagic = 0x43504243; // "CBPC"
+
+		static bool Enabled = false;
+		static bool ParallelCompile = false;
+		static std::string Directory = "";
+		static uint32_t DriverCRC = 0;
+
+		static int Hits = 0;
+		static int Misses = 0;
+		static int Stored = 0;
+
+		static std::string GetString(GLenum name)
+		{
+			const GLubyte* str = glGetString(name);
+			return str ? std::string((const char*)str) : std::string("");
+		}
+
+		static std::string GetPath(uint32_t key)
+		{
+			std::stringstream s;
+			s << Directory << std::hex << std::setw(8) << std::setfill('0') << key << ".bin";
+			return s.str();
+		}
+	}
+
+	void ProgramCache::Initialize(const std::string& directory)
+	{
+		Directory = directory;
+
+		GLint Formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &Formats);
+
+		if (Formats <= 0) {
+			std::cout << "\nProgram binaries not supported by the driver, shader cache disabled.";
+			Enabled = false;
+			return;
+		}
+
+		std::string Driver = GetString(GL_VENDOR) + "|" + GetString(GL_RENDERER) + "|" + GetString(GL_VERSION) + "|" + GetString(GL_SHADING_LANGUAGE_VERSION);
+		DriverCRC = CRC::Calculate(Driver.c_str(), Driver.size(), CRC::CRC_32());
+
+		std::error_code Error;
+		std::filesystem::create_directories(Directory, Error);
+
+		if (Error) {
+			std::cout << "\nCouldn't create shader cache directory (" << Directory << "), shader cache disabled.";
+			Enabled = false;
+			return;
+		}
+
+		Enabled = true;
+	}
+
+	void ProgramCache::EnableParallelCompile()
+	{
+		ParallelCompile = GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+
+		if (GLAD_GL_KHR_parallel_shader_compile) {
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		}
+
+		else if (GLAD_GL_ARB_parallel_shader_compile) {
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+		}
+	}
+
+	bool ProgramCache::IsEnabled()
+	{
+		return Enabled;
+	}
+
+	bool ProgramCache::IsParallelCompileSupported()
+	{
+		return ParallelCompile;
+	}
+
+	uint32_t ProgramCache::ComputeKey(const std::vector<const std::string*>& sources)
+	{
+		uint32_t Key = CRC::Calculate(&DriverCRC, sizeof(DriverCRC), CRC::CRC_32());
+
+		for (auto& e : sources) {
+			uint32_t Size = e->size();
+			Key = CRC::Calculate(&Size, sizeof(Size), CRC::CRC_32(), Key);
+			Key = CRC::Calculate(e->c_str(), e->size(), CRC::CRC_32(), Key);
+		}
+
+		return Key;
+	}
+
+	bool ProgramCache::Load(GLuint program, uint32_t key)
+	{
+		if (!Enabled) {
+			return false;
+		}
+
+		std::ifstream File(GetPath(key), std::ios::in | std::ios::binary);
+
+		if (!File.good() || !File.is_open()) {
+			Misses++;
+			return false;
+		}
+
+		CacheHeader Header;
+		File.read((char*)&Header, sizeof(CacheHeader));
+
+		if (!File || Header.Magic != CacheMagic || Header.DriverCRC != DriverCRC || Header.Key != key || Header.Size == 0) {
+			Misses++;
+			return false;
+		}
+
+		std::vector<char> Binary(Header.Size);
+		File.read(Binary.data(), Header.Size);
+
+		if (!File) {
+			Misses++;
+			return false;
+		}
+
+		glProgramBinary(program, (GLenum)Header.Format, Binary.data(), (GLsizei)Header.Size);
+
+		// The driver is free to reject binaries (driver updates etc), fall back to compiling from source 
+		GLint Linked = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &Linked);
+
+		if (!Linked) {
+			Misses++;
+			return false;
+		}
+
+		Hits++;
+		return true;
+	}
+
+	void ProgramCache::Store(GLuint program, uint32_t key)
+	{
+		if (!Enabled) {
+			return;
+		}
+
+		GLint Linked = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &Linked);
+
+		if (!Linked) {
+			return;
+		}
+
+		GLint Length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &Length);
+
+		if (Length <= 0) {
+			return;
+		}
+
+		std::vector<char> Binary(Length);
+		GLenum Format = 0;
+		GLsizei Written = 0;
+		glGetProgramBinary(program, Length, &Written, &Format, Binary.data());
+
+		if (Written <= 0) {
+			return;
+		}
+
+		CacheHeader Header = { CacheMagic, DriverCRC, key, (uint32_t)Format, (uint32_t)Written };
+
+		std::ofstream File(GetPath(key), std::ios::out | std::ios::binary | std::ios::trunc);
+
+		if (!File.good() || !File.is_open()) {
+			Candela::Logger::LogToFile("\nCouldn't write program binary to the shader cache\n");
+			return;
+		}
+
+		File.write((const char*)&Header, sizeof(CacheHeader));
+		File.write(Binary.data(), Written);
+		Stored++;
+	}
+
+	void ProgramCache::ResetStats()
+	{
+		Hits = 0;
+		Misses = 0;
+		Stored = 0;
+	}
+
+	void ProgramCache::PrintStats()
+	{
+		std::cout << "\nShader Cache : " << Hits << " hits   |   " << Misses << " misses   |   " << Stored << " stored   |   Parallel Compile : " << (ParallelCompile ? "Yes" : "No");
+	}
+}
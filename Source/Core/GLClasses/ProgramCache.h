@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+
+#include <CRC.h>
+
+namespace GLClasses
+{
+	// Caches linked program binaries on disk (glGetProgramBinary/glProgramBinary)
+	// Binaries are keyed by the crc of the fully expanded sources, the driver string is part of the key and is validated on load
+	namespace ProgramCache
+	{
+		void Initialize(const std::string& directory = "Cache/Shaders/");
+		void EnableParallelCompile();
+
+		bool IsEnabled();
+		bool IsParallelCompileSupported();
+
+		uint32_t ComputeKey(const std::vector<const std::string*>& sources);
+
+		// Returns true if the program was successfully created from a cached binary 
+		bool Load(GLuint program, uint32_t key);
+		void Store(GLuint program, uint32_t key);
+
+		void ResetStats();
+		void PrintStats();
+	}
+}
@@ -1,6 +1,4 @@
 #include "Shader.h"
-#define STB_INCLUDE_LINE_NONE
-#include "stb_include.h"
 
 
 namespace GLClasses
@@ -17,133 +15,111 @@ namespace GLClasses
 		glUseProgram(0);
 	}
 
-	void Shader::CompileShaders()
+	static void CheckShaderStatus(GLuint shader, const std::string& stage, const std::string& path)
 	{
-		_BVHTextureFlag = false;
-		m_Program = 0;
-		auto start = std::chrono::steady_clock::now();
-
-		GLuint vs = 0;
-		GLuint fs = 0;
 		GLint successful = 0;
 		GLchar GLInfoLog[512];
 
-		GLuint gs = 0;
-
-		if (m_GeometryData.size() > 0)
-		{
-			gs = glCreateShader(GL_GEOMETRY_SHADER);
-
-			const char* geo_source = m_GeometryData.c_str();
-
-			glShaderSource(gs, 1, &geo_source, 0);
-			glCompileShader(gs);
-			glGetShaderiv(gs, GL_COMPILE_STATUS, &successful);
-
-			if (!successful)
-			{
-				std::stringstream s;
-				glGetShaderInfoLog(gs, 512, NULL, GLInfoLog);
-				std::cout << "\nCOMPILATION ERROR IN GEOMETRY SHADER (" << m_GeometryPath << ")" << "\n" << GLInfoLog << "\n\n";
-				s << "\nCOMPILATION ERROR IN GEOMETRY SHADER (" << m_GeometryPath << ")" << "\n" << GLInfoLog << "\n\n";
-
-				Candela::Logger::LogToFile(s.str());
-			}
-
-			GLint log_length = 0;
-
-			glGetShaderiv(gs, GL_INFO_LOG_LENGTH, &log_length);
-
-			if (log_length > 0)
-			{
-				std::stringstream s;
-
-				std::string shaderlog(log_length, 0);
-				glGetShaderInfoLog(gs, log_length, 0, shaderlog.data());
-				std::cout << "Geometry Shader compilation log: " << shaderlog << std::endl;
-				s << "Geometry Shader compilation log: " << shaderlog << std::endl;
-
-				Candela::Logger::LogToFile(s.str());
-			}
-		}
-
-		vs = glCreateShader(GL_VERTEX_SHADER);
-		fs = glCreateShader(GL_FRAGMENT_SHADER);
-
-		const char* vs_char = m_VertexData.c_str();
-		const char* fs_char = m_FragmentData.c_str();
-
-		glShaderSource(vs, 1, &vs_char, 0);
-		glShaderSource(fs, 1, &fs_char, 0);
-
-		glCompileShader(vs);
-
-		glGetShaderiv(vs, GL_COMPILE_STATUS, &successful);
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &successful);
 
 		if (!successful)
 		{
 			std::stringstream s;
 
-			glGetShaderInfoLog(vs, 512, NULL, GLInfoLog);
-			std::cout << "\nCOMPILATION ERROR IN VERTEX SHADER (" << m_VertexPath << ")" << "\n" << GLInfoLog << "\n\n";
-			s << "\nCOMPILATION ERROR IN VERTEX SHADER (" << m_VertexPath << ")" << "\n" << GLInfoLog << "\n\n";
+			glGetShaderInfoLog(shader, 512, NULL, GLInfoLog);
+			std::cout << "\nCOMPILATION ERROR IN " << stage << " SHADER (" << path << ")" << "\n" << GLInfoLog << "\n\n";
+			s << "\nCOMPILATION ERROR IN " << stage << " SHADER (" << path << ")" << "\n" << GLInfoLog << "\n\n";
 
 			Candela::Logger::LogToFile(s.str());
 		}
 
-
 		GLint log_length = 0;
-		glGetShaderiv(vs, GL_INFO_LOG_LENGTH, &log_length);
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
+
 		if (log_length > 0)
 		{
 			std::stringstream s;
 
 			std::string shaderlog(log_length, 0);
-			glGetShaderInfoLog(vs, log_length, 0, shaderlog.data());
+			glGetShaderInfoLog(shader, log_length, 0, shaderlog.data());
 			std::cout << "Shader compilation log: " << shaderlog << std::endl;
 			s << "Shader compilation log: " << shaderlog << std::endl;
 
 			Candela::Logger::LogToFile(s.str());
 		}
+	}
 
-		glCompileShader(fs);
-		glGetShaderiv(fs, GL_COMPILE_STATUS, &successful);
+	void Shader::CompileShaders()
+	{
+		BeginCompile();
+		FinishCompile();
+	}
 
-		if (!successful)
-		{
-			std::stringstream s;
+	// Issues the compile and link without querying any status so that the driver can compile several programs in parallel
+	void Shader::BeginCompile(bool use_cache)
+	{
+		m_Program = glCreateProgram();
+		m_CompilePending = true;
 
-			glGetShaderInfoLog(fs, 512, NULL, GLInfoLog);
-			std::cout << "\nCOMPILATION ERROR IN FRAGMENT SHADER (" << m_FragmentPath << ")" << "\n" << GLInfoLog << "\n";
-			s << "\nCOMPILATION ERROR IN FRAGMENT SHADER (" << m_FragmentPath << ")" << "\n" << GLInfoLog << "\n";
+		m_CacheKey = ProgramCache::ComputeKey({ &m_VertexData, &m_FragmentData, &m_GeometryData });
+		m_LoadedFromCache = use_cache && ProgramCache::Load(m_Program, m_CacheKey);
 
-			Candela::Logger::LogToFile(s.str());
+		if (m_LoadedFromCache) {
+			return;
 		}
 
-		log_length = 0;
-		glGetShaderiv(fs, GL_INFO_LOG_LENGTH, &log_length);
-		if (log_length > 0)
+		glProgramParameteri(m_Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+		if (m_GeometryData.size() > 0)
 		{
-			std::stringstream s;
+			m_PendingGS = glCreateShader(GL_GEOMETRY_SHADER);
+			const char* geo_source = m_GeometryData.c_str();
+			glShaderSource(m_PendingGS, 1, &geo_source, 0);
+			glCompileShader(m_PendingGS);
+			glAttachShader(m_Program, m_PendingGS);
+		}
 
-			std::string shaderlog(log_length, 0);
-			glGetShaderInfoLog(fs, log_length, 0, shaderlog.data());
-			std::cout << "Shader compilation log: " << shaderlog << std::endl;
-			s << "Shader compilation log: " << shaderlog << std::endl;
+		m_PendingVS = glCreateShader(GL_VERTEX_SHADER);
+		m_PendingFS = glCreateShader(GL_FRAGMENT_SHADER);
 
-			Candela::Logger::LogToFile(s.str());
+		const char* vs_char = m_VertexData.c_str();
+		const char* fs_char = m_FragmentData.c_str();
+
+		glShaderSource(m_PendingVS, 1, &vs_char, 0);
+		glShaderSource(m_PendingFS, 1, &fs_char, 0);
+
+		glCompileShader(m_PendingVS);
+		glCompileShader(m_PendingFS);
+
+		glAttachShader(m_Program, m_PendingVS);
+		glAttachShader(m_Program, m_PendingFS);
+
+		glLinkProgram(m_Program);
+	}
+
+	// Blocks until the program issued in BeginCompile() is linked, logs errors and writes the binary to the cache
+	void Shader::FinishCompile()
+	{
+		if (!m_CompilePending) {
+			return;
 		}
 
-		m_Program = glCreateProgram();
-		glAttachShader(m_Program, vs);
-		glAttachShader(m_Program, fs);
+		m_CompilePending = false;
 
-		if (m_GeometryData.size() > 0)
-		{
-			glAttachShader(m_Program, gs);
+		if (m_LoadedFromCache) {
+			m_LoadedFromCache = false;
+			return;
 		}
 
-		glLinkProgram(m_Program);
+		GLint successful = 0;
+		GLchar GLInfoLog[512];
+
+		if (m_PendingGS) {
+			CheckShaderStatus(m_PendingGS, "GEOMETRY", m_GeometryPath);
+		}
+
+		CheckShaderStatus(m_PendingVS, "VERTEX", m_VertexPath);
+		CheckShaderStatus(m_PendingFS, "FRAGMENT", m_FragmentPath);
 
 		glGetProgramiv(m_Program, GL_LINK_STATUS, &successful);
 
@@ -158,63 +134,62 @@ namespace GLClasses
 			Candela::Logger::LogToFile(s.str());
 		}
 
-		glDeleteShader(vs);
-		glDeleteShader(fs);
-		glDeleteShader(gs);
+		else {
+			ProgramCache::Store(m_Program, m_CacheKey);
+		}
+
+		glDeleteShader(m_PendingVS);
+		glDeleteShader(m_PendingFS);
+		glDeleteShader(m_PendingGS);
 
-		auto end = std::chrono::steady_clock::now();
-		double elapsed_time = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+		m_PendingVS = 0;
+		m_PendingFS = 0;
+		m_PendingGS = 0;
 	}
 
 	void Shader::CreateShaderProgramFromFile(const std::string& vertex_pth, const std::string& fragment_pth, const std::string& geometry_path)
 	{
+		// Sources and includes come from the in memory include cache, files are only read again when their write time changes
+		std::vector<ShaderIncludes::Dependency> Dependencies;
+		bool Expanded = true;
+
+		m_Dependencies.clear();
+
 		if (geometry_path.size() > 0)
 		{
-			std::ifstream geo_file;
-			std::stringstream g_cont;
-
-			geo_file.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-			geo_file.open(geometry_path, std::ios::in);
+			m_GeometryPath = geometry_path;
 
-			if (geo_file.good() && geo_file.is_open())
-			{
-				g_cont << geo_file.rdbuf();
-				m_GeometryPath = geometry_path;
-				m_GeometryData = g_cont.str();
+			if (ShaderIncludes::ExpandFile(geometry_path, m_GeometryData, Dependencies)) {
+				m_Dependencies.insert(m_Dependencies.end(), Dependencies.begin(), Dependencies.end());
 			}
 
-			geo_file.close();
+			else {
+				Expanded = false;
+			}
 		}
 
-		std::stringstream v_cont;
-		std::stringstream f_cont;
-		std::ifstream vertex_file;
-		std::ifstream frag_file;
-
-		vertex_file.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-		frag_file.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-
-		vertex_file.open(vertex_pth, std::ios::in);
-		frag_file.open(fragment_pth, std::ios::in);
-
 		m_VertexPath = vertex_pth;
 		m_FragmentPath = fragment_pth;
 
-		if (vertex_file.good() && frag_file.good())
-		{
-			v_cont << vertex_file.rdbuf();
-			f_cont << frag_file.rdbuf();
-			vertex_file.close();
-			frag_file.close();
+		if (ShaderIncludes::ExpandFile(vertex_pth, m_VertexData, Dependencies)) {
+			m_Dependencies.insert(m_Dependencies.end(), Dependencies.begin(), Dependencies.end());
+		}
+
+		else {
+			Expanded = false;
+		}
+
+		if (ShaderIncludes::ExpandFile(fragment_pth, m_FragmentData, Dependencies)) {
+			m_Dependencies.insert(m_Dependencies.end(), Dependencies.begin(), Dependencies.end());
+		}
 
-			char error[256];
-			char* vcode = stb_include_file((char*)vertex_pth.c_str(), (char*)"", (char*)"Core/Shaders/", error);
-			m_VertexData = vcode;
-            free(vcode);
+		else {
+			Expanded = false;
+		}
 
-			char* fcode = stb_include_file((char*)fragment_pth.c_str(), (char*)"", (char*)"Core/Shaders/", error);
-			m_FragmentData = fcode;
-            free(fcode);
+		// Keep trying on every recompile until all the sources load
+		if (!Expanded) {
+			m_Dependencies.clear();
 		}
 
 		// Create hashes 
@@ -230,7 +205,6 @@ namespace GLClasses
 
 	void Shader::Destroy()
 	{
-		_BVHTextureFlag = false;
 		Location_map.clear();
 		glDeleteProgram(m_Program);
 		glUseProgram(0);
@@ -266,6 +240,11 @@ namespace GLClasses
 
 	bool Shader::Recompile()
 	{
+		// Nothing this program includes has changed since it was last expanded (see ShaderIncludes::Refresh())
+		if (!ShaderIncludes::IsOutOfDate(m_Dependencies)) {
+			return false;
+		}
+
 		uint32_t PrevVHash = m_VertexCRC;
 		uint32_t PrevFHash = m_FragmentCRC;
 		uint32_t PrevGHash = m_GeometryCRC;
@@ -280,8 +259,6 @@ namespace GLClasses
 			PrevGHash != m_GeometryCRC || PrevVSize != m_VertexSize ||
 			PrevFSize != m_FragmentSize || PrevGSize != m_GeometrySize) {
 			
-			_BVHTextureFlag = false;
-
 			Location_map.clear();
 			glDeleteProgram(m_Program);
 			glUseProgram(0);
@@ -295,15 +272,14 @@ namespace GLClasses
 
 	void Shader::ForceRecompile()
 	{
-		_BVHTextureFlag = false;
-
 		CreateShaderProgramFromFile(m_VertexPath, m_FragmentPath, m_GeometryPath);
 		
 		Location_map.clear();
 		glDeleteProgram(m_Program);
 		glUseProgram(0);
 
-		CompileShaders();
+		BeginCompile(false);
+		FinishCompile();
 	}
 
 	void Shader::SetFloat(const std::string& name, GLfloat value, GLboolean useShader)
@@ -16,6 +16,8 @@
 #include <filesystem>
 
 #include "../Application/Logger.h"
+#include "ProgramCache.h"
+#include "ShaderIncludes.h"
 #include <CRC.h>
 
 namespace GLClasses
@@ -36,14 +38,33 @@ namespace GLClasses
 			m_VertexPath = v.m_VertexPath;
 			m_FragmentData = v.m_FragmentData;
 			m_FragmentPath = v.m_FragmentPath;
-
+			m_GeometryData = v.m_GeometryData;
+			m_GeometryPath = v.m_GeometryPath;
+			m_CacheKey = v.m_CacheKey;
+			m_Dependencies = v.m_Dependencies;
+			m_LoadedFromCache = v.m_LoadedFromCache;
+			m_CompilePending = v.m_CompilePending;
+			m_PendingVS = v.m_PendingVS;
+			m_PendingFS = v.m_PendingFS;
+			m_PendingGS = v.m_PendingGS;
+
+			// A program moved between BeginCompile() and FinishCompile() is finished by its new owner
 			v.m_Program = 0;
+			v.m_LoadedFromCache = false;
+			v.m_CompilePending = false;
+			v.m_PendingVS = 0;
+			v.m_PendingFS = 0;
+			v.m_PendingGS = 0;
 		}
 
 
 		~Shader();
 
 		void CompileShaders();
+
+		// Split compile, used by the shader manager to compile every program before querying any status
+		void BeginCompile(bool use_cache = true);
+		void FinishCompile();
 		void CreateShaderProgramFromFile(const std::string& vertex_pth, const std::string& fragment_pth, const std::string& geometry_path = "");
 		inline GLuint GetProgramID() const { return m_Program; };
 		
@@ -74,8 +95,6 @@ namespace GLClasses
 
 		GLuint GetProgram() { return m_Program; }
 
-		bool _BVHTextureFlag = false; // Internal.
-
 	 private:
 
 		std::unordered_map<std::string, GLint> Location_map; // To avoid unnecessary calls to glGetUniformLocation()
@@ -96,5 +115,14 @@ namespace GLClasses
 		uint32_t m_VertexSize = 0;
 		uint32_t m_FragmentSize = 0;
 		uint32_t m_GeometrySize = 0;
+
+		std::vector<ShaderIncludes::Dependency> m_Dependencies;
+
+		uint32_t m_CacheKey = 0;
+		bool m_LoadedFromCache = false;
+		bool m_CompilePending = false; // Between BeginCompile() and FinishCompile()
+		GLuint m_PendingVS = 0;
+		GLuint m_PendingFS = 0;
+		GLuint m_PendingGS = 0;
 	};
 }
@@ -0,0 +1,275 @@
+#include "ShaderIncludes.h"
+
+#include "../Application/Logger.h"
+
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+namespace GLClasses
+{
+	namespace ShaderIncludes
+	{
+		struct IncludeDirective {
+			size_t Start; // Start of the directive line 
+			size_t End; // Position of the newline that ends it
+			std::string Filename; // Empty for #inject
+		};
+
+		struct CachedFile {
+			std::string Text;
+			std::filesystem::file_time_type WriteTime;
+			std::vector<IncludeDirective> Includes;
+			uint32_t Version = 0;
+
+			bool Loaded = false;
+			bool ExpandedValid = false;
+			std::string Expanded;
+			std::vector<std::string> Dependencies; // Transitive, includes itself 
+		};
+
+		static std::unordered_map<std::string, CachedFile> FileCache;
+
+		static const int MaxIncludeDepth = 32;
+
+		// Global so that versions stay unique even if the cache is cleared
+		static uint32_t VersionCounter = 0;
+
+		static std::string NormalizePath(const std::string& path)
+		{
+			return std::filesystem::path(path).lexically_normal().generic_string();
+		}
+
+		static bool IsSpace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+		}
+
+		// Mirrors stb_include_find_includes() 
+		static void FindIncludes(const std::string& text, std::vector<IncludeDirective>& list)
+		{
+			list.clear();
+
+			size_t s = 0;
+			size_t n = text.size();
+
+			while (s < n) {
+				size_t start = s;
+
+				while (s < n && (text[s] == ' ' || text[s] == '\t')) {
+					s++;
+				}
+
+				if (s < n && text[s] == '#') {
+					s++;
+
+					while (s < n && (text[s] == ' ' || text[s] == '\t')) {
+						s++;
+					}
+
+					if (text.compare(s, 7, "include") == 0 && s + 7 < n && IsSpace(text[s + 7])) {
+						s += 7;
+
+						while (s < n && (text[s] == ' ' || text[s] == '\t')) {
+							s++;
+						}
+
+						if (s < n && text[s] == '"') {
+							size_t t = ++s;
+
+							while (t < n && text[t] != '"' && text[t] != '\n' && text[t] != '\r') {
+								t++;
+							}
+
+							if (t < n && text[t] == '"') {
+								std::string Filename = text.substr(s, t - s);
+								s = t;
+
+								while (s < n && text[s] != '\r' && text[s] != '\n') {
+									s++;
+								}
+
+								list.push_back({ start, s, Filename });
+							}
+						}
+					}
+
+					else if (text.compare(s, 6, "inject") == 0 && (s + 6 >= n || IsSpace(text[s + 6]))) {
+						while (s < n && text[s] != '\r' && text[s] != '\n') {
+							s++;
+						}
+
+						list.push_back({ start, s, "" });
+					}
+				}
+
+				while (s < n && text[s] != '\r' && text[s] != '\n') {
+					s++;
+				}
+
+				if (s < n) {
+					s += (text[s] == '\r' && s + 1 < n && text[s + 1] == '\n') ? 2 : 1;
+				}
+			}
+		}
+
+		static bool LoadFile(const std::string& path, CachedFile& file)
+		{
+			std::ifstream Stream(path, std::ios::in | std::ios::binary);
+
+			if (!Stream.good() || !Stream.is_open()) {
+				return false;
+			}
+
+			std::stringstream Contents;
+			Contents << Stream.rdbuf();
+
+			std::error_code Error;
+			file.WriteTime = std::filesystem::last_write_time(path, Error);
+			file.Text = Contents.str();
+			file.Version = ++VersionCounter;
+			file.Loaded = true;
+			file.ExpandedValid = false;
+
+			FindIncludes(file.Text, file.Includes);
+			return true;
+		}
+
+		static CachedFile* GetFile(const std::string& path)
+		{
+			auto& File = FileCache[path];
+
+			if (!File.Loaded && !LoadFile(path, File)) {
+				FileCache.erase(path);
+				return nullptr;
+			}
+
+			return &File;
+		}
+
+		static bool Expand(const std::string& path, const std::string& include_root, int depth)
+		{
+			if (depth > MaxIncludeDepth) {
+				std::stringstream s;
+				s << "\nSHADER INCLUDE ERROR : Include depth exceeded (cyclic include?) while expanding : " << path << "\n";
+				std::cout << s.str();
+				Candela::Logger::LogToFile(s.str());
+				return false;
+			}
+
+			CachedFile* File = GetFile(path);
+
+			if (!File) {
+				std::stringstream s;
+				s << "\nSHADER INCLUDE ERROR : Couldn't load '" << path << "'\n";
+				std::cout << s.str();
+				Candela::Logger::LogToFile(s.str());
+				return false;
+			}
+
+			if (File->ExpandedValid) {
+				return true;
+			}
+
+			std::string Output;
+			std::unordered_set<std::string> Dependencies = { path };
+			size_t Last = 0;
+
+			Output.reserve(File->Text.size());
+
+			for (auto& e : File->Includes) {
+				Output.append(File->Text, Last, e.Start - Last);
+
+				if (e.Filename.size() > 0) {
+					std::string IncludePath = NormalizePath(include_root + "/" + e.Filename);
+
+					if (!Expand(IncludePath, include_root, depth + 1)) {
+						return false;
+					}
+
+					CachedFile& Included = FileCache.at(IncludePath);
+					Output.append(Included.Expanded);
+					Dependencies.insert(Included.Dependencies.begin(), Included.Dependencies.end());
+				}
+
+				Last = e.End;
+			}
+
+			Output.append(File->Text, Last, std::string::npos);
+
+			File->Expanded = std::move(Output);
+			File->Dependencies.assign(Dependencies.begin(), Dependencies.end());
+			File->ExpandedValid = true;
+			return true;
+		}
+	}
+
+	bool ShaderIncludes::ExpandFile(const std::string& path, std::string& output, std::vector<Dependency>& dependencies, const std::string& include_root)
+	{
+		std::string Path = NormalizePath(path);
+
+		if (!Expand(Path, include_root, 0)) {
+			return false;
+		}
+
+		CachedFile& File = FileCache.at(Path);
+
+		output = File.Expanded;
+		dependencies.clear();
+
+		for (auto& e : File.Dependencies) {
+			dependencies.push_back({ e, FileCache.at(e).Version });
+		}
+
+		return true;
+	}
+
+	int ShaderIncludes::Refresh()
+	{
+		int Changed = 0;
+
+		for (auto& e : FileCache) {
+			std::error_code Error;
+			auto WriteTime = std::filesystem::last_write_time(e.first, Error);
+
+			if (Error || WriteTime == e.second.WriteTime) {
+				continue;
+			}
+
+			if (LoadFile(e.first, e.second)) {
+				Changed++;
+			}
+		}
+
+		// Any expansion may reference a changed file, expanding from memory is cheap so just drop all of them
+		if (Changed > 0) {
+			for (auto& e : FileCache) {
+				e.second.ExpandedValid = false;
+			}
+		}
+
+		return Changed;
+	}
+
+	bool ShaderIncludes::IsOutOfDate(const std::vector<Dependency>& dependencies)
+	{
+		if (dependencies.empty()) {
+			return true;
+		}
+
+		for (auto& e : dependencies) {
+			auto File = FileCache.find(e.Path);
+
+			if (File == FileCache.end() || File->second.Version != e.Version) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void ShaderIncludes::Clear()
+	{
+		FileCache.clear();
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+
+namespace GLClasses
+{
+	// In memory include graph for the shader sources
+	// Every file (shader or include) is read once and kept along with its last write time, expansions are cached per file
+	// Refresh() stats the known files and reloads the ones that changed, programs then compare the versions of their transitive dependencies 
+	namespace ShaderIncludes
+	{
+		struct Dependency {
+			std::string Path;
+			uint32_t Version;
+		};
+
+		// Expands #include directives the same way stb_include does (includes are resolved relative to include_root)
+		bool ExpandFile(const std::string& path, std::string& output, std::vector<Dependency>& dependencies, const std::string& include_root = "Core/Shaders/");
+
+		// Returns the number of files that changed on disk since the last refresh
+		int Refresh();
+
+		bool IsOutOfDate(const std::vector<Dependency>& dependencies);
+
+		void Clear();
+	}
+}
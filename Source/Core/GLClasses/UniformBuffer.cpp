@@ -0,0 +1,49 @@
+#include "UniformBuffer.h"
+
+namespace GLClasses
+{
+	UniformBuffer::UniformBuffer(GLuint binding)
+	{
+		m_ID = 0;
+		m_Binding = binding;
+		m_Size = 0;
+	}
+
+	UniformBuffer::~UniformBuffer()
+	{
+		if (m_ID) {
+			glDeleteBuffers(1, &m_ID);
+		}
+	}
+
+	void UniformBuffer::BufferData(GLsizeiptr size, const void* data)
+	{
+		if (m_ID == 0) {
+			glGenBuffers(1, &m_ID);
+		}
+
+		glBindBuffer(GL_UNIFORM_BUFFER, m_ID);
+
+		// Orphan and reallocate only when the size changes, otherwise just update the contents
+		if (size != m_Size) {
+			glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+			m_Size = size;
+		}
+
+		else {
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+		}
+
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	void UniformBuffer::Bind() const
+	{
+		glBindBufferBase(GL_UNIFORM_BUFFER, m_Binding, m_ID);
+	}
+
+	void UniformBuffer::Unbind() const
+	{
+		glBindBufferBase(GL_UNIFORM_BUFFER, m_Binding, 0);
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <string>
+
+namespace GLClasses
+{
+	// Uniform buffer object, storage is created lazily on first upload so that it can live in globals that are constructed before the context 
+	class UniformBuffer
+	{
+	public:
+
+		UniformBuffer(GLuint binding);
+		~UniformBuffer();
+
+		UniformBuffer(const UniformBuffer&) = delete;
+		UniformBuffer operator=(UniformBuffer const&) = delete;
+		UniformBuffer(UniformBuffer&& v)
+		{
+			m_ID = v.m_ID;
+			m_Binding = v.m_Binding;
+			m_Size = v.m_Size;
+			v.m_ID = 0;
+		}
+
+		void BufferData(GLsizeiptr size, const void* data);
+		void Bind() const;
+		void Unbind() const;
+
+		inline GLuint GetID() const { return m_ID; }
+		inline GLuint GetBinding() const { return m_Binding; }
+
+	private:
+
+		GLuint m_ID = 0;
+		GLuint m_Binding = 0;
+		GLsizeiptr m_Size = 0;
+	};
+}
@@ -8,9 +8,13 @@ namespace Candela
 		m_VertexBuffer.Bind();
 		m_IndexBuffer.Bind();
 
+#ifdef COMPACT_VERTICES
+		m_VertexBuffer.VertexAttribIPointer(0, 4, GL_UNSIGNED_INT, sizeof(CompactVertex), (void*)(offsetof(CompactVertex, data)));
+#else
 		m_VertexBuffer.VertexAttribPointer(0, 3, GL_FLOAT, 0, sizeof(Vertex), (void*)(offsetof(Vertex, position)));
 		m_VertexBuffer.VertexAttribIPointer(1, 3, GL_UNSIGNED_INT, sizeof(Vertex), (void*)(offsetof(Vertex, normal_tangent_data)));
 		m_VertexBuffer.VertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*)(offsetof(Vertex, texcoords)));
+#endif
 
 		m_VertexArray.Unbind();
 
@@ -27,14 +31,47 @@ namespace Candela
 		if (m_Vertices.size() > 0)
 		{
 			m_VertexCount = m_Vertices.size();
+
+#ifdef COMPACT_VERTICES
+			glm::vec3 VertexMin = glm::vec3(m_Vertices[0].position);
+			glm::vec3 VertexMax = VertexMin;
+
+			for (auto& e : m_Vertices) {
+				VertexMin = glm::min(VertexMin, glm::vec3(e.position));
+				VertexMax = glm::max(VertexMax, glm::vec3(e.position));
+			}
+
+			m_DequantizeMin = VertexMin;
+			m_DequantizeScale = GetDequantizeScale(VertexMin, VertexMax);
+
+			std::vector<CompactVertex> Compact(m_Vertices.size());
+
+			for (int i = 0; i < (int)m_Vertices.size(); i++) {
+				Compact[i] = PackCompactVertex(m_Vertices[i], m_DequantizeMin, m_DequantizeScale);
+			}
+
+			m_VertexBuffer.BufferData(Compact.size() * sizeof(CompactVertex), &Compact.front(), GL_STATIC_DRAW);
+#else
 			m_VertexBuffer.BufferData(m_Vertices.size() * sizeof(Vertex), &m_Vertices.front(), GL_STATIC_DRAW);
+#endif
 		}
 
 		if (m_Indices.size() > 0)
 		{
 			m_IndicesCount = m_Indices.size();
-			m_IndexBuffer.BufferData(m_Indices.size() * sizeof(GLuint), &m_Indices.front(), GL_STATIC_DRAW);
 			m_Indexed = true;
+
+			if (m_LODIndices.size() > 0)
+			{
+				std::vector<GLuint> Indices = m_Indices;
+				Indices.insert(Indices.end(), m_LODIndices.begin(), m_LODIndices.end());
+				m_IndexBuffer.BufferData(Indices.size() * sizeof(GLuint), &Indices.front(), GL_STATIC_DRAW);
+			}
+
+			else
+			{
+				m_IndexBuffer.BufferData(m_Indices.size() * sizeof(GLuint), &m_Indices.front(), GL_STATIC_DRAW);
+			}
 		}
 
 		else
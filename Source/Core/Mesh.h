@@ -13,6 +13,7 @@
 #include <glad/glad.h>
 
 #include "AABB.h"
+#include "MeshLOD.h"
 
 namespace Candela
 {
@@ -64,6 +65,15 @@ namespace Candela
 
 		FrustumBox Box;
 
+		// Quantization bounds of the vertex buffer when COMPACT_VERTICES is defined (see Utils/Vertex.h)
+		glm::vec3 m_DequantizeMin = glm::vec3(0.0f);
+		glm::vec3 m_DequantizeScale = glm::vec3(1.0f);
+
+		// Simplified index lists, stored after m_Indices in the index buffer
+		// m_LODs[0] is always the full resolution mesh
+		std::vector<MeshLOD> m_LODs;
+		std::vector<GLuint> m_LODIndices;
+
 		friend class Object;
 	};
 
@@ -0,0 +1,381 @@
+#include "MeshLOD.h"
+
+#include <cmath>
+#include <queue>
+#include <algorithm>
+#include <unordered_map>
+
+#include "Mesh.h"
+#include "Object.h"
+#include "Threadpool.h"
+
+// Meshes smaller than this aren't worth simplifying
+#define LOD_MIN_TRIANGLES 128
+
+// A LOD is dropped if it doesn't remove at least this fraction of the previous LOD's triangles
+#define LOD_MIN_REDUCTION 0.85f
+
+namespace Candela {
+
+	namespace LOD {
+
+		static bool Enabled = true;
+		static float Threshold = 0.002f; // ~1 pixel at 1080p
+
+		// Symmetric 4x4 matrix, the sum of squared distances to a set of planes
+		struct Quadric {
+			double A2 = 0.0, AB = 0.0, AC = 0.0, AD = 0.0;
+			double B2 = 0.0, BC = 0.0, BD = 0.0;
+			double C2 = 0.0, CD = 0.0;
+			double D2 = 0.0;
+
+			void AddPlane(const glm::dvec3& n, double d) {
+				A2 += n.x * n.x; AB += n.x * n.y; AC += n.x * n.z; AD += n.x * d;
+				B2 += n.y * n.y; BC += n.y * n.z; BD += n.y * d;
+				C2 += n.z * n.z; CD += n.z * d;
+				D2 += d * d;
+			}
+
+			void Add(const Quadric& q) {
+				A2 += q.A2; AB += q.AB; AC += q.AC; AD += q.AD;
+				B2 += q.B2; BC += q.BC; BD += q.BD;
+				C2 += q.C2; CD += q.CD;
+				D2 += q.D2;
+			}
+
+			double Evaluate(const glm::dvec3& p) const {
+				return A2 * p.x * p.x + 2.0 * AB * p.x * p.y + 2.0 * AC * p.x * p.z + 2.0 * AD * p.x
+					+ B2 * p.y * p.y + 2.0 * BC * p.y * p.z + 2.0 * BD * p.y
+					+ C2 * p.z * p.z + 2.0 * CD * p.z
+					+ D2;
+			}
+		};
+
+		struct Collapse {
+			double Cost;
+			uint32_t From, To;
+			uint32_t FromVersion, ToVersion;
+
+			bool operator>(const Collapse& c) const { return Cost > c.Cost; }
+		};
+
+		// Half edge collapse simplifier, vertices are only ever moved onto other vertices so the original vertex buffer can be reused
+		// Vertices on index space borders (open edges and uv/normal seams) are locked so seams and silhouettes stay intact
+		static void Simplify(const Mesh& mesh, const std::vector<float>& targets, std::vector<std::vector<GLuint>>& lods, std::vector<float>& errors)
+		{
+			const std::vector<GLuint>& Indices = mesh.m_Indices;
+			int VertexCount = (int)mesh.m_Vertices.size();
+			int TriangleCount = (int)Indices.size() / 3;
+
+			std::vector<glm::dvec3> Positions(VertexCount);
+
+			for (int i = 0; i < VertexCount; i++) {
+				Positions[i] = glm::dvec3(mesh.m_Vertices[i].position);
+			}
+
+			// Undirected edge use counts, edges used by a single triangle are borders
+			std::unordered_map<uint64_t, int> EdgeCounts;
+			EdgeCounts.reserve(Indices.size());
+
+			auto EdgeKey = [](uint32_t a, uint32_t b) {
+				return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+			};
+
+			for (int t = 0; t < TriangleCount; t++) {
+				for (int k = 0; k < 3; k++) {
+					EdgeCounts[EdgeKey(Indices[t * 3 + k], Indices[t * 3 + (k + 1) % 3])]++;
+				}
+			}
+
+			std::vector<uint8_t> Locked(VertexCount, 0);
+
+			for (int t = 0; t < TriangleCount; t++) {
+				for (int k = 0; k < 3; k++) {
+					uint32_t A = Indices[t * 3 + k], B = Indices[t * 3 + (k + 1) % 3];
+
+					if (EdgeCounts[EdgeKey(A, B)] == 1) {
+						Locked[A] = Locked[B] = 1;
+					}
+				}
+			}
+
+			std::vector<GLuint> Triangles = Indices;
+			std::vector<uint8_t> TriangleAlive(TriangleCount, 1);
+			std::vector<std::vector<int>> VertexTriangles(VertexCount);
+			std::vector<Quadric> Quadrics(VertexCount);
+
+			for (int t = 0; t < TriangleCount; t++) {
+
+				glm::dvec3 A = Positions[Triangles[t * 3]], B = Positions[Triangles[t * 3 + 1]], C = Positions[Triangles[t * 3 + 2]];
+				glm::dvec3 Normal = glm::cross(B - A, C - A);
+				double Length = glm::length(Normal);
+
+				for (int k = 0; k < 3; k++) {
+					VertexTriangles[Triangles[t * 3 + k]].push_back(t);
+				}
+
+				if (Length < 1e-20) {
+					continue;
+				}
+
+				Normal /= Length;
+				Quadric Plane;
+				Plane.AddPlane(Normal, -glm::dot(Normal, A));
+
+				for (int k = 0; k < 3; k++) {
+					Quadrics[Triangles[t * 3 + k]].Add(Plane);
+				}
+			}
+
+			std::vector<uint32_t> Versions(VertexCount, 0);
+			std::vector<uint8_t> Removed(VertexCount, 0);
+			std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> Queue;
+
+			auto PushCollapse = [&](uint32_t from, uint32_t to) {
+				if (Locked[from] || from == to) {
+					return;
+				}
+
+				Quadric Sum = Quadrics[from];
+				Sum.Add(Quadrics[to]);
+				Queue.push({ std::max(Sum.Evaluate(Positions[to]), 0.0), from, to, Versions[from], Versions[to] });
+			};
+
+			for (int t = 0; t < TriangleCount; t++) {
+				for (int k = 0; k < 3; k++) {
+					uint32_t A = Triangles[t * 3 + k], B = Triangles[t * 3 + (k + 1) % 3];
+					PushCollapse(A, B);
+					PushCollapse(B, A);
+				}
+			}
+
+			int AliveCount = TriangleCount;
+			double MaxCost = 0.0;
+
+			for (float Target : targets) {
+
+				int TargetCount = int(Target * float(TriangleCount));
+
+				while (AliveCount > TargetCount && !Queue.empty()) {
+
+					Collapse Candidate = Queue.top();
+					Queue.pop();
+
+					uint32_t U = Candidate.From, V = Candidate.To;
+
+					if (Removed[U] || Removed[V] || Versions[U] != Candidate.FromVersion || Versions[V] != Candidate.ToVersion) {
+						continue;
+					}
+
+					// Reject collapses that would flip or squash a triangle
+					bool Valid = true;
+
+					for (int t : VertexTriangles[U]) {
+
+						if (!TriangleAlive[t]) {
+							continue;
+						}
+
+						GLuint* Tri = &Triangles[t * 3];
+
+						if (Tri[0] == V || Tri[1] == V || Tri[2] == V) {
+							continue;
+						}
+
+						glm::dvec3 P[3], Q[3];
+
+						for (int k = 0; k < 3; k++) {
+							P[k] = Positions[Tri[k]];
+							Q[k] = Tri[k] == U ? Positions[V] : P[k];
+						}
+
+						glm::dvec3 Old = glm::cross(P[1] - P[0], P[2] - P[0]);
+						glm::dvec3 New = glm::cross(Q[1] - Q[0], Q[2] - Q[0]);
+
+						if (glm::dot(Old, New) <= 0.0) {
+							Valid = false;
+							break;
+						}
+					}
+
+					if (!Valid) {
+						continue;
+					}
+
+					for (int t : VertexTriangles[U]) {
+
+						if (!TriangleAlive[t]) {
+							continue;
+						}
+
+						GLuint* Tri = &Triangles[t * 3];
+
+						if (Tri[0] == V || Tri[1] == V || Tri[2] == V) {
+							TriangleAlive[t] = 0;
+							AliveCount--;
+							continue;
+						}
+
+						for (int k = 0; k < 3; k++) {
+							if (Tri[k] == U) {
+								Tri[k] = V;
+							}
+						}
+
+						VertexTriangles[V].push_back(t);
+					}
+
+					Removed[U] = 1;
+					VertexTriangles[U].clear();
+					Quadrics[V].Add(Quadrics[U]);
+					Versions[V]++;
+					MaxCost = std::max(MaxCost, Candidate.Cost);
+
+					// Drop the dead triangles and requeue every edge around the surviving vertex
+					std::vector<int>& Around = VertexTriangles[V];
+					Around.erase(std::remove_if(Around.begin(), Around.end(), [&](int t) { return !TriangleAlive[t]; }), Around.end());
+
+					for (int t : Around) {
+						for (int k = 0; k < 3; k++) {
+							uint32_t W = Triangles[t * 3 + k];
+
+							if (W != V) {
+								PushCollapse(V, W);
+								PushCollapse(W, V);
+							}
+						}
+					}
+				}
+
+				std::vector<GLuint> LODIndices;
+				LODIndices.reserve(AliveCount * 3);
+
+				for (int t = 0; t < TriangleCount; t++) {
+					if (TriangleAlive[t]) {
+						LODIndices.insert(LODIndices.end(), &Triangles[t * 3], &Triangles[t * 3] + 3);
+					}
+				}
+
+				lods.push_back(std::move(LODIndices));
+				errors.push_back((float)std::sqrt(MaxCost));
+			}
+		}
+	}
+}
+
+void Candela::LOD::GenerateLODs(Mesh& mesh)
+{
+	mesh.m_LODs.clear();
+	mesh.m_LODIndices.clear();
+
+	mesh.m_LODs.push_back({ 0, (uint32_t)mesh.m_Indices.size(), 0.0f });
+
+	if ((int)mesh.m_Indices.size() / 3 < LOD_MIN_TRIANGLES) {
+		return;
+	}
+
+	// Every LOD halves the triangle count of the previous one
+	std::vector<float> Targets;
+
+	for (int i = 1; i < MESH_LOD_COUNT; i++) {
+		Targets.push_back(1.0f / float(1 << i));
+	}
+
+	std::vector<std::vector<GLuint>> LODs;
+	std::vector<float> Errors;
+	Simplify(mesh, Targets, LODs, Errors);
+
+	uint32_t Offset = (uint32_t)mesh.m_Indices.size();
+	uint32_t PreviousCount = Offset;
+
+	for (int i = 0; i < (int)LODs.size(); i++) {
+
+		uint32_t Count = (uint32_t)LODs[i].size();
+
+		// Locked borders can stop the simplifier early, don't keep LODs that barely differ
+		if (Count == 0 || float(Count) > float(PreviousCount) * LOD_MIN_REDUCTION) {
+			break;
+		}
+
+		mesh.m_LODs.push_back({ Offset, Count, Errors[i] });
+		mesh.m_LODIndices.insert(mesh.m_LODIndices.end(), LODs[i].begin(), LODs[i].end());
+
+		Offset += Count;
+		PreviousCount = Count;
+	}
+}
+
+void Candela::LOD::GenerateLODs(Object& object)
+{
+	int MeshCount = (int)object.m_Meshes.size();
+
+	// Meshes vary wildly in size, so each one is its own chunk and the pool balances them
+	ParallelFor(MeshCount, MeshCount, [&object](int, int Start, int End) {
+		for (int i = Start; i < End; i++) {
+			GenerateLODs(object.m_Meshes[i]);
+		}
+	});
+}
+
+Candela::LOD::ViewInfo Candela::LOD::CreateView(const glm::mat4& projection, const glm::vec3& position, int min_lod)
+{
+	ViewInfo View;
+	View.Position = position;
+	View.ProjectionScale = projection[1][1];
+	View.Orthographic = projection[3][3] == 1.0f;
+	View.MinLOD = min_lod;
+	return View;
+}
+
+int Candela::LOD::Select(const Mesh& mesh, const glm::mat4& model, const ViewInfo& view)
+{
+	int Count = (int)mesh.m_LODs.size();
+
+	if (!Enabled || Count <= 1) {
+		return 0;
+	}
+
+	// Errors are in mesh space, scale them by the largest axis scale of the model matrix
+	float Scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	float ProjectionScale = view.ProjectionScale * Scale;
+
+	if (!view.Orthographic) {
+
+		// Distance to the mesh's bounds, the nearest point decides how large the error can get on screen
+		glm::vec3 Center = glm::vec3(model * glm::vec4(mesh.Box.Origin, 1.0f));
+		float Radius = glm::length(mesh.Box.Extent) * Scale;
+		float Distance = glm::max(glm::distance(view.Position, Center) - Radius, 1e-4f);
+
+		ProjectionScale /= Distance;
+	}
+
+	int Selected = 0;
+
+	for (int i = 1; i < Count; i++) {
+		if (mesh.m_LODs[i].Error * ProjectionScale <= Threshold) {
+			Selected = i;
+		}
+	}
+
+	return glm::clamp(glm::max(Selected, view.MinLOD), 0, Count - 1);
+}
+
+void Candela::LOD::SetEnabled(bool enabled)
+{
+	Enabled = enabled;
+}
+
+bool Candela::LOD::IsEnabled()
+{
+	return Enabled;
+}
+
+void Candela::LOD::SetThreshold(float threshold)
+{
+	Threshold = threshold;
+}
+
+float Candela::LOD::GetThreshold()
+{
+	return Threshold;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Including the full resolution mesh
+#define MESH_LOD_COUNT 4
+
+namespace Candela {
+
+	class Mesh;
+	class Object;
+
+	// A range of the mesh's index buffer, LOD 0 is the original index list
+	struct MeshLOD {
+		uint32_t FirstIndex;
+		uint32_t IndexCount;
+		float Error; // Approximate mesh space deviation from LOD 0
+	};
+
+	namespace LOD {
+
+		// Camera state used to pick LODs
+		struct ViewInfo {
+			glm::vec3 Position = glm::vec3(0.0f);
+			float ProjectionScale = 1.0f; // projection[1][1], NDC units per unit of size at distance 1 (or at any distance if orthographic)
+			bool Orthographic = false;
+			int MinLOD = 0; // Forces coarser LODs (shadow and probe passes)
+		};
+
+		// Simplifies the mesh into MESH_LOD_COUNT - 1 coarser index lists sharing its vertices (quadric error metric edge collapses)
+		void GenerateLODs(Mesh& mesh);
+
+		// Generates the LODs of every mesh, across multiple threads
+		void GenerateLODs(Object& object);
+
+		ViewInfo CreateView(const glm::mat4& projection, const glm::vec3& position, int min_lod = 0);
+
+		// Picks the coarsest LOD whose error projects to less than the threshold at the mesh's distance
+		int Select(const Mesh& mesh, const glm::mat4& model, const ViewInfo& view);
+
+		void SetEnabled(bool enabled);
+		bool IsEnabled();
+
+		// Projected error threshold in NDC units (2.0 is the height of the screen)
+		void SetThreshold(float threshold);
+		float GetThreshold();
+	}
+}
@@ -7,6 +7,7 @@
 #include <chrono>
 
 #include "MeshOptimizer.h"
+#include "MeshLOD.h"
 #include <string>
 #include <vector>
 #include <array>
@@ -303,6 +304,14 @@ namespace Candela
 				mesh.Max = AABBMax;
 			}
 
+			LOD::GenerateLODs(*object);
+
+			int LODTriangles = 0;
+
+			for (auto& mesh : object->m_Meshes) {
+				LODTriangles += (int)mesh.m_LODIndices.size() / 3;
+			}
+
 			object->Min = glm::vec3(100000.0f);
 			object->Max = glm::vec3(-100000.0f);
 
@@ -319,7 +328,7 @@ namespace Candela
 			}
 
 			std::cout << "\n\nMODEL LOADER : Loaded Model For Object : " << object->m_ObjectID << "    Model filename : " << filename;
-			std::cout << "\nMeshes : " << mesh_count << "\nIndices : " << IndexCounter << "\nVertices : " << VertexCounter << "\nTriangles : " << IndexCounter / 3 << "\n";
+			std::cout << "\nMeshes : " << mesh_count << "\nIndices : " << IndexCounter << "\nVertices : " << VertexCounter << "\nTriangles : " << IndexCounter / 3 << "\nLOD Triangles : " << LODTriangles << "\n";
 
 
 			object->Buffer();
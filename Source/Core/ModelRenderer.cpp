@@ -7,6 +7,107 @@ static uint64_t PolygonsRendered = 0;
 extern int __TotalMeshesRendered;
 extern int __MainViewMeshesRendered;
 
+// LODs are only selected while a view is set
+static const Candela::LOD::ViewInfo* CurrentLODView = nullptr;
+
+static int SelectLOD(const Candela::Mesh* mesh, const Candela::Entity& entity)
+{
+	return CurrentLODView ? Candela::LOD::Select(*mesh, entity.m_Model, *CurrentLODView) : 0;
+}
+
+// indirect_offset is the byte offset of the mesh's command in the bound indirect buffer, -1 draws directly
+static void RenderMesh(const Candela::Mesh* mesh, Candela::Entity& entity, GLClasses::Shader& shader, int entity_num, GLintptr indirect_offset = -1, int lod = 0)
+{
+	if (mesh->m_AlbedoMap.GetID() != 0)
+	{
+		mesh->m_AlbedoMap.Bind(0);
+	}
+
+	if (mesh->m_NormalMap.GetID() != 0)
+	{
+		mesh->m_NormalMap.Bind(1);
+	}
+
+	if (mesh->m_RoughnessMap.GetID() != 0)
+	{
+		mesh->m_RoughnessMap.Bind(2);
+	}
+
+	if (mesh->m_MetalnessMap.GetID() != 0)
+	{
+		mesh->m_MetalnessMap.Bind(3);
+	}
+
+	if (mesh->m_AmbientOcclusionMap.GetID() != 0)
+	{
+		mesh->m_AmbientOcclusionMap.Bind(4);
+	}
+
+	shader.SetBool("u_UsesGLTFPBR", false);
+	shader.SetBool("u_UsesAlbedoTexture", mesh->m_AlbedoMap.GetID() > 0 && entity.m_UseAlbedoMap);
+	shader.SetBool("u_UsesRoughnessMap", mesh->m_RoughnessMap.GetID() > 0 && entity.m_UsePBRMap);
+	shader.SetBool("u_UsesMetalnessMap", mesh->m_MetalnessMap.GetID() > 0 && entity.m_UsePBRMap);
+	shader.SetBool("u_UsesNormalMap", mesh->m_NormalMap.GetID() > 0 && entity.m_UsePBRMap);
+	shader.SetVector3f("u_EmissiveColor", mesh->m_EmissivityColor); 
+	shader.SetFloat("u_EmissivityAmount", entity.m_EmissiveAmount);
+	shader.SetVector3f("u_ModelColor", mesh->m_Color);
+	shader.SetFloat("u_ModelEmission", entity.m_EmissiveAmount);
+	shader.SetFloat("u_EntityRoughness", entity.m_EntityRoughness);
+	shader.SetFloat("u_EntityMetalness", entity.m_EntityMetalness);
+	shader.SetFloat("m_EntityRoughnessMultiplier", entity.m_EntityRoughnessMultiplier);
+	shader.SetFloat("u_Transparency", entity.m_TranslucencyAmount);
+	shader.SetFloat("u_GlassFactor", entity.m_TranslucencyAmount);
+	shader.SetInteger("u_EntityNumber", entity_num);
+
+#ifdef COMPACT_VERTICES
+	shader.SetVector3f("u_DequantizeMin", mesh->m_DequantizeMin);
+	shader.SetVector3f("u_DequantizeScale", mesh->m_DequantizeScale);
+#endif
+
+	if (mesh->TexturePaths[5].size() > 0 && mesh->m_MetalnessRoughnessMap.GetID() > 0 && mesh->m_IsGLTF && entity.m_UsePBRMap) {
+
+		shader.SetBool("u_UsesGLTFPBR", true);
+		mesh->m_MetalnessRoughnessMap.Bind(5);
+	}
+
+	const GLClasses::VertexArray& VAO = mesh->m_VertexArray;
+	VAO.Bind();
+
+	if (indirect_offset >= 0)
+	{
+		// The instance count is written by the gpu, so polygons aren't counted here
+		if (mesh->m_Indexed) {
+			glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)indirect_offset);
+		}
+
+		else {
+			glDrawArraysIndirect(GL_TRIANGLES, (const void*)indirect_offset);
+		}
+	}
+
+	else if (mesh->m_Indexed && lod > 0 && lod < (int)mesh->m_LODs.size())
+	{
+		const Candela::MeshLOD& Level = mesh->m_LODs[lod];
+		glDrawElements(GL_TRIANGLES, Level.IndexCount, GL_UNSIGNED_INT, (const void*)(uintptr_t(Level.FirstIndex) * sizeof(GLuint)));
+		PolygonsRendered += Level.IndexCount / 3;
+	}
+
+	else if (mesh->m_Indexed)
+	{
+		glDrawElements(GL_TRIANGLES, mesh->m_IndicesCount, GL_UNSIGNED_INT, 0);
+		PolygonsRendered += mesh->m_IndicesCount / 3;
+	}
+
+	else
+	{
+		glDrawArrays(GL_TRIANGLES, 0, mesh->m_VertexCount);
+		PolygonsRendered += mesh->m_VertexCount / 3;
+	}
+
+
+	VAO.Unbind();
+}
+
 void Candela::RenderEntity(Entity& entity, GLClasses::Shader& shader, Frustum& frustum, bool fcull, int entity_num, bool transparent_pass)
 {
 	const glm::mat4 ZOrientMatrix = glm::mat4(glm::vec4(1.0f, 0.0f, 0.0f, 0.0f), glm::vec4(0.0f, 0.0f, 1.0f, 0.0f), glm::vec4(0.0f, 1.0f, 0.0f, 0.0f), glm::vec4(1.0f));
@@ -44,81 +145,91 @@ void Candela::RenderEntity(Entity& entity, GLClasses::Shader& shader, Frustum& f
 		__TotalMeshesRendered++;
 		__MainViewMeshesRendered++;
 
-		const Mesh* mesh = &e;
+		DrawCalls++;
+		RenderMesh(&e, entity, shader, entity_num, -1, SelectLOD(&e, entity));
+
+	}
 
-		if (mesh->m_AlbedoMap.GetID() != 0)
-		{
-			mesh->m_AlbedoMap.Bind(0);
-		}
+	if (std::fmod(glfwGetTime(), 0.5f) < 0.001f)
+	{
+		std::cout << "\nDRAW CALLS : " << DrawCalls;
+	}
+}
 
-		if (mesh->m_NormalMap.GetID() != 0)
-		{
-			mesh->m_NormalMap.Bind(1);
-		}
+int Candela::RenderDrawList(const DrawList& list, const std::vector<uint32_t>& visible, GLClasses::Shader& shader, bool transparent_pass)
+{
+	const std::vector<DrawCommand>& Commands = list.GetCommands();
 
-		if (mesh->m_RoughnessMap.GetID() != 0)
-		{
-			mesh->m_RoughnessMap.Bind(2);
-		}
+	const Entity* CurrentEntity = nullptr;
+	int DrawCalls = 0;
 
-		if (mesh->m_MetalnessMap.GetID() != 0)
-		{
-			mesh->m_MetalnessMap.Bind(3);
-		}
+	for (uint32_t Index : visible)
+	{
+		const DrawCommand& Command = Commands[Index];
+		Entity& entity = *Command.EntityPtr;
+
+		bool EntityTransparent = entity.m_TranslucencyAmount > 0.01f;
 
-		if (mesh->m_AmbientOcclusionMap.GetID() != 0)
-		{
-			mesh->m_AmbientOcclusionMap.Bind(4);
+		if (EntityTransparent != transparent_pass) {
+			continue;
 		}
 
-		shader.SetBool("u_UsesGLTFPBR", false);
-		shader.SetBool("u_UsesAlbedoTexture", mesh->m_AlbedoMap.GetID() > 0 && entity.m_UseAlbedoMap);
-		shader.SetBool("u_UsesRoughnessMap", mesh->m_RoughnessMap.GetID() > 0 && entity.m_UsePBRMap);
-		shader.SetBool("u_UsesMetalnessMap", mesh->m_MetalnessMap.GetID() > 0 && entity.m_UsePBRMap);
-		shader.SetBool("u_UsesNormalMap", mesh->m_NormalMap.GetID() > 0 && entity.m_UsePBRMap);
-		shader.SetVector3f("u_EmissiveColor", mesh->m_EmissivityColor); 
-		shader.SetFloat("u_EmissivityAmount", entity.m_EmissiveAmount);
-		shader.SetVector3f("u_ModelColor", mesh->m_Color);
-		shader.SetFloat("u_ModelEmission", entity.m_EmissiveAmount);
-		shader.SetFloat("u_EntityRoughness", entity.m_EntityRoughness);
-		shader.SetFloat("u_EntityMetalness", entity.m_EntityMetalness);
-		shader.SetFloat("m_EntityRoughnessMultiplier", entity.m_EntityRoughnessMultiplier);
-		shader.SetFloat("u_Transparency", entity.m_TranslucencyAmount);
-		shader.SetFloat("u_GlassFactor", entity.m_TranslucencyAmount);
-		shader.SetInteger("u_EntityNumber", entity_num);
-
-		if (mesh->TexturePaths[5].size() > 0 && mesh->m_MetalnessRoughnessMap.GetID() > 0 && mesh->m_IsGLTF && entity.m_UsePBRMap) {
-
-			shader.SetBool("u_UsesGLTFPBR", true);
-			mesh->m_MetalnessRoughnessMap.Bind(5);
+		// Commands are sorted by entity, only set the matrices when it changes
+		if (CurrentEntity != &entity) {
+			CurrentEntity = &entity;
+			shader.SetMatrix4("u_ModelMatrix", entity.m_Model);
+			shader.SetMatrix3("u_NormalMatrix", glm::mat3(glm::transpose(glm::inverse(entity.m_Model))));
 		}
 
-		const GLClasses::VertexArray& VAO = mesh->m_VertexArray;
-		VAO.Bind();
+		__TotalMeshesRendered++;
+		__MainViewMeshesRendered++;
 
 		DrawCalls++;
+		RenderMesh(Command.MeshPtr, entity, shader, Command.EntityIndex, -1, SelectLOD(Command.MeshPtr, entity));
+	}
 
-		if (mesh->m_Indexed)
-		{
-			glDrawElements(GL_TRIANGLES, mesh->m_IndicesCount, GL_UNSIGNED_INT, 0);
-			PolygonsRendered += mesh->m_IndicesCount / 3;
-		}
+	return DrawCalls;
+}
+
+int Candela::RenderDrawListIndirect(const DrawList& list, const std::vector<uint32_t>& visible, GLClasses::Shader& shader, GLuint indirect_buffer)
+{
+	const std::vector<DrawCommand>& Commands = list.GetCommands();
+
+	const Entity* CurrentEntity = nullptr;
+	int DrawCalls = 0;
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
 
-		else
-		{
-			glDrawArrays(GL_TRIANGLES, 0, mesh->m_VertexCount);
-			PolygonsRendered += mesh->m_VertexCount / 3;
+	for (uint32_t Index : visible)
+	{
+		const DrawCommand& Command = Commands[Index];
+		Entity& entity = *Command.EntityPtr;
+
+		if (entity.m_TranslucencyAmount > 0.01f) {
+			continue;
 		}
 
+		if (CurrentEntity != &entity) {
+			CurrentEntity = &entity;
+			shader.SetMatrix4("u_ModelMatrix", entity.m_Model);
+			shader.SetMatrix3("u_NormalMatrix", glm::mat3(glm::transpose(glm::inverse(entity.m_Model))));
+		}
 
-		VAO.Unbind();
+		__TotalMeshesRendered++;
+		__MainViewMeshesRendered++;
 
+		DrawCalls++;
+		RenderMesh(Command.MeshPtr, entity, shader, Command.EntityIndex, GLintptr(Index) * 5 * sizeof(GLuint));
 	}
 
-	if (std::fmod(glfwGetTime(), 0.5f) < 0.001f)
-	{
-		std::cout << "\nDRAW CALLS : " << DrawCalls;
-	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	return DrawCalls;
+}
+
+void Candela::SetLODView(const LOD::ViewInfo* view)
+{
+	CurrentLODView = view;
 }
 
 uint64_t Candela::QueryPolygonCount()
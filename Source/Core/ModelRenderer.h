@@ -11,10 +11,26 @@
 #include "FpsCamera.h"
 
 #include "Frustum.h"
+#include "DrawList.h"
+#include "MeshLOD.h"
 
 namespace Candela {
 
 	void RenderEntity(Entity& entity, GLClasses::Shader& shader, Frustum& frustum, bool fcull, int entity_num = 0, bool transparent_pass = false);
+
+	// Draws the visible commands of a culled draw list, returns the number of draw calls
+	int RenderDrawList(const DrawList& list, const std::vector<uint32_t>& visible, GLClasses::Shader& shader, bool transparent_pass = false);
+
+	// Draws the opaque visible commands with their instance count taken from an indirect buffer (one 20 byte command per draw list command)
+	// Used by the occlusion culler with the lists from OcclusionCuller::SplitPhases, commands the gpu culled after that split are still submitted with an instance count of 0
+	// Every command is its own draw with its own texture binds and uniforms, batching them needs per draw materials in the gbuffer shader
+	int RenderDrawListIndirect(const DrawList& list, const std::vector<uint32_t>& visible, GLClasses::Shader& shader, GLuint indirect_buffer);
+
+	// LODs are selected against this view by RenderEntity and RenderDrawList, nullptr always draws LOD 0
+	// Indirect draws use the ranges written by OcclusionCuller::SelectLODs
+	// The view has to stay alive until it's reset
+	void SetLODView(const LOD::ViewInfo* view);
+
 	uint64_t QueryPolygonCount();
 	void ResetPolygonCount();
 }
\ No newline at end of file
@@ -30,6 +30,7 @@ namespace Candela
 		{
 			e.m_Indices.clear();
 			e.m_Vertices.clear();
+			e.m_LODIndices.clear();
 		}
 	}
 
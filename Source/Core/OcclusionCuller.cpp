@@ -0,0 +1,368 @@
+#include "OcclusionCuller.h"
+
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+#include "ShaderManager.h"
+
+// DrawElementsIndirectCommand is 5 uints, array draws use the first 4 of them
+#define INDIRECT_COMMAND_SIZE 5
+
+Candela::OcclusionCuller::~OcclusionCuller()
+{
+	GLuint Buffers[7] = { m_BoundsBuffer, m_VisibilityBuffer, m_PhaseOneBuffer, m_PhaseTwoBuffer, m_CounterBuffers[0], m_CounterBuffers[1], m_ReadbackBuffer };
+
+	for (GLuint e : Buffers) {
+		if (e) {
+			glDeleteBuffers(1, &e);
+		}
+	}
+
+	if (m_Pyramid) {
+		glDeleteTextures(1, &m_Pyramid);
+	}
+
+	if (m_ReadbackFence) {
+		glDeleteSync(m_ReadbackFence);
+	}
+}
+
+void Candela::OcclusionCuller::CreateBuffers(const DrawList& list)
+{
+	const std::vector<DrawCommand>& Commands = list.GetCommands();
+	int Count = (int)Commands.size();
+
+	if (!m_BoundsBuffer) {
+		glGenBuffers(1, &m_BoundsBuffer);
+		glGenBuffers(1, &m_VisibilityBuffer);
+		glGenBuffers(1, &m_PhaseOneBuffer);
+		glGenBuffers(1, &m_PhaseTwoBuffer);
+		glGenBuffers(2, m_CounterBuffers);
+		glGenBuffers(1, &m_ReadbackBuffer);
+
+		for (int i = 0; i < 2; i++) {
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_CounterBuffers[i]);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * 3, nullptr, GL_DYNAMIC_READ);
+		}
+	}
+
+	std::vector<GLuint> PhaseOne(std::max(Count, 1) * INDIRECT_COMMAND_SIZE, 0);
+	std::vector<GLuint> PhaseTwo(std::max(Count, 1) * INDIRECT_COMMAND_SIZE, 0);
+
+	for (int i = 0; i < Count; i++) {
+
+		const Mesh* MeshPtr = Commands[i].MeshPtr;
+		GLuint* Command = &PhaseOne[i * INDIRECT_COMMAND_SIZE];
+
+		// { count, instance count, first index, base vertex, base instance } or { count, instance count, first, base instance }
+		Command[0] = MeshPtr->m_Indexed ? MeshPtr->m_IndicesCount : MeshPtr->m_VertexCount;
+		Command[1] = 1;
+
+		std::copy(Command, Command + INDIRECT_COMMAND_SIZE, &PhaseTwo[i * INDIRECT_COMMAND_SIZE]);
+
+		// Nothing is known about the new commands, draw everything in phase 1
+		PhaseTwo[i * INDIRECT_COMMAND_SIZE + 1] = 0;
+	}
+
+	std::vector<GLuint> Visibility(std::max(Count, 1), 1);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_VisibilityBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, Visibility.size() * sizeof(GLuint), Visibility.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_PhaseOneBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, PhaseOne.size() * sizeof(GLuint), PhaseOne.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_PhaseTwoBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, PhaseTwo.size() * sizeof(GLuint), PhaseTwo.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_ReadbackBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, Visibility.size() * sizeof(GLuint), nullptr, GL_STREAM_READ);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// A pending copy belongs to the old commands
+	if (m_ReadbackFence) {
+		glDeleteSync(m_ReadbackFence);
+		m_ReadbackFence = nullptr;
+	}
+
+	m_HasVisibility = false;
+
+	m_Meshes.resize(Count);
+	m_LODs.assign(Count, 0);
+
+	for (int i = 0; i < Count; i++) {
+		m_Meshes[i] = Commands[i].MeshPtr;
+	}
+}
+
+void Candela::OcclusionCuller::SelectLODs(const DrawList& list, const std::vector<uint32_t>& visible, const LOD::ViewInfo& view)
+{
+	const std::vector<DrawCommand>& Commands = list.GetCommands();
+
+	if (!m_BoundsBuffer || Commands.size() != m_Meshes.size()) {
+		return;
+	}
+
+	const GLuint Buffers[2] = { m_PhaseOneBuffer, m_PhaseTwoBuffer };
+
+	for (uint32_t Index : visible) {
+
+		const DrawCommand& Command = Commands[Index];
+		const Mesh* MeshPtr = Command.MeshPtr;
+
+		if (!MeshPtr->m_Indexed) {
+			continue;
+		}
+
+		// Same metric as the direct draws
+		int Level = LOD::Select(*MeshPtr, Command.EntityPtr->m_Model, view);
+
+		if (Level == m_LODs[Index]) {
+			continue;
+		}
+
+		m_LODs[Index] = Level;
+
+		GLuint IndexCount = Level > 0 ? MeshPtr->m_LODs[Level].IndexCount : MeshPtr->m_IndicesCount;
+		GLuint FirstIndex = Level > 0 ? MeshPtr->m_LODs[Level].FirstIndex : 0;
+
+		// The instance count between them is owned by the cull shader
+		GLintptr Offset = GLintptr(Index) * INDIRECT_COMMAND_SIZE * sizeof(GLuint);
+
+		for (GLuint Buffer : Buffers) {
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, Buffer);
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, Offset, sizeof(GLuint), &IndexCount);
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, Offset + 2 * sizeof(GLuint), sizeof(GLuint), &FirstIndex);
+		}
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void Candela::OcclusionCuller::Update(const DrawList& list)
+{
+	if (m_HasVersion && list.GetVersion() == m_Version) {
+		return;
+	}
+
+	const std::vector<DrawCommand>& Commands = list.GetCommands();
+	bool Rebuild = !m_BoundsBuffer || Commands.size() != m_Meshes.size();
+
+	for (int i = 0; i < (int)Commands.size() && !Rebuild; i++) {
+		Rebuild = Commands[i].MeshPtr != m_Meshes[i];
+	}
+
+	if (Rebuild) {
+		CreateBuffers(list);
+	}
+
+	list.PackBounds(m_Bounds);
+
+	if (m_Bounds.empty()) {
+		m_Bounds.resize(2, glm::vec4(0.0f));
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_BoundsBuffer);
+
+	if (Rebuild) {
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_Bounds.size() * sizeof(glm::vec4), m_Bounds.data(), GL_DYNAMIC_DRAW);
+	}
+
+	else {
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_Bounds.size() * sizeof(glm::vec4), m_Bounds.data());
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_Version = list.GetVersion();
+	m_HasVersion = true;
+}
+
+void Candela::OcclusionCuller::BuildPyramid(GLuint depth_texture, int width, int height)
+{
+	// Level 0 is half the depth buffer's resolution, rounded down to keep the reduction conservative
+	int Width = std::max(width / 2, 1);
+	int Height = std::max(height / 2, 1);
+
+	if (Width != m_PyramidWidth || Height != m_PyramidHeight) {
+
+		if (m_Pyramid) {
+			glDeleteTextures(1, &m_Pyramid);
+		}
+
+		m_PyramidWidth = Width;
+		m_PyramidHeight = Height;
+		m_PyramidLevels = 1 + (int)std::floor(std::log2((float)std::max(Width, Height)));
+
+		glGenTextures(1, &m_Pyramid);
+		glBindTexture(GL_TEXTURE_2D, m_Pyramid);
+		glTexStorage2D(GL_TEXTURE_2D, m_PyramidLevels, GL_R32F, Width, Height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	GLClasses::ComputeShader& HiZShader = ShaderManager::GetComputeShader("HIZ_BUILD");
+	HiZShader.Use();
+	HiZShader.SetInteger("u_Depth", 0);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, depth_texture);
+
+	int PreviousWidth = width;
+	int PreviousHeight = height;
+
+	for (int Level = 0; Level < m_PyramidLevels; Level++) {
+
+		int LevelWidth = std::max(Width >> Level, 1);
+		int LevelHeight = std::max(Height >> Level, 1);
+
+		// Level 0 reduces the depth buffer itself
+		HiZShader.SetBool("u_FirstLevel", Level == 0);
+		HiZShader.SetVector2f("u_PreviousSize", glm::vec2(PreviousWidth, PreviousHeight));
+		HiZShader.SetVector2f("u_OutputSize", glm::vec2(LevelWidth, LevelHeight));
+
+		glBindImageTexture(0, m_Pyramid, Level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glBindImageTexture(1, m_Pyramid, std::max(Level - 1, 0), GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+
+		glDispatchCompute((LevelWidth + 7) / 8, (LevelHeight + 7) / 8, 1);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		PreviousWidth = LevelWidth;
+		PreviousHeight = LevelHeight;
+	}
+}
+
+void Candela::OcclusionCuller::ReadCounters()
+{
+	// The counters of the previous cull are read back a frame late so the readback doesn't stall
+	int Previous = 1 - m_CounterIndex;
+
+	if (!m_CountersPending[Previous]) {
+		return;
+	}
+
+	GLuint Counters[3] = { 0, 0, 0 };
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_CounterBuffers[Previous]);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Counters), Counters);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_VisibleCount = (int)Counters[0];
+	m_OccludedCount = (int)Counters[1];
+	m_FrustumCulledCount = (int)Counters[2];
+	m_CountersPending[Previous] = false;
+}
+
+void Candela::OcclusionCuller::ReadVisibility()
+{
+	if (!m_ReadbackFence) {
+		return;
+	}
+
+	// Don't wait for the gpu, the copy is picked up on a later frame
+	GLenum Status = glClientWaitSync(m_ReadbackFence, 0, 0);
+
+	if (Status != GL_ALREADY_SIGNALED && Status != GL_CONDITION_SATISFIED) {
+		return;
+	}
+
+	glDeleteSync(m_ReadbackFence);
+	m_ReadbackFence = nullptr;
+
+	m_Visibility.resize(m_Meshes.size());
+
+	if (!m_Visibility.empty()) {
+		glBindBuffer(GL_COPY_READ_BUFFER, m_ReadbackBuffer);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, m_Visibility.size() * sizeof(GLuint), m_Visibility.data());
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+
+	m_HasVisibility = true;
+}
+
+void Candela::OcclusionCuller::SplitPhases(const std::vector<uint32_t>& visible, std::vector<uint32_t>& phase_one, std::vector<uint32_t>& phase_two)
+{
+	ReadVisibility();
+
+	phase_one.clear();
+	phase_two.clear();
+
+	if (!m_HasVisibility) {
+		phase_one = visible;
+		phase_two = visible;
+		return;
+	}
+
+	// Phase 1's instance counts are exactly this visibility and phase 2 only draws what it marked hidden
+	for (uint32_t Index : visible) {
+		if (m_Visibility[Index] != 0) {
+			phase_one.push_back(Index);
+		}
+
+		else {
+			phase_two.push_back(Index);
+		}
+	}
+}
+
+void Candela::OcclusionCuller::Cull(const Frustum& frustum, const glm::mat4& view_projection)
+{
+	int Count = (int)m_Meshes.size();
+
+	if (!m_BoundsBuffer || !m_Pyramid) {
+		return;
+	}
+
+	ReadCounters();
+
+	const GLuint Zero[3] = { 0, 0, 0 };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_CounterBuffers[m_CounterIndex]);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Zero), Zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	GLClasses::ComputeShader& CullShader = ShaderManager::GetComputeShader("OCCLUSION_CULL");
+	CullShader.Use();
+
+	const Plane* Planes[6] = { &frustum.Left, &frustum.Right, &frustum.Top, &frustum.Bottom, &frustum.Near, &frustum.Far };
+
+	for (int i = 0; i < 6; i++) {
+		CullShader.SetVector4f("u_Planes[" + std::to_string(i) + "]", glm::vec4(Planes[i]->Normal, Planes[i]->Distance));
+	}
+
+	CullShader.SetMatrix4("u_ViewProjection", view_projection);
+	CullShader.SetVector2f("u_HiZSize", glm::vec2(m_PyramidWidth, m_PyramidHeight));
+	CullShader.SetInteger("u_HiZLevels", m_PyramidLevels);
+	CullShader.SetInteger("u_CommandCount", Count);
+	CullShader.SetInteger("u_HiZ", 0);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_Pyramid);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_BoundsBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_VisibilityBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_PhaseOneBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_PhaseTwoBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_CounterBuffers[m_CounterIndex]);
+
+	glDispatchCompute((Count + 63) / 64, 1, 1);
+
+	// The indirect buffers no longer match the copy, a new one is read back once the gpu gets here
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_COPY_READ_BUFFER, m_VisibilityBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_ReadbackBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, std::max(Count, 1) * sizeof(GLuint));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (m_ReadbackFence) {
+		glDeleteSync(m_ReadbackFence);
+	}
+
+	m_ReadbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_HasVisibility = false;
+
+	m_CountersPending[m_CounterIndex] = true;
+	m_CounterIndex = 1 - m_CounterIndex;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "DrawList.h"
+#include "Frustum.h"
+#include "MeshLOD.h"
+
+namespace Candela {
+
+	// Two phase hierarchical-z occlusion culling
+	// Phase 1 draws what was visible last frame, a max depth pyramid is built from its depth, every command is tested against it on the gpu
+	// and phase 2 draws the commands that just became visible. Visibility is written straight into per command indirect draw buffers
+	class OcclusionCuller {
+
+	public :
+
+		OcclusionCuller() {}
+		~OcclusionCuller();
+
+		OcclusionCuller(const OcclusionCuller&) = delete;
+		OcclusionCuller operator=(OcclusionCuller const&) = delete;
+
+		// Uploads bounds when the draw list changed, resets visibility if its commands changed
+		void Update(const DrawList& list);
+
+		// Writes the index range of each visible command's LOD into both indirect buffers, only commands whose LOD changed are uploaded
+		void SelectLODs(const DrawList& list, const std::vector<uint32_t>& visible, const LOD::ViewInfo& view);
+
+		// Builds the max depth pyramid from a depth texture
+		void BuildPyramid(GLuint depth_texture, int width, int height);
+
+		// Tests every command against the frustum and the pyramid, writes both indirect buffers
+		void Cull(const Frustum& frustum, const glm::mat4& view_projection);
+
+		// Splits the frustum visible commands by the visibility the last cull wrote, call it before phase 1
+		// Phase 1 only gets what that cull saw and phase 2 only the rest, so neither submits draws the gpu already zeroed
+		// The visibility is copied back without waiting, until the gpu finished that cull both phases get every command
+		void SplitPhases(const std::vector<uint32_t>& visible, std::vector<uint32_t>& phase_one, std::vector<uint32_t>& phase_two);
+
+		// Indirect buffers hold one DrawElementsIndirectCommand (20 bytes) per draw list command
+		inline GLuint GetPhaseOneBuffer() const { return m_PhaseOneBuffer; }
+		inline GLuint GetPhaseTwoBuffer() const { return m_PhaseTwoBuffer; }
+		inline GLuint GetPyramid() const { return m_Pyramid; }
+
+		// Counts from the last completed cull (read back a frame late)
+		inline int GetVisibleCount() const { return m_VisibleCount; }
+		inline int GetOccludedCount() const { return m_OccludedCount; }
+		inline int GetFrustumCulledCount() const { return m_FrustumCulledCount; }
+
+	private :
+
+		void CreateBuffers(const DrawList& list);
+		void ReadCounters();
+		void ReadVisibility();
+
+		GLuint m_BoundsBuffer = 0;
+		GLuint m_VisibilityBuffer = 0;
+		GLuint m_PhaseOneBuffer = 0;
+		GLuint m_PhaseTwoBuffer = 0;
+		GLuint m_CounterBuffers[2] = { 0, 0 };
+		GLuint m_ReadbackBuffer = 0;
+		GLsync m_ReadbackFence = nullptr;
+
+		GLuint m_Pyramid = 0;
+		int m_PyramidWidth = 0;
+		int m_PyramidHeight = 0;
+		int m_PyramidLevels = 0;
+
+		std::vector<const Mesh*> m_Meshes;
+		std::vector<int> m_LODs; // LOD currently written in each command
+		std::vector<glm::vec4> m_Bounds;
+		uint32_t m_Version = 0;
+		bool m_HasVersion = false;
+
+		std::vector<GLuint> m_Visibility; // Copy of the visibility buffer, valid while m_HasVisibility is set
+		bool m_HasVisibility = false;
+
+		int m_CounterIndex = 0;
+		bool m_CountersPending[2] = { false, false };
+
+		int m_VisibleCount = 0;
+		int m_OccludedCount = 0;
+		int m_FrustumCulledCount = 0;
+	};
+}
@@ -114,9 +114,9 @@ namespace Candela {
 
                         int Packed = floatBitsToInt(CurrentNode.Min.w);
 
-                        int Length = Packed & 0xF;
+                        int Length = Packed & BVH_LEAF_LENGTH_MASK;
 
-                        for (int Idx = Packed >> 4; Idx < (Packed >> 4) + Length; Idx++) {
+                        for (int Idx = Packed >> BVH_LEAF_LENGTH_BITS; Idx < (Packed >> BVH_LEAF_LENGTH_BITS) + Length; Idx++) {
                             BVH::Triangle triangle = Intersector.m_BVHTriangles[Idx];
 
                             const int Offset = 0;
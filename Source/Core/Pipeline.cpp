@@ -31,6 +31,8 @@ PLEASE DO NOT CLAIM MY WORK AS YOUR OWN.
 #include "Entity.h"
 #include "ModelFileLoader.h" 
 #include "ModelRenderer.h"
+#include "DrawList.h"
+#include "OcclusionCuller.h"
 #include "GLClasses/Fps.h"
 #include "GLClasses/Framebuffer.h"
 #include "GLClasses/ComputeShader.h"
@@ -40,6 +42,8 @@ PLEASE DO NOT CLAIM MY WORK AS YOUR OWN.
 #include "GLClasses/CubeTextureMap.h"
 #include "ProbeGI.h"
 #include "Utils/Timer.h"
+#include "Profiler.h"
+#include "Benchmark.h"
 
 #include "Tonemap.h"
 
@@ -55,6 +59,7 @@ PLEASE DO NOT CLAIM MY WORK AS YOUR OWN.
 #include "TAAJitter.h"
 
 #include "Utility.h"
+#include "GLClasses/UniformBuffer.h"
 
 #include "Player.h"
 
@@ -77,6 +82,7 @@ Candela::RayIntersector<Candela::BVH::StacklessTraversalNode> Intersector;
 
 Candela::Player Player;
 Candela::FPSCamera& Camera = Player.Camera;
+Candela::Frustum& CameraFrustum = Player.CameraFrustum;
 
 static bool vsync = false;
 static float SunTick = 50.0f;
@@ -102,7 +108,12 @@ static float NormalStrength = 0.4f;
 static bool DoNormalFix = true;
 
 // Perf
-static bool DoFrustumCulling = false;
+static bool DoFrustumCulling = true;
+static bool DoOcclusionCulling = true;
+static bool DoMeshLODs = true;
+static float LODErrorThreshold = 0.002f;
+static bool DoShadowCasterCulling = false;
+static bool DoStaticShadowCaching = true;
 static bool DoFaceCulling = true;
 
 // Direct shadow 
@@ -122,6 +133,8 @@ static float RTAOStrength = 1.0f;
 // Irradiance volume 
 static bool UpdateIrradianceVolume = true;
 static bool FilterIrradianceVolume = true;
+static int ProbeGIQuality = 1; // <- ProbeGI::Quality
+static int ProbeRayBudget = 16384;
 
 // Specular 
 static bool DoRoughSpecular = true;
@@ -229,6 +242,7 @@ static glm::vec3 SnapSize = glm::vec3(0.5f);
 
 // FBO debug 
 static bool FBODebugMode = false;
+static bool ShowProfiler = false;
 static int FBODebugID = -1;
 GLClasses::Framebuffer* DebugFBO = nullptr;
 static int FBODebugAttachment = 0;
@@ -240,6 +254,13 @@ static float* GraphY;
 // Render list 
 std::vector<Candela::Entity*> EntityRenderList;
 
+// Culled draw list for the main view
+Candela::DrawList SceneDrawList;
+static std::vector<uint32_t> VisibleDraws;
+static std::vector<uint32_t> PhaseOneDraws;
+static std::vector<uint32_t> PhaseTwoDraws;
+static Candela::OcclusionCuller SceneOcclusionCuller;
+
 // GBuffers
 GLClasses::Framebuffer GBuffers[2] = { GLClasses::Framebuffer(16, 16, {{GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, false, false}, {GL_RGBA16F, GL_RGBA, GL_FLOAT, false, false}, {GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, false, false}, {GL_RGBA16F, GL_RGBA, GL_FLOAT, false, false}, {GL_R16I, GL_RED_INTEGER, GL_SHORT, false, false}}, false, true),GLClasses::Framebuffer(16, 16, {{GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, false, false}, {GL_RGBA16F, GL_RGBA, GL_FLOAT, false, false}, {GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, false, false}, {GL_RGBA16F, GL_RGBA, GL_FLOAT, false, false}, {GL_R16I, GL_RED_INTEGER, GL_SHORT, false, false}}, false, true) };
 GLClasses::Framebuffer TransparentGBuffer = GLClasses::Framebuffer(16, 16, { {GL_RGBA16F, GL_RGBA, GL_FLOAT, false, false}, {GL_RGBA16F, GL_RGBA, GL_FLOAT, false, false} }, false, true);
@@ -288,13 +309,26 @@ public:
 		GLFWwindow* window = GetWindow();
 		float camera_speed = DeltaTime * 23.0f * ((glfwGetKey(window, GLFW_KEY_TAB) == GLFW_PRESS ? 3.0f : 1.0f));
 
+		if (Candela::Benchmark::IsActive()) {
+			Candela::Benchmark::ApplyCamera(Camera);
+			return;
+		}
+
 		Player.OnUpdate(window, DeltaTime, camera_speed, GetCurrentFrame());
+
+		if (Candela::Benchmark::IsRecording()) {
+			Candela::Benchmark::RecordCamera(Camera);
+		}
 	}
 
 	void OnImguiRender(double ts) override
 	{
 		ImGuiIO& io = ImGui::GetIO();
 
+		if (ShowProfiler) {
+			Candela::Profiler::RenderImGui();
+		}
+
 		if (EditMode) {
 
 			if (ImGui::Begin("Debug/Edit Mode")) {
@@ -438,6 +472,7 @@ public:
 					ImGui::NewLine();
 					ImGui::Checkbox("Use Albedo map?", &SelectedEntity->m_UseAlbedoMap);
 					ImGui::Checkbox("Use PBR/Normal map?", &SelectedEntity->m_UsePBRMap);
+					ImGui::Checkbox("Dynamic? (Not cached in the static shadow layer)", &SelectedEntity->m_IsDynamic);
 					ImGui::End();
 				}
 			}
@@ -463,6 +498,8 @@ public:
 			ImGui::Text("Number of Meshes Rendered (For the main camera view) : %d", __MainViewMeshesRendered);
 			ImGui::Text("Total Number of Meshes Rendered : %d", __TotalMeshesRendered);
 			ImGui::NewLine();
+			ImGui::Checkbox("Show Profiler", &ShowProfiler);
+			ImGui::NewLine();
 			ImGui::NewLine();
 			ImGui::SliderFloat3("Sun Direction", &_SunDirection[0], -1.0f, 1.0f);
 			ImGui::NewLine();
@@ -494,7 +531,12 @@ public:
 			ImGui::NewLine();
 			ImGui::NewLine();
 			ImGui::Checkbox("Frustum Culling?", &DoFrustumCulling);
+			ImGui::Checkbox("Hi-Z Occlusion Culling?", &DoOcclusionCulling);
+			ImGui::Checkbox("Shadow Caster-Receiver Culling? (Offscreen GI may lose shadows)", &DoShadowCasterCulling);
+			ImGui::Checkbox("Cache Static Shadows?", &DoStaticShadowCaching);
 			ImGui::Checkbox("Face Culling?", &DoFaceCulling);
+			ImGui::Checkbox("Mesh LODs?", &DoMeshLODs);
+			ImGui::SliderFloat("LOD Error Threshold (Screen space)", &LODErrorThreshold, 0.0005f, 0.02f);
 			ImGui::NewLine();
 			ImGui::NewLine();
 			ImGui::SliderFloat("Shadow Distance Multiplier", &ShadowDistanceMultiplier, 0.1f, 16.0f);
@@ -508,6 +550,10 @@ public:
 			ImGui::NewLine();
 			ImGui::Checkbox("Update Irradiance Volume?", &UpdateIrradianceVolume);
 			ImGui::Checkbox("Temporally Filter Irradiance Volume?", &FilterIrradianceVolume);
+			if (ImGui::SliderInt("Irradiance Volume Quality (Low, Medium, High, Ultra)", &ProbeGIQuality, 0, 3)) {
+				Candela::ProbeGI::SetQuality((Candela::ProbeGI::Quality)ProbeGIQuality);
+			}
+			ImGui::SliderInt("Irradiance Volume Ray Budget (Probes updated per frame)", &ProbeRayBudget, 1024, 131072);
 			ImGui::NewLine();
 			ImGui::NewLine();
 			ImGui::Checkbox("Do Diffuse Multi Bounce?", &DoMultiBounce);
@@ -798,7 +844,7 @@ void RenderEntityList(const std::vector<Candela::Entity*> EntityList, GLClasses:
 	int En = 0;
 		
 	for (auto& e : EntityList) {
-		Candela::RenderEntity(*e, shader, Player.CameraFrustum, DoFrustumCulling, En, glasspass);
+		Candela::RenderEntity(*e, shader, Player.CameraFrustum, false, En, glasspass);
 		En++;
 	}
 }
@@ -847,8 +893,14 @@ void RenderProbe(Candela::ProbeMap& probe, int face, glm::vec3 center, std::vect
 	shader.SetInteger("u_MetalnessRoughnessMap", 5);
 	shader.SetBool("u_NormalFix", DoNormalFix);
 
+	// Probe captures are low resolution, force coarser LODs
+	Candela::LOD::ViewInfo ProbeLODView = Candela::LOD::CreateView(projection_matrix, center, 1);
+	Candela::SetLODView(&ProbeLODView);
+
 	RenderEntityList(EntityList, shader, false);
 
+	Candela::SetLODView(nullptr);
+
 	glDisable(GL_CULL_FACE);
 	glDisable(GL_DEPTH_TEST);
 
@@ -856,28 +908,45 @@ void RenderProbe(Candela::ProbeMap& probe, int face, glm::vec3 center, std::vect
 }
 
 
+// Shared uniform buffers (see Shaders/Include/CommonUniforms.glsl)
+GLClasses::UniformBuffer CommonUniformBuffer(UBO_COMMON_UNIFORMS_BINDING);
+GLClasses::UniformBuffer ShadowUniformBuffer(UBO_SHADOW_UNIFORMS_BINDING);
+
+// Uploads the per frame uniforms once, every pass reads them through the bound blocks
+void UploadCommonUniforms(CommonUniforms& uniforms) {
+	CommonUniformsUBO Data;
+	Data.View = uniforms.View;
+	Data.Projection = uniforms.Projection;
+	Data.InverseView = uniforms.InvView;
+	Data.InverseProjection = uniforms.InvProjection;
+	Data.PrevView = uniforms.PrevView;
+	Data.PrevProjection = uniforms.PrevProj;
+	Data.PrevInverseView = uniforms.InvPrevView;
+	Data.PrevInverseProjection = uniforms.InvPrevProj;
+	Data.ViewerPositionTime = glm::vec4(glm::vec3(uniforms.InvView[3]), Candela::Benchmark::IsActive() ? Candela::Benchmark::GetTime() : (float)glfwGetTime());
+	Data.SunDirectionFrame = glm::vec4(uniforms.SunDirection, glm::intBitsToFloat(uniforms.Frame));
+	Data.ClipPlanes = glm::vec4(Camera.GetNearPlane(), Camera.GetFarPlane(), 0.0f, 0.0f);
+
+	CommonUniformBuffer.BufferData(sizeof(CommonUniformsUBO), &Data);
+	CommonUniformBuffer.Bind();
+}
+
+void UploadShadowUniforms() {
+	ShadowUniformsUBO Data;
+
+	for (int i = 0; i < 5; i++) {
+		Data.ShadowMatrices[i] = Candela::ShadowHandler::GetShadowViewProjectionMatrix(i);
+		Data.ShadowClipPlanes[i] = glm::vec4(Candela::ShadowHandler::GetShadowCascadeDistance(i));
+	}
+
+	ShadowUniformBuffer.BufferData(sizeof(ShadowUniformsUBO), &Data);
+	ShadowUniformBuffer.Bind();
+}
+
 template <typename T>
-void SetCommonUniforms(T& shader, CommonUniforms& uniforms) {
-	shader.SetFloat("u_Time", glfwGetTime());
-	shader.SetInteger("u_Frame", uniforms.Frame);
-	shader.SetInteger("u_CurrentFrame", uniforms.Frame);
+void SetCommonUniforms(T& shader) {
+	// Everything else lives in the common uniform block, the view projection is kept separate since some passes jitter it
 	shader.SetMatrix4("u_ViewProjection", Camera.GetViewProjection());
-	shader.SetMatrix4("u_Projection", uniforms.Projection);
-	shader.SetMatrix4("u_View", uniforms.View);
-	shader.SetMatrix4("u_InverseProjection", uniforms.InvProjection);
-	shader.SetMatrix4("u_InverseView", uniforms.InvView);
-	shader.SetMatrix4("u_PrevProjection", uniforms.PrevProj);
-	shader.SetMatrix4("u_PrevView", uniforms.PrevView);
-	shader.SetMatrix4("u_PrevInverseProjection", uniforms.InvPrevProj);
-	shader.SetMatrix4("u_PrevInverseView", uniforms.InvPrevView);
-	shader.SetMatrix4("u_InversePrevProjection", uniforms.InvPrevProj);
-	shader.SetMatrix4("u_InversePrevView", uniforms.InvPrevView);
-	shader.SetVector3f("u_ViewerPosition", glm::vec3(uniforms.InvView[3]));
-	shader.SetVector3f("u_Incident", glm::vec3(uniforms.InvView[3]));
-	shader.SetVector3f("u_SunDirection", uniforms.SunDirection);
-	shader.SetVector3f("u_LightDirection", uniforms.SunDirection);
-	shader.SetFloat("u_zNear", Camera.GetNearPlane());
-	shader.SetFloat("u_zFar", Camera.GetFarPlane());
 }
 
 // Deferred
@@ -984,8 +1053,19 @@ void Candela::StartPipeline()
 
 	// Create App, initialize 
 	RayTracerApp app;
+
+	// Benchmark runs use a fixed resolution and no vsync so results are comparable
+	const Benchmark::Settings& BenchmarkSettings = Benchmark::GetSettings();
+
+	if (Benchmark::IsActive()) {
+		app.SetHeadless(BenchmarkSettings.Headless);
+		app.SetFixedWindowSize(BenchmarkSettings.Width, BenchmarkSettings.Height);
+		vsync = false;
+	}
+
 	app.Initialize();
 	app.SetCursorLocked(true);
+	Benchmark::Begin();
 	ImPlot::CreateContext();
 
 	// Scene setup 
@@ -996,7 +1076,7 @@ void Candela::StartPipeline()
 	
 	// Load demo models 
 	FileLoader::LoadModelFile(&MetalObject, "Models/ball/scene.gltf");
-	FileLoader::LoadModelFile(&MainModel, "Models/sponza-2/sponza.obj");
+	FileLoader::LoadModelFile(&MainModel, Benchmark::GetScenePath(BenchmarkSettings.Scene));
 	FileLoader::LoadModelFile(&Dragon, "Models/dragon/dragon.obj");
 	FileLoader::LoadModelFile(&Sphere, "Models/sphere/scene.gltf");
 
@@ -1020,6 +1100,7 @@ void Candela::StartPipeline()
 
 	// Add the objects to the intersector (you could use a vector or similar to make this generic)
 	Intersector.AddObject(MainModel);
+
 	Intersector.AddObject(Dragon);
 	Intersector.AddObject(MetalObject);
 	Intersector.AddObject(Sphere);
@@ -1231,6 +1312,9 @@ void Candela::StartPipeline()
 			continue;
 		}
 
+		Profiler::BeginFrame();
+		Profiler::BeginZone("Prepare");
+
 		// Prepare 
 
 		int DebugMode = EditMode ? SelectedDebugView : -1;
@@ -1343,7 +1427,7 @@ void Candela::StartPipeline()
 			CollisionShader.SetInteger("u_QueryCount", 1);
 			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, CollisionQuerySSBO);
 			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, CollisionResultSSBO);
-			Intersector.BindEverything(CollisionShader, false);
+			Intersector.BindEverything(CollisionShader);
 			glDispatchCompute(1, 1, 1);
 
 			glm::ivec4 Retrieved;
@@ -1379,23 +1463,44 @@ void Candela::StartPipeline()
 
 		CommonUniforms UniformBuffer = { View, Projection, InverseView, InverseProjection, PreviousProjection, PreviousView, glm::inverse(PreviousProjection), glm::inverse(PreviousView), (int)app.GetCurrentFrame(), SunDirection};
 
+		Profiler::EndZone();
+
+		// The camera is final for this frame, used by shadow caster culling and the main view culling
+		CameraFrustum.Update(Camera, app.GetCurrentFrame());
+
+		Profiler::BeginZone("Shadows");
+
 		// Render shadow maps
 		glEnable(GL_DEPTH_TEST);
 		glDepthFunc(GL_LESS);
 		glDepthMask(GL_TRUE);
 
-		for (int i = 0; i < ShadowmapUpdateRate; i++) {
-			ShadowHandler::UpdateDirectShadowMaps((app.GetCurrentFrame() * ShadowmapUpdateRate) + i, Camera.GetPosition(), SunDirection, EntityRenderList, ShadowDistanceMultiplier, ShadowmapUpdateRate);
+		int ShadowDrawCalls = 0;
+
+		ShadowHandler::SetStaticShadowCaching(DoStaticShadowCaching);
 
+		for (int i = 0; i < ShadowmapUpdateRate; i++) {
+			ShadowDrawCalls += ShadowHandler::UpdateDirectShadowMaps((app.GetCurrentFrame() * ShadowmapUpdateRate) + i, Camera.GetPosition(), SunDirection, EntityRenderList, ShadowDistanceMultiplier, ShadowmapUpdateRate, DoShadowCasterCulling ? &CameraFrustum : nullptr);
 		}
 
+		ShadowDrawCalls += ShadowHandler::CompositeDynamicShadowMaps(DoShadowCasterCulling ? &CameraFrustum : nullptr);
+
+		Profiler::SetCounter("Shadow Draws", ShadowDrawCalls);
+		Profiler::SetCounter("Static Cascade Refreshes", ShadowHandler::GetStaticCascadeRefreshes());
+
 		ShadowHandler::CalculateClipPlanes(Camera.GetProjectionMatrix());
+
+		// Upload shared uniforms 
+		UploadCommonUniforms(UniformBuffer);
+		UploadShadowUniforms();
 		
 		// Hemispherical SM
 		if (DoHSM) {
-			ShadowHandler::UpdateSkyShadowMaps(app.GetCurrentFrame(), Camera.GetPosition(), EntityRenderList);
+			Profiler::SetCounter("Sky Shadow Draws", ShadowHandler::UpdateSkyShadowMaps(app.GetCurrentFrame(), Camera.GetPosition(), EntityRenderList));
 		}
 
+		Profiler::EndZone();
+
 		// Render player probe
 		if (RENDER_PLAYER_PROBE) {
 			bool dynamic = true;
@@ -1409,11 +1514,51 @@ void Candela::StartPipeline()
 			}
 		}
 
+		Profiler::BeginZone("Probe Update");
+
 		// Update probes
 		if (UpdateIrradianceVolume) {
+			ProbeGI::SetRayBudget(ProbeRayBudget);
 			ProbeGI::UpdateProbes(app.GetCurrentFrame(), Intersector, UniformBuffer, Skymap.GetID(), FilterIrradianceVolume && !UpdatedLightThisFrame);
+
+			Profiler::SetCounter("Active Probes", ProbeGI::GetActiveProbeCount());
+			Profiler::SetCounter("Converged Probes", ProbeGI::GetConvergedProbeCount());
+			Profiler::SetCounter("Inactive Probes", ProbeGI::GetInactiveProbeCount());
+			Profiler::SetCounter("Probe Rays", ProbeGI::GetRaysPerFrame());
 		}
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("Culling");
+
+		LOD::SetEnabled(DoMeshLODs);
+		LOD::SetThreshold(LODErrorThreshold);
+
+		// Cull the scene against the main view before submission
+
+		SceneDrawList.Update(EntityRenderList);
+
+		if (DoFrustumCulling) {
+			SceneDrawList.Cull(CameraFrustum, VisibleDraws);
+		}
+
+		else {
+			SceneDrawList.GetAll(VisibleDraws);
+		}
+
+		Profiler::SetCounter("Scene Meshes", SceneDrawList.GetCommandCount());
+		Profiler::SetCounter("Visible Meshes", (int)VisibleDraws.size());
+
+		if (DoOcclusionCulling) {
+			SceneOcclusionCuller.Update(SceneDrawList);
+			Profiler::SetCounter("Occlusion Visible", SceneOcclusionCuller.GetVisibleCount());
+			Profiler::SetCounter("Occlusion Occluded", SceneOcclusionCuller.GetOccludedCount());
+		}
+
+		Profiler::EndZone();
+
+		Profiler::BeginZone("GBuffer");
+
 		// Render GBuffer
 
 		if (DoFaceCulling) {
@@ -1452,11 +1597,41 @@ void Candela::StartPipeline()
 		GBufferShader.SetFloat("u_ScaleLODBias", floor(log2(InternalRenderResolution)));
 		GBufferShader.SetVector2f("u_Dimensions", glm::vec2(GBuffer.GetWidth(), GBuffer.GetHeight()));
 
-		RenderEntityList(EntityRenderList, GBufferShader, false);
+		LOD::ViewInfo MainLODView = LOD::CreateView(Camera.GetProjectionMatrix(), Camera.GetPosition());
+		SetLODView(&MainLODView);
+
+		if (DoOcclusionCulling) {
+
+			SceneOcclusionCuller.SelectLODs(SceneDrawList, VisibleDraws, MainLODView);
+			SceneOcclusionCuller.SplitPhases(VisibleDraws, PhaseOneDraws, PhaseTwoDraws);
+
+			// Phase 1 : draw what was visible last frame
+			RenderDrawListIndirect(SceneDrawList, PhaseOneDraws, GBufferShader, SceneOcclusionCuller.GetPhaseOneBuffer());
+
+			// Test everything against the depth of phase 1, the cull also writes next frame's phase 1 commands
+			Profiler::BeginZone("Hi-Z Cull");
+			SceneOcclusionCuller.BuildPyramid(GBuffer.GetDepthBuffer(), GBuffer.GetWidth(), GBuffer.GetHeight());
+			// Same jittered matrix phase 1 was rasterized with, so the boxes line up with the pyramid
+			SceneOcclusionCuller.Cull(CameraFrustum, TAAMatrix * Camera.GetViewProjection());
+
+			// The counters are read back with glGetBufferSubData next frame
+			glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+			Profiler::EndZone();
+
+			// Phase 2 : draw what just became visible
+			GBufferShader.Use();
+			RenderDrawListIndirect(SceneDrawList, PhaseTwoDraws, GBufferShader, SceneOcclusionCuller.GetPhaseTwoBuffer());
+		}
+
+		else {
+			RenderDrawList(SceneDrawList, VisibleDraws, GBufferShader, false);
+		}
 
 		if (!RENDER_GLASS) {
-			RenderEntityList(EntityRenderList, GBufferShader, true);
+			RenderDrawList(SceneDrawList, VisibleDraws, GBufferShader, true);
 		}
+
+		SetLODView(nullptr);
 		UnbindEverything();
 
 		// Glass pre-pass
@@ -1471,12 +1646,11 @@ void Candela::StartPipeline()
 			GBufferTransparentPrepassShader.SetMatrix4("u_ViewProjection", TAAMatrix * Camera.GetViewProjection());
 			GBufferTransparentPrepassShader.SetInteger("u_AlbedoMap", 0);
 			GBufferTransparentPrepassShader.SetInteger("u_NormalMap", 1);
-			GBufferTransparentPrepassShader.SetVector3f("u_ViewerPosition", Camera.GetPosition());
 			GBufferTransparentPrepassShader.SetVector2f("u_Dimensions", glm::vec2(GBuffer.GetWidth(), GBuffer.GetHeight()));
 			GBufferTransparentPrepassShader.SetBool("u_Stochastic", StochasticTransparency && OIT);
 			GBufferTransparentPrepassShader.SetBool("u_NormalFix", DoNormalFix);
 
-			SetCommonUniforms<GLClasses::Shader>(GBufferTransparentPrepassShader, UniformBuffer);
+			SetCommonUniforms<GLClasses::Shader>(GBufferTransparentPrepassShader);
 
 			RenderEntityList(EntityRenderList, GBufferTransparentPrepassShader, true);
 
@@ -1484,6 +1658,10 @@ void Candela::StartPipeline()
 			UnbindEverything();
 		}
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("Prepasses");
+
 		// Post processing passes :
 
 		glDisable(GL_CULL_FACE);
@@ -1507,7 +1685,7 @@ void Candela::StartPipeline()
 			glActiveTexture(GL_TEXTURE1);
 			glBindTexture(GL_TEXTURE_2D, GBuffer.GetTexture(3));
 
-			SetCommonUniforms<GLClasses::Shader>(GenerateHQN, UniformBuffer);
+			SetCommonUniforms<GLClasses::Shader>(GenerateHQN);
 
 			ScreenQuadVAO.Bind();
 			glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -1536,7 +1714,7 @@ void Candela::StartPipeline()
 			glActiveTexture(GL_TEXTURE2);
 			glBindTexture(GL_TEXTURE_2D, GBuffer.GetDepthBuffer());
 
-			SetCommonUniforms<GLClasses::Shader>(SSRefractionShader, UniformBuffer);
+			SetCommonUniforms<GLClasses::Shader>(SSRefractionShader);
 
 			ScreenQuadVAO.Bind();
 			glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -1554,7 +1732,7 @@ void Candela::StartPipeline()
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, GBuffer.GetDepthBuffer());
 
-		SetCommonUniforms<GLClasses::Shader>(MotionVectorShader, UniformBuffer);
+		SetCommonUniforms<GLClasses::Shader>(MotionVectorShader);
 
 		ScreenQuadVAO.Bind();
 		glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -1562,6 +1740,10 @@ void Candela::StartPipeline()
 
 		MotionVectors.Unbind();
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("Volumetrics");
+
 		// Volumetrics 
 
 		if (DoVolumetrics) {
@@ -1577,9 +1759,7 @@ void Candela::StartPipeline()
 			VolumetricsShader.SetInteger("u_Skymap", 2);
 			VolumetricsShader.SetInteger("u_Steps", VolumetricsSteps);
 
-			VolumetricsShader.SetVector3f("u_ProbeBoxSize", PROBE_GRID_SIZE);
-			VolumetricsShader.SetVector3f("u_ProbeGridResolution", PROBE_GRID_RES);
-			VolumetricsShader.SetVector3f("u_ProbeBoxOrigin", ProbeGI::GetProbeBoxOrigin());
+			ProbeGI::SetUniforms(VolumetricsShader);
 			VolumetricsShader.SetInteger("u_ProbeRadiance", 14);
 			VolumetricsShader.SetFloat("u_Strength", VolumetricsGlobalStrength);
 			VolumetricsShader.SetFloat("u_DStrength", VolumetricsDirectStrength);
@@ -1588,7 +1768,7 @@ void Candela::StartPipeline()
 			VolumetricsShader.SetBool("u_CompleteTransmittance", CompleteTransmittance);
 			VolumetricsShader.SetBool("u_UniformDensity", UniformDensityFog);
 
-			SetCommonUniforms<GLClasses::Shader>(VolumetricsShader, UniformBuffer);
+			SetCommonUniforms<GLClasses::Shader>(VolumetricsShader);
 
 			glActiveTexture(GL_TEXTURE0);
 			glBindTexture(GL_TEXTURE_2D, GBuffer.GetDepthBuffer());
@@ -1603,13 +1783,9 @@ void Candela::StartPipeline()
 
 				const int BindingPointStart = 4;
 
-				std::string Name = "u_ShadowMatrices[" + std::to_string(i) + "]";
-				std::string NameClip = "u_ShadowClipPlanes[" + std::to_string(i) + "]";
 				std::string NameTex = "u_ShadowTextures[" + std::to_string(i) + "]";
 
-				VolumetricsShader.SetMatrix4(Name, ShadowHandler::GetShadowViewProjectionMatrix(i));
 				VolumetricsShader.SetInteger(NameTex, i + BindingPointStart);
-				VolumetricsShader.SetFloat(NameClip, ShadowHandler::GetShadowCascadeDistance(i));
 
 				glActiveTexture(GL_TEXTURE0 + i + BindingPointStart);
 				glBindTexture(GL_TEXTURE_2D, ShadowHandler::GetDirectShadowmap(i));
@@ -1628,6 +1804,10 @@ void Candela::StartPipeline()
 			Volumetrics.Unbind();
 		}
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("Diffuse Trace");
+
 		// Indirect diffuse raytracing
 
 		DiffuseShader.Use();
@@ -1639,9 +1819,7 @@ void Candela::StartPipeline()
 		DiffuseShader.SetInteger("u_Skymap", 2);
 		DiffuseShader.SetInteger("u_BlueNoise", 3);
 
-		DiffuseShader.SetVector3f("u_ProbeBoxSize", PROBE_GRID_SIZE);
-		DiffuseShader.SetVector3f("u_ProbeGridResolution", PROBE_GRID_RES);
-		DiffuseShader.SetVector3f("u_ProbeBoxOrigin", ProbeGI::GetProbeBoxOrigin());
+		ProbeGI::SetUniforms(DiffuseShader);
 		DiffuseShader.SetInteger("u_IndirectDiffuse", 11);
 		DiffuseShader.SetInteger("u_MotionVectors", 12);
 		DiffuseShader.SetInteger("u_SHDataA", 14);
@@ -1656,7 +1834,7 @@ void Candela::StartPipeline()
 		DiffuseShader.SetBool("u_IndirectSSCaustics", IndirectSSCaustics);
 		DiffuseShader.SetBool("DO_BL_SAMPLING", DO_BL_SAMPLING);
 
-		SetCommonUniforms<GLClasses::ComputeShader>(DiffuseShader, UniformBuffer);
+		SetCommonUniforms<GLClasses::ComputeShader>(DiffuseShader);
 
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, GBuffer.GetDepthBuffer());
@@ -1674,13 +1852,9 @@ void Candela::StartPipeline()
 
 			const int BindingPointStart = 4;
 
-			std::string Name = "u_ShadowMatrices[" + std::to_string(i) + "]";
-			std::string NameClip = "u_ShadowClipPlanes[" + std::to_string(i) + "]";
 			std::string NameTex = "u_ShadowTextures[" + std::to_string(i) + "]";
 
-			DiffuseShader.SetMatrix4(Name, ShadowHandler::GetShadowViewProjectionMatrix(i));
 			DiffuseShader.SetInteger(NameTex, i + BindingPointStart);
-			DiffuseShader.SetFloat(NameClip, ShadowHandler::GetShadowCascadeDistance(i));
 
 			glActiveTexture(GL_TEXTURE0 + i + BindingPointStart);
 			glBindTexture(GL_TEXTURE_2D, ShadowHandler::GetDirectShadowmap(i));
@@ -1707,10 +1881,14 @@ void Candela::StartPipeline()
 		glActiveTexture(GL_TEXTURE18);
 		glBindTexture(GL_TEXTURE_2D, TransparentGBuffer.GetTexture(1));
 
-		Intersector.BindEverything(DiffuseShader, true);
+		Intersector.BindEverything(DiffuseShader);
 		glBindImageTexture(0, DiffuseTrace.GetTexture(), 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA16F);
 		glDispatchCompute((int)floor(float(DiffuseTrace.GetWidth()) / 16.0f) + 1, (int)(floor(float(DiffuseTrace.GetHeight())) / 16.0f) + 1, 1);
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("Specular Trace");
+
 		// Indirect specular raytracing 
 
 		SpecularShader.Use();
@@ -1725,9 +1903,7 @@ void Candela::StartPipeline()
 		SpecularShader.SetInteger("u_MotionVectors", 17);
 		SpecularShader.SetInteger("u_SkyCube", 12);
 		SpecularShader.SetVector2f("u_Dimensions", glm::vec2(SpecularTrace.GetWidth(), SpecularTrace.GetHeight()));
-		SpecularShader.SetVector3f("u_ProbeBoxSize", PROBE_GRID_SIZE);
-		SpecularShader.SetVector3f("u_ProbeGridResolution", PROBE_GRID_RES);
-		SpecularShader.SetVector3f("u_ProbeBoxOrigin", ProbeGI::GetProbeBoxOrigin());
+		ProbeGI::SetUniforms(SpecularShader);
 		SpecularShader.SetInteger("u_SHDataA", 14);
 		SpecularShader.SetInteger("u_SHDataB", 15);
 		SpecularShader.SetInteger("u_BlueNoise", 13);
@@ -1761,13 +1937,9 @@ void Candela::StartPipeline()
 
 			const int BindingPointStart = 6;
 
-			std::string Name = "u_ShadowMatrices[" + std::to_string(i) + "]";
-			std::string NameClip = "u_ShadowClipPlanes[" + std::to_string(i) + "]";
 			std::string NameTex = "u_ShadowTextures[" + std::to_string(i) + "]";
 
-			SpecularShader.SetMatrix4(Name, ShadowHandler::GetShadowViewProjectionMatrix(i));
 			SpecularShader.SetInteger(NameTex, i + BindingPointStart);
-			SpecularShader.SetFloat(NameClip, ShadowHandler::GetShadowCascadeDistance(i));
 
 			glActiveTexture(GL_TEXTURE0 + i + BindingPointStart);
 			glBindTexture(GL_TEXTURE_2D, ShadowHandler::GetDirectShadowmap(i));
@@ -1787,13 +1959,17 @@ void Candela::StartPipeline()
 		glActiveTexture(GL_TEXTURE15);
 		glBindTexture(GL_TEXTURE_3D, ProbeGI::GetProbeDataTextures().y);
 
-		SetCommonUniforms<GLClasses::ComputeShader>(SpecularShader, UniformBuffer);
+		SetCommonUniforms<GLClasses::ComputeShader>(SpecularShader);
 
-		Intersector.BindEverything(SpecularShader, true);
+		Intersector.BindEverything(SpecularShader);
 		glBindImageTexture(0, SpecularTrace.GetTexture(), 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA16F);
 		glDispatchCompute((int)floor(float(SpecularTrace.GetWidth()) / 16.0f) + 1, (int)(floor(float(SpecularTrace.GetHeight())) / 16.0f) + 1, 1);
 
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("Temporal");
+
 		// Spatio-temporal Checkerboard reconstruction
 
 		CheckerboardUpscaled.Bind();
@@ -1813,7 +1989,7 @@ void Candela::StartPipeline()
 		CheckerReconstructShader.SetBool("u_Enabled", DoCheckering);
 		CheckerReconstructShader.SetVector2f("u_Dimensions", glm::vec2(CheckerboardUpscaled.GetWidth(), CheckerboardUpscaled.GetHeight()));
 
-		SetCommonUniforms<GLClasses::Shader>(CheckerReconstructShader, UniformBuffer);
+		SetCommonUniforms<GLClasses::Shader>(CheckerReconstructShader);
 
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, GBuffer.GetDepthBuffer());
@@ -1879,7 +2055,7 @@ void Candela::StartPipeline()
 		TemporalFilterShader.SetBool("u_ClipDiffuse", ClipDiffuse);
 		TemporalFilterShader.SetFloat("u_ClipStrength", 0.082f - ClipStrength);
 
-		SetCommonUniforms<GLClasses::Shader>(TemporalFilterShader, UniformBuffer);
+		SetCommonUniforms<GLClasses::Shader>(TemporalFilterShader);
 
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, GBuffer.GetDepthBuffer());
@@ -1929,6 +2105,10 @@ void Candela::StartPipeline()
 
 		IndirectTemporal.Unbind();
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("SVGF");
+
 		// SVGF 
 
 		{
@@ -1957,7 +2137,7 @@ void Candela::StartPipeline()
 			glActiveTexture(GL_TEXTURE4);
 			glBindTexture(GL_TEXTURE_2D, IndirectTemporal.GetTexture(2));
 
-			SetCommonUniforms<GLClasses::Shader>(SpatialVarianceShader, UniformBuffer);
+			SetCommonUniforms<GLClasses::Shader>(SpatialVarianceShader);
 
 			ScreenQuadVAO.Bind();
 			glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -2005,7 +2185,7 @@ void Candela::StartPipeline()
 				SpatialFilterShader.SetBool("u_RoughSpec", DoRoughSpecular);
 				SpatialFilterShader.SetBool("u_DoSVGF", DoSVGF);
 
-				SetCommonUniforms<GLClasses::Shader>(SpatialFilterShader, UniformBuffer);
+				SetCommonUniforms<GLClasses::Shader>(SpatialFilterShader);
 
 				glActiveTexture(GL_TEXTURE0);
 				glBindTexture(GL_TEXTURE_2D, GBuffer.GetDepthBuffer());
@@ -2040,6 +2220,10 @@ void Candela::StartPipeline()
 			}
 		}
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("Spatial Upscale");
+
 		// Spatial Upscale 
 
 		SpatialUpscaleShader.Use();
@@ -2056,7 +2240,7 @@ void Candela::StartPipeline()
 		SpatialUpscaleShader.SetInteger("u_NormalsHF", 6);
 		SpatialUpscaleShader.SetBool("u_Enabled", DoSpatialUpscaling);
 
-		SetCommonUniforms<GLClasses::Shader>(SpatialUpscaleShader, UniformBuffer);
+		SetCommonUniforms<GLClasses::Shader>(SpatialUpscaleShader);
 
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, GBuffer.GetDepthBuffer());
@@ -2085,6 +2269,10 @@ void Candela::StartPipeline()
 
 		SpatialUpscaled.Unbind();
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("Lighting");
+
 		// Light Combiner 
 
 		LightingShader.Use();
@@ -2102,9 +2290,7 @@ void Candela::StartPipeline()
 		LightingShader.SetMatrix4("u_LightVP",ShadowHandler::GetShadowViewProjectionMatrix(0));
 		LightingShader.SetVector2f("u_Dims", glm::vec2(app.GetWidth(), app.GetHeight()));
 
-		LightingShader.SetVector3f("u_ProbeBoxSize", PROBE_GRID_SIZE);
-		LightingShader.SetVector3f("u_ProbeGridResolution", PROBE_GRID_RES);
-		LightingShader.SetVector3f("u_ProbeBoxOrigin", ProbeGI::GetProbeBoxOrigin());
+		ProbeGI::SetUniforms(LightingShader);
 
 		LightingShader.SetInteger("u_SHDataA", 15);
 		LightingShader.SetInteger("u_SHDataB", 16);
@@ -2130,19 +2316,15 @@ void Candela::StartPipeline()
 		}
 
 		
-		SetCommonUniforms<GLClasses::Shader>(LightingShader, UniformBuffer);
+		SetCommonUniforms<GLClasses::Shader>(LightingShader);
 
 		for (int i = 0; i < 5; i++) {
 
 			const int BindingPointStart = 9;
 
-			std::string Name = "u_ShadowMatrices[" + std::to_string(i) + "]";
-			std::string NameClip = "u_ShadowClipPlanes[" + std::to_string(i) + "]";
 			std::string NameTex = "u_ShadowTextures[" + std::to_string(i) + "]";
 
-			LightingShader.SetMatrix4(Name, ShadowHandler::GetShadowViewProjectionMatrix(i));
 			LightingShader.SetInteger(NameTex, i+BindingPointStart);
-			LightingShader.SetFloat(NameClip, ShadowHandler::GetShadowCascadeDistance(i));
 
 			glActiveTexture(GL_TEXTURE0 + i + BindingPointStart);
 			glBindTexture(GL_TEXTURE_2D, ShadowHandler::GetDirectShadowmap(i));
@@ -2247,6 +2429,10 @@ void Candela::StartPipeline()
 
 		PlayerShadowSmooth = glm::mix(DownloadedPlayerShadow, PlayerShadowSmooth, 0.6f);
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("Transparency");
+
 		// Transparent Forward pass 
 
 		if (RENDER_GLASS)
@@ -2273,11 +2459,8 @@ void Candela::StartPipeline()
 				TransparentForwardShader.SetInteger("u_NormalMap", 1);
 				TransparentForwardShader.SetInteger("u_RefractionData", 8);
 				TransparentForwardShader.SetInteger("u_OpaqueLighting", 9);
-				TransparentForwardShader.SetVector3f("u_ViewerPosition", Camera.GetPosition());
 				TransparentForwardShader.SetVector2f("u_Dimensions", glm::vec2(TransparentPass.GetWidth(), TransparentPass.GetHeight()));
-				TransparentForwardShader.SetVector3f("u_ProbeBoxSize", PROBE_GRID_SIZE);
-				TransparentForwardShader.SetVector3f("u_ProbeGridResolution", PROBE_GRID_RES);
-				TransparentForwardShader.SetVector3f("u_ProbeBoxOrigin", ProbeGI::GetProbeBoxOrigin());
+				ProbeGI::SetUniforms(TransparentForwardShader);
 
 				TransparentForwardShader.SetInteger("u_RadianceCache", 14);
 				TransparentForwardShader.SetBool("u_NormalFix", DoNormalFix);
@@ -2286,7 +2469,7 @@ void Candela::StartPipeline()
 				glActiveTexture(GL_TEXTURE14);
 				glBindTexture(GL_TEXTURE_3D, ProbeGI::GetProbeColorTexture());
 
-				SetCommonUniforms<GLClasses::Shader>(TransparentForwardShader, UniformBuffer);
+				SetCommonUniforms<GLClasses::Shader>(TransparentForwardShader);
 
 				glActiveTexture(GL_TEXTURE8);
 				glBindTexture(GL_TEXTURE_2D, SSRefractions.GetTexture());
@@ -2313,7 +2496,7 @@ void Candela::StartPipeline()
 				OITCompositeShader.SetInteger("u_OpaqueDepth", 2);
 				OITCompositeShader.SetInteger("u_TransparentDepth", 3);
 
-				SetCommonUniforms<GLClasses::Shader>(OITCompositeShader, UniformBuffer);
+				SetCommonUniforms<GLClasses::Shader>(OITCompositeShader);
 
 				glActiveTexture(GL_TEXTURE0);
 				glBindTexture(GL_TEXTURE_2D, TransparentPass.GetTexture(0));
@@ -2367,9 +2550,7 @@ void Candela::StartPipeline()
 				GlassDeferredShaderStochastic.SetInteger("u_OpaqueDepth", 5);
 				GlassDeferredShaderStochastic.SetInteger("u_TransparentDepth", 6);
 
-				GlassDeferredShaderStochastic.SetVector3f("u_ProbeBoxSize", PROBE_GRID_SIZE);
-				GlassDeferredShaderStochastic.SetVector3f("u_ProbeGridResolution", PROBE_GRID_RES);
-				GlassDeferredShaderStochastic.SetVector3f("u_ProbeBoxOrigin", ProbeGI::GetProbeBoxOrigin());
+				ProbeGI::SetUniforms(GlassDeferredShaderStochastic);
 
 				GlassDeferredShaderStochastic.SetInteger("u_RadianceCache", 14);
 
@@ -2400,7 +2581,7 @@ void Candela::StartPipeline()
 				glActiveTexture(GL_TEXTURE14);
 				glBindTexture(GL_TEXTURE_3D, ProbeGI::GetProbeColorTexture());
 
-				SetCommonUniforms<GLClasses::Shader>(GlassDeferredShaderStochastic, UniformBuffer);
+				SetCommonUniforms<GLClasses::Shader>(GlassDeferredShaderStochastic);
 
 				ScreenQuadVAO.Bind();
 				glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -2467,7 +2648,7 @@ void Candela::StartPipeline()
 				glActiveTexture(GL_TEXTURE7);
 				glBindTexture(GL_TEXTURE_2D, SpatialUpscaled.GetTexture(2));
 
-				SetCommonUniforms<GLClasses::Shader>(GlassDeferredShader, UniformBuffer);
+				SetCommonUniforms<GLClasses::Shader>(GlassDeferredShader);
 
 				ScreenQuadVAO.Bind();
 				glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -2477,6 +2658,10 @@ void Candela::StartPipeline()
 			}
 		}
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("Volumetrics Composite");
+
 		// Composite volumetrics (use post fx composite buffer for perf sake)
 
 		VolComposited.Bind();
@@ -2507,6 +2692,10 @@ void Candela::StartPipeline()
 		glDisable(GL_BLEND);
 		glDisable(GL_CULL_FACE);
 		
+		Profiler::EndZone();
+
+		Profiler::BeginZone("TAA");
+
 		// Temporal Anti Aliasing 
 
 		TAAShader.Use();
@@ -2525,7 +2714,7 @@ void Candela::StartPipeline()
 		TAAShader.SetFloat("u_TAAClipBias", TAAClipBias);
 		TAAShader.SetVector2f("u_CurrentJitter", GetTAAJitter(app.GetCurrentFrame()));
 
-		SetCommonUniforms<GLClasses::Shader>(TAAShader, UniformBuffer);
+		SetCommonUniforms<GLClasses::Shader>(TAAShader);
 
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, VolComposited.GetTexture());
@@ -2549,6 +2738,10 @@ void Candela::StartPipeline()
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 		ScreenQuadVAO.Unbind();
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("Bloom");
+
 		// Bloom 
 
 		GLuint BrightTex = 0;
@@ -2571,6 +2764,10 @@ void Candela::StartPipeline()
 
 		}
 
+		Profiler::EndZone();
+
+		Profiler::BeginZone("Post Process");
+
 		// Combine Post FX (excluding DOF.)
 
 		PFXComposited.Bind();
@@ -2595,7 +2792,7 @@ void Candela::StartPipeline()
 		PostFXCombineShader.SetVector2f("u_SunScreenPosition", SunScreenspaceCoord);
 		PostFXCombineShader.SetFloat("u_InternalRenderResolution", InternalRenderResolution);
 
-		SetCommonUniforms<GLClasses::Shader>(PostFXCombineShader, UniformBuffer);
+		SetCommonUniforms<GLClasses::Shader>(PostFXCombineShader);
 
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, TAA.GetTexture(0));
@@ -2649,7 +2846,7 @@ void Candela::StartPipeline()
 			DOFShader.SetFloat("u_BlurRadius", DOFBlurRadius);
 			DOFShader.SetFloat("u_DOFScale", DOFScale);
 
-			SetCommonUniforms<GLClasses::Shader>(DOFShader, UniformBuffer);
+			SetCommonUniforms<GLClasses::Shader>(DOFShader);
 
 			glActiveTexture(GL_TEXTURE0);
 			glBindTexture(GL_TEXTURE_2D, GBuffer.GetDepthBuffer());
@@ -2683,7 +2880,7 @@ void Candela::StartPipeline()
 		CompositeShader.SetFloat("u_PurkinjeStrength", PurkinjeStrength);
 
 
-		SetCommonUniforms<GLClasses::Shader>(CompositeShader, UniformBuffer);
+		SetCommonUniforms<GLClasses::Shader>(CompositeShader);
 
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, PFXComposited.GetTexture(0));
@@ -2718,7 +2915,7 @@ void Candela::StartPipeline()
 		CASShader.SetBool("u_DebugTexValid", EditMode && FBODebugMode && FBODebugAttachment > -1 && DebugFBO && FBODebugID >= 0);
 		CASShader.SetInteger("u_DebugTexture", 8);
 
-		SetCommonUniforms<GLClasses::Shader>(CASShader, UniformBuffer);
+		SetCommonUniforms<GLClasses::Shader>(CASShader);
 
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, Composited.GetTexture(0));
@@ -2732,15 +2929,29 @@ void Candela::StartPipeline()
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 		ScreenQuadVAO.Unbind();
 
+		Profiler::EndZone();
+
 		// Finish 
 
+		Profiler::BeginZone("Finish");
 		glFinish();
+		Profiler::EndZone();
+
+		Profiler::EndFrame();
 		app.FinishFrame();
 
 		CurrentTime = glfwGetTime();
 		DeltaTime = CurrentTime - Frametime;
 		Frametime = glfwGetTime();
 
+		if (Benchmark::IsActive()) {
+			DeltaTime = Benchmark::GetDeltaTime();
+
+			if (Benchmark::EndFrame()) {
+				glfwSetWindowShouldClose(app.GetWindow(), true);
+			}
+		}
+
 		if (app.GetCurrentFrame() > 4) {
 			int GraphIdx = app.GetCurrentFrame() % 1024;
 			GraphX[GraphIdx] = glfwGetTime();
@@ -2754,6 +2965,8 @@ void Candela::StartPipeline()
 
 		GLClasses::DisplayFrameRate(app.GetWindow(), EditMode ? "Candela | Edit Mode | " : "Candela | ");
 	}
+
+	Benchmark::Shutdown();
 }
 
 // End.
\ No newline at end of file
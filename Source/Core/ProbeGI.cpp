@@ -13,238 +13,276 @@ namespace Candela {
 		static GLuint _PrevProbeDataTextures[2] = { 0, 0 };
 		static GLuint _PrevFrameDataTextures[2] = { 0, 0 };
 		static GLuint _ProbeMapSSBO = 0;
-		static glm::vec3 LastOrigin = glm::vec3(0.0f);
-		static glm::vec3 _PreviousOrigin = glm::vec3(0.0f);
 		static glm::uvec3 _CurrentDataTextures;
-		static GLuint _ProbeRawRadianceBuffers[2]; // <- Unprojected radiance
+		static GLuint _ProbeRawRadianceBuffers[2] = { 0, 0 }; // <- Unprojected radiance
+
+		// Cascade configuration
+		static int _CascadeCount = 3;
+		static glm::ivec3 _GridResolution = glm::ivec3(32, 16, 32);
+		static glm::vec3 _GridSize = glm::vec3(16.0f, 8.0f, 16.0f);
+		static bool _Initialized = false;
+
+		// Grid min is the integer coordinate of a cascade's first probe on that cascade's world space probe lattice
+		static glm::vec3 _CascadeOrigins[MAX_PROBE_CASCADES];
+		static glm::ivec3 _CascadeGridMin[MAX_PROBE_CASCADES];
+		static glm::ivec3 _PreviousCascadeGridMin[MAX_PROBE_CASCADES];
+		static bool _HasHistory = false;
+
+		// Update scheduling
+		static GLuint _ProbeStateSSBO = 0;
+		static GLuint _ProbeScheduleSSBO = 0;
+		static GLuint _ProbeCounterSSBOs[2] = { 0, 0 };
+		static int _CounterIndex = 0;
+		static bool _CountersPending[2] = { false, false };
+		static int _RayBudget = 16384;
+
+		// Stats, read back a frame late
+		static int _TierCounts[3] = { 0, 0, 0 };
+		static int _RaysPerFrame = 0;
 
 		// Scene voxel representation
 		//static GLuint VoxelVolume = 0;
-	}
-}
 
-void Candela::ProbeGI::Initialize()
-{
-	const int ProbeGridX = PROBE_GRID_X;
-	const int ProbeGridY = PROBE_GRID_Y;
-	const int ProbeGridZ = PROBE_GRID_Z;
-
-	glGenTextures(1, &_ProbeDataTextures[0]);
-	glBindTexture(GL_TEXTURE_3D, _ProbeDataTextures[0]);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA32UI, ProbeGridX, ProbeGridY, ProbeGridZ);
-	glClearTexImage(_ProbeDataTextures[0], 0, GL_RGB_INTEGER, GL_UNSIGNED_BYTE, nullptr);
-
-	glGenTextures(1, &_ProbeDataTextures[1]);
-	glBindTexture(GL_TEXTURE_3D, _ProbeDataTextures[1]);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA32UI, ProbeGridX, ProbeGridY, ProbeGridZ);
-	glClearTexImage(_ProbeDataTextures[1], 0, GL_RGB_INTEGER, GL_UNSIGNED_BYTE, nullptr);
-
-	glGenTextures(1, &_PrevProbeDataTextures[0]);
-	glBindTexture(GL_TEXTURE_3D, _PrevProbeDataTextures[0]);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA32UI, ProbeGridX, ProbeGridY, ProbeGridZ);
-	glClearTexImage(_PrevProbeDataTextures[0], 0, GL_RGB_INTEGER, GL_UNSIGNED_BYTE, nullptr);
-
-	glGenTextures(1, &_PrevProbeDataTextures[1]);
-	glBindTexture(GL_TEXTURE_3D, _PrevProbeDataTextures[1]);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA32UI, ProbeGridX, ProbeGridY, ProbeGridZ);
-	glClearTexImage(_PrevProbeDataTextures[1], 0, GL_RGB_INTEGER, GL_UNSIGNED_BYTE, nullptr);
-
-	glGenTextures(1, &_PrevFrameDataTextures[0]);
-	glBindTexture(GL_TEXTURE_3D, _PrevFrameDataTextures[0]);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA32UI, ProbeGridX, ProbeGridY, ProbeGridZ);
-	glClearTexImage(_PrevFrameDataTextures[0], 0, GL_RGB_INTEGER, GL_UNSIGNED_BYTE, nullptr);
-
-	glGenTextures(1, &_PrevFrameDataTextures[1]);
-	glBindTexture(GL_TEXTURE_3D, _PrevFrameDataTextures[1]);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA32UI, ProbeGridX, ProbeGridY, ProbeGridZ);
-	glClearTexImage(_PrevFrameDataTextures[1], 0, GL_RGB_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+		static glm::vec3 GetCascadeSize(int cascade) {
+			return _GridSize * float(1 << cascade);
+		}
+
+		static void CreateVolume(GLuint& texture, GLenum format, const glm::ivec3& size) {
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_3D, texture);
+			glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+			glTexStorage3D(GL_TEXTURE_3D, 1, format, size.x, size.y, size.z);
 
-	// Raw radiance buffers
-	glGenTextures(1, &_ProbeRawRadianceBuffers[0]);
-	glBindTexture(GL_TEXTURE_3D, _ProbeRawRadianceBuffers[0]);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexStorage3D(GL_TEXTURE_3D, 1, GL_R11F_G11F_B10F, ProbeGridX, ProbeGridY, ProbeGridZ);
-	glClearTexImage(_ProbeRawRadianceBuffers[0], 0, GL_RGB, GL_FLOAT, nullptr);
-
-	glGenTextures(1, &_ProbeRawRadianceBuffers[1]);
-	glBindTexture(GL_TEXTURE_3D, _ProbeRawRadianceBuffers[1]);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexStorage3D(GL_TEXTURE_3D, 1, GL_R11F_G11F_B10F, ProbeGridX, ProbeGridY, ProbeGridZ);
-	glClearTexImage(_ProbeRawRadianceBuffers[1], 0, GL_RGB, GL_FLOAT, nullptr);
+			if (format == GL_RGBA32UI) {
+				glClearTexImage(texture, 0, GL_RGB_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+			}
 
-	// Voxel volume
-	//glGenTextures(1, &VoxelVolume);
-	//glBindTexture(GL_TEXTURE_3D, VoxelVolume);
-	//glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	//glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	//glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	//glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	//glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	//glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, VOXEL_GRID_X , VOXEL_GRID_Y, VOXEL_GRID_Z, 0, GL_RGBA, GL_FLOAT, nullptr);
+			else {
+				glClearTexImage(texture, 0, GL_RGB, GL_FLOAT, nullptr);
+			}
+		}
 
+		static void DeleteVolumes() {
 
-	// 8x8 luminance and depth/variance map
-	glGenBuffers(1, &_ProbeMapSSBO);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _ProbeMapSSBO);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, (ProbeGridX * ProbeGridY * ProbeGridZ) * sizeof(glm::vec2) * 8 * 8, nullptr, GL_DYNAMIC_DRAW);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-}
+			GLuint* Textures[4] = { _ProbeDataTextures, _PrevProbeDataTextures, _PrevFrameDataTextures, _ProbeRawRadianceBuffers };
 
-static float Align(float value, float size)
-{
-	return std::floor(value / size) * size;
-}
+			for (GLuint* e : Textures) {
+				glDeleteTextures(2, e);
+				e[0] = e[1] = 0;
+			}
 
-void Candela::ProbeGI::UpdateProbes(int Frame, RayIntersector<BVH::StacklessTraversalNode>& Intersector, CommonUniforms& uniforms, GLuint Skymap, bool Temporal)
-{
-	const int ProbeGridX = PROBE_GRID_X;
-	const int ProbeGridY = PROBE_GRID_Y;
-	const int ProbeGridZ = PROBE_GRID_Z;
+			GLuint* Buffers[5] = { &_ProbeMapSSBO, &_ProbeStateSSBO, &_ProbeScheduleSSBO, &_ProbeCounterSSBOs[0], &_ProbeCounterSSBOs[1] };
 
-	GLClasses::ComputeShader& ProbeUpdate = ShaderManager::GetComputeShader("PROBE_UPDATE");
-	GLClasses::ComputeShader& CopyVolume = ShaderManager::GetComputeShader("COPY_VOLUME");
+			for (GLuint* e : Buffers) {
+				glDeleteBuffers(1, e);
+				*e = 0;
+			}
 
-	bool Checkerboard = Frame % 2 == 0;
-	GLuint CurrentVolumeTextures[2] = { Checkerboard ? _ProbeDataTextures[0] : _PrevProbeDataTextures[0], Checkerboard ? _ProbeDataTextures[1] : _PrevProbeDataTextures[1] };
-	GLuint PreviousVolumeTextures[2] = { (!Checkerboard) ? _ProbeDataTextures[0] : _PrevProbeDataTextures[0], (!Checkerboard) ? _ProbeDataTextures[1] : _PrevProbeDataTextures[1] };
+			_CountersPending[0] = _CountersPending[1] = false;
+		}
 
-	GLuint CurrentRawRadianceTexture = Checkerboard ? _ProbeRawRadianceBuffers[0] : _ProbeRawRadianceBuffers[1];
-	GLuint PreviousRawRadianceTexture = Checkerboard ? _ProbeRawRadianceBuffers[1] : _ProbeRawRadianceBuffers[0];
+		static void CreateBuffer(GLuint& buffer, size_t size) {
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+			glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		}
 
-	_CurrentDataTextures.x = CurrentVolumeTextures[0];
-	_CurrentDataTextures.y = CurrentVolumeTextures[1];
-	_CurrentDataTextures.z = CurrentRawRadianceTexture;
+		// Snaps every cascade to its probe spacing so probes stay at fixed world positions while the camera moves
+		static void UpdateCascades(const glm::vec3& center) {
 
-	ProbeUpdate.Use();
+			for (int i = 0; i < _CascadeCount; i++) {
+				glm::vec3 Spacing = (2.0f * GetCascadeSize(i)) / glm::vec3(_GridResolution);
+				glm::ivec3 GridCenter = glm::ivec3(glm::floor(center / Spacing));
+				glm::ivec3 GridMin = GridCenter - (_GridResolution / 2);
 
-	_PreviousOrigin = LastOrigin;
+				// Without history the previous grid is placed so that no probe overlaps it
+				_PreviousCascadeGridMin[i] = _HasHistory ? _CascadeGridMin[i] : GridMin + _GridResolution;
+				_CascadeGridMin[i] = GridMin;
+				_CascadeOrigins[i] = glm::vec3(GridCenter) * Spacing;
+			}
 
-	LastOrigin = glm::vec3(uniforms.InvView[3]);
-	LastOrigin.x = Align(LastOrigin.x, 1.0f);
-	LastOrigin.y = Align(LastOrigin.y, 1.0f);
-	LastOrigin.z = Align(LastOrigin.z, 1.0f);
+			_HasHistory = true;
+		}
 
-	ProbeUpdate.SetVector3f("u_SunDirection", uniforms.SunDirection);
-	ProbeUpdate.SetVector3f("u_BoxOrigin", LastOrigin);
-	ProbeUpdate.SetVector3f("u_Resolution", glm::vec3(ProbeGridX,ProbeGridY,ProbeGridZ));
-	ProbeUpdate.SetVector3f("u_Size", PROBE_GRID_SIZE);
-	ProbeUpdate.SetVector3f("u_PreviousOrigin", _PreviousOrigin);
-	ProbeUpdate.SetFloat("u_Time", glfwGetTime());
+		// Uniform names are built once, the shaders cache locations by name
+		struct CascadeUniformNames {
+			std::string Origin, Size, GridMin, PreviousGridMin;
+		};
 
-	ProbeUpdate.SetInteger("u_Skymap", 4);
+		static const CascadeUniformNames* GetCascadeUniformNames() {
 
-	ProbeUpdate.SetInteger("u_PreviousSHA", 5);
-	ProbeUpdate.SetInteger("u_PreviousSHB", 6);
-	ProbeUpdate.SetBool("u_Temporal", Temporal);
+			static CascadeUniformNames Names[MAX_PROBE_CASCADES];
 
-	for (int i = 0; i < 5; i++) {
+			if (Names[0].Origin.empty()) {
+				for (int i = 0; i < MAX_PROBE_CASCADES; i++) {
+					std::string Index = "[" + std::to_string(i) + "]";
+					Names[i].Origin = "u_ProbeCascadeOrigins" + Index;
+					Names[i].Size = "u_ProbeCascadeSizes" + Index;
+					Names[i].GridMin = "u_ProbeCascadeGridMin" + Index;
+					Names[i].PreviousGridMin = "u_ProbeCascadePreviousGridMin" + Index;
+				}
+			}
 
-		const int BindingPointStart = 8;
+			return Names;
+		}
 
-		std::string Name = "u_ShadowMatrices[" + std::to_string(i) + "]";
-		std::string NameClip = "u_ShadowClipPlanes[" + std::to_string(i) + "]";
-		std::string NameTex = "u_ShadowTextures[" + std::to_string(i) + "]";
+		template <typename T>
+		static void SetCascadeUniforms(T& shader) {
 
-		ProbeUpdate.SetMatrix4(Name, ShadowHandler::GetShadowViewProjectionMatrix(i));
-		ProbeUpdate.SetInteger(NameTex, i + BindingPointStart);
-		ProbeUpdate.SetFloat(NameClip, ShadowHandler::GetShadowCascadeDistance(i));
+			const CascadeUniformNames* Names = GetCascadeUniformNames();
 
-		glActiveTexture(GL_TEXTURE0 + i + BindingPointStart);
-		glBindTexture(GL_TEXTURE_2D, ShadowHandler::GetDirectShadowmap(i));
-	}
+			shader.SetInteger("u_ProbeCascadeCount", _CascadeCount);
+			shader.SetVector3f("u_ProbeGridResolution", glm::vec3(_GridResolution));
 
-	glActiveTexture(GL_TEXTURE4);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, Skymap);
+			for (int i = 0; i < _CascadeCount; i++) {
+				shader.SetVector3f(Names[i].Origin, _CascadeOrigins[i]);
+				shader.SetVector3f(Names[i].Size, GetCascadeSize(i));
+				shader.SetVector3f(Names[i].GridMin, glm::vec3(_CascadeGridMin[i]));
+			}
+		}
 
-	glActiveTexture(GL_TEXTURE5);
-	glBindTexture(GL_TEXTURE_3D, PreviousVolumeTextures[0]);
+		// Used by the passes that track history (see Include/ProbeScheduling.glsl)
+		static void SetSchedulingUniforms(GLClasses::ComputeShader& shader) {
 
-	glActiveTexture(GL_TEXTURE6);
-	glBindTexture(GL_TEXTURE_3D, PreviousVolumeTextures[1]);
+			const CascadeUniformNames* Names = GetCascadeUniformNames();
 
-	glBindImageTexture(0, CurrentVolumeTextures[0], 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA32UI);
-	glBindImageTexture(1, CurrentVolumeTextures[1], 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA32UI);
+			SetCascadeUniforms(shader);
 
-	glBindImageTexture(2, CurrentRawRadianceTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R11F_G11F_B10F);
-	glBindImageTexture(3, PreviousRawRadianceTexture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R11F_G11F_B10F);
+			for (int i = 0; i < _CascadeCount; i++) {
+				shader.SetVector3f(Names[i].PreviousGridMin, glm::vec3(_PreviousCascadeGridMin[i]));
+			}
+		}
 
-	glBindImageTexture(4, _PrevFrameDataTextures[0], 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA32UI);
-	glBindImageTexture(5, _PrevFrameDataTextures[1], 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA32UI);
-	//glBindImageTexture(8, VoxelVolume, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA16F);
+		static void ReadCounters() {
 
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, _ProbeMapSSBO);
+			// The counters of the previous frame are read back a frame late so the readback doesn't stall
+			int Previous = 1 - _CounterIndex;
 
-	Intersector.BindEverything(ProbeUpdate, true);
+			if (!_CountersPending[Previous]) {
+				return;
+			}
 
-	glDispatchCompute(ProbeGridX / 8, ProbeGridY / 4, ProbeGridZ / 8);
+			GLuint Counters[6] = { 0, 0, 0, 0, 0, 0 };
 
-	glUseProgram(0);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, _ProbeCounterSSBOs[Previous]);
+			glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Counters), Counters);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-	// Copy data to buffer (feedback loop)
+			for (int i = 0; i < 3; i++) {
+				_TierCounts[i] = (int)Counters[i];
+			}
 
-	CopyVolume.Use();
+			_RaysPerFrame = glm::min((int)(Counters[3] + Counters[4] + Counters[5]), _RayBudget);
+			_CountersPending[Previous] = false;
+		}
+	}
+}
 
-	CopyVolume.SetInteger("u_CurrentSHA", 0);
-	CopyVolume.SetInteger("u_CurrentSHB", 1);
+void Candela::ProbeGI::Initialize()
+{
+	// Cascades are stacked along z
+	const glm::ivec3 VolumeSize = glm::ivec3(_GridResolution.x, _GridResolution.y, _GridResolution.z * _CascadeCount);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_3D, CurrentVolumeTextures[0]);
+	DeleteVolumes();
 
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_3D, CurrentVolumeTextures[1]);
+	CreateVolume(_ProbeDataTextures[0], GL_RGBA32UI, VolumeSize);
+	CreateVolume(_ProbeDataTextures[1], GL_RGBA32UI, VolumeSize);
+	CreateVolume(_PrevProbeDataTextures[0], GL_RGBA32UI, VolumeSize);
+	CreateVolume(_PrevProbeDataTextures[1], GL_RGBA32UI, VolumeSize);
+	CreateVolume(_PrevFrameDataTextures[0], GL_RGBA32UI, VolumeSize);
+	CreateVolume(_PrevFrameDataTextures[1], GL_RGBA32UI, VolumeSize);
 
-	glBindImageTexture(2, _PrevFrameDataTextures[0], 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA32UI);
-	glBindImageTexture(3, _PrevFrameDataTextures[1], 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA32UI);
+	// Raw radiance buffers
+	// Filtered manually, hardware filtering would blend across the toroidal seam and between cascades
+	CreateVolume(_ProbeRawRadianceBuffers[0], GL_R11F_G11F_B10F, VolumeSize);
+	CreateVolume(_ProbeRawRadianceBuffers[1], GL_R11F_G11F_B10F, VolumeSize);
 
-	glDispatchCompute(ProbeGridX / 8, ProbeGridY / 4, ProbeGridZ / 8);
+	// Voxel volume
+	//glGenTextures(1, &VoxelVolume);
+	//glBindTexture(GL_TEXTURE_3D, VoxelVolume);
+	//glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	//glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	//glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	//glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	//glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	//glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, VOXEL_GRID_X , VOXEL_GRID_Y, VOXEL_GRID_Z, 0, GL_RGBA, GL_FLOAT, nullptr);
 
-	glUseProgram(0);
+
+	const int ProbeCount = VolumeSize.x * VolumeSize.y * VolumeSize.z;
+
+	// 8x8 luminance and depth/variance map
+	glGenBuffers(1, &_ProbeMapSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _ProbeMapSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, ProbeCount * sizeof(glm::vec2) * 8 * 8, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// Classification state (16 bytes per probe), one update list per tier and the tier counters
+	CreateBuffer(_ProbeStateSSBO, ProbeCount * sizeof(glm::vec4));
+	CreateBuffer(_ProbeScheduleSSBO, ProbeCount * sizeof(GLuint) * 3);
+	CreateBuffer(_ProbeCounterSSBOs[0], sizeof(GLuint) * 6);
+	CreateBuffer(_ProbeCounterSSBOs[1], sizeof(GLuint) * 6);
+
+	_CurrentDataTextures = glm::uvec3(_ProbeDataTextures[0], _ProbeDataTextures[1], _ProbeRawRadianceBuffers[0]);
+	_HasHistory = false;
+	_Initialized = true;
+}
+
+void Candela::ProbeGI::Configure(int CascadeCount, const glm::ivec3& Resolution, const glm::vec3& Size)
+{
+	if (CascadeCount < 1 || CascadeCount > MAX_PROBE_CASCADES) {
+		throw "ProbeGI::Configure() : Cascade count has to be between 1 and MAX_PROBE_CASCADES";
+	}
+
+	if (Resolution.x <= 0 || Resolution.y <= 0 || Resolution.z <= 0 || Resolution.x % 8 != 0 || Resolution.y % 4 != 0 || Resolution.z % 8 != 0) {
+		throw "ProbeGI::Configure() : Probe grid resolution has to be a multiple of (8, 4, 8)";
+	}
+
+	_CascadeCount = CascadeCount;
+	_GridResolution = Resolution;
+	_GridSize = Size;
+
+	if (_Initialized) {
+		Initialize();
+	}
 }
 
-void Candela::ProbeGI::UpdateProbes(int Frame, RayIntersector<BVH::StackTraversalNode>& Intersector, CommonUniforms& uniforms, GLuint Skymap, bool Temporal)
+void Candela::ProbeGI::SetQuality(Quality quality)
 {
-	const int ProbeGridX = PROBE_GRID_X;
-	const int ProbeGridY = PROBE_GRID_Y;
-	const int ProbeGridZ = PROBE_GRID_Z;
+	// The finest cascade keeps a probe spacing of 1 unit in every preset
+	switch (quality)
+	{
+		case Quality::Low:
+			Configure(2, glm::ivec3(32, 16, 32), glm::vec3(16.0f, 8.0f, 16.0f));
+			break;
+
+		case Quality::Medium:
+			Configure(3, glm::ivec3(32, 16, 32), glm::vec3(16.0f, 8.0f, 16.0f));
+			break;
+
+		case Quality::High:
+			Configure(3, glm::ivec3(48, 24, 48), glm::vec3(24.0f, 12.0f, 24.0f));
+			break;
+
+		case Quality::Ultra:
+			Configure(4, glm::ivec3(64, 32, 64), glm::vec3(32.0f, 16.0f, 32.0f));
+			break;
+	}
+}
 
+// Sampler units, image units and buffer bindings are fixed in the shaders (layout(binding)), only the objects are bound here
+template <typename T>
+void Candela::ProbeGI::UpdateProbes(int Frame, RayIntersector<T>& Intersector, CommonUniforms& uniforms, GLuint Skymap, bool Temporal)
+{
+	const glm::ivec3 VolumeSize = glm::ivec3(_GridResolution.x, _GridResolution.y, _GridResolution.z * _CascadeCount);
+	const int RayBudget = glm::min(_RayBudget, VolumeSize.x * VolumeSize.y * VolumeSize.z);
+
+	GLClasses::ComputeShader& ClassifyShader = ShaderManager::GetComputeShader("PROBE_CLASSIFY");
 	GLClasses::ComputeShader& ProbeUpdate = ShaderManager::GetComputeShader("PROBE_UPDATE");
 	GLClasses::ComputeShader& CopyVolume = ShaderManager::GetComputeShader("COPY_VOLUME");
 
@@ -259,95 +297,121 @@ void Candela::ProbeGI::UpdateProbes(int Frame, RayIntersector<BVH::StackTraversa
 	_CurrentDataTextures.y = CurrentVolumeTextures[1];
 	_CurrentDataTextures.z = CurrentRawRadianceTexture;
 
-	ProbeUpdate.Use();
-
-	_PreviousOrigin = LastOrigin;
+	UpdateCascades(glm::vec3(uniforms.InvView[3]));
+	ReadCounters();
 
-	LastOrigin = glm::vec3(uniforms.InvView[3]);
-	LastOrigin.x = Align(LastOrigin.x, 1.0f);
-	LastOrigin.y = Align(LastOrigin.y, 1.0f);
-	LastOrigin.z = Align(LastOrigin.z, 1.0f);
+	const GLuint Zero[6] = { 0, 0, 0, 0, 0, 0 };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _ProbeCounterSSBOs[_CounterIndex]);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Zero), Zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-	ProbeUpdate.SetVector3f("u_SunDirection", uniforms.SunDirection);
-	ProbeUpdate.SetVector3f("u_BoxOrigin", LastOrigin);
-	ProbeUpdate.SetVector3f("u_Resolution", glm::vec3(ProbeGridX, ProbeGridY, ProbeGridZ));
-	ProbeUpdate.SetVector3f("u_Size", PROBE_GRID_SIZE);
-	ProbeUpdate.SetVector3f("u_PreviousOrigin", _PreviousOrigin);
-	ProbeUpdate.SetFloat("u_Time", glfwGetTime());
+	// Shared by all three passes : 
+	// Images : current SH (0, 1), current/previous raw radiance (2, 3), previous frame's SH (4, 5)
+	// Buffers : probe maps (2), classification state (3), update lists (4), counters (5)
+	const GLuint Images[6] = { CurrentVolumeTextures[0], CurrentVolumeTextures[1], CurrentRawRadianceTexture, PreviousRawRadianceTexture, _PrevFrameDataTextures[0], _PrevFrameDataTextures[1] };
+	const GLuint Buffers[4] = { _ProbeMapSSBO, _ProbeStateSSBO, _ProbeScheduleSSBO, _ProbeCounterSSBOs[_CounterIndex] };
 
-	ProbeUpdate.SetInteger("u_Skymap", 4);
+	glBindImageTextures(0, 6, Images);
+	glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 2, 4, Buffers);
 
-	ProbeUpdate.SetInteger("u_PreviousSHA", 5);
-	ProbeUpdate.SetInteger("u_PreviousSHB", 6);
-	ProbeUpdate.SetBool("u_Temporal", Temporal);
+	// Carry every probe over to the current volumes and build this frame's update lists (see ClassifyProbes.comp)
+	const GLuint ClassifyTextures[2] = { PreviousVolumeTextures[0], PreviousVolumeTextures[1] };
+	glBindTextures(0, 2, ClassifyTextures);
 
-	for (int i = 0; i < 5; i++) {
+	ClassifyShader.Use();
+	SetSchedulingUniforms(ClassifyShader);
+	ClassifyShader.SetBool("u_Temporal", Temporal);
 
-		const int BindingPointStart = 8;
+	glDispatchCompute(VolumeSize.x / 8, VolumeSize.y / 4, VolumeSize.z / 8);
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
 
-		std::string Name = "u_ShadowMatrices[" + std::to_string(i) + "]";
-		std::string NameClip = "u_ShadowClipPlanes[" + std::to_string(i) + "]";
-		std::string NameTex = "u_ShadowTextures[" + std::to_string(i) + "]";
+	// Trace the scheduled probes
+	GLuint UpdateTextures[9] = { Skymap, PreviousVolumeTextures[0], PreviousVolumeTextures[1], 0 };
 
-		ProbeUpdate.SetMatrix4(Name, ShadowHandler::GetShadowViewProjectionMatrix(i));
-		ProbeUpdate.SetInteger(NameTex, i + BindingPointStart);
-		ProbeUpdate.SetFloat(NameClip, ShadowHandler::GetShadowCascadeDistance(i));
-
-		glActiveTexture(GL_TEXTURE0 + i + BindingPointStart);
-		glBindTexture(GL_TEXTURE_2D, ShadowHandler::GetDirectShadowmap(i));
+	for (int i = 0; i < 5; i++) {
+		UpdateTextures[4 + i] = ShadowHandler::GetDirectShadowmap(i);
 	}
 
-	glActiveTexture(GL_TEXTURE4);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, Skymap);
-
-	glActiveTexture(GL_TEXTURE5);
-	glBindTexture(GL_TEXTURE_3D, PreviousVolumeTextures[0]);
+	glBindTextures(4, 9, UpdateTextures);
 
-	glActiveTexture(GL_TEXTURE6);
-	glBindTexture(GL_TEXTURE_3D, PreviousVolumeTextures[1]);
+	ProbeUpdate.Use();
+	SetSchedulingUniforms(ProbeUpdate);
+	ProbeUpdate.SetBool("u_Temporal", Temporal);
+	ProbeUpdate.SetInteger("u_RayBudget", RayBudget);
 
-	glBindImageTexture(0, CurrentVolumeTextures[0], 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA32UI);
-	glBindImageTexture(1, CurrentVolumeTextures[1], 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA32UI);
+	Intersector.BindEverything(ProbeUpdate);
 
-	glBindImageTexture(2, CurrentRawRadianceTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R11F_G11F_B10F);
-	glBindImageTexture(3, PreviousRawRadianceTexture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R11F_G11F_B10F);
+	// One ray per scheduled probe
+	glDispatchCompute((RayBudget + 63) / 64, 1, 1);
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
 
-	glBindImageTexture(4, _PrevFrameDataTextures[0], 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA32UI);
-	glBindImageTexture(5, _PrevFrameDataTextures[1], 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA32UI);
-	//glBindImageTexture(8, VoxelVolume, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA16F);
+	_CountersPending[_CounterIndex] = true;
+	_CounterIndex = 1 - _CounterIndex;
 
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, _ProbeMapSSBO);
+	// Copy data to buffer (feedback loop)
+	const GLuint CopyImages[2] = { _PrevFrameDataTextures[0], _PrevFrameDataTextures[1] };
+	glBindTextures(0, 2, CurrentVolumeTextures);
+	glBindImageTextures(2, 2, CopyImages);
 
-	Intersector.BindEverything(ProbeUpdate, true);
+	CopyVolume.Use();
 
-	glDispatchCompute(ProbeGridX / 8, ProbeGridY / 4, ProbeGridZ / 8);
+	glDispatchCompute(VolumeSize.x / 8, VolumeSize.y / 4, VolumeSize.z / 8);
 
 	glUseProgram(0);
+}
 
-	// Copy data to buffer (feedback loop)
+// Node layouts the probes can be traced with, a new layout only needs to be added here
+template void Candela::ProbeGI::UpdateProbes<Candela::BVH::StacklessTraversalNode>(int, Candela::RayIntersector<Candela::BVH::StacklessTraversalNode>&, CommonUniforms&, GLuint, bool);
+template void Candela::ProbeGI::UpdateProbes<Candela::BVH::StackTraversalNode>(int, Candela::RayIntersector<Candela::BVH::StackTraversalNode>&, CommonUniforms&, GLuint, bool);
 
-	CopyVolume.Use();
+void Candela::ProbeGI::SetUniforms(GLClasses::Shader& shader)
+{
+	SetCascadeUniforms(shader);
+}
 
-	CopyVolume.SetInteger("u_CurrentSHA", 0);
-	CopyVolume.SetInteger("u_CurrentSHB", 1);
+void Candela::ProbeGI::SetUniforms(GLClasses::ComputeShader& shader)
+{
+	SetCascadeUniforms(shader);
+}
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_3D, CurrentVolumeTextures[0]);
+void Candela::ProbeGI::SetRayBudget(int RaysPerFrame)
+{
+	_RayBudget = glm::max(RaysPerFrame, 64);
+}
 
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_3D, CurrentVolumeTextures[1]);
+int Candela::ProbeGI::GetRayBudget()
+{
+	return _RayBudget;
+}
 
-	glBindImageTexture(2, _PrevFrameDataTextures[0], 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA32UI);
-	glBindImageTexture(3, _PrevFrameDataTextures[1], 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA32UI);
+int Candela::ProbeGI::GetActiveProbeCount()
+{
+	return _TierCounts[0] + _TierCounts[1];
+}
 
-	glDispatchCompute(ProbeGridX / 8, ProbeGridY / 4, ProbeGridZ / 8);
+int Candela::ProbeGI::GetConvergedProbeCount()
+{
+	return _TierCounts[1];
+}
 
-	glUseProgram(0);
+int Candela::ProbeGI::GetInactiveProbeCount()
+{
+	return _TierCounts[2];
+}
+
+int Candela::ProbeGI::GetRaysPerFrame()
+{
+	return _RaysPerFrame;
+}
+
+int Candela::ProbeGI::GetCascadeCount()
+{
+	return _CascadeCount;
 }
 
-glm::vec3 Candela::ProbeGI::GetProbeBoxOrigin()
+glm::ivec3 Candela::ProbeGI::GetGridResolution()
 {
-	return LastOrigin;
+	return _GridResolution;
 }
 
 GLuint Candela::ProbeGI::GetProbeDataSSBO()
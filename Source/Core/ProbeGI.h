@@ -14,15 +14,55 @@
 
 #include "ShadowMapHandler.h"
 
+#include "GLClasses/Shader.h"
+#include "GLClasses/ComputeShader.h"
+
+// Must match Shaders/Include/ProbeCascades.glsl
+#define MAX_PROBE_CASCADES 4
+
 namespace Candela {
 
 	namespace ProbeGI {
 
+		enum class Quality {
+			Low,
+			Medium,
+			High,
+			Ultra
+		};
+
+		// Allocates the probe volumes, uses Quality::Medium unless Configure()/SetQuality() was called before
 		void Initialize();
 
-		void UpdateProbes(int Frame, RayIntersector<BVH::StacklessTraversalNode>& Intersector, CommonUniforms& uniforms, GLuint Skymap, bool Temporal);
-		void UpdateProbes(int Frame, RayIntersector<BVH::StackTraversalNode>& Intersector, CommonUniforms& uniforms, GLuint Skymap, bool Temporal);
-		glm::vec3 GetProbeBoxOrigin();
+		// Nested clipmap cascades centered on the camera, each with the same resolution and twice the extent of the previous one
+		// Resolution has to be a multiple of (8, 4, 8), size is the half extent of the finest cascade
+		// Reallocates the probe volumes (and drops their history) if the volumes already exist
+		void Configure(int CascadeCount, const glm::ivec3& Resolution, const glm::vec3& Size);
+		void SetQuality(Quality quality);
+
+		// Probes are classified as dirty, converged or inactive (inside geometry or far from every surface) every frame
+		// and at most the ray budget's worth of them is traced, dirty probes first (see Shaders/ClassifyProbes.comp)
+		// Instantiated for every node layout in ProbeGI.cpp
+		template <typename T>
+		void UpdateProbes(int Frame, RayIntersector<T>& Intersector, CommonUniforms& uniforms, GLuint Skymap, bool Temporal);
+
+		// Sets the cascade uniforms declared in Include/ProbeCascades.glsl
+		void SetUniforms(GLClasses::Shader& shader);
+		void SetUniforms(GLClasses::ComputeShader& shader);
+
+		// One ray per updated probe
+		void SetRayBudget(int RaysPerFrame);
+		int GetRayBudget();
+
+		// Stats of the previous frame
+		int GetActiveProbeCount(); // Dirty + converged
+		int GetConvergedProbeCount();
+		int GetInactiveProbeCount();
+		int GetRaysPerFrame();
+
+		int GetCascadeCount();
+		glm::ivec3 GetGridResolution();
+
 		GLuint GetProbeDataSSBO();
 		glm::uvec2 GetProbeDataTextures();
 		GLuint GetProbeColorTexture();
@@ -30,4 +70,3 @@ namespace Candela {
 	}
 
 }
-
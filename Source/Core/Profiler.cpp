@@ -0,0 +1,406 @@
+#include "Profiler.h"
+
+#include <chrono>
+#include <unordered_map>
+#include <algorithm>
+
+#include <imgui.h>
+
+// Number of frames in flight for the query ring, results are read back this many frames late 
+#define PROFILER_FRAME_LATENCY 4
+
+// Number of samples the rolling averages are computed over
+#define PROFILER_HISTORY 128
+
+namespace Candela {
+
+	namespace Profiler {
+
+		struct ZoneRecord {
+			std::string Name;
+			int Depth;
+			double CPUStart, CPUEnd;
+			int QueryStart, QueryEnd;
+		};
+
+		struct FrameSlot {
+			std::vector<ZoneRecord> Zones;
+			std::vector<GLuint> Queries;
+			int QueriesUsed = 0;
+			uint64_t FrameIndex = 0;
+			bool Pending = false;
+		};
+
+		struct ZoneHistory {
+			float CPU[PROFILER_HISTORY] = { 0.0f };
+			float GPU[PROFILER_HISTORY] = { 0.0f };
+			int Index = 0;
+			int Count = 0;
+			float CPUAverage = 0.0f;
+			float GPUAverage = 0.0f;
+		};
+
+		static bool Enabled = true;
+		static bool InFrame = false;
+
+		static FrameSlot Slots[PROFILER_FRAME_LATENCY];
+		static int CurrentSlot = 0;
+		static uint64_t FrameIndex = 0;
+
+		static std::vector<int> ZoneStack;
+		static std::chrono::steady_clock::time_point FrameStart;
+
+		static std::unordered_map<std::string, ZoneHistory> History;
+		static std::vector<std::string> ZoneOrder; // Order of first appearance, used for display
+		static std::vector<ZoneTiming> LastResolved;
+
+		static std::unordered_map<std::string, int> Counters;
+		static std::vector<std::string> CounterOrder;
+
+		static int DroppedFrames = 0;
+
+		static std::function<void(uint64_t, const std::vector<ZoneTiming>&)> ResolveCallback;
+
+		static double GetCPUTime()
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - FrameStart).count();
+		}
+
+		static int AllocateQuery(FrameSlot& slot)
+		{
+			if (slot.QueriesUsed >= (int)slot.Queries.size()) {
+				GLuint Query = 0;
+				glGenQueries(1, &Query);
+				slot.Queries.push_back(Query);
+			}
+
+			int Index = slot.QueriesUsed++;
+			glQueryCounter(slot.Queries[Index], GL_TIMESTAMP);
+			return Index;
+		}
+
+		static void PushHistory(const std::string& name, float cpu, float gpu)
+		{
+			auto Found = History.find(name);
+
+			if (Found == History.end()) {
+				ZoneOrder.push_back(name);
+				Found = History.emplace(name, ZoneHistory()).first;
+			}
+
+			ZoneHistory& Zone = Found->second;
+
+			Zone.CPU[Zone.Index] = cpu;
+			Zone.GPU[Zone.Index] = gpu;
+			Zone.Index = (Zone.Index + 1) % PROFILER_HISTORY;
+			Zone.Count = Zone.Count < PROFILER_HISTORY ? Zone.Count + 1 : PROFILER_HISTORY;
+
+			float CPUTotal = 0.0f;
+			float GPUTotal = 0.0f;
+
+			for (int i = 0; i < Zone.Count; i++) {
+				CPUTotal += Zone.CPU[i];
+				GPUTotal += Zone.GPU[i];
+			}
+
+			Zone.CPUAverage = CPUTotal / float(Zone.Count);
+			Zone.GPUAverage = GPUTotal / float(Zone.Count);
+		}
+
+		// Reads back a slot if all of its queries are done, returns false (without waiting) otherwise
+		static bool TryResolve(FrameSlot& slot)
+		{
+			if (!slot.Pending) {
+				return true;
+			}
+
+			if (slot.QueriesUsed > 0) {
+				GLint Available = 0;
+				glGetQueryObjectiv(slot.Queries[slot.QueriesUsed - 1], GL_QUERY_RESULT_AVAILABLE, &Available);
+
+				if (!Available) {
+					return false;
+				}
+			}
+
+			std::vector<GLuint64> Timestamps(slot.QueriesUsed);
+
+			for (int i = 0; i < slot.QueriesUsed; i++) {
+				glGetQueryObjectui64v(slot.Queries[i], GL_QUERY_RESULT, &Timestamps[i]);
+			}
+
+			GLuint64 Base = slot.QueriesUsed > 0 ? Timestamps[0] : 0;
+
+			LastResolved.clear();
+
+			for (auto& e : slot.Zones) {
+				if (e.QueryEnd < 0) {
+					continue;
+				}
+
+				ZoneTiming Timing;
+				Timing.Name = e.Name;
+				Timing.Depth = e.Depth;
+				Timing.CPUStart = float(e.CPUStart);
+				Timing.CPUEnd = float(e.CPUEnd);
+				Timing.GPUStart = float(double(Timestamps[e.QueryStart] - Base) / 1000000.0);
+				Timing.GPUEnd = float(double(Timestamps[e.QueryEnd] - Base) / 1000000.0);
+
+				LastResolved.push_back(Timing);
+				PushHistory(Timing.Name, Timing.CPUEnd - Timing.CPUStart, Timing.GPUEnd - Timing.GPUStart);
+			}
+
+			if (ResolveCallback) {
+				ResolveCallback(slot.FrameIndex, LastResolved);
+			}
+
+			slot.Pending = false;
+			return true;
+		}
+	}
+}
+
+void Candela::Profiler::SetEnabled(bool enabled)
+{
+	Enabled = enabled;
+}
+
+bool Candela::Profiler::IsEnabled()
+{
+	return Enabled;
+}
+
+void Candela::Profiler::BeginFrame()
+{
+	if (!Enabled) {
+		return;
+	}
+
+	CurrentSlot = (CurrentSlot + 1) % PROFILER_FRAME_LATENCY;
+
+	FrameSlot& Slot = Slots[CurrentSlot];
+
+	// This slot was issued PROFILER_FRAME_LATENCY frames ago, if the gpu still hasn't finished it, drop it rather than stall
+	if (!TryResolve(Slot)) {
+		DroppedFrames++;
+		Slot.Pending = false;
+	}
+
+	Slot.Zones.clear();
+	Slot.QueriesUsed = 0;
+	Slot.FrameIndex = ++FrameIndex;
+
+	ZoneStack.clear();
+	FrameStart = std::chrono::steady_clock::now();
+	InFrame = true;
+}
+
+void Candela::Profiler::EndFrame()
+{
+	if (!Enabled || !InFrame) {
+		return;
+	}
+
+	while (!ZoneStack.empty()) {
+		EndZone();
+	}
+
+	Slots[CurrentSlot].Pending = true;
+	InFrame = false;
+}
+
+void Candela::Profiler::BeginZone(const std::string& name)
+{
+	if (!Enabled || !InFrame) {
+		return;
+	}
+
+	FrameSlot& Slot = Slots[CurrentSlot];
+
+	ZoneRecord Record;
+	Record.Name = name;
+	Record.Depth = (int)ZoneStack.size();
+	Record.CPUStart = GetCPUTime();
+	Record.CPUEnd = Record.CPUStart;
+	Record.QueryStart = AllocateQuery(Slot);
+	Record.QueryEnd = -1;
+
+	ZoneStack.push_back((int)Slot.Zones.size());
+	Slot.Zones.push_back(Record);
+}
+
+void Candela::Profiler::EndZone()
+{
+	if (!Enabled || !InFrame || ZoneStack.empty()) {
+		return;
+	}
+
+	FrameSlot& Slot = Slots[CurrentSlot];
+	ZoneRecord& Record = Slot.Zones[ZoneStack.back()];
+	ZoneStack.pop_back();
+
+	Record.CPUEnd = GetCPUTime();
+	Record.QueryEnd = AllocateQuery(Slot);
+}
+
+void Candela::Profiler::SetCounter(const std::string& name, int value)
+{
+	if (Counters.find(name) == Counters.end()) {
+		CounterOrder.push_back(name);
+	}
+
+	Counters[name] = value;
+}
+
+int Candela::Profiler::GetCounter(const std::string& name)
+{
+	auto Found = Counters.find(name);
+	return Found == Counters.end() ? 0 : Found->second;
+}
+
+float Candela::Profiler::GetAverageCPUTime(const std::string& name)
+{
+	auto Found = History.find(name);
+	return Found == History.end() ? -1.0f : Found->second.CPUAverage;
+}
+
+float Candela::Profiler::GetAverageGPUTime(const std::string& name)
+{
+	auto Found = History.find(name);
+	return Found == History.end() ? -1.0f : Found->second.GPUAverage;
+}
+
+const std::vector<Candela::Profiler::ZoneTiming>& Candela::Profiler::GetLastResolvedFrame()
+{
+	return LastResolved;
+}
+
+uint64_t Candela::Profiler::GetFrameIndex()
+{
+	return FrameIndex;
+}
+
+void Candela::Profiler::SetResolveCallback(std::function<void(uint64_t, const std::vector<ZoneTiming>&)> callback)
+{
+	ResolveCallback = callback;
+}
+
+void Candela::Profiler::Flush()
+{
+	if (!Enabled) {
+		return;
+	}
+
+	glFinish();
+
+	// Oldest slot first so frames are resolved in order
+	for (int i = 1; i <= PROFILER_FRAME_LATENCY; i++) {
+		TryResolve(Slots[(CurrentSlot + i) % PROFILER_FRAME_LATENCY]);
+	}
+}
+
+void Candela::Profiler::RenderImGui()
+{
+	if (!ImGui::Begin("Profiler")) {
+		ImGui::End();
+		return;
+	}
+
+	ImGui::Checkbox("Enabled", &Enabled);
+	ImGui::SameLine();
+	ImGui::Text("   Latency : %d frames   |   Dropped readbacks : %d", PROFILER_FRAME_LATENCY, DroppedFrames);
+	ImGui::Separator();
+
+	// Timeline of the last resolved frame, one row per nesting depth
+	float FrameGPUEnd = 0.0f;
+	float FrameCPUEnd = 0.0f;
+	int MaxDepth = 0;
+
+	for (auto& e : LastResolved) {
+		FrameGPUEnd = std::max(FrameGPUEnd, e.GPUEnd);
+		FrameCPUEnd = std::max(FrameCPUEnd, e.CPUEnd);
+		MaxDepth = std::max(MaxDepth, e.Depth);
+	}
+
+	const float RowHeight = 20.0f;
+	const float Scale = std::max(FrameGPUEnd, FrameCPUEnd);
+
+	ImDrawList* DrawList = ImGui::GetWindowDrawList();
+	float Width = ImGui::GetContentRegionAvail().x;
+
+	for (int Timeline = 0; Timeline < 2; Timeline++) {
+		bool GPU = Timeline == 0;
+
+		ImGui::Text(GPU ? "GPU (%.3f ms)" : "CPU (%.3f ms)", GPU ? FrameGPUEnd : FrameCPUEnd);
+
+		ImVec2 Origin = ImGui::GetCursorScreenPos();
+		ImGui::Dummy(ImVec2(Width, RowHeight * float(MaxDepth + 1)));
+
+		if (Scale <= 0.0f) {
+			continue;
+		}
+
+		for (int i = 0; i < (int)LastResolved.size(); i++) {
+			const ZoneTiming& Zone = LastResolved[i];
+
+			float Start = GPU ? Zone.GPUStart : Zone.CPUStart;
+			float End = GPU ? Zone.GPUEnd : Zone.CPUEnd;
+
+			ImVec2 Min = ImVec2(Origin.x + (Start / Scale) * Width, Origin.y + Zone.Depth * RowHeight);
+			ImVec2 Max = ImVec2(Origin.x + (End / Scale) * Width, Min.y + RowHeight - 2.0f);
+
+			// Cheap hash so that a zone keeps its colour between frames
+			unsigned int Hash = 2166136261u;
+
+			for (char c : Zone.Name) {
+				Hash = (Hash ^ (unsigned int)c) * 16777619u;
+			}
+
+			ImU32 Color = IM_COL32(80 + (Hash & 0x7F), 80 + ((Hash >> 8) & 0x7F), 80 + ((Hash >> 16) & 0x7F), 255);
+
+			DrawList->AddRectFilled(Min, Max, Color);
+			DrawList->PushClipRect(Min, Max, true);
+			DrawList->AddText(ImVec2(Min.x + 2.0f, Min.y + 2.0f), IM_COL32(0, 0, 0, 255), Zone.Name.c_str());
+			DrawList->PopClipRect();
+
+			if (ImGui::IsMouseHoveringRect(Min, Max)) {
+				ImGui::SetTooltip("%s\n%.3f ms", Zone.Name.c_str(), End - Start);
+			}
+		}
+	}
+
+	ImGui::Separator();
+
+	// Rolling averages 
+	ImGui::Columns(3, "##ProfilerZones");
+	ImGui::Text("Zone");
+	ImGui::NextColumn();
+	ImGui::Text("CPU (avg ms)");
+	ImGui::NextColumn();
+	ImGui::Text("GPU (avg ms)");
+	ImGui::NextColumn();
+	ImGui::Separator();
+
+	for (auto& e : ZoneOrder) {
+		ZoneHistory& Zone = History[e];
+
+		ImGui::Text("%s", e.c_str());
+		ImGui::NextColumn();
+		ImGui::Text("%.3f", Zone.CPUAverage);
+		ImGui::NextColumn();
+		ImGui::Text("%.3f", Zone.GPUAverage);
+		ImGui::NextColumn();
+	}
+
+	ImGui::Columns(1);
+
+	if (CounterOrder.size() > 0) {
+		ImGui::Separator();
+
+		for (auto& e : CounterOrder) {
+			ImGui::Text("%s : %d", e.c_str(), Counters[e]);
+		}
+	}
+
+	ImGui::End();
+}
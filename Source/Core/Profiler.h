@@ -0,0 +1,53 @@
+#pragma once 
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <glad/glad.h>
+
+namespace Candela {
+
+	// Scoped CPU + GPU profiler
+	// GPU times come from GL_TIMESTAMP queries kept in a small ring of frames, results are read back a few frames late and never stall 
+	namespace Profiler {
+
+		struct ZoneTiming {
+			std::string Name;
+			int Depth;
+			float CPUStart, CPUEnd; // ms, relative to the start of the frame
+			float GPUStart, GPUEnd; // ms, relative to the first timestamp of the frame
+		};
+
+		void SetEnabled(bool enabled);
+		bool IsEnabled();
+
+		void BeginFrame();
+		void EndFrame();
+
+		void BeginZone(const std::string& name);
+		void EndZone();
+
+		// Per frame counters (draw counts etc), shown alongside the zones
+		void SetCounter(const std::string& name, int value);
+		int GetCounter(const std::string& name);
+
+		// Rolling averages in ms, -1 if the zone hasn't been resolved yet
+		float GetAverageCPUTime(const std::string& name);
+		float GetAverageGPUTime(const std::string& name);
+
+		const std::vector<ZoneTiming>& GetLastResolvedFrame();
+
+		// Index of the frame currently being recorded (incremented by BeginFrame)
+		uint64_t GetFrameIndex();
+
+		// Called with the frame index and its zones whenever a frame is read back
+		void SetResolveCallback(std::function<void(uint64_t, const std::vector<ZoneTiming>&)> callback);
+
+		// Waits on the gpu and reads back every frame still in flight
+		void Flush();
+
+		void RenderImGui();
+	}
+}
@@ -1,11 +1,22 @@
 #include "ShaderManager.h"
 #include <sstream>
+#include <chrono>
 
 static std::unordered_map<std::string, GLClasses::Shader> ShaderManager_ShaderMap;
 static std::unordered_map<std::string, GLClasses::ComputeShader> ShaderManager_ShaderMapC;
 
+// When set, AddShader()/AddComputeShader() only issue the compile, the status is queried for every program at once in FinishCompiling() 
+static bool ShaderManager_Batching = false;
+
 void Candela::ShaderManager::CreateShaders()
 {
+	auto start = std::chrono::steady_clock::now();
+
+	GLClasses::ProgramCache::Initialize();
+	GLClasses::ProgramCache::EnableParallelCompile();
+
+	ShaderManager_Batching = true;
+
 	AddShader("GBUFFER", "Core/Shaders/GeometryVert.glsl", "Core/Shaders/GeometryFrag.glsl");
 	AddShader("GLASS_PREPASS", "Core/Shaders/GlassPrePassVert.glsl", "Core/Shaders/GlassPrePassFrag.glsl");
 	AddShader("TRANSPARENT_FORWARD", "Core/Shaders/TransparentForwardVert.glsl", "Core/Shaders/TransparentForwardFrag.glsl");
@@ -33,12 +44,38 @@ void Candela::ShaderManager::CreateShaders()
 	AddShader("SS_REFRACT", "Core/Shaders/FBOVert.glsl", "Core/Shaders/RefractionTrace.glsl");
 	AddComputeShader("PROBE_UPDATE", "Core/Shaders/UpdateRadianceProbes.glsl");
 	AddComputeShader("COPY_VOLUME", "Core/Shaders/CopyVolume.glsl");
+	AddComputeShader("PROBE_CLASSIFY", "Core/Shaders/ClassifyProbes.comp");
 	AddComputeShader("COLLISIONS", "Core/Shaders/Collide.comp");
+	AddComputeShader("HIZ_BUILD", "Core/Shaders/HiZ.comp");
+	AddComputeShader("OCCLUSION_CULL", "Core/Shaders/OcclusionCull.comp");
 	AddShader("GLASS_DEFERRED", "Core/Shaders/FBOVert.glsl", "Core/Shaders/GlassDeferred.glsl");
 	AddShader("GLASS_DEFERRED_ST", "Core/Shaders/FBOVert.glsl", "Core/Shaders/GlassDeferredStochastic.glsl");
 	AddShader("BASIC_BLIT", "Core/Shaders/FBOVert.glsl", "Core/Shaders/BasicBlit.glsl");
 	AddShader("GEN_HQN", "Core/Shaders/FBOVert.glsl", "Core/Shaders/GenerateHighFreqNormals.glsl");
 	AddShader("PROBE", "Core/Shaders/ProbeForwardVert.glsl", "Core/Shaders/ProbeForwardFrag.glsl");
+
+	ShaderManager_Batching = false;
+
+	FinishCompiling();
+
+	auto end = std::chrono::steady_clock::now();
+	double elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+	GLClasses::ProgramCache::PrintStats();
+	std::cout << "\nShaders created in " << elapsed * 1000.0 << " ms";
+}
+
+void Candela::ShaderManager::FinishCompiling()
+{
+	for (auto& e : ShaderManager_ShaderMap)
+	{
+		e.second.FinishCompile();
+	}
+
+	for (auto& e : ShaderManager_ShaderMapC)
+	{
+		e.second.FinishCompile();
+	}
 }
 
 void Candela::ShaderManager::AddShader(const std::string& name, const std::string& vert, const std::string& frag, const std::string& geo)
@@ -48,8 +85,12 @@ void Candela::ShaderManager::AddShader(const std::string& name, const std::strin
 	if (exists == ShaderManager_ShaderMap.end())
 	{
 		ShaderManager_ShaderMap.emplace(name, GLClasses::Shader());
-		ShaderManager_ShaderMap.at(name).CreateShaderProgramFromFile(vert, frag);
-		ShaderManager_ShaderMap.at(name).CompileShaders();
+		ShaderManager_ShaderMap.at(name).CreateShaderProgramFromFile(vert, frag, geo);
+		ShaderManager_ShaderMap.at(name).BeginCompile();
+
+		if (!ShaderManager_Batching) {
+			ShaderManager_ShaderMap.at(name).FinishCompile();
+		}
 	}
 
 	else
@@ -67,7 +108,11 @@ void Candela::ShaderManager::AddComputeShader(const std::string& name, const std
 	{
 		ShaderManager_ShaderMapC.emplace(name, GLClasses::ComputeShader());
 		ShaderManager_ShaderMapC.at(name).CreateComputeShader(comp);
-		ShaderManager_ShaderMapC.at(name).Compile();
+		ShaderManager_ShaderMapC.at(name).BeginCompile();
+
+		if (!ShaderManager_Batching) {
+			ShaderManager_ShaderMapC.at(name).FinishCompile();
+		}
 	}
 
 	else
@@ -124,9 +169,14 @@ GLuint Candela::ShaderManager::GetShaderID(const std::string& name)
 
 void Candela::ShaderManager::RecompileShaders()
 {
+	auto start = std::chrono::steady_clock::now();
+
 	int ShadersRecompiled = 0;
 	int ComputeShadersRecompiled = 0;
 
+	// Only programs whose (transitive) includes changed on disk get re-expanded and recompiled
+	int FilesChanged = GLClasses::ShaderIncludes::Refresh();
+
 	for (auto& e : ShaderManager_ShaderMap)
 	{
 		ShadersRecompiled += (int)e.second.Recompile();
@@ -137,11 +187,16 @@ void Candela::ShaderManager::RecompileShaders()
 		ComputeShadersRecompiled += (int)e.second.Recompile();
 	}
 	
-	std::cout << "\nShaders Recompiled : " << ShadersRecompiled << "   |   Compute Shaders Recompiled : " << ComputeShadersRecompiled;
+	auto end = std::chrono::steady_clock::now();
+	double elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+	
+	std::cout << "\nFiles Changed : " << FilesChanged << "   |   Shaders Recompiled : " << ShadersRecompiled << "   |   Compute Shaders Recompiled : " << ComputeShadersRecompiled << "   |   " << elapsed * 1000.0 << " ms";
 }
 
 void Candela::ShaderManager::ForceRecompileShaders()
 {
+	GLClasses::ShaderIncludes::Clear();
+
 	for (auto& e : ShaderManager_ShaderMap)
 	{
 		e.second.ForceRecompile();
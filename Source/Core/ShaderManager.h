@@ -13,6 +13,7 @@ namespace Candela
 	namespace ShaderManager
 	{
 		void CreateShaders();
+		void FinishCompiling();
 
 		void AddShader(const std::string& name, const std::string& vert, const std::string& frag, const std::string& geo = std::string(""));
 		void AddComputeShader(const std::string& name, const std::string& comp);
@@ -1,4 +1,4 @@
-#version 330 core
+#version 420 core
 
 #define EPSILON 0.01f
 
@@ -15,7 +15,7 @@ uniform bool u_Enabled;
 
 uniform float u_GrainStrength;
 
-uniform float u_Time;
+#include "Include/CommonUniforms.glsl"
 
 uniform float u_RenderScale;
 
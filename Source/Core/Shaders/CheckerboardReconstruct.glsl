@@ -1,4 +1,4 @@
-#version 330 core 
+#version 420 core 
 
 #include "Include/Utility.glsl"
 #include "Include/SpatialUtility.glsl"
@@ -24,18 +24,7 @@ uniform sampler2D u_PreviousFrameVolumetrics;
 
 uniform sampler2D u_MotionVectors;
 
-uniform mat4 u_InverseView;
-uniform mat4 u_InverseProjection;
-uniform mat4 u_Projection;
-uniform mat4 u_View;
-uniform mat4 u_PrevProjection;
-uniform mat4 u_PrevView;
-uniform mat4 u_PrevInverseProjection;
-uniform mat4 u_PrevInverseView;
-
-uniform int u_Frame;
-uniform float u_zNear;
-uniform float u_zFar;
+#include "Include/CommonUniforms.glsl"
 
 uniform vec2 u_Dimensions;
 
@@ -41,33 +41,19 @@ uniform sampler2D u_DebugTexture;
 uniform samplerCube u_ProbePlayer;
 
 uniform float u_RTAOStrength;
-uniform vec3 u_ViewerPosition;
-uniform vec3 u_LightDirection;
-uniform mat4 u_InverseView;
-uniform mat4 u_InverseProjection;
-uniform mat4 u_Projection;
+#include "Include/CommonUniforms.glsl"
 uniform mat4 u_ViewProjection;
-uniform mat4 u_View;
 uniform vec2 u_Dims;
 
 uniform bool u_DoSSShadow;
 
-uniform int u_Frame;
-
 uniform int u_DebugMode;
 
 uniform bool u_DoVolumetrics;
 
-uniform float u_Time;
-
-uniform float u_zNear;
-uniform float u_zFar;
-
 uniform vec2 u_FocusPoint;
 
-uniform mat4 u_ShadowMatrices[5]; // <- shadow matrices 
 uniform sampler2DShadow u_ShadowTextures[5]; // <- the shadowmaps themselves 
-uniform float u_ShadowClipPlanes[5]; // <- world space clip distances 
 uniform vec2 u_ShadowBiasMult;
 
 struct ProbeMapPixel {
@@ -1,4 +1,4 @@
-#version 330 core
+#version 420 core
 
 #include "Include/Utility.glsl"
 
@@ -14,8 +14,7 @@ uniform int u_SelectedTonemap;
 
 uniform bool u_DOFEnabled;
 
-uniform float u_zNear;
-uniform float u_zFar;
+#include "Include/CommonUniforms.glsl"
 
 uniform float u_DOFScale;
 
@@ -25,12 +24,8 @@ uniform bool u_PerformanceDOF;
 
 uniform float u_GrainStrength;
 
-uniform float u_Time;
-
 uniform float u_Exposure;
 
-uniform vec3 u_SunDirection;
-
 uniform float u_PurkinjeStrength;
 
 const float DOFBlurSize = 20.0f;
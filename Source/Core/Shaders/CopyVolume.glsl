@@ -6,8 +6,8 @@ layout(local_size_x = 8, local_size_y = 4, local_size_z = 8) in;
 layout(rgba32ui, binding = 2) uniform uimage3D o_SHOutputA;
 layout(rgba32ui, binding = 3) uniform uimage3D o_SHOutputB;
 
-uniform usampler3D u_CurrentSHA;
-uniform usampler3D u_CurrentSHB;
+layout(binding = 0) uniform usampler3D u_CurrentSHA;
+layout(binding = 1) uniform usampler3D u_CurrentSHB;
 
 void main() {
 	
@@ -1,4 +1,4 @@
-#version 330 core 
+#version 420 core 
 
 #define PI 3.14159265359
 
@@ -13,12 +13,9 @@ in vec2 v_TexCoords;
 
 uniform sampler2D u_Input;
 
-uniform float u_zNear;
-uniform float u_zFar;
+#include "Include/CommonUniforms.glsl"
 uniform float u_FocusDepth;
 
-uniform float u_Time;
-
 uniform bool u_HQ;
 
 uniform float u_BlurRadius;
@@ -16,14 +16,10 @@
 layout(local_size_x = 16, local_size_y = 16) in;
 layout(rgba16f, binding = 0) uniform image2D o_OutputData;
 
-uniform mat4 u_Projection;
-uniform mat4 u_View;
-uniform mat4 u_InverseProjection;
-uniform mat4 u_InverseView;
+#include "Include/CommonUniforms.glsl"
 uniform mat4 u_ViewProjection;
 
 uniform vec2 u_Dims;
-uniform vec3 u_SunDirection;
 
 uniform sampler2D u_DepthTexture;
 uniform sampler2D u_TransparentDepth;
@@ -33,24 +29,15 @@ uniform sampler2D u_Albedo;
 uniform sampler2D u_BlueNoise;
 uniform samplerCube u_Skymap;
 
-uniform int u_Frame;
 uniform int u_SecondaryBounces;
-uniform float u_Time;
 
-uniform mat4 u_ShadowMatrices[5]; // <- shadow matrices 
 uniform sampler2D u_ShadowTextures[5]; // <- the shadowmaps themselves 
-uniform float u_ShadowClipPlanes[5]; // <- world space clip distances 
 
-uniform vec3 u_ProbeBoxSize;
-uniform vec3 u_ProbeGridResolution;
-uniform vec3 u_ProbeBoxOrigin;
+#include "Include/ProbeCascades.glsl"
 
 uniform usampler3D u_SHDataA;
 uniform usampler3D u_SHDataB;
 
-uniform float u_zNear;
-uniform float u_zFar;
-
 uniform bool u_Checker;
 
 uniform bool u_SecondBounce;
@@ -62,11 +49,6 @@ uniform bool DO_BL_SAMPLING;
 uniform sampler2D u_IndirectDiffuse; // <- Previous frame diffuse, to create a positive feedback loop 
 uniform sampler2D u_MotionVectors;
 
-uniform mat4 u_PrevProjection;
-uniform mat4 u_PrevView;
-uniform mat4 u_PrevInverseProjection;
-uniform mat4 u_PrevInverseView;
-
 vec3 Reprojection(vec3 WorldPos) 
 {
 	vec4 ProjectedPosition = u_PrevProjection * u_PrevView * vec4(WorldPos, 1.0f);
@@ -230,11 +212,9 @@ SH GetSH(ivec3 Texel) {
 	return UnpackSH(A,B);
 }
 
-float GetVisibility(ivec3 Texel, vec3 WorldPosition, vec3 Normal) {
+float GetVisibility(ivec3 Probe, int Cascade, vec3 WorldPosition, vec3 Normal) {
 	
-	vec3 TexCoords = vec3(Texel) / u_ProbeGridResolution;
-	vec3 Clip = TexCoords * 2.0f - 1.0f;
-	vec3 ProbePosition = u_ProbeBoxOrigin + Clip * u_ProbeBoxSize;
+	vec3 ProbePosition = GetProbePosition(Probe, Cascade);
 
 	vec3 Vector = ProbePosition - WorldPosition;
 	float Length = length(Vector);
@@ -248,12 +228,11 @@ vec3 SampleProbes(vec3 WorldPosition, vec3 N) {
 
 	WorldPosition += N * 0.4f;
 
-	vec3 SamplePoint = (WorldPosition - u_ProbeBoxOrigin) / u_ProbeBoxSize; 
-	SamplePoint = SamplePoint * 0.5 + 0.5; 
+	int Cascade = GetProbeCascade(WorldPosition);
 
-	if (SamplePoint == clamp(SamplePoint, 0.0f, 1.0f)) {
+	if (Cascade >= 0) {
 		
-		vec3 VolumeCoords = SamplePoint * (u_ProbeGridResolution);
+		vec3 VolumeCoords = GetProbeVolumeCoords(WorldPosition, Cascade);
 		
 		vec3 MinSampleBox = floor(VolumeCoords);
 		vec3 MaxSampleBox = ceil(VolumeCoords);
@@ -273,8 +252,8 @@ vec3 SampleProbes(vec3 WorldPosition, vec3 N) {
 		TexelCoordinates[7] = ivec3(vec3(MaxSampleBox.x, MinSampleBox.y, MaxSampleBox.z));
 
 		for (int i = 0 ; i < 8 ; i++) {
-			sh[i] = GetSH(TexelCoordinates[i]);
-			float ProbeVisibility = GetVisibility(TexelCoordinates[i], WorldPosition, N);
+			sh[i] = GetSH(GetProbeTexel(TexelCoordinates[i], Cascade));
+			float ProbeVisibility = GetVisibility(TexelCoordinates[i], Cascade, WorldPosition, N);
 			Alpha += Trilinear[i] * (1.0f - ProbeVisibility);
 			Trilinear[i] *= ProbeVisibility;
 		}
@@ -537,10 +516,7 @@ void main() {
 
 		else {
 			
-			vec3 SamplePointP = ((HitPosition + iNormal * 0.01f) - u_ProbeBoxOrigin) / u_ProbeBoxSize; 
-			SamplePointP = SamplePointP * 0.5 + 0.5; 
-
-			if (SamplePointP == clamp(SamplePointP, 0.00001f, 0.99999f)) {
+			if (IsInProbeCascades(HitPosition + iNormal * 0.01f)) {
 				const float Strength = 1.0f; 
 
 				vec3 InterpolatedRadiance = SampleProbes(HitPosition + iNormal * 0.01f, iNormal);
@@ -592,8 +568,7 @@ void main() {
 				if (SampleApprox) {
 
 					//Point not in probe range, sample probes approximately 
-					vec3 NudgedPosition = clamp(SamplePointP, 0.0002f, 0.9998f); 
-					NudgedPosition = u_ProbeBoxOrigin + (u_ProbeBoxSize * (2.0f * NudgedPosition - 1.0f));
+					vec3 NudgedPosition = ClampToProbeCascades(HitPosition + iNormal * 0.01f);
 					
 					float DistanceError = distance(NudgedPosition, HitPosition);
 					
@@ -7,13 +7,10 @@ layout (location = 0) out vec4 o_Color;
 uniform sampler2D u_AlbedoData;
 uniform sampler2D u_NormalData;
 
-uniform vec3 u_ViewerPosition;
+#include "Include/CommonUniforms.glsl"
 
 uniform vec2 u_Dimensions;
 
-uniform float u_zNear;
-uniform float u_zFar;
-
 uniform sampler2D u_RefractionData;
 uniform sampler2D u_OpaqueLighting;
 
@@ -16,15 +16,12 @@ uniform float u_GlassFactor;
 
 uniform bool u_Stochastic;
 
-uniform int u_Frame;
-
-uniform vec3 u_ViewerPosition;
+#include "Include/CommonUniforms.glsl"
 
 uniform int u_EntityNumber;
 uniform vec2 u_Dimensions;
 
 uniform bool u_UsesNormalMap;
-uniform float u_Time;
 
 in vec2 v_TexCoords;
 in vec3 v_FragPosition;
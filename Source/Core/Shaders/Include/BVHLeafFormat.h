@@ -0,0 +1,10 @@
+// Shared between the engine and the shaders
+// Leaves of the flattened BVH pack their first triangle and triangle count into one int : (Start << BVH_LEAF_LENGTH_BITS) | Length
+// Inner nodes are flagged with -1, so the start index has 31 - BVH_LEAF_LENGTH_BITS bits (67M triangles)
+
+#define BVH_LEAF_LENGTH_BITS 5
+#define BVH_LEAF_LENGTH_MASK 31 // (1 << BVH_LEAF_LENGTH_BITS) - 1, also the largest leaf
+
+// Comment out to test leaf triangles by fetching their three vertices through the triangle's indices
+// Otherwise the intersector keeps a 48 byte record (vertex 0 and two edges, see Intersectors/Include/BVHTriangle.glsl) per triangle, in leaf order
+#define PRECOMPUTED_TRIANGLES
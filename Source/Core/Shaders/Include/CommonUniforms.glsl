@@ -0,0 +1,35 @@
+// Shared per-frame uniforms, uploaded once per frame (see CommonUniformsUBO and ShadowUniformsUBO in Utility.h)
+// Layouts must match the C++ mirrors exactly 
+
+#ifndef COMMON_UNIFORMS_INCLUDED
+#define COMMON_UNIFORMS_INCLUDED
+
+layout (std140, binding = 0) uniform UBO_CommonUniforms {
+	mat4 u_View;
+	mat4 u_Projection;
+	mat4 u_InverseView;
+	mat4 u_InverseProjection;
+	mat4 u_PrevView;
+	mat4 u_PrevProjection;
+	mat4 u_PrevInverseView;
+	mat4 u_PrevInverseProjection;
+	vec3 u_ViewerPosition;
+	float u_Time;
+	vec3 u_SunDirection;
+	int u_Frame;
+	float u_zNear;
+	float u_zFar;
+};
+
+layout (std140, binding = 1) uniform UBO_ShadowUniforms {
+	mat4 u_ShadowMatrices[5]; // <- shadow matrices 
+	float u_ShadowClipPlanes[5]; // <- world space clip distances 
+};
+
+// Aliases 
+#define u_LightDirection u_SunDirection
+#define u_Incident u_ViewerPosition
+#define u_InversePrevView u_PrevInverseView
+#define u_InversePrevProjection u_PrevInverseProjection
+
+#endif
@@ -0,0 +1,33 @@
+// Decodes the compact vertex format, see Include/VertexFormat.h
+
+vec3 DecodeCompactOctahedron(vec2 coord) {
+
+	coord = 2.0 * coord - 1.0;
+	float y = 1.0 - dot(abs(coord), vec2(1.0));
+
+	// Lower hemisphere
+	if (y < 0.0) {
+		vec2 orig = coord;
+		coord.x = (orig.x >= 0.0 ? 1.0 : -1.0) * (1.0 - abs(orig.y));
+		coord.y = (orig.y >= 0.0 ? 1.0 : -1.0) * (1.0 - abs(orig.x));
+	}
+
+	return normalize(vec3(coord.x, y, coord.y));
+}
+
+vec3 DecodeCompactPosition(uvec4 Data, vec3 DequantizeMin, vec3 DequantizeScale) {
+	vec3 Quantized = vec3(Data.x & 0xFFFFu, Data.x >> 16u, Data.y & 0xFFFFu);
+	return DequantizeMin + Quantized * DequantizeScale;
+}
+
+vec3 DecodeCompactNormal(uvec4 Data) {
+	return DecodeCompactOctahedron(unpackUnorm2x16(Data.z));
+}
+
+vec3 DecodeCompactTangent(uvec4 Data) {
+	return DecodeCompactOctahedron(unpackUnorm4x8(Data.y).zw);
+}
+
+vec2 DecodeCompactTexCoords(uvec4 Data) {
+	return unpackHalf2x16(Data.w);
+}
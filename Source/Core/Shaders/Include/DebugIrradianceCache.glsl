@@ -1,6 +1,4 @@
-uniform vec3 u_ProbeBoxSize;
-uniform vec3 u_ProbeGridResolution;
-uniform vec3 u_ProbeBoxOrigin;
+#include "Include/ProbeCascades.glsl"
 uniform usampler3D u_SHDataA;
 uniform usampler3D u_SHDataB;
 
@@ -25,11 +23,9 @@ SH GetSH(ivec3 Texel) {
 	return UnpackSH(A,B);
 }
 
-float GetVisibility(ivec3 Texel, vec3 WorldPosition, vec3 Normal, SH sh) {
+float GetVisibility(ivec3 Probe, int Cascade, vec3 WorldPosition, vec3 Normal, SH sh) {
 	
-	vec3 TexCoords = vec3(Texel) / u_ProbeGridResolution;
-	vec3 Clip = TexCoords * 2.0f - 1.0f;
-	vec3 ProbePosition = u_ProbeBoxOrigin + Clip * u_ProbeBoxSize;
+	vec3 ProbePosition = GetProbePosition(Probe, Cascade);
 
 	vec3 Vector = ProbePosition - WorldPosition;
 	float Length = length(Vector);
@@ -43,12 +39,11 @@ float GetVisibility(ivec3 Texel, vec3 WorldPosition, vec3 Normal, SH sh) {
 vec3 SampleProbes(vec3 WorldPosition, vec3 N, bool Nudge) {
 
 	WorldPosition += N * 0.4f * float(Nudge);
-	vec3 SamplePoint = (WorldPosition - u_ProbeBoxOrigin) / u_ProbeBoxSize; 
-	SamplePoint = SamplePoint * 0.5 + 0.5; 
+	int Cascade = GetProbeCascade(WorldPosition);
 
-	if (SamplePoint == clamp(SamplePoint, 0.0f, 1.0f)) {
+	if (Cascade >= 0) {
 		
-		vec3 VolumeCoords = SamplePoint * (u_ProbeGridResolution);
+		vec3 VolumeCoords = GetProbeVolumeCoords(WorldPosition, Cascade);
 		
 		vec3 MinSampleBox = floor(VolumeCoords);
 		vec3 MaxSampleBox = ceil(VolumeCoords);
@@ -68,8 +63,8 @@ vec3 SampleProbes(vec3 WorldPosition, vec3 N, bool Nudge) {
 		TexelCoordinates[7] = ivec3(vec3(MaxSampleBox.x, MinSampleBox.y, MaxSampleBox.z));
 
 		for (int i = 0 ; i < 8 ; i++) {
-			sh[i] = GetSH(TexelCoordinates[i]);
-			float ProbeVisibility = GetVisibility(TexelCoordinates[i], WorldPosition, N, sh[i]);
+			sh[i] = GetSH(GetProbeTexel(TexelCoordinates[i], Cascade));
+			float ProbeVisibility = GetVisibility(TexelCoordinates[i], Cascade, WorldPosition, N, sh[i]);
 			Alpha += Trilinear[i] * (1.0f - ProbeVisibility);
 			Trilinear[i] *= ProbeVisibility;
 		}
@@ -90,7 +85,5 @@ vec3 SampleProbes(vec3 WorldPosition, vec3 N, bool Nudge) {
 }
 
 bool IsInProbeGrid(vec3 P) {
-	vec3 SamplePoint = (P - u_ProbeBoxOrigin) / u_ProbeBoxSize; 
-	SamplePoint = SamplePoint * 0.5 + 0.5; 
-	return SamplePoint == clamp(SamplePoint, 0.0f, 1.0f);
+	return IsInProbeCascades(P);
 }
\ No newline at end of file
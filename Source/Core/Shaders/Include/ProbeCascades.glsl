@@ -0,0 +1,83 @@
+// Probe GI clipmap cascades (see ProbeGI.h)
+// Every cascade has the same resolution and covers twice the extent of the previous one
+// Cascades are stacked along z in the probe volumes and addressed toroidally, a probe keeps its texel for as long as it stays inside its cascade
+
+#define MAX_PROBE_CASCADES 4
+
+uniform int u_ProbeCascadeCount;
+uniform vec3 u_ProbeGridResolution; // Per cascade
+uniform vec3 u_ProbeCascadeOrigins[MAX_PROBE_CASCADES];
+uniform vec3 u_ProbeCascadeSizes[MAX_PROBE_CASCADES]; // Half extents
+uniform vec3 u_ProbeCascadeGridMin[MAX_PROBE_CASCADES]; // Integer coordinate of the cascade's first probe on the world probe grid
+
+vec3 GetProbeSpacing(int Cascade) {
+	return (2.0f * u_ProbeCascadeSizes[Cascade]) / u_ProbeGridResolution;
+}
+
+// Continuous probe coordinates of a point, probe i of the cascade sits at i
+vec3 GetProbeVolumeCoords(vec3 WorldPosition, int Cascade) {
+	return ((WorldPosition - u_ProbeCascadeOrigins[Cascade]) / GetProbeSpacing(Cascade)) + (u_ProbeGridResolution * 0.5f);
+}
+
+vec3 GetProbePosition(ivec3 Probe, int Cascade) {
+	return u_ProbeCascadeOrigins[Cascade] + (vec3(Probe) - (u_ProbeGridResolution * 0.5f)) * GetProbeSpacing(Cascade);
+}
+
+// Finest cascade whose probes enclose the point, -1 if it is outside every cascade
+int GetProbeCascade(vec3 WorldPosition) {
+
+	for (int Cascade = 0 ; Cascade < u_ProbeCascadeCount ; Cascade++) {
+
+		vec3 Coords = GetProbeVolumeCoords(WorldPosition, Cascade);
+
+		if (Coords == clamp(Coords, vec3(0.0f), u_ProbeGridResolution - 1.0f)) {
+			return Cascade;
+		}
+	}
+
+	return -1;
+}
+
+// Toroidal texel of a probe in the stacked volume
+ivec3 GetProbeTexel(ivec3 Probe, int Cascade) {
+	ivec3 Resolution = ivec3(u_ProbeGridResolution);
+	ivec3 Texel = (((Probe + ivec3(u_ProbeCascadeGridMin[Cascade])) % Resolution) + Resolution) % Resolution;
+	return Texel + ivec3(0, 0, Cascade * Resolution.z);
+}
+
+// Clamps a point to the bounds of the outermost cascade
+vec3 ClampToProbeCascades(vec3 WorldPosition) {
+	int Cascade = u_ProbeCascadeCount - 1;
+	vec3 Coords = clamp(GetProbeVolumeCoords(WorldPosition, Cascade), vec3(0.0f), u_ProbeGridResolution - 1.0f);
+	return u_ProbeCascadeOrigins[Cascade] + (Coords - (u_ProbeGridResolution * 0.5f)) * GetProbeSpacing(Cascade);
+}
+
+bool IsInProbeCascades(vec3 WorldPosition) {
+	return GetProbeCascade(WorldPosition) >= 0;
+}
+
+// Trilinearly filters a probe radiance volume, hardware filtering can't be used across the toroidal seam
+vec3 SampleProbeRadiance(sampler3D Volume, vec3 WorldPosition) {
+
+	int Cascade = GetProbeCascade(WorldPosition);
+
+	if (Cascade < 0) {
+		return vec3(0.0f);
+	}
+
+	vec3 Coords = GetProbeVolumeCoords(WorldPosition, Cascade);
+	ivec3 Base = ivec3(floor(Coords));
+	vec3 Fraction = Coords - vec3(Base);
+	ivec3 Last = ivec3(u_ProbeGridResolution) - 1;
+
+	vec3 Radiance = vec3(0.0f);
+
+	for (int i = 0 ; i < 8 ; i++) {
+		ivec3 Offset = ivec3(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+		vec3 Weights = mix(1.0f - Fraction, Fraction, vec3(Offset));
+		ivec3 Probe = min(Base + Offset, Last);
+		Radiance += texelFetch(Volume, GetProbeTexel(Probe, Cascade), 0).xyz * (Weights.x * Weights.y * Weights.z);
+	}
+
+	return Radiance;
+}
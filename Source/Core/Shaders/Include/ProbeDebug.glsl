@@ -16,7 +16,7 @@ float Target(vec3 p){
 
 float MapSDF(vec3 p)
 {
-    vec3 GridSpace = u_ProbeGridResolution / u_ProbeBoxSize;
+    vec3 GridSpace = u_ProbeGridResolution / u_ProbeCascadeSizes[0];
     Repeat(p, vec3(GridSpace));
     return SphereSDF(p, 0.15f);
 }
@@ -66,9 +66,9 @@ void DrawProbeSphereGrid(vec3 Origin, vec3 Direction, float SurfaceDistance, ino
 		const bool OutputRaw = false; 
 
 		if (OutputRaw) {
-			vec3 Probe = ((Origin + Direction * Intersection.w) - u_ProbeBoxOrigin) / u_ProbeBoxSize; 
-			Probe = Probe * 0.5 + 0.5;  
-			ivec3 ProbeTexel = ivec3(Probe * u_ProbeGridResolution);
+			vec3 Position = Origin + Direction * Intersection.w;
+			int Cascade = max(GetProbeCascade(Position), 0);
+			ivec3 ProbeTexel = GetProbeTexel(ivec3(round(GetProbeVolumeCoords(Position, Cascade))), Cascade);
 			SH sh = GetSH(ProbeTexel);
 			oColor = SampleSH(sh, Intersection.xyz); 
 		}
@@ -0,0 +1,66 @@
+// Probe update scheduling (see ProbeGI.h)
+// ClassifyProbes.comp sorts every probe into a tier and appends the ones that are due for an update to that tier's list
+// UpdateRadianceProbes.glsl then traces at most u_RayBudget of them, tier by tier
+// Needs Include/ProbeCascades.glsl
+
+#define PROBE_DIRTY 0
+#define PROBE_CONVERGED 1
+#define PROBE_INACTIVE 2
+
+struct ProbeState {
+	float Change; // Running average of the relative change of the probe's irradiance per update
+	float Backface; // Running average of the fraction of rays that hit a backface
+	float NearestHit; // Distance to the closest surface seen (in probe spacings), relaxes slowly
+	uint Packed; // Frames since the last update (low 16 bits), frames left in which the probe is forced dirty (high 16 bits)
+};
+
+layout (std430, binding = 3) buffer SSBO_ProbeStates {
+	ProbeState States[];
+};
+
+layout (std430, binding = 4) buffer SSBO_ProbeSchedule {
+	uint Schedule[]; // One list of probe indices per tier, each with room for every probe
+};
+
+layout (std430, binding = 5) buffer SSBO_ProbeCounters {
+	uint TierCounts[3]; // Probes in each tier
+	uint DueCounts[3]; // Probes appended to each tier's list
+};
+
+// Grid min of every cascade last frame, probes outside of it have just scrolled in and have no history
+uniform vec3 u_ProbeCascadePreviousGridMin[MAX_PROBE_CASCADES];
+
+ivec3 GetProbeVolumeResolution() {
+	ivec3 Resolution = ivec3(u_ProbeGridResolution);
+	return ivec3(Resolution.xy, Resolution.z * u_ProbeCascadeCount);
+}
+
+int GetProbeCount() {
+	ivec3 Resolution = GetProbeVolumeResolution();
+	return Resolution.x * Resolution.y * Resolution.z;
+}
+
+int GetProbeIndex(ivec3 Texel) {
+	ivec3 Resolution = GetProbeVolumeResolution();
+	return (Texel.z * Resolution.x * Resolution.y) + (Texel.y * Resolution.x) + Texel.x;
+}
+
+ivec3 GetProbeTexelFromIndex(int Index) {
+	ivec3 Resolution = GetProbeVolumeResolution();
+	int z = Index / (Resolution.x * Resolution.y);
+	Index -= z * Resolution.x * Resolution.y;
+	return ivec3(Index % Resolution.x, Index / Resolution.x, z);
+}
+
+// Inverse of GetProbeTexel()
+ivec3 GetProbeFromTexel(ivec3 Texel, out int Cascade) {
+	ivec3 Resolution = ivec3(u_ProbeGridResolution);
+	Cascade = Texel.z / Resolution.z;
+	ivec3 CascadeTexel = ivec3(Texel.xy, Texel.z - Cascade * Resolution.z);
+	return (((CascadeTexel - ivec3(u_ProbeCascadeGridMin[Cascade])) % Resolution) + Resolution) % Resolution;
+}
+
+bool WasProbeTracked(ivec3 Probe, int Cascade) {
+	ivec3 Previous = Probe + ivec3(u_ProbeCascadeGridMin[Cascade]) - ivec3(u_ProbeCascadePreviousGridMin[Cascade]);
+	return all(greaterThanEqual(Previous, ivec3(0))) && all(lessThan(Previous, ivec3(u_ProbeGridResolution)));
+}
@@ -0,0 +1,11 @@
+// Shared between the engine and the shaders
+// Uncomment to use the 16 byte quantized vertex format for both the raster vertex buffers and the BVH vertex SSBO
+
+//#define COMPACT_VERTICES
+
+// Compact vertex layout (uvec4) :
+// x : 16 bit x position | 16 bit y position
+// y : 16 bit z position | octahedral tangent (2 x 8 bit)
+// z : octahedral normal (2 x 16 bit)
+// w : half precision texcoords
+// Positions are relative to the bounds of the mesh (raster) or object (BVH), dequantized as Min + Position * Scale
@@ -0,0 +1,50 @@
+// Vertex attributes of a mesh, in either vertex format (see Include/VertexFormat.h)
+
+#include "Include/VertexFormat.h"
+
+#ifdef COMPACT_VERTICES
+
+#include "Include/CompactVertex.glsl"
+
+layout (location = 0) in uvec4 a_CompactData;
+
+// Quantization bounds of the mesh being drawn
+uniform vec3 u_DequantizeMin;
+uniform vec3 u_DequantizeScale;
+
+vec3 GetVertexPosition() {
+	return DecodeCompactPosition(a_CompactData, u_DequantizeMin, u_DequantizeScale);
+}
+
+vec2 GetVertexTexCoords() {
+	return DecodeCompactTexCoords(a_CompactData);
+}
+
+void GetVertexNormalTangent(out vec3 Normal, out vec3 Tangent) {
+	Normal = DecodeCompactNormal(a_CompactData);
+	Tangent = DecodeCompactTangent(a_CompactData);
+}
+
+#else
+
+layout (location = 0) in vec3 a_Position;
+layout (location = 1) in uvec3 a_NormalTangentData;
+layout (location = 2) in uint a_TexCoords;
+
+vec3 GetVertexPosition() {
+	return a_Position;
+}
+
+vec2 GetVertexTexCoords() {
+	return unpackHalf2x16(a_TexCoords);
+}
+
+void GetVertexNormalTangent(out vec3 Normal, out vec3 Tangent) {
+	vec2 Data_0 = unpackHalf2x16(a_NormalTangentData.x);
+	vec2 Data_1 = unpackHalf2x16(a_NormalTangentData.y);
+	vec2 Data_2 = unpackHalf2x16(a_NormalTangentData.z);
+	Normal = vec3(Data_0.x, Data_0.y, Data_1.x);
+	Tangent = vec3(Data_1.y, Data_2.x, Data_2.y);
+}
+
+#endif
@@ -0,0 +1,9 @@
+// 192 bytes, matches Candela::BVHEntity (see BVH/Intersector.h)
+// Data : emissivity, alpha and the entity's vertex quantization bounds (see SetBVHDequantization)
+struct BVHEntity {
+	mat4 ModelMatrix; // 64
+	mat4 InverseMatrix; // 64
+	int NodeOffset;
+	int NodeCount;
+	int Data[14];
+};
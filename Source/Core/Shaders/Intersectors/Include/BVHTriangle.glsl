@@ -0,0 +1,81 @@
+// Leaf triangle access for the intersectors (see PRECOMPUTED_TRIANGLES in Include/BVHLeafFormat.h)
+// Include after the BVHTris and BVHVertices SSBOs
+
+#ifndef SSBO_BINDING_STARTINDEX
+#define SSBO_BINDING_STARTINDEX 0
+#endif
+
+#ifdef PRECOMPUTED_TRIANGLES
+
+// 48 bytes, matches BVH::TriangleIntersectionData
+struct TriangleData {
+	vec4 Vertex0; // W : mesh index (int bits)
+	vec4 Edge1;
+	vec4 Edge2;
+};
+
+layout (std430, binding = (SSBO_BINDING_STARTINDEX + 5)) buffer SSBO_BVHTriangleData {
+	TriangleData BVHTriangleData[];
+};
+
+#endif
+
+// RayTriangle() with the edges passed in, returns T, U, V
+vec3 RayTriangleEdges(in vec3 ro, in vec3 rd, in vec3 v0, in vec3 e1, in vec3 e2)
+{
+	vec3 rov0 = ro - v0;
+
+	vec3  n = cross(e1, e2);
+	vec3  q = cross(rov0, rd);
+	float d = 1.0f / dot(rd, n);
+	float u = d * dot(-q, e2);
+	float v = d * dot( q, e1);
+	float t = d * dot(-n, rov0);
+
+	if(u < 0.0f || v < 0.0f || (u + v) > 1.0f) {
+		t = -1.0;
+	}
+
+	return vec3(t, u, v);
+}
+
+void GetLeafTriangleVertices(in int Index, out vec3 VertexA, out vec3 VertexB, out vec3 VertexC) {
+
+#ifdef PRECOMPUTED_TRIANGLES
+	TriangleData Data = BVHTriangleData[Index];
+	VertexA = Data.Vertex0.xyz;
+	VertexB = Data.Vertex0.xyz + Data.Edge1.xyz;
+	VertexC = Data.Vertex0.xyz + Data.Edge2.xyz;
+#else
+	Triangle triangle = BVHTris[Index];
+	VertexA = BVHVertexPosition(BVHVertices[triangle.PackedData[0]]);
+	VertexB = BVHVertexPosition(BVHVertices[triangle.PackedData[1]]);
+	VertexC = BVHVertexPosition(BVHVertices[triangle.PackedData[2]]);
+#endif
+
+}
+
+// Returns T, U, V
+vec3 IntersectLeafTriangle(in int Index, in vec3 RayOrigin, in vec3 RayDirection) {
+
+#ifdef PRECOMPUTED_TRIANGLES
+	// One record instead of the triangle and its three vertices
+	TriangleData Data = BVHTriangleData[Index];
+	return RayTriangleEdges(RayOrigin, RayDirection, Data.Vertex0.xyz, Data.Edge1.xyz, Data.Edge2.xyz);
+#else
+	vec3 VertexA, VertexB, VertexC;
+	GetLeafTriangleVertices(Index, VertexA, VertexB, VertexC);
+	return RayTriangleEdges(RayOrigin, RayDirection, VertexA, VertexB - VertexA, VertexC - VertexA);
+#endif
+
+}
+
+int GetLeafTriangleMesh(in int Index) {
+
+#ifdef PRECOMPUTED_TRIANGLES
+	return floatBitsToInt(BVHTriangleData[Index].Vertex0.w);
+#else
+	return BVHTris[Index].PackedData[3];
+#endif
+
+}
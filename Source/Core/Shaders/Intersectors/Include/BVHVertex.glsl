@@ -0,0 +1,66 @@
+// BVH vertex layout, in either vertex format (see Include/VertexFormat.h)
+
+#include "Include/VertexFormat.h"
+
+#ifdef COMPACT_VERTICES
+
+#include "Include/CompactVertex.glsl"
+
+// 16 bytes 
+struct Vertex {
+	uvec4 Data; // Quantized position, octahedral normal and tangent, texcoords
+};
+
+#else
+
+// 32 bytes 
+struct Vertex {
+	vec4 Position;
+	uvec4 PackedData; // Packed normal, tangent and texcoords
+};
+
+#endif
+
+// Quantization bounds of the object being traversed, positions are relative to them
+vec3 BVHDequantizeMin = vec3(0.0f);
+vec3 BVHDequantizeScale = vec3(1.0f);
+
+// Call with BVHEntities[i].Data before fetching any vertex of that entity
+void SetBVHDequantization(in int Data[14]) {
+
+#ifdef COMPACT_VERTICES
+	BVHDequantizeMin = intBitsToFloat(ivec3(Data[2], Data[3], Data[4]));
+	BVHDequantizeScale = intBitsToFloat(ivec3(Data[5], Data[6], Data[7]));
+#endif
+
+}
+
+vec3 BVHVertexPosition(in Vertex V) {
+
+#ifdef COMPACT_VERTICES
+	return DecodeCompactPosition(V.Data, BVHDequantizeMin, BVHDequantizeScale);
+#else
+	return V.Position.xyz;
+#endif
+
+}
+
+vec3 BVHVertexNormal(in Vertex V) {
+
+#ifdef COMPACT_VERTICES
+	return DecodeCompactNormal(V.Data);
+#else
+	return vec3(unpackHalf2x16(V.PackedData.x).xy, unpackHalf2x16(V.PackedData.y).x);
+#endif
+
+}
+
+vec2 BVHVertexTexCoords(in Vertex V) {
+
+#ifdef COMPACT_VERTICES
+	return DecodeCompactTexCoords(V.Data);
+#else
+	return unpackHalf2x16(V.PackedData.w);
+#endif
+
+}
@@ -10,11 +10,8 @@ const float INFINITY = 1.0f / 0.0f;
 const float INF = INFINITY;
 const float EPS = 0.001f;
 
-// 32 bytes 
-struct Vertex {
-	vec4 Position;
-	uvec4 PackedData; // Packed normal, tangent and texcoords
-};
+#include "Intersectors/Include/BVHVertex.glsl"
+#include "Include/BVHLeafFormat.h"
 
 // 16 bytes 
 struct Triangle {
@@ -34,13 +31,7 @@ struct Node
     Bounds RightChildData;
 };
 
-struct BVHEntity {
-	mat4 ModelMatrix; // 64
-	mat4 InverseMatrix; // 64
-	int NodeOffset;
-	int NodeCount;
-    int Data[14];
-};
+#include "Intersectors/Include/BVHEntity.glsl"
 
 struct C_AABB {
     vec3 Min;
@@ -64,6 +55,8 @@ layout (std430, binding = (SSBO_BINDING_STARTINDEX + 3)) buffer SSBO_Entities {
 	BVHEntity BVHEntities[];
 };
 
+#include "Intersectors/Include/BVHTriangle.glsl"
+
 float max3(vec3 val) 
 {
     return max(max(val.x, val.y), val.z);
@@ -203,22 +196,17 @@ bool CollideBVH(vec3 CMin, vec3 CMax, in const int NodeStartIndex, in const int
         if (LeftLeaf) {
 
             int Packed = GetStartIdx(CurrentNode.LeftChildData);
-            int StartIdx = Packed >> 4;
+            int StartIdx = Packed >> BVH_LEAF_LENGTH_BITS;
                     
-            int Length = Packed & 0xF;
+            int Length = Packed & BVH_LEAF_LENGTH_MASK;
                     
             for (int Idx = 0; Idx < Length ; Idx++) {
-                Triangle triangle = BVHTris[Idx + StartIdx];
-                
-                const int Offset = 0;
-                        
-                vec3 VertexA = BVHVertices[triangle.PackedData[0] + Offset].Position.xyz;
-                vec3 VertexB = BVHVertices[triangle.PackedData[1] + Offset].Position.xyz;
-                vec3 VertexC = BVHVertices[triangle.PackedData[2] + Offset].Position.xyz;
-                
+                vec3 VertexA, VertexB, VertexC;
+                GetLeafTriangleVertices(Idx + StartIdx, VertexA, VertexB, VertexC);
+
                 if (BoxTriangleOverlap(VertexA, VertexB, VertexC, aabb))
                 {
-                    Mesh = triangle.PackedData[3];
+                    Mesh = GetLeafTriangleMesh(Idx + StartIdx);
                     TriangleIndex = Idx;
                     return true;
                 }
@@ -230,22 +218,17 @@ bool CollideBVH(vec3 CMin, vec3 CMax, in const int NodeStartIndex, in const int
         if (RightLeaf) {
             
             int Packed = GetStartIdx(CurrentNode.RightChildData);
-            int StartIdx = Packed >> 4;
+            int StartIdx = Packed >> BVH_LEAF_LENGTH_BITS;
                     
-            int Length = Packed & 0xF;
+            int Length = Packed & BVH_LEAF_LENGTH_MASK;
                     
             for (int Idx = 0; Idx < Length ; Idx++) {
-                Triangle triangle = BVHTris[Idx + StartIdx];
-                
-                const int Offset = 0;
-                        
-                vec3 VertexA = BVHVertices[triangle.PackedData[0] + Offset].Position.xyz;
-                vec3 VertexB = BVHVertices[triangle.PackedData[1] + Offset].Position.xyz;
-                vec3 VertexC = BVHVertices[triangle.PackedData[2] + Offset].Position.xyz;
-                
+                vec3 VertexA, VertexB, VertexC;
+                GetLeafTriangleVertices(Idx + StartIdx, VertexA, VertexB, VertexC);
+
                 if (BoxTriangleOverlap(VertexA, VertexB, VertexC, aabb))
                 {
-                    Mesh = triangle.PackedData[3];
+                    Mesh = GetLeafTriangleMesh(Idx + StartIdx);
                     TriangleIndex = Idx;
                     return true;
                 }
@@ -308,6 +291,7 @@ bool CollideScene(in const vec3 Min, in const vec3 Max, out int Mesh, out int Tr
 
     for (int i = 0 ; i < u_EntityCount ; i++)
     {
+        SetBVHDequantization(BVHEntities[i].Data);
         bool Collided = CollideBVH(aabb.Min, aabb.Max, BVHEntities[i].NodeOffset, BVHEntities[i].NodeCount, BVHEntities[i].InverseMatrix, Mesh_, Tri_);
 
         if (Collided) {
@@ -7,11 +7,8 @@ const float INFINITY = 1.0f / 0.0f;
 const float INF = INFINITY;
 const float EPS = 0.001f;
 
-// 32 bytes 
-struct Vertex {
-	vec4 Position;
-	uvec4 PackedData; // Packed normal, tangent and texcoords
-};
+#include "Intersectors/Include/BVHVertex.glsl"
+#include "Include/BVHLeafFormat.h"
 
 // 16 bytes 
 struct Triangle {
@@ -23,13 +20,7 @@ struct Node {
     vec4 Max; // W component contains packed leaf data 
 };
 
-struct BVHEntity {
-	mat4 ModelMatrix; // 64
-	mat4 InverseMatrix; // 64
-	int NodeOffset;
-	int NodeCount;
-    int Data[14];
-};
+#include "Intersectors/Include/BVHEntity.glsl"
 
 // SSBOs
 layout (std430, binding = (SSBO_BINDING_STARTINDEX + 0)) buffer SSBO_BVHVertices {
@@ -48,6 +39,8 @@ layout (std430, binding = (SSBO_BINDING_STARTINDEX + 3)) buffer SSBO_Entities {
 	BVHEntity BVHEntities[];
 };
 
+#include "Intersectors/Include/BVHTriangle.glsl"
+
 struct C_AABB {
     vec3 Min;
     vec3 Max;
@@ -163,20 +156,15 @@ bool CollideBVH(vec3 CMin, vec3 CMax, in const int NodeStartIndex, in const int
 
                 int Packed = floatBitsToInt(CurrentNode.Min.w);
                 
-                int Length = Packed & 0xF;
+                int Length = Packed & BVH_LEAF_LENGTH_MASK;
                 
-                for (int Idx = Packed >> 4 ; Idx < (Packed >> 4) + Length ; Idx++) {
-                    Triangle triangle = BVHTris[Idx];
-
-                    const int Offset = 0;
-                    
-                    vec3 VertexA = BVHVertices[triangle.PackedData[0] + Offset].Position.xyz;
-                    vec3 VertexB = BVHVertices[triangle.PackedData[1] + Offset].Position.xyz;
-                    vec3 VertexC = BVHVertices[triangle.PackedData[2] + Offset].Position.xyz;
+                for (int Idx = Packed >> BVH_LEAF_LENGTH_BITS ; Idx < (Packed >> BVH_LEAF_LENGTH_BITS) + Length ; Idx++) {
+                    vec3 VertexA, VertexB, VertexC;
+                    GetLeafTriangleVertices(Idx, VertexA, VertexB, VertexC);
 
                     if (BoxTriangleOverlap(VertexA, VertexB, VertexC, aabb))
                     {
-                        Mesh = triangle.PackedData[3];
+                        Mesh = GetLeafTriangleMesh(Idx);
                         TriangleIndex = Idx;
                         return true;
                     }
@@ -232,6 +220,7 @@ bool CollideScene(in const vec3 Min, in const vec3 Max, out int Mesh, out int Tr
 
     for (int i = 0 ; i < u_EntityCount ; i++)
     {
+        SetBVHDequantization(BVHEntities[i].Data);
         bool Collided = CollideBVH(aabb.Min, aabb.Max, BVHEntities[i].NodeOffset, BVHEntities[i].NodeCount, BVHEntities[i].InverseMatrix, Mesh_, Tri_);
 
         if (Collided) {
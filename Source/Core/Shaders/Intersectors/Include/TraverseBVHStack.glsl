@@ -2,7 +2,6 @@
 
 #extension GL_ARB_bindless_texture : require
 #extension GL_ARB_bindless_texture : enable
-layout(bindless_sampler) uniform sampler2D Textures[512];
 
 uniform int u_EntityCount; 
 uniform int u_TotalNodes;
@@ -11,11 +10,8 @@ const float INFINITY = 1.0f / 0.0f;
 const float INF = INFINITY;
 const float EPS = 0.001f;
 
-// 32 bytes 
-struct Vertex {
-	vec4 Position;
-	uvec4 PackedData; // Packed normal, tangent and texcoords
-};
+#include "Intersectors/Include/BVHVertex.glsl"
+#include "Include/BVHLeafFormat.h"
 
 // 16 bytes 
 struct Triangle {
@@ -35,13 +31,7 @@ struct Node
     Bounds RightChildData;
 };
 
-struct BVHEntity {
-	mat4 ModelMatrix; // 64
-	mat4 InverseMatrix; // 64
-	int NodeOffset;
-	int NodeCount;
-    int Data[14];
-};
+#include "Intersectors/Include/BVHEntity.glsl"
 
 struct TextureReferences {
 	vec4 ModelColor;
@@ -71,6 +61,13 @@ layout (std430, binding = (SSBO_BINDING_STARTINDEX + 4)) buffer SSBO_TextureRefe
     TextureReferences BVHTextureReferences[];
 };
 
+// Bindless handles of every texture the meshes reference, indexed by TextureReferences (uvec2 is the handle's 64 bits)
+layout (std430, binding = (SSBO_BINDING_STARTINDEX + 6)) readonly buffer SSBO_TextureHandles {
+    uvec2 BVHTextureHandles[];
+};
+
+#include "Intersectors/Include/BVHTriangle.glsl"
+
 
 float max3(vec3 val) 
 {
@@ -221,26 +218,18 @@ float IntersectBVHStack(vec3 RayOrigin, vec3 RayDirection, in const int NodeStar
         if (LeftLeaf && IntersectTriangles) {
 
             int Packed = GetStartIdx(CurrentNode.LeftChildData);
-            int StartIdx = Packed >> 4;
+            int StartIdx = Packed >> BVH_LEAF_LENGTH_BITS;
                     
-            int Length = Packed & 0xF;
+            int Length = Packed & BVH_LEAF_LENGTH_MASK;
                     
             for (int Idx = 0; Idx < Length ; Idx++) {
-                Triangle triangle = BVHTris[Idx + StartIdx];
-                
-                const int Offset = 0;
-                        
-                vec3 VertexA = BVHVertices[triangle.PackedData[0] + Offset].Position.xyz;
-                vec3 VertexB = BVHVertices[triangle.PackedData[1] + Offset].Position.xyz;
-                vec3 VertexC = BVHVertices[triangle.PackedData[2] + Offset].Position.xyz;
-                
-                vec3 Intersect = RayTriangle(RayOrigin, RayDirection, VertexA, VertexB, VertexC);
+                vec3 Intersect = IntersectLeafTriangle(Idx + StartIdx, RayOrigin, RayDirection);
                         
                 if (Intersect.x > 0.0f && Intersect.x < TMax)
                 {
                     TMax = Intersect.x;
                     ClosestTraversal = Intersect.x;
-                    IntersectMesh = triangle.PackedData[3];
+                    IntersectMesh = GetLeafTriangleMesh(Idx + StartIdx);
                     IntersectTriangleIdx = Idx + StartIdx;
                 }
             }
@@ -251,26 +240,18 @@ float IntersectBVHStack(vec3 RayOrigin, vec3 RayDirection, in const int NodeStar
         if (RightLeaf && IntersectTriangles) {
              
             int Packed = GetStartIdx(CurrentNode.RightChildData);
-            int StartIdx = Packed >> 4;
+            int StartIdx = Packed >> BVH_LEAF_LENGTH_BITS;
                     
-            int Length = Packed & 0xF;
+            int Length = Packed & BVH_LEAF_LENGTH_MASK;
                     
             for (int Idx = 0; Idx < Length ; Idx++) {
-                Triangle triangle = BVHTris[Idx + StartIdx];
-                
-                const int Offset = 0;
-                        
-                vec3 VertexA = BVHVertices[triangle.PackedData[0] + Offset].Position.xyz;
-                vec3 VertexB = BVHVertices[triangle.PackedData[1] + Offset].Position.xyz;
-                vec3 VertexC = BVHVertices[triangle.PackedData[2] + Offset].Position.xyz;
-                
-                vec3 Intersect = RayTriangle(RayOrigin, RayDirection, VertexA, VertexB, VertexC);
+                vec3 Intersect = IntersectLeafTriangle(Idx + StartIdx, RayOrigin, RayDirection);
                         
                 if (Intersect.x > 0.0f && Intersect.x < TMax)
                 {
                     TMax = Intersect.x;
                     ClosestTraversal = Intersect.x;
-                    IntersectMesh = triangle.PackedData[3];
+                    IntersectMesh = GetLeafTriangleMesh(Idx + StartIdx);
                     IntersectTriangleIdx = Idx + StartIdx;
                 }
             }
@@ -336,6 +317,7 @@ vec4 IntersectScene(vec3 RayOrigin, vec3 RayDirection, out int Mesh, out int Tri
 
     for (int i = 0 ; i < u_EntityCount ; i++)
     {
+        SetBVHDequantization(BVHEntities[i].Data);
         float T = IntersectBVHStack(RayOrigin, RayDirection, BVHEntities[i].NodeOffset, BVHEntities[i].NodeCount, BVHEntities[i].InverseMatrix, TMax, Mesh_, Tri_, Iters);
 
         if (T > 0.0f && T < TMax) {
@@ -350,14 +332,15 @@ vec4 IntersectScene(vec3 RayOrigin, vec3 RayDirection, out int Mesh, out int Tri
 
     if (ClosestT > 0.0f && TriangleIdx > 0) {
 
+         SetBVHDequantization(BVHEntities[Entity_].Data);
          RayOrigin = vec3(BVHEntities[Entity_].InverseMatrix * vec4(RayOrigin.xyz, 1.0f));
          RayDirection = vec3(BVHEntities[Entity_].InverseMatrix * vec4(RayDirection.xyz, 0.0f));
         
          Triangle triangle = BVHTris[TriangleIdx];
          
-         vec3 VertexA = BVHVertices[triangle.PackedData[0]].Position.xyz;
-         vec3 VertexB = BVHVertices[triangle.PackedData[1]].Position.xyz;
-         vec3 VertexC = BVHVertices[triangle.PackedData[2]].Position.xyz;
+         vec3 VertexA = BVHVertexPosition(BVHVertices[triangle.PackedData[0]]);
+         vec3 VertexB = BVHVertexPosition(BVHVertices[triangle.PackedData[1]]);
+         vec3 VertexC = BVHVertexPosition(BVHVertices[triangle.PackedData[2]]);
 
          return vec4(ClosestT, ComputeBarycentrics(RayOrigin + RayDirection * ClosestT, VertexA, VertexB, VertexC));
     }
@@ -383,6 +366,7 @@ vec4 IntersectSceneIgnoreTransparent(vec3 RayOrigin, vec3 RayDirection, out int
             continue;
         }
 
+        SetBVHDequantization(BVHEntities[i].Data);
         float T = IntersectBVHStack(RayOrigin, RayDirection, BVHEntities[i].NodeOffset, BVHEntities[i].NodeCount, BVHEntities[i].InverseMatrix, TMax, Mesh_, Tri_, Iters);
 
         if (T > 0.0f && T < TMax) {
@@ -397,14 +381,15 @@ vec4 IntersectSceneIgnoreTransparent(vec3 RayOrigin, vec3 RayDirection, out int
 
     if (ClosestT > 0.0f && TriangleIdx > 0) {
 
+         SetBVHDequantization(BVHEntities[Entity_].Data);
          RayOrigin = vec3(BVHEntities[Entity_].InverseMatrix * vec4(RayOrigin.xyz, 1.0f));
          RayDirection = vec3(BVHEntities[Entity_].InverseMatrix * vec4(RayDirection.xyz, 0.0f));
         
          Triangle triangle = BVHTris[TriangleIdx];
          
-         vec3 VertexA = BVHVertices[triangle.PackedData[0]].Position.xyz;
-         vec3 VertexB = BVHVertices[triangle.PackedData[1]].Position.xyz;
-         vec3 VertexC = BVHVertices[triangle.PackedData[2]].Position.xyz;
+         vec3 VertexA = BVHVertexPosition(BVHVertices[triangle.PackedData[0]]);
+         vec3 VertexB = BVHVertexPosition(BVHVertices[triangle.PackedData[1]]);
+         vec3 VertexC = BVHVertexPosition(BVHVertices[triangle.PackedData[2]]);
 
          return vec4(ClosestT, ComputeBarycentrics(RayOrigin + RayDirection * ClosestT, VertexA, VertexB, VertexC));
     }
@@ -414,11 +399,6 @@ vec4 IntersectSceneIgnoreTransparent(vec3 RayOrigin, vec3 RayDirection, out int
 
 
 // Closest rays 
-vec3 UnpackNormal(in const uvec2 Packed) {
-    
-    return vec3(unpackHalf2x16(Packed.x).xy, unpackHalf2x16(Packed.y).x);
-}
-
 void GetData(in const vec4 TUVW, in const int Mesh, in const int TriangleIndex, in const int EntityIdx, out vec3 Normal, out vec3 Albedo, out float Emissivity, out float Alpha) {
 
     if (TUVW.x < 0.0f || Mesh < 0) {
@@ -434,8 +414,8 @@ void GetData(in const vec4 TUVW, in const int Mesh, in const int TriangleIndex,
     Vertex B = BVHVertices[triangle.PackedData[1]];
     Vertex C = BVHVertices[triangle.PackedData[2]];
 
-    vec2 UV = (unpackHalf2x16(A.PackedData.w) * TUVW.y) + (unpackHalf2x16(B.PackedData.w) * TUVW.z) + (unpackHalf2x16(C.PackedData.w) * TUVW.w);
-    vec3 MeshNormal = normalize((UnpackNormal(A.PackedData.xy) * TUVW.y) + (UnpackNormal(B.PackedData.xy) * TUVW.z) + (UnpackNormal(C.PackedData.xy) * TUVW.w));
+    vec2 UV = (BVHVertexTexCoords(A) * TUVW.y) + (BVHVertexTexCoords(B) * TUVW.z) + (BVHVertexTexCoords(C) * TUVW.w);
+    vec3 MeshNormal = normalize((BVHVertexNormal(A) * TUVW.y) + (BVHVertexNormal(B) * TUVW.z) + (BVHVertexNormal(C) * TUVW.w));
 
     int Ref = BVHTextureReferences[Mesh].Albedo;
 
@@ -443,7 +423,7 @@ void GetData(in const vec4 TUVW, in const int Mesh, in const int TriangleIndex,
     Albedo = vec3(0.0f);
 
     if (Ref > -1 && Mesh > -1 && TUVW.x > 0.) {
-        Albedo = texture(Textures[Ref], UV.xy).xyz; 
+        Albedo = texture(sampler2D(BVHTextureHandles[Ref]), UV.xy).xyz; 
     }
 
     else {
@@ -560,20 +540,12 @@ float IntersectBVHStackOcclusion(vec3 RayOrigin, vec3 RayDirection, in const int
         if (LeftLeaf && IntersectTriangles) {
 
             int Packed = GetStartIdx(CurrentNode.LeftChildData);
-            int StartIdx = Packed >> 4;
+            int StartIdx = Packed >> BVH_LEAF_LENGTH_BITS;
                     
-            int Length = Packed & 0xF;
+            int Length = Packed & BVH_LEAF_LENGTH_MASK;
                     
             for (int Idx = 0; Idx < Length ; Idx++) {
-                Triangle triangle = BVHTris[Idx + StartIdx];
-                
-                const int Offset = 0;
-                        
-                vec3 VertexA = BVHVertices[triangle.PackedData[0] + Offset].Position.xyz;
-                vec3 VertexB = BVHVertices[triangle.PackedData[1] + Offset].Position.xyz;
-                vec3 VertexC = BVHVertices[triangle.PackedData[2] + Offset].Position.xyz;
-                
-                vec3 Intersect = RayTriangle(RayOrigin, RayDirection, VertexA, VertexB, VertexC);
+                vec3 Intersect = IntersectLeafTriangle(Idx + StartIdx, RayOrigin, RayDirection);
                         
                 if (Intersect.x > 0.0f && Intersect.x < TMax)
                 {
@@ -589,20 +561,12 @@ float IntersectBVHStackOcclusion(vec3 RayOrigin, vec3 RayDirection, in const int
         if (RightLeaf && IntersectTriangles) {
              
             int Packed = GetStartIdx(CurrentNode.RightChildData);
-            int StartIdx = Packed >> 4;
+            int StartIdx = Packed >> BVH_LEAF_LENGTH_BITS;
                     
-            int Length = Packed & 0xF;
+            int Length = Packed & BVH_LEAF_LENGTH_MASK;
                     
             for (int Idx = 0; Idx < Length ; Idx++) {
-                Triangle triangle = BVHTris[Idx + StartIdx];
-                
-                const int Offset = 0;
-                        
-                vec3 VertexA = BVHVertices[triangle.PackedData[0] + Offset].Position.xyz;
-                vec3 VertexB = BVHVertices[triangle.PackedData[1] + Offset].Position.xyz;
-                vec3 VertexC = BVHVertices[triangle.PackedData[2] + Offset].Position.xyz;
-                
-                vec3 Intersect = RayTriangle(RayOrigin, RayDirection, VertexA, VertexB, VertexC);
+                vec3 Intersect = IntersectLeafTriangle(Idx + StartIdx, RayOrigin, RayDirection);
                         
                 if (Intersect.x > 0.0f && Intersect.x < TMax)
                 {
@@ -664,6 +628,7 @@ float IntersectSceneOcclusion(vec3 RayOrigin, vec3 RayDirection) {
 
     for (int i = 0 ; i < u_EntityCount ; i++)
     {
+        SetBVHDequantization(BVHEntities[i].Data);
         float T = IntersectBVHStackOcclusion(RayOrigin, RayDirection, BVHEntities[i].NodeOffset, BVHEntities[i].NodeCount, BVHEntities[i].InverseMatrix, TMax);
 
         if (T > 0.0f) {
@@ -3,8 +3,6 @@
 #extension GL_ARB_bindless_texture : require
 #extension GL_ARB_bindless_texture : enable
 
-layout(bindless_sampler) uniform sampler2D Textures[512];
-
 uniform int u_EntityCount; 
 uniform int u_TotalNodes;
 
@@ -12,11 +10,8 @@ const float INFINITY = 1.0f / 0.0f;
 const float INF = INFINITY;
 const float EPS = 0.001f;
 
-// 32 bytes 
-struct Vertex {
-	vec4 Position;
-	uvec4 PackedData; // Packed normal, tangent and texcoords
-};
+#include "Intersectors/Include/BVHVertex.glsl"
+#include "Include/BVHLeafFormat.h"
 
 // 16 bytes 
 struct Triangle {
@@ -28,13 +23,7 @@ struct Node {
     vec4 Max; // W component contains packed leaf data 
 };
 
-struct BVHEntity {
-	mat4 ModelMatrix; // 64
-	mat4 InverseMatrix; // 64
-	int NodeOffset;
-	int NodeCount;
-    int Data[14];
-};
+#include "Intersectors/Include/BVHEntity.glsl"
 
 struct TextureReferences {
 	vec4 ModelColor;
@@ -64,6 +53,13 @@ layout (std430, binding = (SSBO_BINDING_STARTINDEX + 4)) buffer SSBO_TextureRefe
     TextureReferences BVHTextureReferences[];
 };
 
+// Bindless handles of every texture the meshes reference, indexed by TextureReferences (uvec2 is the handle's 64 bits)
+layout (std430, binding = (SSBO_BINDING_STARTINDEX + 6)) readonly buffer SSBO_TextureHandles {
+    uvec2 BVHTextureHandles[];
+};
+
+#include "Intersectors/Include/BVHTriangle.glsl"
+
 float max3(vec3 val) 
 {
     return max(max(val.x, val.y), val.z);
@@ -210,24 +206,16 @@ float IntersectBVHStackless(vec3 RayOrigin, vec3 RayDirection, in const int Node
 
                 int Packed = floatBitsToInt(CurrentNode.Min.w);
                 
-                int Length = Packed & 0xF;
+                int Length = Packed & BVH_LEAF_LENGTH_MASK;
                 
-                for (int Idx = Packed >> 4 ; Idx < (Packed >> 4) + Length ; Idx++) {
-                    Triangle triangle = BVHTris[Idx];
-
-                    const int Offset = 0;
-                    
-                    vec3 VertexA = BVHVertices[triangle.PackedData[0] + Offset].Position.xyz;
-                    vec3 VertexB = BVHVertices[triangle.PackedData[1] + Offset].Position.xyz;
-                    vec3 VertexC = BVHVertices[triangle.PackedData[2] + Offset].Position.xyz;
-
-                    vec3 Intersect = RayTriangle(RayOrigin, RayDirection, VertexA, VertexB, VertexC);
+                for (int Idx = Packed >> BVH_LEAF_LENGTH_BITS ; Idx < (Packed >> BVH_LEAF_LENGTH_BITS) + Length ; Idx++) {
+                    vec3 Intersect = IntersectLeafTriangle(Idx, RayOrigin, RayDirection);
                     
                     if (Intersect.x > 0.0f && Intersect.x < TMax)
                     {
                         TMax = Intersect.x;
                         ClosestTraversal = Intersect.x;
-                        Mesh = triangle.PackedData[3];
+                        Mesh = GetLeafTriangleMesh(Idx);
                         TriangleIndex = Idx;
                     }
                 }
@@ -289,6 +277,7 @@ vec4 IntersectScene(vec3 RayOrigin, vec3 RayDirection, out int Mesh, out int Tri
 
     for (int i = 0 ; i < u_EntityCount ; i++)
     {
+        SetBVHDequantization(BVHEntities[i].Data);
         float T = IntersectBVHStackless(RayOrigin, RayDirection, BVHEntities[i].NodeOffset, BVHEntities[i].NodeCount, BVHEntities[i].InverseMatrix, TMax, Mesh_, Tri_, Iters);
 
         if (T > 0.0f && T < TMax) {
@@ -303,14 +292,15 @@ vec4 IntersectScene(vec3 RayOrigin, vec3 RayDirection, out int Mesh, out int Tri
 
     if (ClosestT > 0.0f && TriangleIdx > 0) {
 
+         SetBVHDequantization(BVHEntities[Entity_].Data);
          RayOrigin = vec3(BVHEntities[Entity_].InverseMatrix * vec4(RayOrigin.xyz, 1.0f));
          RayDirection = vec3(BVHEntities[Entity_].InverseMatrix * vec4(RayDirection.xyz, 0.0f));
         
          Triangle triangle = BVHTris[TriangleIdx];
          
-         vec3 VertexA = BVHVertices[triangle.PackedData[0]].Position.xyz;
-         vec3 VertexB = BVHVertices[triangle.PackedData[1]].Position.xyz;
-         vec3 VertexC = BVHVertices[triangle.PackedData[2]].Position.xyz;
+         vec3 VertexA = BVHVertexPosition(BVHVertices[triangle.PackedData[0]]);
+         vec3 VertexB = BVHVertexPosition(BVHVertices[triangle.PackedData[1]]);
+         vec3 VertexC = BVHVertexPosition(BVHVertices[triangle.PackedData[2]]);
 
          return vec4(ClosestT, ComputeBarycentrics(RayOrigin + RayDirection * ClosestT, VertexA, VertexB, VertexC));
     }
@@ -336,6 +326,7 @@ vec4 IntersectSceneIgnoreTransparent(vec3 RayOrigin, vec3 RayDirection, out int
             continue;
         }
 
+        SetBVHDequantization(BVHEntities[i].Data);
         float T = IntersectBVHStackless(RayOrigin, RayDirection, BVHEntities[i].NodeOffset, BVHEntities[i].NodeCount, BVHEntities[i].InverseMatrix, TMax, Mesh_, Tri_, Iters);
 
         if (T > 0.0f && T < TMax) {
@@ -350,14 +341,15 @@ vec4 IntersectSceneIgnoreTransparent(vec3 RayOrigin, vec3 RayDirection, out int
 
     if (ClosestT > 0.0f && TriangleIdx > 0) {
 
+         SetBVHDequantization(BVHEntities[Entity_].Data);
          RayOrigin = vec3(BVHEntities[Entity_].InverseMatrix * vec4(RayOrigin.xyz, 1.0f));
          RayDirection = vec3(BVHEntities[Entity_].InverseMatrix * vec4(RayDirection.xyz, 0.0f));
         
          Triangle triangle = BVHTris[TriangleIdx];
          
-         vec3 VertexA = BVHVertices[triangle.PackedData[0]].Position.xyz;
-         vec3 VertexB = BVHVertices[triangle.PackedData[1]].Position.xyz;
-         vec3 VertexC = BVHVertices[triangle.PackedData[2]].Position.xyz;
+         vec3 VertexA = BVHVertexPosition(BVHVertices[triangle.PackedData[0]]);
+         vec3 VertexB = BVHVertexPosition(BVHVertices[triangle.PackedData[1]]);
+         vec3 VertexC = BVHVertexPosition(BVHVertices[triangle.PackedData[2]]);
 
          return vec4(ClosestT, ComputeBarycentrics(RayOrigin + RayDirection * ClosestT, VertexA, VertexB, VertexC));
     }
@@ -367,11 +359,6 @@ vec4 IntersectSceneIgnoreTransparent(vec3 RayOrigin, vec3 RayDirection, out int
 
 
 // Closest rays 
-vec3 UnpackNormal(in const uvec2 Packed) {
-    
-    return vec3(unpackHalf2x16(Packed.x).xy, unpackHalf2x16(Packed.y).x);
-}
-
 void GetData(in const vec4 TUVW, in const int Mesh, in const int TriangleIndex, in const int EntityIdx, out vec3 Normal, out vec3 Albedo, out float Emissivity, out float Alpha) {
 
     if (TUVW.x < 0.0f || Mesh < 0) {
@@ -387,8 +374,8 @@ void GetData(in const vec4 TUVW, in const int Mesh, in const int TriangleIndex,
     Vertex B = BVHVertices[triangle.PackedData[1]];
     Vertex C = BVHVertices[triangle.PackedData[2]];
 
-    vec2 UV = (unpackHalf2x16(A.PackedData.w) * TUVW.y) + (unpackHalf2x16(B.PackedData.w) * TUVW.z) + (unpackHalf2x16(C.PackedData.w) * TUVW.w);
-    vec3 MeshNormal = normalize((UnpackNormal(A.PackedData.xy) * TUVW.y) + (UnpackNormal(B.PackedData.xy) * TUVW.z) + (UnpackNormal(C.PackedData.xy) * TUVW.w));
+    vec2 UV = (BVHVertexTexCoords(A) * TUVW.y) + (BVHVertexTexCoords(B) * TUVW.z) + (BVHVertexTexCoords(C) * TUVW.w);
+    vec3 MeshNormal = normalize((BVHVertexNormal(A) * TUVW.y) + (BVHVertexNormal(B) * TUVW.z) + (BVHVertexNormal(C) * TUVW.w));
 
     int Ref = BVHTextureReferences[Mesh].Albedo;
 
@@ -396,7 +383,7 @@ void GetData(in const vec4 TUVW, in const int Mesh, in const int TriangleIndex,
     Albedo = vec3(0.0f);
 
     if (Ref > -1 && Mesh > -1 && TUVW.x > 0.) {
-        Albedo = texture(Textures[Ref], UV.xy).xyz; 
+        Albedo = texture(sampler2D(BVHTextureHandles[Ref]), UV.xy).xyz; 
     }
 
     else {
@@ -494,18 +481,10 @@ float IntersectBVHStacklessOcclusion(vec3 RayOrigin, vec3 RayDirection, in const
 
                 int Packed = floatBitsToInt(CurrentNode.Min.w);
                 
-                int Length = Packed & 0xF;
+                int Length = Packed & BVH_LEAF_LENGTH_MASK;
                 
-                for (int Idx = Packed >> 4 ; Idx < (Packed >> 4) + Length ; Idx++) {
-                    Triangle triangle = BVHTris[Idx];
-
-                    const int Offset = 0;
-                    
-                    vec3 VertexA = BVHVertices[triangle.PackedData[0] + Offset].Position.xyz;
-                    vec3 VertexB = BVHVertices[triangle.PackedData[1] + Offset].Position.xyz;
-                    vec3 VertexC = BVHVertices[triangle.PackedData[2] + Offset].Position.xyz;
-
-                    vec3 Intersect = RayTriangle(RayOrigin, RayDirection, VertexA, VertexB, VertexC);
+                for (int Idx = Packed >> BVH_LEAF_LENGTH_BITS ; Idx < (Packed >> BVH_LEAF_LENGTH_BITS) + Length ; Idx++) {
+                    vec3 Intersect = IntersectLeafTriangle(Idx, RayOrigin, RayDirection);
                     
                     if (Intersect.x > 0.0f && Intersect.x < TMax)
                     {
@@ -563,6 +542,7 @@ float IntersectScene(vec3 RayOrigin, vec3 RayDirection) {
 
     for (int i = 0 ; i < u_EntityCount ; i++)
     {
+        SetBVHDequantization(BVHEntities[i].Data);
         float Traversal = IntersectBVHStacklessOcclusion(RayOrigin, RayDirection, BVHEntities[i].NodeOffset, BVHEntities[i].NodeCount, BVHEntities[i].InverseMatrix, TMax);
 
         if (Traversal > 0.) {
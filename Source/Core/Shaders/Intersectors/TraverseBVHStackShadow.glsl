@@ -20,15 +20,12 @@ const float INFINITY = 1.0f / 0.0f;
 const float INF = INFINITY;
 const float EPS = 0.001f;
 
-// 32 bytes 
-struct Vertex {
-	vec4 Position;
-	uvec4 PackedData; // Packed normal, tangent and texcoords
-};
+#include "Intersectors/Include/BVHVertex.glsl"
+#include "Include/BVHLeafFormat.h"
 
 // 16 bytes 
 struct Triangle {
-    int Packed[4]; // Contains packed data 
+    int PackedData[4]; // Contains packed data 
 };
 
 // W Component contains packed data
@@ -44,13 +41,7 @@ struct Node
     Bounds RightChildData;
 };
 
-struct BVHEntity {
-	mat4 ModelMatrix; // 64
-	mat4 InverseMatrix; // 64
-	int NodeOffset;
-	int NodeCount;
-    int Padding[14];
-};
+#include "Intersectors/Include/BVHEntity.glsl"
 
 struct TextureReferences {
     int Albedo;
@@ -78,6 +69,8 @@ layout (std430, binding = 4) buffer SSBO_TextureReferences {
     TextureReferences BVHTextureReferences[];
 };
 
+#include "Intersectors/Include/BVHTriangle.glsl"
+
 
 float max3(vec3 val) 
 {
@@ -232,20 +225,12 @@ float IntersectBVHStack(vec3 RayOrigin, vec3 RayDirection, in const int NodeStar
         if (LeftLeaf && IntersectTriangles) {
 
             int Packed = GetStartIdx(CurrentNode.LeftChildData);
-            int StartIdx = Packed >> 4;
+            int StartIdx = Packed >> BVH_LEAF_LENGTH_BITS;
                     
-            int Length = Packed & 0xF;
+            int Length = Packed & BVH_LEAF_LENGTH_MASK;
                     
             for (int Idx = 0; Idx < Length ; Idx++) {
-                Triangle triangle = BVHTris[Idx + StartIdx];
-                
-                const int Offset = 0;
-                        
-                vec3 VertexA = BVHVertices[triangle.Packed[0] + Offset].Position.xyz;
-                vec3 VertexB = BVHVertices[triangle.Packed[1] + Offset].Position.xyz;
-                vec3 VertexC = BVHVertices[triangle.Packed[2] + Offset].Position.xyz;
-                
-                vec3 Intersect = RayTriangle(RayOrigin, RayDirection, VertexA, VertexB, VertexC);
+                vec3 Intersect = IntersectLeafTriangle(Idx + StartIdx, RayOrigin, RayDirection);
                         
                 if (Intersect.x > 0.0f && Intersect.x < TMax)
                 {
@@ -260,20 +245,12 @@ float IntersectBVHStack(vec3 RayOrigin, vec3 RayDirection, in const int NodeStar
         if (RightLeaf && IntersectTriangles) {
              
             int Packed = GetStartIdx(CurrentNode.RightChildData);
-            int StartIdx = Packed >> 4;
+            int StartIdx = Packed >> BVH_LEAF_LENGTH_BITS;
                     
-            int Length = Packed & 0xF;
+            int Length = Packed & BVH_LEAF_LENGTH_MASK;
                     
             for (int Idx = 0; Idx < Length ; Idx++) {
-                Triangle triangle = BVHTris[Idx + StartIdx];
-                
-                const int Offset = 0;
-                        
-                vec3 VertexA = BVHVertices[triangle.Packed[0] + Offset].Position.xyz;
-                vec3 VertexB = BVHVertices[triangle.Packed[1] + Offset].Position.xyz;
-                vec3 VertexC = BVHVertices[triangle.Packed[2] + Offset].Position.xyz;
-                
-                vec3 Intersect = RayTriangle(RayOrigin, RayDirection, VertexA, VertexB, VertexC);
+                vec3 Intersect = IntersectLeafTriangle(Idx + StartIdx, RayOrigin, RayDirection);
                         
                 if (Intersect.x > 0.0f && Intersect.x < TMax)
                 {
@@ -334,6 +311,7 @@ float IntersectScene(vec3 RayOrigin, vec3 RayDirection) {
 
     for (int i = 0 ; i < u_EntityCount ; i++)
     {
+        SetBVHDequantization(BVHEntities[i].Data);
         float Intersect = IntersectBVHStack(RayOrigin, RayDirection, BVHEntities[i].NodeOffset, BVHEntities[i].NodeCount, BVHEntities[i].InverseMatrix, TMax);
 
         if (Intersect > 0.0f && Intersect < TMax) {
@@ -1,4 +1,4 @@
-#version 330 core
+#version 420 core
 
 #include "Include/Utility.glsl"
 
@@ -9,12 +9,7 @@ in vec2 v_TexCoords;
 
 uniform sampler2D u_Depth;
 
-uniform mat4 u_InverseView;
-uniform mat4 u_InverseProjection;
-uniform mat4 u_Projection;
-uniform mat4 u_View;
-uniform mat4 u_PrevProjection;
-uniform mat4 u_PrevView;
+#include "Include/CommonUniforms.glsl"
 
 vec3 WorldPosFromDepth(float depth, vec2 txc)
 {
@@ -1,8 +1,6 @@
 #version 430 core
 
-layout (location = 0) in vec3 a_Position;
-layout (location = 1) in uvec3 a_NormalTangentData;
-layout (location = 2) in uint a_TexCoords;
+#include "Include/VertexInput.glsl"
 
 uniform mat4 u_ModelMatrix;
 uniform mat3 u_NormalMatrix;
@@ -16,15 +14,12 @@ uniform mat4 u_ViewProjection;
 
 void main()
 {
-	gl_Position = u_ModelMatrix * vec4(a_Position, 1.0f);
+	gl_Position = u_ModelMatrix * vec4(GetVertexPosition(), 1.0f);
 	v_FragPosition = gl_Position.xyz;
 	gl_Position = u_ViewProjection * gl_Position;
-	v_TexCoords = unpackHalf2x16(a_TexCoords);
-	vec2 Data_0 = unpackHalf2x16(a_NormalTangentData.x);
-	vec2 Data_1 = unpackHalf2x16(a_NormalTangentData.y);
-	vec2 Data_2 = unpackHalf2x16(a_NormalTangentData.z);
-	vec3 Normal = vec3(Data_0.x, Data_0.y, Data_1.x);
-	vec3 Tangent = vec3(Data_1.y, Data_2.x, Data_2.y);
+	v_TexCoords = GetVertexTexCoords();
+	vec3 Normal, Tangent;
+	GetVertexNormalTangent(Normal, Tangent);
 
 	v_Normal = mat3(u_NormalMatrix) * Normal;  
 
@@ -1,4 +1,4 @@
-#version 330 core 
+#version 420 core 
 
 layout (location = 0) out vec3 o_Output;
 
@@ -8,18 +8,10 @@ uniform sampler2D u_Depth;
 uniform sampler2D u_RefractDepth;
 uniform sampler2D u_Normals;
 
-uniform float u_zNear;
-uniform float u_zFar;
+#include "Include/CommonUniforms.glsl"
 
-uniform mat4 u_Projection;
-uniform mat4 u_View;
-uniform mat4 u_InverseProjection;
-uniform mat4 u_InverseView;
 uniform mat4 u_ViewProjection;
 
-uniform float u_Time;
-uniform int u_Frame;
-
 uniform bool u_HQ;
 
 
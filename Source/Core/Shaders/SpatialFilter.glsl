@@ -26,22 +26,13 @@ uniform bool u_FilterVolumetrics;
 
 uniform sampler2D u_Variance; // <- Diffuse variance 
 
-uniform mat4 u_Projection;
-uniform mat4 u_View;
-uniform mat4 u_InverseView;
-uniform mat4 u_InverseProjection;
-
-uniform float u_zNear;
-uniform float u_zFar;
+#include "Include/CommonUniforms.glsl"
 
 uniform float u_SpecularBeta;
 
-uniform vec3 u_ViewerPosition;
-
 uniform int u_StepSize;
 uniform float u_SqrtStepSize;
 uniform sampler2D u_FrameCounters;
-uniform float u_Time;
 
 uniform int u_Pass;
 
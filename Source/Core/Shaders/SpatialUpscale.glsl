@@ -1,4 +1,4 @@
-#version 330 core
+#version 420 core
 
 #include "Include/Utility.glsl"
 #include "Include/SpatialUtility.glsl"
@@ -18,17 +18,7 @@ uniform sampler2D u_Diffuse;
 uniform sampler2D u_Specular;
 uniform sampler2D u_Volumetrics;
 
-uniform mat4 u_Projection;
-uniform mat4 u_View;
-uniform mat4 u_InverseView;
-uniform mat4 u_InverseProjection;
-
-uniform float u_zNear;
-uniform float u_zFar;
-
-uniform float u_Time;
-
-uniform vec3 u_ViewerPosition;
+#include "Include/CommonUniforms.glsl"
 
 uniform bool u_Enabled;
 
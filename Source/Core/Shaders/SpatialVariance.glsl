@@ -1,4 +1,4 @@
-#version 330 core 
+#version 420 core 
 
 #include "Include/Utility.glsl"
 #include "Include/SpatialUtility.glsl"
@@ -14,8 +14,7 @@ uniform sampler2D u_FrameCounters;
 
 uniform sampler2D u_TemporalMoments;
 
-uniform float u_zNear;
-uniform float u_zFar;
+#include "Include/CommonUniforms.glsl"
 
 uniform bool u_Enabled;
 
@@ -21,36 +21,22 @@ uniform sampler2D u_LFNormals;
 uniform sampler2D u_PBR;
 uniform sampler2D u_Albedo; 
 
-uniform float u_Time;
-uniform int u_Frame;
+#include "Include/CommonUniforms.glsl"
 
 uniform vec2 u_Dimensions; 
 
-uniform mat4 u_Projection;
-uniform mat4 u_View;
-uniform mat4 u_InverseProjection;
-uniform mat4 u_InverseView;
 uniform mat4 u_ViewProjection;
 
-uniform vec3 u_SunDirection;
-
-uniform float u_zNear;
-uniform float u_zFar;
-
 uniform sampler2D u_IndirectDiffuse;
 uniform sampler2D u_MotionVectors;
 
 uniform sampler2D u_BlueNoise;
 
-uniform mat4 u_ShadowMatrices[5]; // <- shadow matrices 
 uniform sampler2D u_ShadowTextures[5]; // <- the shadowmaps themselves 
-uniform float u_ShadowClipPlanes[5]; // <- world space clip distances 
 
 uniform samplerCube u_SkyCube;
 
-uniform vec3 u_ProbeBoxSize;
-uniform vec3 u_ProbeGridResolution;
-uniform vec3 u_ProbeBoxOrigin;
+#include "Include/ProbeCascades.glsl"
 
 uniform usampler3D u_SHDataA;
 uniform usampler3D u_SHDataB;
@@ -327,11 +313,9 @@ SH GetSH(ivec3 Texel) {
 }
 
 // Visibility weight 
-float GetVisibility(ivec3 Texel, vec3 WorldPosition, vec3 Normal) {
+float GetVisibility(ivec3 Probe, int Cascade, vec3 WorldPosition, vec3 Normal) {
 	
-	vec3 TexCoords = vec3(Texel) / u_ProbeGridResolution;
-	vec3 Clip = TexCoords * 2.0f - 1.0f;
-	vec3 ProbePosition = u_ProbeBoxOrigin + Clip * u_ProbeBoxSize;
+	vec3 ProbePosition = GetProbePosition(Probe, Cascade);
 
 	vec3 Vector = ProbePosition - WorldPosition;
 	float Length = length(Vector);
@@ -346,12 +330,11 @@ vec3 SampleProbes(vec3 WorldPosition, vec3 N) {
 
 	WorldPosition += N * 0.05f;
 
-	vec3 SamplePoint = (WorldPosition - u_ProbeBoxOrigin) / u_ProbeBoxSize; 
-	SamplePoint = SamplePoint * 0.5 + 0.5; 
+	int Cascade = GetProbeCascade(WorldPosition);
 
-	if (SamplePoint == clamp(SamplePoint, 0.0f, 1.0f)) {
+	if (Cascade >= 0) {
 		
-		vec3 VolumeCoords = SamplePoint * (u_ProbeGridResolution);
+		vec3 VolumeCoords = GetProbeVolumeCoords(WorldPosition, Cascade);
 		
 		vec3 MinSampleBox = floor(VolumeCoords);
 		vec3 MaxSampleBox = ceil(VolumeCoords);
@@ -371,8 +354,8 @@ vec3 SampleProbes(vec3 WorldPosition, vec3 N) {
 		TexelCoordinates[7] = ivec3(vec3(MaxSampleBox.x, MinSampleBox.y, MaxSampleBox.z));
 
 		for (int i = 0 ; i < 8 ; i++) {
-			sh[i] = GetSH(TexelCoordinates[i]);
-			float ProbeVisibility = GetVisibility(TexelCoordinates[i], WorldPosition, N);
+			sh[i] = GetSH(GetProbeTexel(TexelCoordinates[i], Cascade));
+			float ProbeVisibility = GetVisibility(TexelCoordinates[i], Cascade, WorldPosition, N);
 			Alpha += Trilinear[i] * (1.0f - ProbeVisibility);
 			Trilinear[i] *= ProbeVisibility;
 		}
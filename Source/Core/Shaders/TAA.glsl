@@ -1,4 +1,4 @@
-#version 400 core
+#version 420 core
 
 #include "Include/Utility.glsl"
 #include "Include/SpatialUtility.glsl"
@@ -20,17 +20,7 @@ uniform vec2 u_CurrentJitter;
 uniform bool u_TAAU;
 uniform float u_TAAUConfidenceExponent;
 
-uniform mat4 u_InverseView;
-uniform mat4 u_InverseProjection;
-uniform mat4 u_Projection;
-uniform mat4 u_View;
-uniform mat4 u_PrevProjection;
-uniform mat4 u_PrevView;
-uniform mat4 u_PrevInverseProjection;
-uniform mat4 u_PrevInverseView;
-
-uniform float u_zNear;
-uniform float u_zFar;
+#include "Include/CommonUniforms.glsl"
 
 uniform float u_TAAStrengthMultiplier;
 uniform float u_TAAClipBias;
@@ -40,8 +30,6 @@ uniform float u_InternalRenderResolution;
 uniform bool u_Enabled;
 uniform bool u_FSRU;
 
-uniform vec3 u_ViewerPosition;
-
 float ScaleMultiplier = 1.0f;
 
 float LinearizeDepth(float depth)
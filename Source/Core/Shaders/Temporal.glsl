@@ -1,4 +1,4 @@
-#version 330 core 
+#version 420 core 
 
 #include "Include/Utility.glsl"
 #include "Include/SpatialUtility.glsl"
@@ -12,14 +12,7 @@ layout (location = 4) out vec4 o_Volumetrics;
 
 in vec2 v_TexCoords;
 
-uniform mat4 u_InverseView;
-uniform mat4 u_InverseProjection;
-uniform mat4 u_Projection;
-uniform mat4 u_View;
-uniform mat4 u_PrevProjection;
-uniform mat4 u_PrevView;
-uniform mat4 u_PrevInverseProjection;
-uniform mat4 u_PrevInverseView;
+#include "Include/CommonUniforms.glsl"
 
 uniform sampler2D u_DiffuseCurrent;
 uniform sampler2D u_DiffuseHistory;
@@ -43,11 +36,6 @@ uniform sampler2D u_MomentsHistory;
 
 uniform sampler2D u_PBR;
 
-uniform float u_zNear;
-uniform float u_zFar;
-
-uniform vec3 u_ViewerPosition;
-
 uniform bool u_DoVolumetrics;
 
 uniform bool u_Enabled;
@@ -16,14 +16,11 @@ uniform vec3 u_ModelColor;
 
 uniform float u_Transparency;
 
-uniform vec3 u_ViewerPosition;
+#include "Include/CommonUniforms.glsl"
 
 uniform int u_EntityNumber;
 uniform vec2 u_Dimensions;
 
-uniform float u_zNear;
-uniform float u_zFar;
-
 uniform sampler2D u_RefractionData;
 uniform sampler2D u_OpaqueLighting;
 
@@ -9,7 +9,7 @@
 #include "Include/Utility.glsl"
 #include "Include/ColorConstants.h"
 
-layout(local_size_x = 8, local_size_y = 4, local_size_z = 8) in;
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
 
 layout(rgba32ui, binding = 0) uniform uimage3D o_SHOutputA; // 2 normalized floats in each channel, 8 normalized floats in a single texture 
 layout(rgba32ui, binding = 1) uniform uimage3D o_SHOutputB;
@@ -23,25 +23,20 @@ layout(rgba32ui, binding = 5) uniform readonly uimage3D u_PrevFrameSHB;
 // Reproject lighting to voxel volume to get an approximate voxel representation of the scene
 ///layout(rgba16f, binding = 8) uniform image3D o_VoxelVolume; 
 
-uniform vec3 u_BoxOrigin;
-uniform vec3 u_Resolution;
-uniform vec3 u_Size;
+#include "Include/ProbeCascades.glsl"
+#include "Include/ProbeScheduling.glsl"
 
-uniform mat4 u_ShadowMatrices[5]; // <- shadow matrices 
-uniform sampler2D u_ShadowTextures[5]; // <- the shadowmaps themselves 
-uniform float u_ShadowClipPlanes[5]; // <- world space clip distances 
+uniform int u_RayBudget;
 
-uniform vec3 u_SunDirection;
-uniform float u_Time;
-
-uniform vec3 u_PreviousOrigin;
+#include "Include/CommonUniforms.glsl"
+layout(binding = 8) uniform sampler2D u_ShadowTextures[5]; // <- the shadowmaps themselves 
 
 uniform bool u_Temporal;
 
-uniform usampler3D u_PreviousSHA;
-uniform usampler3D u_PreviousSHB;
+layout(binding = 5) uniform usampler3D u_PreviousSHA;
+layout(binding = 6) uniform usampler3D u_PreviousSHB;
 
-uniform samplerCube u_Skymap;
+layout(binding = 4) uniform samplerCube u_Skymap;
 
 uniform vec3 u_VoxelRange;
 uniform vec3 u_VoxelRes;
@@ -173,11 +168,9 @@ SH GetSH(ivec3 Texel) {
 	return UnpackSH(A,B);
 }
 
-float GetVisibility(ivec3 Texel, vec3 WorldPosition, vec3 Normal) {
+float GetVisibility(ivec3 Probe, int Cascade, vec3 WorldPosition, vec3 Normal) {
 
-	vec3 TexCoords = vec3(Texel) / u_Resolution;
-	vec3 Clip = TexCoords * 2.0f - 1.0f;
-	vec3 ProbePosition = u_PreviousOrigin + Clip * u_Size;
+	vec3 ProbePosition = GetProbePosition(Probe, Cascade);
 
 	vec3 Vector = ProbePosition - WorldPosition;
 	float Length = length(Vector);
@@ -191,12 +184,11 @@ vec3 SampleProbes(vec3 WorldPosition, vec3 N) {
 
 	WorldPosition += N * 0.45f;
 
-	vec3 SamplePoint = (WorldPosition - u_PreviousOrigin) / u_Size; 
-	SamplePoint = SamplePoint * 0.5 + 0.5; 
+	int Cascade = GetProbeCascade(WorldPosition);
 
-	if (SamplePoint == clamp(SamplePoint, 0.0f, 1.0f)) {
+	if (Cascade >= 0) {
 		
-		vec3 VolumeCoords = SamplePoint * (u_Resolution);
+		vec3 VolumeCoords = GetProbeVolumeCoords(WorldPosition, Cascade);
 		
 		vec3 MinSampleBox = floor(VolumeCoords);
 		vec3 MaxSampleBox = ceil(VolumeCoords);
@@ -216,8 +208,8 @@ vec3 SampleProbes(vec3 WorldPosition, vec3 N) {
 		TexelCoordinates[7] = ivec3(vec3(MaxSampleBox.x, MinSampleBox.y, MaxSampleBox.z));
 
 		for (int i = 0 ; i < 8 ; i++) {
-			sh[i] = GetSH(TexelCoordinates[i]);
-			float ProbeVisibility = GetVisibility(TexelCoordinates[i], WorldPosition, N);
+			sh[i] = GetSH(GetProbeTexel(TexelCoordinates[i], Cascade));
+			float ProbeVisibility = WasProbeTracked(TexelCoordinates[i], Cascade) ? GetVisibility(TexelCoordinates[i], Cascade, WorldPosition, N) : 0.0f;
 			Alpha += Trilinear[i] * (1.0f - ProbeVisibility);
 			Trilinear[i] *= ProbeVisibility;
 		}
@@ -241,18 +233,17 @@ vec3 SampleProbes(vec3 WorldPosition, vec3 N, out vec3 Min, out vec3 Max) {
 
 	WorldPosition += N * 0.45f;
 
-	vec3 SamplePoint = (WorldPosition - u_PreviousOrigin) / u_Size; 
-	SamplePoint = SamplePoint * 0.5 + 0.5; 
+	int Cascade = GetProbeCascade(WorldPosition);
 
 	vec3 MinB = vec3(-1000.0f);
 	vec3 MaxB = vec3(1000.0f);
 
-	if (SamplePoint == clamp(SamplePoint, 0.0f, 1.0f)) {
+	if (Cascade >= 0) {
 		
 		MinB *= -1.0f;
 		MaxB *= -1.0f;
 
-		vec3 VolumeCoords = SamplePoint * (u_Resolution);
+		vec3 VolumeCoords = GetProbeVolumeCoords(WorldPosition, Cascade);
 		
 		vec3 MinSampleBox = floor(VolumeCoords);
 		vec3 MaxSampleBox = ceil(VolumeCoords);
@@ -272,11 +263,11 @@ vec3 SampleProbes(vec3 WorldPosition, vec3 N, out vec3 Min, out vec3 Max) {
 		TexelCoordinates[7] = ivec3(vec3(MaxSampleBox.x, MinSampleBox.y, MaxSampleBox.z));
 
 		for (int i = 0 ; i < 8 ; i++) {
-			sh[i] = GetSH(TexelCoordinates[i]);
+			sh[i] = GetSH(GetProbeTexel(TexelCoordinates[i], Cascade));
 			vec3 Radiosity = SampleSH(sh[i]);
 			MinB = min(MinB, Radiosity);
 			MaxB = max(MaxB, Radiosity);
-			float ProbeVisibility = GetVisibility(TexelCoordinates[i], WorldPosition, N);
+			float ProbeVisibility = WasProbeTracked(TexelCoordinates[i], Cascade) ? GetVisibility(TexelCoordinates[i], Cascade, WorldPosition, N) : 0.0f;
 			Alpha += Trilinear[i] * (1.0f - ProbeVisibility);
 			Trilinear[i] *= ProbeVisibility;
 		}
@@ -295,23 +286,6 @@ vec3 SampleProbes(vec3 WorldPosition, vec3 N, out vec3 Min, out vec3 Max) {
 	return vec3(0.0f);
 }
 
-vec4 Reproject(vec3 WorldPosition) {
-
-	vec3 SamplePoint = (WorldPosition - u_PreviousOrigin) / u_Size; 
-	SamplePoint = SamplePoint * 0.5 + 0.5;
-	
-	if (SamplePoint.x > 0.0f && SamplePoint.x < 1.0f &&
-		SamplePoint.y > 0.0f && SamplePoint.y < 1.0f &&
-		SamplePoint.z > 0.0f && SamplePoint.z < 1.0f) {
-	
-		SamplePoint *= u_Resolution;
-		SamplePoint = SamplePoint + 0.5f;
-		return vec4(SamplePoint, 5.0f);
-	}
-
-	return vec4(-10.0f);
-}
-
 vec3 SampleCone(vec2 Xi, float CosThetaMax) 
 {
     float CosTheta = (1.0f - Xi.x) + Xi.x * CosThetaMax;
@@ -405,24 +379,63 @@ vec3 ImportanceSample(int PixelStartOffset) {
 	return LambertSample;
 }
 
+// Picks the probe an invocation traces, tiers are filled in order (dirty, converged, inactive)
+// A tier that doesn't fit in what is left of the budget is walked round robin over the frames
+bool GetScheduledProbe(int Invocation, out int Index) {
+
+	int Taken = 0;
+
+	for (int Tier = 0 ; Tier < 3 ; Tier++) {
+
+		int Due = int(DueCounts[Tier]);
+		int Available = max(u_RayBudget - Taken, 0);
+		int Slot = Invocation - Taken;
+
+		if (Slot < min(Due, Available)) {
+			
+			if (Due > Available) {
+				Slot = int((uint(Slot) + uint(u_Frame) * uint(Available)) % uint(Due)); // Wraps harmlessly
+			}
+
+			Index = int(Schedule[Tier * GetProbeCount() + Slot]);
+			return true;
+		}
+
+		Taken += min(Due, Available);
+	}
+
+	Index = -1;
+	return false;
+}
+
 void main() {
 
-	ivec3 Pixel = ivec3(gl_GlobalInvocationID.xyz);
+	int ProbeIndex;
+
+	if (!GetScheduledProbe(int(gl_GlobalInvocationID.x), ProbeIndex)) {
+		return;
+	}
+
+	ivec3 Pixel = GetProbeTexelFromIndex(ProbeIndex);
 
-	vec3 TexCoords = vec3(Pixel) / u_Resolution;
+	// Cascades are stacked along z
+	ivec3 VolumeResolution = GetProbeVolumeResolution();
+
+	int Cascade;
+	ivec3 Probe = GetProbeFromTexel(Pixel, Cascade);
+
+	vec3 TexCoords = vec3(Pixel) / vec3(VolumeResolution);
 
     HASH2SEED = ((TexCoords.x * TexCoords.y * TexCoords.z) * 128.0 * u_Time) + (TexCoords.z * TexCoords.y); hash2();
 
-	vec3 Clip = TexCoords * 2.0f - 1.0f;
-	vec3 RayOrigin = u_BoxOrigin + Clip * u_Size;
+	vec3 RayOrigin = GetProbePosition(Probe, Cascade);
 	const int PerProbePixelCount = 8 * 8;
-	int ProbeMapPixelStartOffset = (Get1DIdx(Pixel,ivec3(u_Resolution)) * PerProbePixelCount);
-
-	vec3 Unjittered = RayOrigin;
+	int ProbeMapPixelStartOffset = (Get1DIdx(Pixel, VolumeResolution) * PerProbePixelCount);
 
 	//RayOrigin += vec3(hash2(), hash2().x) * 0.125f;
 
-	vec4 Reprojected = Reproject(Unjittered);
+	// A probe keeps its texel while it stays inside its cascade, so its history is at the same texel
+	bool Tracked = WasProbeTracked(Probe, Cascade);
 
 	vec3 DiffuseDirection = ImportanceSample(ProbeMapPixelStartOffset);
     
@@ -437,7 +450,9 @@ void main() {
 	
 	IntersectRay(RayOrigin, DiffuseDirection, TUVW, IntersectedMesh, IntersectedTri, Albedo, iNormal);
 
-	if (dot(iNormal, DiffuseDirection) > 0.0001f) {
+	bool Backface = dot(iNormal, DiffuseDirection) > 0.0001f;
+
+	if (Backface) {
 		iNormal = -iNormal;
 	}
 
@@ -479,13 +494,14 @@ void main() {
 
 	// Succcessful reprojection
 	int AccumulatedFrames = 0;
+	float Change = 1.0f;
 
-	if (Reprojected.w > 0.01f)
+	if (Tracked)
 	{
 		SH PreviousSH; 
 
-		uvec4 A = texelFetch(u_PreviousSHA, ivec3(Reprojected.xyz), 0);
-		uvec4 B = texelFetch(u_PreviousSHB, ivec3(Reprojected.xyz), 0);
+		uvec4 A = texelFetch(u_PreviousSHA, Pixel, 0);
+		uvec4 B = texelFetch(u_PreviousSHB, Pixel, 0);
 
 		AccumulatedFrames = int(B.w) + 1;
 
@@ -501,7 +517,12 @@ void main() {
 		FinalSH.L11 = mix(FinalSH.L11, PreviousSH.L11, TemporalAlpha);
 		FinalSH.L10 = mix(FinalSH.L10, PreviousSH.L10, TemporalAlpha);
 		FinalSH.L1_1 = mix(FinalSH.L1_1, PreviousSH.L1_1, TemporalAlpha);
-		FinalRadiance = mix(FinalRadiance, imageLoad(u_PrevRaw,ivec3(Reprojected.xyz)).xyz, TemporalAlpha);
+
+		// Relative change of the irradiance estimate, drives convergence
+		float PreviousLuminance = dot(PreviousSH.L00, vec3(0.2126f, 0.7152f, 0.0722f));
+		float Luminance = dot(FinalSH.L00, vec3(0.2126f, 0.7152f, 0.0722f));
+		Change = AccumulatedFrames > 1 ? abs(Luminance - PreviousLuminance) / max(PreviousLuminance, 0.001f) : 1.0f;
+		FinalRadiance = mix(FinalRadiance, imageLoad(u_PrevRaw, Pixel).xyz, TemporalAlpha);
 	}
 
 	else {
@@ -517,6 +538,17 @@ void main() {
 	imageStore(o_SHOutputA, Pixel, PackedA);
 	imageStore(o_SHOutputB, Pixel, PackedB);
 	imageStore(o_CurrentRaw, Pixel, vec4(FinalRadiance,0.));
+
+	// Update classification state
+	vec3 Spacing = GetProbeSpacing(Cascade);
+	float HitDistance = TUVW.x < 0.0f ? 256.0f : TUVW.x / max(Spacing.x, max(Spacing.y, Spacing.z));
+
+	ProbeState State = States[ProbeIndex];
+	State.Change = mix(State.Change, Change, 0.1f);
+	State.Backface = mix(State.Backface, float(Backface && TUVW.x > 0.0f), 0.05f);
+	State.NearestHit = min(State.NearestHit + 0.05f, HitDistance);
+	State.Packed &= 0xFFFF0000u; // Resets the frames since the last update
+	States[ProbeIndex] = State;
 }
 
 
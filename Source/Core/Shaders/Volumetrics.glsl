@@ -1,4 +1,4 @@
-#version 400 core 
+#version 420 core 
 #define PI 3.14159265359 
 
 #include "Include/Utility.glsl"
@@ -11,22 +11,15 @@ layout (location = 0) out vec4 o_Volumetrics; // w -> Transmittance
 
 in vec2 v_TexCoords;
 
-uniform mat4 u_InverseView;
-uniform mat4 u_InverseProjection;
-uniform mat4 u_Projection;
-uniform mat4 u_View;
+#include "Include/CommonUniforms.glsl"
 
 uniform vec2 u_Dims;
-uniform vec3 u_SunDirection;
 
 uniform sampler2D u_DepthTexture;
 uniform sampler2D u_TransparentDepth;
 uniform sampler2D u_NormalTexture;
 uniform samplerCube u_Skymap;
 
-uniform int u_Frame;
-uniform float u_Time;
-
 uniform bool u_UniformDensity;
 uniform bool u_CompleteTransmittance;
 
@@ -35,13 +28,9 @@ uniform float u_Strength;
 uniform float u_DStrength;
 uniform float u_IStrength;
 
-uniform mat4 u_ShadowMatrices[5]; // <- shadow matrices 
 uniform sampler2D u_ShadowTextures[5]; // <- the shadowmaps themselves 
-uniform float u_ShadowClipPlanes[5]; // <- world space clip distances 
 
-uniform vec3 u_ProbeBoxSize;
-uniform vec3 u_ProbeGridResolution;
-uniform vec3 u_ProbeBoxOrigin;
+#include "Include/ProbeCascades.glsl"
 
 uniform sampler3D u_ProbeRadiance;
 
@@ -188,14 +177,7 @@ vec3 GetVolumeGI(vec3 Point, vec3 Hash3D) {
 
 	Point += Hash3D * 2.0f - 1.0f;
 	
-	vec3 SamplePoint = (Point - u_ProbeBoxOrigin) / u_ProbeBoxSize; 
-	SamplePoint = SamplePoint * 0.5 + 0.5; 
-
-	if (SamplePoint == clamp(SamplePoint, 0.0001f, 0.9999f)) {
-		return texture(u_ProbeRadiance, SamplePoint).xyz;
-	}
-
-	return vec3(0.0f);
+	return SampleProbeRadiance(u_ProbeRadiance, Point);
 }
 
 vec3 Incident(vec2 screenspace)
@@ -3,6 +3,9 @@
 static int Resolution = 1024;
 const float CascadeDistances[5] = { 6.0f, 12.0f, 18.0f, 36.0f, 72.0f };
 
+// Coarsest LOD the 384x384 sky shadow maps start at
+#define SKY_SHADOW_MIN_LOD 2
+
 static std::vector<Candela::Shadowmap> Shadowmaps;
 static glm::mat4 ProjectionMatrices[5];
 static glm::mat4 ViewMatrices[5];
@@ -10,6 +13,36 @@ static float ClipPlanes[5];
 
 static float ShadowDistanceMult = 1.0f;
 
+// Static shadow caching
+struct CascadeCache {
+	glm::mat4 ViewProjection = glm::mat4(0.0f);
+	uint32_t StaticVersion = 0;
+	int DynamicCasters = 0; // Dynamic casters inside the light box at the last composite
+	bool Valid = false;
+	bool NeedsComposite = false;
+};
+
+static bool StaticCaching = true;
+static std::vector<Candela::Shadowmap> StaticShadowmaps;
+static CascadeCache Cache[5];
+static glm::vec3 CachedDirection;
+static bool CachedLODEnabled = true;
+static float CachedLODThreshold = 0.0f;
+static int StaticRefreshes = 0;
+
+static std::vector<Candela::Entity*> StaticEntities;
+static std::vector<Candela::Entity*> DynamicEntities;
+static Candela::DrawList StaticCasters;
+static Candela::DrawList DynamicCasters;
+static std::vector<uint32_t> DynamicVisible;
+
+static void InvalidateCascadeCache()
+{
+	for (int i = 0; i < 5; i++) {
+		Cache[i].Valid = false;
+	}
+}
+
 // Sky shadowmaps! 
 static glm::vec3 SkyShadowmapDirections[SKY_SHADOWMAP_COUNT];
 static Candela::Shadowmap SkyShadowingMaps[SKY_SHADOWMAP_COUNT];
@@ -23,11 +56,16 @@ void Candela::ShadowHandler::SetDirectShadowMapRes(int r)
 		Resolution = r;
 		Shadowmaps.clear();
         Shadowmaps.resize(5);
+		StaticShadowmaps.clear();
+		StaticShadowmaps.resize(5);
 
 		for (int i = 0; i < 5; i++) {
 			Shadowmaps[i].Create(Resolution, Resolution);
+			StaticShadowmaps[i].Create(Resolution, Resolution);
 		}
 
+		InvalidateCascadeCache();
+
 	}
 }
 
@@ -35,9 +73,11 @@ void Candela::ShadowHandler::GenerateShadowMaps()
 {
 	ShadowRenderer::Initialize();
 	Shadowmaps.resize(5);
+	StaticShadowmaps.resize(5);
 
 	for (int i = 0; i < 5; i++) {
 		Shadowmaps[i].Create(Resolution, Resolution);
+		StaticShadowmaps[i].Create(Resolution, Resolution);
 	}
 
 	for (int i = 0; i < SKY_SHADOWMAP_COUNT; i++) {
@@ -52,7 +92,7 @@ void Candela::ShadowHandler::GenerateShadowMaps()
 	}
 }
 
-void Candela::ShadowHandler::UpdateDirectShadowMaps(int Frame, const glm::vec3& Origin, const glm::vec3& Direction, const std::vector<Entity*> Entities, float DistanceMultiplier, int UpdateRate)
+int Candela::ShadowHandler::UpdateDirectShadowMaps(int Frame, const glm::vec3& Origin, const glm::vec3& Direction, const std::vector<Entity*> Entities, float DistanceMultiplier, int UpdateRate, const Frustum* ReceiverFrustum)
 {
 	ShadowDistanceMult = DistanceMultiplier;
 		
@@ -82,10 +122,111 @@ void Candela::ShadowHandler::UpdateDirectShadowMaps(int Frame, const glm::vec3&
 
 	int id = UpdateList[Frame % 8];
 
-	ShadowRenderer::RenderShadowMap(Shadowmaps[id], Origin, Direction, Entities, CascadeDistances[id] * DistanceMultiplier, ProjectionMatrices[id], ViewMatrices[id]);
+	if (!StaticCaching) {
+		return ShadowRenderer::RenderShadowMap(Shadowmaps[id], Origin, Direction, Entities, CascadeDistances[id] * DistanceMultiplier, ProjectionMatrices[id], ViewMatrices[id], ReceiverFrustum);
+	}
+
+	// The static layers were drawn with the old LOD selection
+	if (LOD::IsEnabled() != CachedLODEnabled || LOD::GetThreshold() != CachedLODThreshold) {
+		CachedLODEnabled = LOD::IsEnabled();
+		CachedLODThreshold = LOD::GetThreshold();
+		InvalidateCascadeCache();
+	}
+
+	// Split the casters 
+	StaticEntities.clear();
+	DynamicEntities.clear();
+
+	for (auto& e : Entities) {
+		(e->m_IsDynamic || e->m_IsPhysicsObject ? DynamicEntities : StaticEntities).push_back(e);
+	}
+
+	StaticCasters.Update(StaticEntities);
+	DynamicCasters.Update(DynamicEntities);
+
+	glm::vec3 SunDirection = glm::normalize(Direction);
+	CachedDirection = SunDirection;
+
+	glm::mat4 Projection, View;
+	ShadowRenderer::GenerateShadowMatrices(Origin, SunDirection, Projection, View, CascadeDistances[id] * DistanceMultiplier);
+
+	CascadeCache& Cascade = Cache[id];
+	glm::mat4 ViewProjection = Projection * View;
+
+	if (Cascade.Valid && Cascade.StaticVersion == StaticCasters.GetVersion() && ViewProjection == Cascade.ViewProjection) {
+		return 0;
+	}
+
+	// Static layer is out of date, re-render it and composite the dynamic layer this frame
+	int DrawCalls = ShadowRenderer::RenderCasters(StaticShadowmaps[id], StaticCasters, Projection, View, true);
+
+	ProjectionMatrices[id] = Projection;
+	ViewMatrices[id] = View;
+
+	Cascade.ViewProjection = ViewProjection;
+	Cascade.StaticVersion = StaticCasters.GetVersion();
+	Cascade.Valid = true;
+	Cascade.NeedsComposite = true;
+
+	StaticRefreshes++;
+
+	return DrawCalls;
+}
+
+int Candela::ShadowHandler::CompositeDynamicShadowMaps(const Frustum* ReceiverFrustum)
+{
+	if (!StaticCaching) {
+		return 0;
+	}
+
+	int DrawCalls = 0;
+
+	for (int i = 0; i < 5; i++) {
+
+		if (!Cache[i].Valid) {
+			continue;
+		}
+
+		// Only cascades with a dynamic caster in their light box (or one that just left it) are recomposited
+		Frustum LightFrustum;
+		LightFrustum.FromMatrix(ProjectionMatrices[i] * ViewMatrices[i]);
+		DynamicCasters.Cull(LightFrustum, DynamicVisible);
+
+		int Count = (int)DynamicVisible.size();
+
+		if (!Cache[i].NeedsComposite && Count == 0 && Cache[i].DynamicCasters == 0) {
+			continue;
+		}
+
+		Shadowmaps[i].CopyFrom(StaticShadowmaps[i]);
+
+		if (Count > 0) {
+			DrawCalls += ShadowRenderer::RenderCasters(Shadowmaps[i], DynamicCasters, ProjectionMatrices[i], ViewMatrices[i], false, ReceiverFrustum, CachedDirection * CascadeDistances[i] * ShadowDistanceMult * 2.0f);
+		}
+
+		Cache[i].DynamicCasters = Count;
+		Cache[i].NeedsComposite = false;
+	}
+
+	return DrawCalls;
+}
+
+void Candela::ShadowHandler::SetStaticShadowCaching(bool enabled)
+{
+	if (enabled != StaticCaching) {
+		StaticCaching = enabled;
+		InvalidateCascadeCache();
+	}
+}
+
+int Candela::ShadowHandler::GetStaticCascadeRefreshes()
+{
+	int Refreshes = StaticRefreshes;
+	StaticRefreshes = 0;
+	return Refreshes;
 }
 
-void Candela::ShadowHandler::UpdateSkyShadowMaps(int Frame, const glm::vec3& Origin, const std::vector<Entity*> Entities)
+int Candela::ShadowHandler::UpdateSkyShadowMaps(int Frame, const glm::vec3& Origin, const std::vector<Entity*> Entities)
 {
 	if (Frame % 16 == 0) {
 		std::cout << "\Sky map rendered";
@@ -94,8 +235,9 @@ void Candela::ShadowHandler::UpdateSkyShadowMaps(int Frame, const glm::vec3& Ori
 	int id = Frame % 32;
 	float Distance = 64.0f;
 	glm::vec3 Direction = SkyShadowmapDirections[id];
-	ShadowRenderer::RenderShadowMap(SkyShadowingMaps[id], Origin, Direction, Entities, 
-									Distance, SkyProjectionMatrices[id], SkyViewMatrices[id]);
+	// Sky maps are tiny, full resolution geometry is wasted on them
+	return ShadowRenderer::RenderShadowMap(SkyShadowingMaps[id], Origin, Direction, Entities, 
+									Distance, SkyProjectionMatrices[id], SkyViewMatrices[id], nullptr, SKY_SHADOW_MIN_LOD);
 }
 
 GLuint Candela::ShadowHandler::GetDirectShadowmap(int n)
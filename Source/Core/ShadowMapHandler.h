@@ -15,10 +15,19 @@ namespace Candela {
 
 		void GenerateShadowMaps();
 		
-		void UpdateDirectShadowMaps(int Frame, const glm::vec3& Origin, const glm::vec3& Direction, const std::vector<Entity*> Entities, float DistanceMultiplier, int);
+		// Each cascade keeps a cached depth layer of the static entities, only re-rendered (on the cascade's turn in the update schedule)
+		// when the sun direction, the snapped cascade origin, the LOD settings or a static entity changes. Dynamic entities are composited on top, only in the
+		// cascades whose light box they overlap.
+		// Both return the number of draw calls issued
+		int UpdateDirectShadowMaps(int Frame, const glm::vec3& Origin, const glm::vec3& Direction, const std::vector<Entity*> Entities, float DistanceMultiplier, int, const Frustum* ReceiverFrustum = nullptr);
 		GLuint GetDirectShadowmap(int n);
 
-		void UpdateSkyShadowMaps(int Frame, const glm::vec3& Origin, const std::vector<Entity*> Entities);
+		int CompositeDynamicShadowMaps(const Frustum* ReceiverFrustum = nullptr);
+
+		void SetStaticShadowCaching(bool enabled);
+		int GetStaticCascadeRefreshes(); // Refreshes since the last call
+
+		int UpdateSkyShadowMaps(int Frame, const glm::vec3& Origin, const std::vector<Entity*> Entities);
 		GLuint GetSkyShadowmap(int n);
 		const Candela::Shadowmap& GetSkyShadowmapRef(int n);
 
@@ -4,6 +4,7 @@
 #include <iostream>
 
 #include "Macros.h"
+#include "DrawList.h"
 
 extern int __TotalMeshesRendered;
 
@@ -11,6 +12,9 @@ namespace Candela
 {
 	namespace ShadowRenderer {
 
+		static DrawList ShadowDrawList;
+		static std::vector<uint32_t> ShadowVisible;
+
 		void PrintVec3(std::string s, glm::vec3 x)
 		{
 		}
@@ -118,58 +122,97 @@ namespace Candela
 			
 		}
 
-		void RenderShadowMap(Shadowmap& Shadowmap, const glm::vec3& Origin, glm::vec3 SunDirection, const std::vector<Entity*>& Entities, float Distance, glm::mat4& Projection, glm::mat4& View)
+		int RenderCasters(Shadowmap& Shadowmap, const DrawList& Casters, const glm::mat4& Projection, const glm::mat4& View, bool Clear, const Frustum* ReceiverFrustum, const glm::vec3& Sweep, int MinLOD)
 		{
-			glm::mat4 LightProjectionMatrix;
-			glm::mat4 LightViewMatrix;
-
-			SunDirection = glm::normalize(SunDirection);
-			GenerateShadowMatrices(Origin, SunDirection, LightProjectionMatrix, LightViewMatrix, Distance);
-
 			GLClasses::Shader& shader = ShaderManager::GetShader("DEPTH");
 
 			glEnable(GL_DEPTH_TEST);
 
 			shader.Use();
 			Shadowmap.Bind();
-			glClear(GL_DEPTH_BUFFER_BIT);
 
-			shader.SetMatrix4("u_ViewProjection", LightProjectionMatrix * LightViewMatrix);
+			if (Clear) {
+				glClear(GL_DEPTH_BUFFER_BIT);
+			}
+
+			shader.SetMatrix4("u_ViewProjection", Projection * View);
+
+			// Cull against the orthographic light box
+			Frustum LightFrustum;
+			LightFrustum.FromMatrix(Projection * View);
+
+			Casters.Cull(LightFrustum, ShadowVisible);
 
-			for (auto& entity : Entities)
+			// Caster-receiver culling
+			if (ReceiverFrustum) {
+				Casters.CullSwept(*ReceiverFrustum, Sweep, ShadowVisible);
+			}
+
+			// Orthographic, so the LOD only depends on the size of the light box
+			LOD::ViewInfo LODView = LOD::CreateView(Projection, glm::vec3(0.0f), MinLOD);
+
+			const std::vector<DrawCommand>& Commands = Casters.GetCommands();
+			const Entity* CurrentEntity = nullptr;
+			int DrawCalls = 0;
+
+			for (uint32_t Index : ShadowVisible)
 			{
-				shader.SetMatrix4("u_ModelMatrix", entity->m_Model);
+				const DrawCommand& Command = Commands[Index];
+
+				if (CurrentEntity != Command.EntityPtr) {
+					CurrentEntity = Command.EntityPtr;
+					shader.SetMatrix4("u_ModelMatrix", CurrentEntity->m_Model);
+				}
+
+				__TotalMeshesRendered++;
+				const Mesh* mesh = Command.MeshPtr;
 
-				int DrawCalls = 0;
-				Object* object = entity->m_Object;
+#ifdef COMPACT_VERTICES
+				shader.SetVector3f("u_DequantizeMin", mesh->m_DequantizeMin);
+				shader.SetVector3f("u_DequantizeScale", mesh->m_DequantizeScale);
+#endif
 
-				for (auto& e : object->m_Meshes)
+				const GLClasses::VertexArray& VAO = mesh->m_VertexArray;
+				VAO.Bind();
+
+				if (mesh->m_Indexed)
 				{
-					__TotalMeshesRendered++;
-					const Mesh* mesh = &e;
-					const GLClasses::VertexArray& VAO = mesh->m_VertexArray;
-					VAO.Bind();
-
-					if (mesh->m_Indexed)
-					{
-						DrawCalls++;
-						glDrawElements(GL_TRIANGLES, mesh->m_IndicesCount, GL_UNSIGNED_INT, 0);
+					int Level = LOD::Select(*mesh, CurrentEntity->m_Model, LODView);
+
+					DrawCalls++;
+
+					if (Level > 0) {
+						glDrawElements(GL_TRIANGLES, mesh->m_LODs[Level].IndexCount, GL_UNSIGNED_INT, (const void*)(uintptr_t(mesh->m_LODs[Level].FirstIndex) * sizeof(GLuint)));
 					}
 
-					else
-					{
-						DrawCalls++;
-						glDrawArrays(GL_TRIANGLES, 0, mesh->m_VertexCount);
+					else {
+						glDrawElements(GL_TRIANGLES, mesh->m_IndicesCount, GL_UNSIGNED_INT, 0);
 					}
+				}
 
-					VAO.Unbind();
+				else
+				{
+					DrawCalls++;
+					glDrawArrays(GL_TRIANGLES, 0, mesh->m_VertexCount);
 				}
+
+				VAO.Unbind();
 			}
 
 			Shadowmap.Unbind();
 
-			Projection = LightProjectionMatrix;
-			View = LightViewMatrix;
+			return DrawCalls;
+		}
+
+		int RenderShadowMap(Shadowmap& Shadowmap, const glm::vec3& Origin, glm::vec3 SunDirection, const std::vector<Entity*>& Entities, float Distance, glm::mat4& Projection, glm::mat4& View, const Frustum* ReceiverFrustum, int MinLOD)
+		{
+			SunDirection = glm::normalize(SunDirection);
+			GenerateShadowMatrices(Origin, SunDirection, Projection, View, Distance);
+
+			ShadowDrawList.Update(Entities);
+
+			// A caster's shadow extends along the light direction at most across the cascade
+			return RenderCasters(Shadowmap, ShadowDrawList, Projection, View, true, ReceiverFrustum, SunDirection * Distance * 2.0f, MinLOD);
 		}
 
 	}
@@ -13,6 +13,8 @@
 #include "Entity.h"
 
 #include "Shadowmap.h"
+#include "Frustum.h"
+#include "DrawList.h"
 
 #include "MathsHelpers.h"
 
@@ -21,6 +23,18 @@
 namespace Candela {
 	namespace ShadowRenderer {
 		void Initialize();
-		void RenderShadowMap(Shadowmap& Shadowmap, const glm::vec3& Origin, glm::vec3 SunDirection, const std::vector<Entity*>& Entities, float Distance, glm::mat4&, glm::mat4&);
+
+		// Light space matrices of a cascade, the box is snapped to whole units around the origin
+		void GenerateShadowMatrices(const glm::vec3& Origin, const glm::vec3& SunDirection, glm::mat4& Projection, glm::mat4& View, float Distance);
+
+		// Draws the commands of a draw list into a shadow map, culled against the light space box
+		// If a receiver frustum is given, casters whose bounds swept along the sweep vector miss it are culled too
+		// Mesh LODs are picked by their projected error in the light box, MinLOD forces coarser ones
+		// Returns the number of draw calls
+		int RenderCasters(Shadowmap& Shadowmap, const DrawList& Casters, const glm::mat4& Projection, const glm::mat4& View, bool Clear, const Frustum* ReceiverFrustum = nullptr, const glm::vec3& Sweep = glm::vec3(0.0f), int MinLOD = 0);
+
+		// Meshes are culled against the light space box, if a receiver frustum is given casters whose shadow can't reach it are culled too
+		// Returns the number of draw calls
+		int RenderShadowMap(Shadowmap& Shadowmap, const glm::vec3& Origin, glm::vec3 SunDirection, const std::vector<Entity*>& Entities, float Distance, glm::mat4&, glm::mat4&, const Frustum* ReceiverFrustum = nullptr, int MinLOD = 0);
 	}
 }
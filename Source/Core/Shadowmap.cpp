@@ -36,6 +36,11 @@ namespace Candela
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 
+    void Shadowmap::CopyFrom(const Shadowmap& other)
+    {
+        glCopyImageSubData(other.m_DepthMap, GL_TEXTURE_2D, 0, 0, 0, 0, m_DepthMap, GL_TEXTURE_2D, 0, 0, 0, 0, m_Width, m_Height, 1);
+    }
+
     Shadowmap::~Shadowmap()
     {
         glDeleteTextures(1, &m_DepthMap);
@@ -37,6 +37,9 @@ namespace Candela
 
 		void Create(int,int);
 
+		// Copies the depth of another shadow map of the same size
+		void CopyFrom(const Shadowmap& other);
+
 		inline GLuint GetDepthTexture() const
 		{
 			return m_DepthMap;
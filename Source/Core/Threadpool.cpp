@@ -1,2 +1,169 @@
 #include "Threadpool.h"
 
+#include <atomic>
+#include <algorithm>
+#include <deque>
+
+namespace Candela {
+
+	struct ParallelJob {
+		const std::function<void(int, int, int)>* Function;
+		int Count;
+		int ChunkCount;
+		int ChunkSize;
+		std::atomic<int> NextChunk;
+		std::atomic<int> FinishedChunks;
+		int Workers; // Guarded by the pool mutex
+	};
+
+	// Started on first use and shared by every ParallelFor call
+	class ParallelPool {
+
+	public :
+
+		ParallelPool() {
+			int ThreadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+
+			for (int t = 1; t < ThreadCount; t++) {
+				m_Threads.push_back(std::thread(&ParallelPool::ThreadLoop, this));
+			}
+		}
+
+		~ParallelPool() {
+			{
+				std::unique_lock<std::mutex> Lock(m_Mutex);
+				m_ShouldTerminate = true;
+			}
+
+			m_WorkCondition.notify_all();
+
+			for (auto& Thread : m_Threads) {
+				Thread.join();
+			}
+		}
+
+		int GetThreadCount() const {
+			return (int)m_Threads.size() + 1;
+		}
+
+		void Run(ParallelJob& Job) {
+			{
+				std::unique_lock<std::mutex> Lock(m_Mutex);
+				m_Jobs.push_back(&Job);
+			}
+
+			m_WorkCondition.notify_all();
+
+			RunChunks(Job);
+
+			std::unique_lock<std::mutex> Lock(m_Mutex);
+
+			// Workers still holding the job keep it alive until they let go of it
+			m_DoneCondition.wait(Lock, [&Job] {
+				return Job.FinishedChunks.load() == Job.ChunkCount && Job.Workers == 0;
+			});
+
+			auto Position = std::find(m_Jobs.begin(), m_Jobs.end(), &Job);
+
+			if (Position != m_Jobs.end()) {
+				m_Jobs.erase(Position);
+			}
+		}
+
+	private :
+
+		static void RunChunks(ParallelJob& Job) {
+			int Chunk;
+
+			while ((Chunk = Job.NextChunk.fetch_add(1)) < Job.ChunkCount) {
+				int Start = std::min(Chunk * Job.ChunkSize, Job.Count);
+				int End = std::min(Start + Job.ChunkSize, Job.Count);
+				(*Job.Function)(Chunk, Start, End);
+				Job.FinishedChunks.fetch_add(1);
+			}
+		}
+
+		void ThreadLoop() {
+			while (true) {
+
+				ParallelJob* Job;
+
+				{
+					std::unique_lock<std::mutex> Lock(m_Mutex);
+
+					m_WorkCondition.wait(Lock, [this] {
+						return !m_Jobs.empty() || m_ShouldTerminate;
+					});
+
+					if (m_ShouldTerminate) {
+						return;
+					}
+
+					Job = m_Jobs.front();
+
+					// Every chunk has been handed out, the submitting thread waits for the rest
+					if (Job->NextChunk.load() >= Job->ChunkCount) {
+						m_Jobs.pop_front();
+						continue;
+					}
+
+					Job->Workers++;
+				}
+
+				RunChunks(*Job);
+
+				{
+					std::unique_lock<std::mutex> Lock(m_Mutex);
+					Job->Workers--;
+				}
+
+				m_DoneCondition.notify_all();
+			}
+		}
+
+		bool m_ShouldTerminate = false;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_WorkCondition;
+		std::condition_variable m_DoneCondition;
+		std::vector<std::thread> m_Threads;
+		std::deque<ParallelJob*> m_Jobs;
+	};
+
+	static ParallelPool& GetParallelPool() {
+		static ParallelPool Pool;
+		return Pool;
+	}
+
+	int GetParallelThreadCount()
+	{
+		return GetParallelPool().GetThreadCount();
+	}
+
+	void ParallelFor(int Count, int ChunkCount, const std::function<void(int, int, int)>& Function)
+	{
+		ChunkCount = std::max(std::min(ChunkCount, Count), 1);
+
+		if (ChunkCount == 1 || GetParallelThreadCount() == 1) {
+			int ChunkSize = (Count + ChunkCount - 1) / ChunkCount;
+
+			for (int c = 0; c < ChunkCount; c++) {
+				int Start = std::min(c * ChunkSize, Count);
+				Function(c, Start, std::min(Start + ChunkSize, Count));
+			}
+
+			return;
+		}
+
+		ParallelJob Job;
+		Job.Function = &Function;
+		Job.Count = Count;
+		Job.ChunkCount = ChunkCount;
+		Job.ChunkSize = (Count + ChunkCount - 1) / ChunkCount;
+		Job.NextChunk = 0;
+		Job.FinishedChunks = 0;
+		Job.Workers = 0;
+
+		GetParallelPool().Run(Job);
+	}
+}
@@ -111,4 +111,11 @@ namespace Candela {
 		}
 	}
 
+	// Number of threads ParallelFor spreads work over, the calling thread included
+	int GetParallelThreadCount();
+
+	// Splits [0, Count) into ChunkCount contiguous chunks and runs Function(Chunk, Start, End) for each of them on a persistent worker pool
+	// The calling thread works on chunks too and returns once all of them are done, it's safe to call from several threads at once
+	void ParallelFor(int Count, int ChunkCount, const std::function<void(int, int, int)>& Function);
+
 }
\ No newline at end of file
@@ -12,3 +12,31 @@ struct CommonUniforms {
 };
 
 
+
+// std140 mirrors of the shared uniform blocks (Shaders/Include/CommonUniforms.glsl)
+// vec3s are padded out to 16 bytes by packing a scalar into the fourth component 
+
+#define UBO_COMMON_UNIFORMS_BINDING 0
+#define UBO_SHADOW_UNIFORMS_BINDING 1
+
+struct CommonUniformsUBO {
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::mat4 InverseView;
+	glm::mat4 InverseProjection;
+	glm::mat4 PrevView;
+	glm::mat4 PrevProjection;
+	glm::mat4 PrevInverseView;
+	glm::mat4 PrevInverseProjection;
+	glm::vec4 ViewerPositionTime; // xyz : viewer position, w : time 
+	glm::vec4 SunDirectionFrame; // xyz : sun direction, w : frame (int bits)
+	glm::vec4 ClipPlanes; // x : near, y : far 
+};
+
+struct ShadowUniformsUBO {
+	glm::mat4 ShadowMatrices[5];
+	glm::vec4 ShadowClipPlanes[5]; // std140 pads float arrays to a 16 byte stride
+};
+
+static_assert(sizeof(CommonUniformsUBO) == 560, "CommonUniformsUBO does not match the std140 layout");
+static_assert(sizeof(ShadowUniformsUBO) == 400, "ShadowUniformsUBO does not match the std140 layout");
@@ -1,7 +1,10 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glad/glad.h>
 
+#include "../Shaders/Include/VertexFormat.h"
+
 namespace Candela
 {
 	struct Vertex
@@ -10,4 +13,59 @@ namespace Candela
 		glm::uvec3 normal_tangent_data;
 		GLuint texcoords;
 	};
-}
\ No newline at end of file
+
+	// 16 byte quantized vertex, layout is described in Shaders/Include/VertexFormat.h
+	struct CompactVertex
+	{
+		glm::uvec4 data;
+	};
+
+	// Matches UnitVectorToOctahedron() in Shaders/Include/Octahedral.glsl
+	inline glm::vec2 EncodeOctahedron(glm::vec3 dir)
+	{
+		float Length = glm::abs(dir.x) + glm::abs(dir.y) + glm::abs(dir.z);
+
+		if (Length < 1e-6f) {
+			return glm::vec2(0.5f, 1.0f);
+		}
+
+		dir /= Length;
+
+		// Lower hemisphere
+		if (dir.y < 0.0f) {
+			glm::vec2 Original = glm::vec2(dir.x, dir.z);
+			dir.x = (Original.x >= 0.0f ? 1.0f : -1.0f) * (1.0f - glm::abs(Original.y));
+			dir.z = (Original.y >= 0.0f ? 1.0f : -1.0f) * (1.0f - glm::abs(Original.x));
+		}
+
+		return glm::clamp(0.5f * glm::vec2(dir.x, dir.z) + 0.5f, 0.0f, 1.0f);
+	}
+
+	// Positions are quantized relative to min, scale is (max - min) / 65535
+	inline CompactVertex PackCompactVertex(const Vertex& vertex, const glm::vec3& min, const glm::vec3& scale)
+	{
+		glm::vec2 Data_0 = glm::unpackHalf2x16(vertex.normal_tangent_data.x);
+		glm::vec2 Data_1 = glm::unpackHalf2x16(vertex.normal_tangent_data.y);
+		glm::vec2 Data_2 = glm::unpackHalf2x16(vertex.normal_tangent_data.z);
+		glm::vec3 Normal = glm::vec3(Data_0.x, Data_0.y, Data_1.x);
+		glm::vec3 Tangent = glm::vec3(Data_1.y, Data_2.x, Data_2.y);
+
+		glm::vec3 Quantized = glm::round((glm::vec3(vertex.position) - min) / scale);
+		glm::uvec3 Position = glm::uvec3(glm::clamp(Quantized, glm::vec3(0.0f), glm::vec3(65535.0f)));
+
+		glm::vec2 OctTangent = glm::round(EncodeOctahedron(Tangent) * 255.0f);
+
+		CompactVertex Packed;
+		Packed.data.x = Position.x | (Position.y << 16);
+		Packed.data.y = Position.z | (GLuint(OctTangent.x) << 16) | (GLuint(OctTangent.y) << 24);
+		Packed.data.z = glm::packUnorm2x16(EncodeOctahedron(Normal));
+		Packed.data.w = vertex.texcoords;
+		return Packed;
+	}
+
+	// Dequantization scale for a set of bounds, degenerate axes keep a non zero scale
+	inline glm::vec3 GetDequantizeScale(const glm::vec3& min, const glm::vec3& max)
+	{
+		return glm::max((max - min) / 65535.0f, glm::vec3(1e-7f));
+	}
+}
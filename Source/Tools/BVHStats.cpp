@@ -0,0 +1,511 @@
+/*
+	BVH quality and traversal statistics
+
+	Loads a model (no window or GL context), builds its BVH with every available strategy and reports build time, node count,
+	depth, SAH cost and the leaf size histogram. A fixed set of primary and diffuse rays is then traced on the CPU through the
+	flattened stackless layout, the same way Intersectors/TraverseBVHStackless.glsl walks it, to count nodes/triangles visited per ray.
+
+	The same rays are traced through the stack layout (Intersectors/TraverseBVHStack.glsl) in breadth first order and laid out in
+	treelets (see BVH::LayoutTreelets), both have to return the same hits. Every layout reports the distinct cache lines a ray's
+	nodes span next to the nodes it visits.
+
+	Usage : candela-bvhstats <model path> [--rays <primary rays per cube face side>] [--line <cache line bytes>] [--csv <path>]
+
+	Primary rays start at the center of the model's bounds and cover all 6 cube faces, every primary hit spawns one cosine
+	distributed diffuse ray. Everything is seeded, so runs are comparable across builds.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <glm/glm.hpp>
+
+#include "../Core/BVH/BVHConstructor.h"
+
+using namespace Candela;
+
+struct Strategy {
+	const char* Name;
+	BVH::BuildMode Mode;
+	bool Use63BitCodes;
+	int ClusterBits;
+	bool Treelets;
+};
+
+static const Strategy Strategies[] = {
+	{ "SAH", BVH::BuildMode::SAH, true, 0, false },
+	{ "SAH+Treelets", BVH::BuildMode::SAH, true, 0, true },
+	{ "LBVH30", BVH::BuildMode::LBVH, false, 0, false },
+	{ "LBVH63", BVH::BuildMode::LBVH, true, 0, false },
+	{ "LBVH63+Clusters15", BVH::BuildMode::LBVH, true, 15, false },
+	{ "LBVH63+Treelets", BVH::BuildMode::LBVH, true, 0, true }
+};
+
+// Every leaf length the packed leaf format can hold
+static const int LEAF_SIZE_COUNT = BVH_LEAF_LENGTH_MASK + 1;
+
+struct TraversalStats {
+	uint64_t Rays = 0;
+	uint64_t Hits = 0;
+	uint64_t NodesVisited = 0;
+	uint64_t TrianglesTested = 0;
+	uint64_t LinesTouched = 0;
+};
+
+struct Hit {
+	float T;
+	int Triangle;
+};
+
+static bool LoadModel(const std::string& Path, std::vector<Vertex>& oVertices, std::vector<GLuint>& oIndices, std::vector<int>& oMeshIDs) {
+
+	Assimp::Importer importer;
+
+	const aiScene* Scene = importer.ReadFile(Path, aiProcess_JoinIdenticalVertices | aiProcess_Triangulate);
+
+	if (!Scene || !Scene->mRootNode) {
+		std::cout << "\nCouldn't load " << Path << " : " << importer.GetErrorString() << "\n";
+		return false;
+	}
+
+	for (unsigned int m = 0; m < Scene->mNumMeshes; m++) {
+
+		const aiMesh* Mesh = Scene->mMeshes[m];
+		GLuint IndexOffset = oVertices.size();
+
+		for (unsigned int v = 0; v < Mesh->mNumVertices; v++) {
+			Vertex vertex = {};
+			vertex.position = glm::vec4(Mesh->mVertices[v].x, Mesh->mVertices[v].y, Mesh->mVertices[v].z, 1.0f);
+			oVertices.push_back(vertex);
+		}
+
+		for (unsigned int f = 0; f < Mesh->mNumFaces; f++) {
+
+			if (Mesh->mFaces[f].mNumIndices != 3) {
+				continue;
+			}
+
+			for (int i = 0; i < 3; i++) {
+				oIndices.push_back(IndexOffset + Mesh->mFaces[f].mIndices[i]);
+			}
+
+			oMeshIDs.push_back(m);
+		}
+	}
+
+	return !oIndices.empty();
+}
+
+static void IntersectLeaf(int Packed, const std::vector<BVH::Triangle>& Triangles, const std::vector<Vertex>& Vertices, const glm::vec3& Origin, const glm::vec3& Direction, Hit& Result, TraversalStats& Stats) {
+
+	for (int i = Packed >> BVH_LEAF_LENGTH_BITS; i < (Packed >> BVH_LEAF_LENGTH_BITS) + (Packed & BVH_LEAF_LENGTH_MASK); i++) {
+
+		const BVH::Triangle& triangle = Triangles[i];
+		Stats.TrianglesTested++;
+
+		float T = BVH::IntersectTriangle(Origin, Direction, glm::vec3(Vertices[triangle.PackedData[0]].position), glm::vec3(Vertices[triangle.PackedData[1]].position), glm::vec3(Vertices[triangle.PackedData[2]].position));
+
+		if (T > 0.0f && T < Result.T) {
+			Result.T = T;
+			Result.Triangle = i;
+		}
+	}
+}
+
+// Entry distance (exit distance when the origin is inside), -1 on a miss, same as RayBounds() in the stack traversal
+static float BoundsDistance(const glm::vec4& Min, const glm::vec4& Max, const glm::vec3& Origin, const glm::vec3& InverseDirection, float TMax) {
+	glm::vec3 T0 = (glm::vec3(Min) - Origin) * InverseDirection;
+	glm::vec3 T1 = (glm::vec3(Max) - Origin) * InverseDirection;
+	glm::vec3 Near = glm::min(T0, T1);
+	glm::vec3 Far = glm::max(T0, T1);
+	float TNear = glm::max(glm::max(Near.x, Near.y), glm::max(Near.z, 0.0f));
+	float TFar = glm::min(glm::min(Far.x, Far.y), glm::min(Far.z, TMax));
+	return TFar >= TNear ? (TNear > 0.0f ? TNear : TFar) : -1.0f;
+}
+
+// Distinct cache lines spanned by the nodes a ray visited, the node array starts on a line
+static uint64_t CountLines(std::vector<int>& VisitedNodes, int NodeBytes, int LineBytes) {
+
+	for (int& Node : VisitedNodes) {
+		Node = int(int64_t(Node) * NodeBytes / LineBytes);
+	}
+
+	std::sort(VisitedNodes.begin(), VisitedNodes.end());
+	return std::unique(VisitedNodes.begin(), VisitedNodes.end()) - VisitedNodes.begin();
+}
+
+// Walks the stackless layout : a hit inner node continues with the next node (its left child), a miss or a leaf follows the miss link
+static Hit Trace(const std::vector<BVH::FlattenedNode>& Nodes, const std::vector<BVH::Triangle>& Triangles, const std::vector<Vertex>& Vertices, const glm::vec3& Origin, const glm::vec3& Direction, int LineBytes, TraversalStats& Stats) {
+
+	Hit Result = { 1e30f, -1 };
+
+	glm::vec3 InverseDirection = 1.0f / Direction;
+	int Pointer = 0;
+
+	std::vector<int> VisitedNodes;
+
+	Stats.Rays++;
+
+	while (Pointer >= 0) {
+
+		const BVH::FlattenedNode& Node = Nodes[Pointer];
+		Stats.NodesVisited++;
+		VisitedNodes.push_back(Pointer);
+
+		if (!BVH::IntersectBounds(glm::vec3(Node.Min), glm::vec3(Node.Max), Origin, InverseDirection, Result.T)) {
+			Pointer = glm::floatBitsToInt(Node.Max.w);
+			continue;
+		}
+
+		int Packed = glm::floatBitsToInt(Node.Min.w);
+
+		if (Packed == -1) {
+			Pointer++;
+			continue;
+		}
+
+		IntersectLeaf(Packed, Triangles, Vertices, Origin, Direction, Result, Stats);
+		Pointer = glm::floatBitsToInt(Node.Max.w);
+	}
+
+	Stats.Hits += Result.Triangle >= 0 ? 1 : 0;
+	Stats.LinesTouched += CountLines(VisitedNodes, sizeof(BVH::FlattenedNode), LineBytes);
+	return Result;
+}
+
+// Walks the stack layout : leaf children are intersected right away, when both inner children are hit the closer one is visited first
+static Hit Trace(const std::vector<BVH::FlattenedStackNode>& Nodes, const std::vector<BVH::Triangle>& Triangles, const std::vector<Vertex>& Vertices, const glm::vec3& Origin, const glm::vec3& Direction, int LineBytes, TraversalStats& Stats) {
+
+	Hit Result = { 1e30f, -1 };
+
+	glm::vec3 InverseDirection = 1.0f / Direction;
+
+	std::vector<int> Stack = { 0 };
+	std::vector<int> VisitedNodes;
+
+	Stats.Rays++;
+
+	while (!Stack.empty()) {
+
+		int Pointer = Stack.back();
+		Stack.pop_back();
+
+		const BVH::FlattenedStackNode& Node = Nodes[Pointer];
+		Stats.NodesVisited++;
+		VisitedNodes.push_back(Pointer);
+
+		const BVH::FBounds* Children[2] = { &Node.LBounds, &Node.RBounds };
+		float Distances[2];
+
+		// Both children are culled against the closest hit so far before any leaf is intersected
+		for (int c = 0; c < 2; c++) {
+			bool Leaf = glm::floatBitsToInt(Children[c]->Min.w) != -1;
+			Distances[c] = Leaf ? -1.0f : BoundsDistance(Children[c]->Min, Children[c]->Max, Origin, InverseDirection, Result.T);
+		}
+
+		for (int c = 0; c < 2; c++) {
+			if (glm::floatBitsToInt(Children[c]->Min.w) != -1) {
+				IntersectLeaf(glm::floatBitsToInt(Children[c]->Min.w), Triangles, Vertices, Origin, Direction, Result, Stats);
+			}
+		}
+
+		// Pushed last, popped first
+		int Near = Distances[1] < Distances[0] ? 1 : 0;
+
+		for (int c : { 1 - Near, Near }) {
+			if (Distances[c] > 0.0f) {
+				Stack.push_back(glm::floatBitsToInt(Children[c]->Max.w));
+			}
+		}
+	}
+
+	Stats.Hits += Result.Triangle >= 0 ? 1 : 0;
+	Stats.LinesTouched += CountLines(VisitedNodes, sizeof(BVH::FlattenedStackNode), LineBytes);
+	return Result;
+}
+
+// Every ray's hit is appended to oHits, primary and diffuse rays interleaved
+template<typename NodeType>
+static void TraceRays(const std::vector<NodeType>& Nodes, const std::vector<BVH::Triangle>& Triangles, const std::vector<Vertex>& Vertices, const glm::vec3& BoundsMin, const glm::vec3& BoundsMax, int Resolution, int LineBytes, TraversalStats& Primary, TraversalStats& Diffuse, std::vector<Hit>& oHits) {
+
+	glm::vec3 Center = (BoundsMin + BoundsMax) * 0.5f;
+	glm::vec3 Extent = BoundsMax - BoundsMin;
+	float Epsilon = glm::max(glm::max(Extent.x, Extent.y), Extent.z) * 1e-5f;
+
+	for (int Face = 0; Face < 6; Face++) {
+
+		glm::vec3 Forward = glm::vec3(0.0f);
+		Forward[Face / 2] = Face % 2 == 0 ? 1.0f : -1.0f;
+
+		glm::vec3 Up = Face / 2 == 1 ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::vec3 Right = glm::normalize(glm::cross(Forward, Up));
+		Up = glm::cross(Right, Forward);
+
+		for (int y = 0; y < Resolution; y++) {
+			for (int x = 0; x < Resolution; x++) {
+
+				glm::vec2 Screen = (glm::vec2(x, y) + 0.5f) / float(Resolution) * 2.0f - 1.0f;
+				glm::vec3 Direction = glm::normalize(Forward + Right * Screen.x + Up * Screen.y);
+
+				Hit PrimaryHit = Trace(Nodes, Triangles, Vertices, Center, Direction, LineBytes, Primary);
+				oHits.push_back(PrimaryHit);
+
+				if (PrimaryHit.Triangle < 0) {
+					continue;
+				}
+
+				const BVH::Triangle& triangle = Triangles[PrimaryHit.Triangle];
+				glm::vec3 V0 = glm::vec3(Vertices[triangle.PackedData[0]].position);
+				glm::vec3 V1 = glm::vec3(Vertices[triangle.PackedData[1]].position);
+				glm::vec3 V2 = glm::vec3(Vertices[triangle.PackedData[2]].position);
+
+				glm::vec3 Normal = glm::cross(V1 - V0, V2 - V0);
+
+				if (glm::dot(Normal, Normal) < 1e-20f) {
+					continue;
+				}
+
+				Normal = glm::normalize(Normal);
+				Normal = glm::dot(Normal, Direction) > 0.0f ? -Normal : Normal;
+
+				// Cosine distributed around the normal
+				uint32_t Seed = uint32_t((Face * Resolution + y) * Resolution + x) * 2u;
+				float Radius = glm::sqrt(BVH::HashFloat(Seed));
+				float Phi = BVH::HashFloat(Seed + 1u) * 6.28318530718f;
+
+				glm::vec3 Tangent = glm::normalize(glm::abs(Normal.x) > 0.9f ? glm::cross(Normal, glm::vec3(0.0f, 1.0f, 0.0f)) : glm::cross(Normal, glm::vec3(1.0f, 0.0f, 0.0f)));
+				glm::vec3 Bitangent = glm::cross(Normal, Tangent);
+				glm::vec3 DiffuseDirection = glm::normalize(Tangent * Radius * glm::cos(Phi) + Bitangent * Radius * glm::sin(Phi) + Normal * glm::sqrt(glm::max(1.0f - Radius * Radius, 0.0f)));
+
+				glm::vec3 Position = Center + Direction * PrimaryHit.T + Normal * Epsilon;
+				oHits.push_back(Trace(Nodes, Triangles, Vertices, Position, DiffuseDirection, LineBytes, Diffuse));
+			}
+		}
+	}
+}
+
+static void MeasureTree(const BVH::Node* Node, int Depth, int& oMaxDepth, std::vector<int>& oLeafHistogram) {
+
+	oMaxDepth = glm::max(oMaxDepth, Depth);
+
+	if (Node->IsLeafNode) {
+		oLeafHistogram[glm::min((int)Node->Length, (int)oLeafHistogram.size() - 1)]++;
+		return;
+	}
+
+	MeasureTree(Node->LeftChildPtr, Depth + 1, oMaxDepth, oLeafHistogram);
+	MeasureTree(Node->RightChildPtr, Depth + 1, oMaxDepth, oLeafHistogram);
+}
+
+static float PerRay(uint64_t Count, uint64_t Rays) {
+	return Rays == 0 ? 0.0f : float(double(Count) / double(Rays));
+}
+
+static void PrintTraversal(const char* Name, const TraversalStats& Stats) {
+	std::cout << "\n" << Name << " Rays : " << Stats.Rays << "    Nodes/Ray : " << PerRay(Stats.NodesVisited, Stats.Rays) << "    Lines/Ray : " << PerRay(Stats.LinesTouched, Stats.Rays);
+	std::cout << "    Triangles/Ray : " << PerRay(Stats.TrianglesTested, Stats.Rays) << "    Hit Rate : " << PerRay(Stats.Hits, Stats.Rays);
+}
+
+static int CountMismatches(const std::vector<Hit>& A, const std::vector<Hit>& B) {
+
+	if (A.size() != B.size()) {
+		return glm::max(A.size(), B.size());
+	}
+
+	int Mismatches = 0;
+
+	for (int i = 0; i < (int)A.size(); i++) {
+		Mismatches += A[i].Triangle != B[i].Triangle || A[i].T != B[i].T ? 1 : 0;
+	}
+
+	return Mismatches;
+}
+
+int main(int argc, char** argv)
+{
+	std::string ModelPath;
+	std::string CSVPath;
+	int Resolution = 128;
+	int LineBytes = 128;
+
+	for (int i = 1; i < argc; i++) {
+
+		std::string Arg = argv[i];
+		bool HasValue = i + 1 < argc;
+
+		if (Arg == "--rays" && HasValue) {
+			Resolution = glm::max(std::atoi(argv[++i]), 1);
+		}
+
+		else if (Arg == "--line" && HasValue) {
+			LineBytes = glm::max(std::atoi(argv[++i]), 1);
+		}
+
+		else if (Arg == "--csv" && HasValue) {
+			CSVPath = argv[++i];
+		}
+
+		else if (ModelPath.empty()) {
+			ModelPath = Arg;
+		}
+
+		else {
+			std::cout << "\nUnknown or incomplete argument : " << Arg << "\n";
+		}
+	}
+
+	if (ModelPath.empty()) {
+		std::cout << "Usage : candela-bvhstats <model path> [--rays <primary rays per cube face side>] [--line <cache line bytes>] [--csv <path>]\n";
+		return 1;
+	}
+
+	std::vector<Vertex> Vertices;
+	std::vector<GLuint> Indices;
+	std::vector<int> MeshIDs;
+
+	if (!LoadModel(ModelPath, Vertices, Indices, MeshIDs)) {
+		return 1;
+	}
+
+	std::cout << "\nModel : " << ModelPath << "    Triangles : " << Indices.size() / 3 << "    Vertices : " << Vertices.size() << "\n";
+
+	std::ofstream CSV;
+
+	if (!CSVPath.empty()) {
+		CSV.open(CSVPath);
+		CSV << "strategy,build_ms,nodes,depth,sah_cost,primary_nodes_per_ray,primary_triangles_per_ray,primary_hit_rate,diffuse_nodes_per_ray,diffuse_triangles_per_ray,diffuse_hit_rate,primary_lines_per_ray,diffuse_lines_per_ray";
+		CSV << ",stack_primary_nodes_per_ray,stack_bfs_primary_lines_per_ray,stack_treelet_primary_lines_per_ray,stack_diffuse_nodes_per_ray,stack_bfs_diffuse_lines_per_ray,stack_treelet_diffuse_lines_per_ray";
+
+		for (int i = 1; i < LEAF_SIZE_COUNT; i++) {
+			CSV << ",leaves_" << i;
+		}
+
+		CSV << "\n";
+	}
+
+	// The stack layout is built breadth first and laid out here, so both orders come from the same tree
+	BVH::ConfigureNodeLayout(0);
+
+	int TotalMismatches = 0;
+
+	for (const Strategy& strategy : Strategies) {
+
+		BVH::ConfigureLBVH(strategy.Use63BitCodes, strategy.ClusterBits);
+		BVH::ConfigureTreeletOptimization(strategy.Treelets, 60000.0f);
+
+		std::vector<BVH::FlattenedNode> Nodes;
+		std::vector<BVH::Triangle> Triangles;
+
+		size_t OrderingCount = BVH::GetChildOrderingStats().size();
+
+		auto Start = std::chrono::steady_clock::now();
+		BVH::Node* RootNode = BVH::BuildBVH(Vertices, Indices, MeshIDs, Nodes, Triangles, 0, strategy.Mode);
+		auto End = std::chrono::steady_clock::now();
+
+		float BuildTime = std::chrono::duration<float, std::milli>(End - Start).count();
+
+		int MaxDepth = 0;
+		std::vector<int> LeafHistogram(LEAF_SIZE_COUNT, 0);
+		MeasureTree(RootNode, 1, MaxDepth, LeafHistogram);
+		BVH::DeleteBVH(RootNode);
+
+		float SAHCost = BVH::GetFlattenedSAHCost(Nodes.data(), Nodes.size());
+
+		glm::vec3 BoundsMin = glm::vec3(Nodes[0].Min);
+		glm::vec3 BoundsMax = glm::vec3(Nodes[0].Max);
+
+		TraversalStats Primary;
+		TraversalStats Diffuse;
+		std::vector<Hit> Hits;
+		TraceRays(Nodes, Triangles, Vertices, BoundsMin, BoundsMax, Resolution, LineBytes, Primary, Diffuse, Hits);
+
+		std::vector<BVH::FlattenedStackNode> StackNodes;
+		std::vector<BVH::Triangle> StackTriangles;
+		BVH::DeleteBVH(BVH::BuildBVH(Vertices, Indices, MeshIDs, StackNodes, StackTriangles, 0, strategy.Mode));
+
+		TraversalStats StackPrimary;
+		TraversalStats StackDiffuse;
+		std::vector<Hit> StackHits;
+		TraceRays(StackNodes, StackTriangles, Vertices, BoundsMin, BoundsMax, Resolution, LineBytes, StackPrimary, StackDiffuse, StackHits);
+
+		int BreadthFirstNodes = StackNodes.size();
+		BVH::LayoutTreelets(StackNodes, LineBytes);
+
+		TraversalStats TreeletPrimary;
+		TraversalStats TreeletDiffuse;
+		std::vector<Hit> TreeletHits;
+		TraceRays(StackNodes, StackTriangles, Vertices, BoundsMin, BoundsMax, Resolution, LineBytes, TreeletPrimary, TreeletDiffuse, TreeletHits);
+
+		// Only the node order changed, so every ray has to hit the same triangle at the same distance
+		int Mismatches = CountMismatches(StackHits, TreeletHits);
+		TotalMismatches += Mismatches;
+
+		std::cout << "\n--" << strategy.Name << "--";
+		std::cout << "\nBuild Time : " << BuildTime << " ms";
+		std::cout << "\nNode Count : " << Nodes.size();
+		std::cout << "\nMax Depth : " << MaxDepth;
+		std::cout << "\nSAH Cost : " << SAHCost;
+		std::cout << "\nLeaf Sizes :";
+
+		for (int i = 1; i < LEAF_SIZE_COUNT; i++) {
+			if (LeafHistogram[i] > 0) {
+				std::cout << " " << i << " : " << LeafHistogram[i];
+			}
+		}
+
+		// Only stackless SAH builds pick a child ordering
+		if (BVH::GetChildOrderingStats().size() > OrderingCount) {
+
+			const BVH::ChildOrderingStats& Ordering = BVH::GetChildOrderingStats().back();
+			std::cout << "\nChild Ordering (" << Ordering.SampleRays << " sample rays, nodes/ray) :";
+
+			for (int o = 0; o < BVH::CHILD_ORDERING_COUNT; o++) {
+				std::cout << " " << BVH::GetChildOrderingName(static_cast<BVH::ChildOrdering>(o)) << " : " << Ordering.AverageNodesVisited[o];
+			}
+
+			std::cout << "    Chosen : " << BVH::GetChildOrderingName(Ordering.Chosen);
+		}
+
+		PrintTraversal("Primary", Primary);
+		PrintTraversal("Diffuse", Diffuse);
+
+		std::cout << "\nStack Layout : " << BreadthFirstNodes << " nodes breadth first, " << StackNodes.size() << " nodes in treelets of " << LineBytes << " bytes";
+		PrintTraversal("  Breadth First Primary", StackPrimary);
+		PrintTraversal("  Breadth First Diffuse", StackDiffuse);
+		PrintTraversal("  Treelets Primary", TreeletPrimary);
+		PrintTraversal("  Treelets Diffuse", TreeletDiffuse);
+		std::cout << "\n  Layout Mismatches : " << Mismatches;
+		std::cout << "\n";
+
+		if (CSV.is_open()) {
+			CSV << strategy.Name << "," << BuildTime << "," << Nodes.size() << "," << MaxDepth << "," << SAHCost << ",";
+			CSV << PerRay(Primary.NodesVisited, Primary.Rays) << "," << PerRay(Primary.TrianglesTested, Primary.Rays) << "," << PerRay(Primary.Hits, Primary.Rays) << ",";
+			CSV << PerRay(Diffuse.NodesVisited, Diffuse.Rays) << "," << PerRay(Diffuse.TrianglesTested, Diffuse.Rays) << "," << PerRay(Diffuse.Hits, Diffuse.Rays) << ",";
+			CSV << PerRay(Primary.LinesTouched, Primary.Rays) << "," << PerRay(Diffuse.LinesTouched, Diffuse.Rays) << ",";
+			CSV << PerRay(StackPrimary.NodesVisited, StackPrimary.Rays) << "," << PerRay(StackPrimary.LinesTouched, StackPrimary.Rays) << "," << PerRay(TreeletPrimary.LinesTouched, TreeletPrimary.Rays) << ",";
+			CSV << PerRay(StackDiffuse.NodesVisited, StackDiffuse.Rays) << "," << PerRay(StackDiffuse.LinesTouched, StackDiffuse.Rays) << "," << PerRay(TreeletDiffuse.LinesTouched, TreeletDiffuse.Rays);
+
+			for (int i = 1; i < LEAF_SIZE_COUNT; i++) {
+				CSV << "," << LeafHistogram[i];
+			}
+
+			CSV << "\n";
+		}
+	}
+
+	if (TotalMismatches > 0) {
+		std::cout << "\nTreelet layout changed " << TotalMismatches << " hits\n";
+		return 1;
+	}
+
+	return 0;
+}
@@ -12,6 +12,10 @@ General :
 Read controls.txt for controls
 "UNIFORM NOT FOUND" errors can safely be ignored.
 
+Benchmark :
+Run with "--record <path>" to record a camera path, "--benchmark <path>" to replay it.
+See Core/Benchmark.h for the rest of the options.
+
 
 
 
@@ -19,9 +23,11 @@ PLEASE DO NOT CLAIM MY WORK AS YOUR OWN.
 */
 
 #include "Core/Pipeline.h"
+#include "Core/Benchmark.h"
 
-int main()
+int main(int argc, char** argv)
 {
+	Candela::Benchmark::ParseArguments(argc, argv);
 	Candela::StartPipeline();
 }
 